@@ -985,6 +985,7 @@ void sphore_init(SEMAPHORE *sem)
 	*sem = CreateSemaphore(0, 0, 10000, 0);
 }
 void sphore_wait(SEMAPHORE *sem) { WaitForSingleObject((HANDLE)*sem, INFINITE); }
+bool sphore_trywait(SEMAPHORE *sem) { return WaitForSingleObject((HANDLE)*sem, 0) == WAIT_OBJECT_0; }
 void sphore_signal(SEMAPHORE *sem) { ReleaseSemaphore((HANDLE)*sem, 1, NULL); }
 void sphore_destroy(SEMAPHORE *sem) { CloseHandle((HANDLE)*sem); }
 #elif defined(CONF_PLATFORM_MACOS)
@@ -997,6 +998,7 @@ void sphore_init(SEMAPHORE *sem)
 		dbg_msg("sphore", "init failed: %d", errno);
 }
 void sphore_wait(SEMAPHORE *sem) { sem_wait(*sem); }
+bool sphore_trywait(SEMAPHORE *sem) { return sem_trywait(*sem) == 0; }
 void sphore_signal(SEMAPHORE *sem) { sem_post(*sem); }
 void sphore_destroy(SEMAPHORE *sem)
 {
@@ -1022,6 +1024,16 @@ void sphore_wait(SEMAPHORE *sem)
 	} while(errno == EINTR);
 }
 
+bool sphore_trywait(SEMAPHORE *sem)
+{
+	int Result;
+	do
+	{
+		Result = sem_trywait(sem);
+	} while(Result != 0 && errno == EINTR);
+	return Result == 0;
+}
+
 void sphore_signal(SEMAPHORE *sem)
 {
 	if(sem_post(sem) != 0)
@@ -728,6 +728,16 @@ void sphore_init(SEMAPHORE *sem);
  * @ingroup Locks
  */
 void sphore_wait(SEMAPHORE *sem);
+/**
+ * Decrements the semaphore if it is positive, without blocking.
+ *
+ * @ingroup Locks
+ *
+ * @param sem Semaphore to decrement.
+ *
+ * @return `true` if the semaphore was decremented, `false` otherwise.
+ */
+bool sphore_trywait(SEMAPHORE *sem);
 /**
  * @ingroup Locks
  */
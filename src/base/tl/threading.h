@@ -21,6 +21,13 @@ public:
 		sphore_wait(&m_Sem);
 		m_Count.fetch_sub(1);
 	}
+	bool TryWait()
+	{
+		if(!sphore_trywait(&m_Sem))
+			return false;
+		m_Count.fetch_sub(1);
+		return true;
+	}
 	void Signal()
 	{
 		m_Count.fetch_add(1);
@@ -18,14 +18,25 @@ ERunCommandReturnTypes CCommandProcessorFragment_Null::RunCommand(const CCommand
 	case CCommandBuffer::CMD_TEXT_TEXTURE_UPDATE:
 		Cmd_TextTexture_Update(static_cast<const CCommandBuffer::SCommand_TextTexture_Update *>(pBaseCommand));
 		break;
+	case CCommandBuffer::CMD_CREATE_BUFFER_OBJECT:
+		Cmd_CreateBufferObject(static_cast<const CCommandBuffer::SCommand_CreateBufferObject *>(pBaseCommand));
+		break;
+	case CCommandBuffer::CMD_RECREATE_BUFFER_OBJECT:
+		Cmd_RecreateBufferObject(static_cast<const CCommandBuffer::SCommand_RecreateBufferObject *>(pBaseCommand));
+		break;
+	case CCommandBuffer::CMD_UPDATE_BUFFER_OBJECT:
+		Cmd_UpdateBufferObject(static_cast<const CCommandBuffer::SCommand_UpdateBufferObject *>(pBaseCommand));
+		break;
 	}
 	return ERunCommandReturnTypes::RUN_COMMAND_COMMAND_HANDLED;
 }
 
 bool CCommandProcessorFragment_Null::Cmd_Init(const SCommand_Init *pCommand)
 {
-	pCommand->m_pCapabilities->m_TileBuffering = false;
-	pCommand->m_pCapabilities->m_QuadBuffering = false;
+	// buffers are accepted and dropped, so that the map layers are prepared
+	// like with a real backend
+	pCommand->m_pCapabilities->m_TileBuffering = true;
+	pCommand->m_pCapabilities->m_QuadBuffering = true;
 	pCommand->m_pCapabilities->m_TextBuffering = false;
 	pCommand->m_pCapabilities->m_QuadContainerBuffering = false;
 
@@ -59,3 +70,21 @@ void CCommandProcessorFragment_Null::Cmd_TextTexture_Update(const CCommandBuffer
 {
 	free(pCommand->m_pData);
 }
+
+void CCommandProcessorFragment_Null::Cmd_CreateBufferObject(const CCommandBuffer::SCommand_CreateBufferObject *pCommand)
+{
+	if(pCommand->m_DeletePointer)
+		free(pCommand->m_pUploadData);
+}
+
+void CCommandProcessorFragment_Null::Cmd_RecreateBufferObject(const CCommandBuffer::SCommand_RecreateBufferObject *pCommand)
+{
+	if(pCommand->m_DeletePointer)
+		free(pCommand->m_pUploadData);
+}
+
+void CCommandProcessorFragment_Null::Cmd_UpdateBufferObject(const CCommandBuffer::SCommand_UpdateBufferObject *pCommand)
+{
+	if(pCommand->m_DeletePointer)
+		free(pCommand->m_pUploadData);
+}
@@ -1739,7 +1739,8 @@ void CClient::ProcessServerPacket(CNetChunk *pPacket, int Conn, bool Dummy)
 						m_pMapdownloadTask = HttpGetFile(pMapUrl ? pMapUrl : aUrl, Storage(), m_aMapdownloadFilenameTemp, IStorage::TYPE_SAVE);
 						m_pMapdownloadTask->Timeout(CTimeout{g_Config.m_ClMapDownloadConnectTimeoutMs, 0, g_Config.m_ClMapDownloadLowSpeedLimit, g_Config.m_ClMapDownloadLowSpeedTime});
 						m_pMapdownloadTask->MaxResponseSize(1024 * 1024 * 1024); // 1 GiB
-						Engine()->AddJob(m_pMapdownloadTask);
+						m_pMapdownloadTask->SetPriority(IJob::PRIORITY_HIGH);
+						HttpRun(m_pMapdownloadTask);
 					}
 					else
 						SendMapRequest();
@@ -3345,6 +3346,9 @@ void CClient::Run()
 	GameClient()->OnShutdown();
 	Disconnect();
 
+	// abort downloads, nothing waits for them anymore
+	HttpShutdown(0);
+
 	// close socket
 	for(unsigned int i = 0; i < std::size(m_aNetClient); i++)
 		m_aNetClient[i].Close();
@@ -4027,6 +4031,48 @@ void CClient::BenchmarkQuit(int Seconds, const char *pFilename)
 	m_BenchmarkStopTime = time_get() + time_freq() * Seconds;
 }
 
+void CClient::Con_BenchmarkText(IConsole::IResult *pResult, void *pUserData)
+{
+	CClient *pSelf = (CClient *)pUserData;
+	pSelf->BenchmarkText(pResult->NumArguments() ? maximum(pResult->GetInteger(0), 1) : 200);
+}
+
+void CClient::BenchmarkText(int Frames)
+{
+	float aPoints[4];
+	Graphics()->GetScreen(&aPoints[0], &aPoints[1], &aPoints[2], &aPoints[3]);
+	const int OldTextLayoutCache = g_Config.m_GfxTextLayoutCache;
+	for(int TextLayoutCache = 0; TextLayoutCache <= 1; TextLayoutCache++)
+	{
+		g_Config.m_GfxTextLayoutCache = TextLayoutCache;
+		const int64_t Start = time_get();
+		for(int Frame = 0; Frame < Frames; Frame++)
+		{
+			Graphics()->MapScreen(0, 0, 1600, 1000);
+			// a full scoreboard, only the pings change between frames
+			char aBuf[32];
+			for(int Row = 0; Row < MAX_CLIENTS; Row++)
+			{
+				const float y = 20.0f + Row * 15.0f;
+				str_format(aBuf, sizeof(aBuf), "%d", Row * 37 % 1000);
+				TextRender()->Text(200.0f, y, 12.0f, aBuf);
+				str_format(aBuf, sizeof(aBuf), "Player %d", Row);
+				TextRender()->Text(300.0f, y, 12.0f, aBuf);
+				str_format(aBuf, sizeof(aBuf), "Clan %d", Row % 8);
+				TextRender()->Text(700.0f, y, 12.0f, aBuf);
+				str_format(aBuf, sizeof(aBuf), "%d", (Row + Frame) % 300);
+				TextRender()->Text(1000.0f, y, 12.0f, aBuf);
+			}
+			Graphics()->Swap();
+			Graphics()->Clear(0, 0, 0);
+		}
+		const int64_t Time = time_get() - Start;
+		log_info("client", "text layout cache %s: %d frames, %.3fms per frame", TextLayoutCache ? "on" : "off", Frames, Time * 1000.0 / time_freq() / Frames);
+	}
+	g_Config.m_GfxTextLayoutCache = OldTextLayoutCache;
+	Graphics()->MapScreen(aPoints[0], aPoints[1], aPoints[2], aPoints[3]);
+}
+
 void CClient::UpdateAndSwap()
 {
 	Input()->Update();
@@ -4380,6 +4426,7 @@ void CClient::RegisterCommands()
 
 	m_pConsole->Register("save_replay", "?i[length] s[filename]", CFGFLAG_CLIENT, Con_SaveReplay, this, "Save a replay of the last defined amount of seconds");
 	m_pConsole->Register("benchmark_quit", "i[seconds] r[file]", CFGFLAG_CLIENT | CFGFLAG_STORE, Con_BenchmarkQuit, this, "Benchmark frame times for number of seconds to file, then quit");
+	m_pConsole->Register("benchmark_text", "?i[frames]", CFGFLAG_CLIENT, Con_BenchmarkText, this, "Benchmark rendering a full scoreboard of text with and without the text layout cache");
 
 	RustVersionRegister(*m_pConsole);
 
@@ -4868,7 +4915,8 @@ void CClient::RequestDDNetInfo()
 	m_pDDNetInfoTask = HttpGetFile(aUrl, Storage(), m_aDDNetInfoTmp, IStorage::TYPE_SAVE);
 	m_pDDNetInfoTask->Timeout(CTimeout{10000, 0, 500, 10});
 	m_pDDNetInfoTask->IpResolve(IPRESOLVE::V4);
-	Engine()->AddJob(m_pDDNetInfoTask);
+	m_pDDNetInfoTask->UseCache(Storage());
+	HttpRun(m_pDDNetInfoTask);
 }
 
 int CClient::GetPredictionTime()
@@ -416,6 +416,21 @@ bool CGraphics_Threaded::IsSpriteTextureFullyTransparent(CImageInfo &FromImageIn
 }
 
 IGraphics::CTextureHandle CGraphics_Threaded::LoadTextureRaw(size_t Width, size_t Height, CImageInfo::EImageFormat Format, const void *pData, int Flags, const char *pTexName)
+{
+	// copy texture data
+	void *pTmpData = nullptr;
+	if(Width != 0 && Height != 0)
+	{
+		pTmpData = malloc(Width * Height * CImageInfo::PixelSize(CImageInfo::FORMAT_RGBA));
+		if(!ConvertToRGBA((uint8_t *)pTmpData, (const uint8_t *)pData, Width, Height, Format))
+		{
+			dbg_msg("graphics", "converted image %s to RGBA, consider making its file format RGBA", pTexName ? pTexName : "(no name)");
+		}
+	}
+	return LoadTextureRawMove(Width, Height, pTmpData, Flags, pTexName);
+}
+
+IGraphics::CTextureHandle CGraphics_Threaded::LoadTextureRawMove(size_t Width, size_t Height, void *pData, int Flags, const char *pTexName)
 {
 	if((Flags & IGraphics::TEXLOAD_TO_2D_ARRAY_TEXTURE) != 0 || (Flags & IGraphics::TEXLOAD_TO_3D_TEXTURE) != 0)
 	{
@@ -435,7 +450,10 @@ IGraphics::CTextureHandle CGraphics_Threaded::LoadTextureRaw(size_t Width, size_
 	}
 
 	if(Width == 0 || Height == 0)
+	{
+		free(pData);
 		return IGraphics::CTextureHandle();
+	}
 
 	IGraphics::CTextureHandle TextureHandle = FindFreeTextureIndex();
 
@@ -461,14 +479,7 @@ IGraphics::CTextureHandle CGraphics_Threaded::LoadTextureRaw(size_t Width, size_
 	if((Flags & IGraphics::TEXLOAD_NO_2D_TEXTURE) != 0)
 		Cmd.m_Flags |= CCommandBuffer::TEXFLAG_NO_2D_TEXTURE;
 
-	// copy texture data
-	const size_t MemSize = Width * Height * CImageInfo::PixelSize(CImageInfo::FORMAT_RGBA);
-	void *pTmpData = malloc(MemSize);
-	if(!ConvertToRGBA((uint8_t *)pTmpData, (const uint8_t *)pData, Width, Height, Format))
-	{
-		dbg_msg("graphics", "converted image %s to RGBA, consider making its file format RGBA", pTexName ? pTexName : "(no name)");
-	}
-	Cmd.m_pData = pTmpData;
+	Cmd.m_pData = pData;
 	AddCmd(Cmd);
 
 	return TextureHandle;
@@ -803,7 +814,9 @@ bool CGraphics_Threaded::ScreenshotDirect()
 
 	if(Image.m_pData)
 	{
-		m_pEngine->AddJob(std::make_shared<CScreenshotSaveJob>(m_pStorage, m_pConsole, m_aScreenshotName, Image.m_Width, Image.m_Height, Image.m_pData));
+		auto pJob = std::make_shared<CScreenshotSaveJob>(m_pStorage, m_pConsole, m_aScreenshotName, Image.m_Width, Image.m_Height, Image.m_pData);
+		pJob->SetPriority(IJob::PRIORITY_LOW);
+		m_pEngine->AddJob(std::move(pJob));
 	}
 
 	return DidSwap;
@@ -35,7 +35,16 @@ class CSortWrap
 public:
 	CSortWrap(CServerBrowser *pServer, SortFunc Func) :
 		m_pfnSort(Func), m_pThis(pServer) {}
-	bool operator()(int a, int b) { return (g_Config.m_BrSortOrder ? (m_pThis->*m_pfnSort)(b, a) : (m_pThis->*m_pfnSort)(a, b)); }
+	bool operator()(int a, int b)
+	{
+		if(g_Config.m_BrSortOrder ? (m_pThis->*m_pfnSort)(b, a) : (m_pThis->*m_pfnSort)(a, b))
+			return true;
+		if(g_Config.m_BrSortOrder ? (m_pThis->*m_pfnSort)(a, b) : (m_pThis->*m_pfnSort)(b, a))
+			return false;
+		// equal servers stay in the order of the server list, so servers
+		// sorted in one by one end up where a full sort puts them
+		return a < b;
+	}
 };
 
 bool matchesPart(const char *a, const char *b)
@@ -59,6 +68,7 @@ CServerBrowser::CServerBrowser()
 
 	m_NeedResort = false;
 	m_Sorthash = 0;
+	m_FilterGeneration = 1;
 
 	m_NumSortedServers = 0;
 	m_NumSortedServersCapacity = 0;
@@ -263,162 +273,197 @@ bool CServerBrowser::SortCompareNumPlayersAndPing(int Index1, int Index2) const
 		return pIndex1->m_Info.m_Latency > pIndex2->m_Info.m_Latency;
 }
 
-void CServerBrowser::Filter()
+std::string CServerBrowser::FilterKey() const
 {
-	m_NumSortedServers = 0;
-	m_NumSortedPlayers = 0;
+	char aFlags[128];
+	str_format(aFlags, sizeof(aFlags), "%d %d %d %d %d %d %d %d %d",
+		g_Config.m_BrFilterEmpty, g_Config.m_BrFilterFull, g_Config.m_BrFilterSpectators,
+		g_Config.m_BrFilterPw, g_Config.m_BrFilterGametypeStrict, g_Config.m_BrFilterUnfinishedMap,
+		g_Config.m_BrFilterCountry, g_Config.m_BrFilterCountryIndex, g_Config.m_BrFilterConnectingPlayers);
+	std::string Key = aFlags;
+	// the strings can't contain null bytes, so these separate them unambiguously
+	for(const char *pStr : {g_Config.m_BrFilterServerAddress, g_Config.m_BrFilterGametype, g_Config.m_BrFilterString, g_Config.m_BrExcludeString})
+	{
+		Key.push_back('\0');
+		Key.append(pStr);
+	}
+	return Key;
+}
 
-	// allocate the sorted list
-	if(m_NumSortedServersCapacity < m_NumServers)
+void CServerBrowser::ParseSearchTokens(const char *pStr, std::vector<CSearchToken> *pvTokens)
+{
+	pvTokens->clear();
+	char aToken[128];
+	while((pStr = str_next_token(pStr, IServerBrowser::SEARCH_EXCLUDE_TOKEN, aToken, sizeof(aToken))))
 	{
-		free(m_pSortedServerlist);
-		m_NumSortedServersCapacity = m_NumServers;
-		m_pSortedServerlist = (int *)calloc(m_NumSortedServersCapacity, sizeof(int));
+		if(aToken[0] == '\0')
+		{
+			continue;
+		}
+		CSearchToken Token;
+		Token.m_pfnMatches = matchesPart;
+		const int TokenLen = str_length(aToken);
+		if(aToken[0] == '"' && aToken[TokenLen - 1] == '"')
+		{
+			aToken[TokenLen - 1] = '\0';
+			Token.m_pfnMatches = matchesExactly;
+		}
+		Token.m_String = aToken;
+		pvTokens->push_back(Token);
 	}
+}
 
-	// filter the servers
-	for(int i = 0; i < m_NumServers; i++)
+bool CServerBrowser::IsFiltered(CServerInfo &Info) const
+{
+	UpdateServerFilteredPlayers(&Info);
+
+	if(g_Config.m_BrFilterEmpty && Info.m_NumFilteredPlayers == 0)
+		return true;
+	else if(g_Config.m_BrFilterFull && Players(Info) == Max(Info))
+		return true;
+	else if(g_Config.m_BrFilterPw && Info.m_Flags & SERVER_FLAG_PASSWORD)
+		return true;
+	else if(g_Config.m_BrFilterServerAddress[0] && !str_find_nocase(Info.m_aAddress, g_Config.m_BrFilterServerAddress))
+		return true;
+	else if(g_Config.m_BrFilterGametypeStrict && g_Config.m_BrFilterGametype[0] && str_comp_nocase(Info.m_aGameType, g_Config.m_BrFilterGametype))
+		return true;
+	else if(!g_Config.m_BrFilterGametypeStrict && g_Config.m_BrFilterGametype[0] && !str_utf8_find_nocase(Info.m_aGameType, g_Config.m_BrFilterGametype))
+		return true;
+	else if(g_Config.m_BrFilterUnfinishedMap && Info.m_HasRank == CServerInfo::RANK_RANKED)
+		return true;
+
+	if(g_Config.m_BrFilterCountry)
 	{
-		CServerInfo &Info = m_ppServerlist[i]->m_Info;
-		bool Filtered = false;
-
-		if(g_Config.m_BrFilterEmpty && Info.m_NumFilteredPlayers == 0)
-			Filtered = true;
-		else if(g_Config.m_BrFilterFull && Players(Info) == Max(Info))
-			Filtered = true;
-		else if(g_Config.m_BrFilterPw && Info.m_Flags & SERVER_FLAG_PASSWORD)
-			Filtered = true;
-		else if(g_Config.m_BrFilterServerAddress[0] && !str_find_nocase(Info.m_aAddress, g_Config.m_BrFilterServerAddress))
-			Filtered = true;
-		else if(g_Config.m_BrFilterGametypeStrict && g_Config.m_BrFilterGametype[0] && str_comp_nocase(Info.m_aGameType, g_Config.m_BrFilterGametype))
-			Filtered = true;
-		else if(!g_Config.m_BrFilterGametypeStrict && g_Config.m_BrFilterGametype[0] && !str_utf8_find_nocase(Info.m_aGameType, g_Config.m_BrFilterGametype))
-			Filtered = true;
-		else if(g_Config.m_BrFilterUnfinishedMap && Info.m_HasRank == CServerInfo::RANK_RANKED)
-			Filtered = true;
-		else
+		// match against player country
+		bool Found = false;
+		for(int p = 0; p < minimum(Info.m_NumClients, (int)MAX_CLIENTS); p++)
 		{
-			if(g_Config.m_BrFilterCountry)
+			if(Info.m_aClients[p].m_Country == g_Config.m_BrFilterCountryIndex)
 			{
-				Filtered = true;
-				// match against player country
-				for(int p = 0; p < minimum(Info.m_NumClients, (int)MAX_CLIENTS); p++)
-				{
-					if(Info.m_aClients[p].m_Country == g_Config.m_BrFilterCountryIndex)
-					{
-						Filtered = false;
-						break;
-					}
-				}
+				Found = true;
+				break;
 			}
+		}
+		if(!Found)
+			return true;
+	}
+
+	if(g_Config.m_BrFilterString[0] != '\0')
+	{
+		Info.m_QuickSearchHit = 0;
+
+		for(const CSearchToken &Token : m_vFilterTokens)
+		{
+			const char *pToken = Token.m_String.c_str();
 
-			if(!Filtered && g_Config.m_BrFilterString[0] != '\0')
+			// match against server name
+			if(Token.m_pfnMatches(Info.m_aName, pToken))
 			{
-				Info.m_QuickSearchHit = 0;
+				Info.m_QuickSearchHit |= IServerBrowser::QUICK_SERVERNAME;
+			}
 
-				const char *pStr = g_Config.m_BrFilterString;
-				char aFilterStr[sizeof(g_Config.m_BrFilterString)];
-				while((pStr = str_next_token(pStr, IServerBrowser::SEARCH_EXCLUDE_TOKEN, aFilterStr, sizeof(aFilterStr))))
+			// match against players
+			for(int p = 0; p < minimum(Info.m_NumClients, (int)MAX_CLIENTS); p++)
+			{
+				if(Token.m_pfnMatches(Info.m_aClients[p].m_aName, pToken) ||
+					Token.m_pfnMatches(Info.m_aClients[p].m_aClan, pToken))
 				{
-					if(aFilterStr[0] == '\0')
+					if(g_Config.m_BrFilterConnectingPlayers &&
+						str_comp(Info.m_aClients[p].m_aName, "(connecting)") == 0 &&
+						Info.m_aClients[p].m_aClan[0] == '\0')
 					{
 						continue;
 					}
-					auto MatchesFn = matchesPart;
-					const int FilterLen = str_length(aFilterStr);
-					if(aFilterStr[0] == '"' && aFilterStr[FilterLen - 1] == '"')
-					{
-						aFilterStr[FilterLen - 1] = '\0';
-						MatchesFn = matchesExactly;
-					}
+					Info.m_QuickSearchHit |= IServerBrowser::QUICK_PLAYER;
+					break;
+				}
+			}
 
-					// match against server name
-					if(MatchesFn(Info.m_aName, aFilterStr))
-					{
-						Info.m_QuickSearchHit |= IServerBrowser::QUICK_SERVERNAME;
-					}
+			// match against map
+			if(Token.m_pfnMatches(Info.m_aMap, pToken))
+			{
+				Info.m_QuickSearchHit |= IServerBrowser::QUICK_MAPNAME;
+			}
+		}
 
-					// match against players
-					for(int p = 0; p < minimum(Info.m_NumClients, (int)MAX_CLIENTS); p++)
-					{
-						if(MatchesFn(Info.m_aClients[p].m_aName, aFilterStr) ||
-							MatchesFn(Info.m_aClients[p].m_aClan, aFilterStr))
-						{
-							if(g_Config.m_BrFilterConnectingPlayers &&
-								str_comp(Info.m_aClients[p].m_aName, "(connecting)") == 0 &&
-								Info.m_aClients[p].m_aClan[0] == '\0')
-							{
-								continue;
-							}
-							Info.m_QuickSearchHit |= IServerBrowser::QUICK_PLAYER;
-							break;
-						}
-					}
+		if(!Info.m_QuickSearchHit)
+			return true;
+	}
 
-					// match against map
-					if(MatchesFn(Info.m_aMap, aFilterStr))
-					{
-						Info.m_QuickSearchHit |= IServerBrowser::QUICK_MAPNAME;
-					}
-				}
+	for(const CSearchToken &Token : m_vExcludeTokens)
+	{
+		const char *pToken = Token.m_String.c_str();
+		// match against server name, map and gametype
+		if(Token.m_pfnMatches(Info.m_aName, pToken) ||
+			Token.m_pfnMatches(Info.m_aMap, pToken) ||
+			Token.m_pfnMatches(Info.m_aGameType, pToken))
+		{
+			return true;
+		}
+	}
+	return false;
+}
 
-				if(!Info.m_QuickSearchHit)
-					Filtered = true;
-			}
+bool CServerBrowser::Filtered(CServerEntry *pEntry) const
+{
+	// the filters only have to be evaluated again if the info or the
+	// settings changed
+	if(pEntry->m_FilterGeneration != m_FilterGeneration)
+	{
+		pEntry->m_Filtered = IsFiltered(pEntry->m_Info);
+		pEntry->m_FilterGeneration = m_FilterGeneration;
+	}
+	if(pEntry->m_Filtered)
+		return true;
 
-			if(!Filtered && g_Config.m_BrExcludeString[0] != '\0')
-			{
-				const char *pStr = g_Config.m_BrExcludeString;
-				char aExcludeStr[sizeof(g_Config.m_BrExcludeString)];
-				while((pStr = str_next_token(pStr, IServerBrowser::SEARCH_EXCLUDE_TOKEN, aExcludeStr, sizeof(aExcludeStr))))
-				{
-					if(aExcludeStr[0] == '\0')
-					{
-						continue;
-					}
-					auto MatchesFn = matchesPart;
-					const int FilterLen = str_length(aExcludeStr);
-					if(aExcludeStr[0] == '"' && aExcludeStr[FilterLen - 1] == '"')
-					{
-						aExcludeStr[FilterLen - 1] = '\0';
-						MatchesFn = matchesExactly;
-					}
+	// friends can change without the server info changing
+	UpdateServerFriends(&pEntry->m_Info);
+	return g_Config.m_BrFilterFriends && pEntry->m_Info.m_FriendState == IFriends::FRIEND_NO;
+}
 
-					// match against server name
-					if(MatchesFn(Info.m_aName, aExcludeStr))
-					{
-						Filtered = true;
-						break;
-					}
+void CServerBrowser::ReserveSorted()
+{
+	if(m_NumSortedServersCapacity >= m_NumServers)
+		return;
 
-					// match against map
-					if(MatchesFn(Info.m_aMap, aExcludeStr))
-					{
-						Filtered = true;
-						break;
-					}
+	int *pNewList = (int *)calloc(m_NumServers, sizeof(int));
+	if(m_NumSortedServers > 0)
+		mem_copy(pNewList, m_pSortedServerlist, m_NumSortedServers * sizeof(int));
+	free(m_pSortedServerlist);
+	m_pSortedServerlist = pNewList;
+	m_NumSortedServersCapacity = m_NumServers;
+}
 
-					// match against gametype
-					if(MatchesFn(Info.m_aGameType, aExcludeStr))
-					{
-						Filtered = true;
-						break;
-					}
-				}
-			}
-		}
+void CServerBrowser::Filter()
+{
+	m_NumSortedServers = 0;
+	m_NumSortedPlayers = 0;
 
-		if(!Filtered)
-		{
-			UpdateServerFriends(&Info);
+	// allocate the sorted list
+	ReserveSorted();
 
-			if(!g_Config.m_BrFilterFriends || Info.m_FriendState != IFriends::FRIEND_NO)
-			{
-				m_NumSortedPlayers += Info.m_NumFilteredPlayers;
-				m_pSortedServerlist[m_NumSortedServers++] = i;
-			}
+	// the cached results are only valid for the settings they were made with
+	std::string Key = FilterKey();
+	if(Key != m_FilterKey)
+	{
+		m_FilterKey = std::move(Key);
+		m_FilterGeneration++;
+		ParseSearchTokens(g_Config.m_BrFilterString, &m_vFilterTokens);
+		ParseSearchTokens(g_Config.m_BrExcludeString, &m_vExcludeTokens);
+	}
+
+	// filter the servers
+	for(int i = 0; i < m_NumServers; i++)
+	{
+		CServerEntry *pEntry = m_ppServerlist[i];
+		pEntry->m_Changed = false;
+		if(!Filtered(pEntry))
+		{
+			m_NumSortedPlayers += pEntry->m_Info.m_NumFilteredPlayers;
+			m_pSortedServerlist[m_NumSortedServers++] = i;
 		}
 	}
+	m_vChangedServers.clear();
 }
 
 int CServerBrowser::SortHash() const
@@ -437,34 +482,81 @@ int CServerBrowser::SortHash() const
 	return i;
 }
 
-void CServerBrowser::Sort()
+CServerBrowser::FSortCompare CServerBrowser::SortCompare() const
 {
-	// update number of filtered players
-	for(int i = 0; i < m_NumServers; i++)
-	{
-		UpdateServerFilteredPlayers(&m_ppServerlist[i]->m_Info);
-	}
-
-	// create filtered list
-	Filter();
-
-	// sort
 	if(g_Config.m_BrSortOrder == 2 && (g_Config.m_BrSort == IServerBrowser::SORT_NUMPLAYERS || g_Config.m_BrSort == IServerBrowser::SORT_PING))
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist + m_NumSortedServers, CSortWrap(this, &CServerBrowser::SortCompareNumPlayersAndPing));
+		return &CServerBrowser::SortCompareNumPlayersAndPing;
 	else if(g_Config.m_BrSort == IServerBrowser::SORT_NAME)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist + m_NumSortedServers, CSortWrap(this, &CServerBrowser::SortCompareName));
+		return &CServerBrowser::SortCompareName;
 	else if(g_Config.m_BrSort == IServerBrowser::SORT_PING)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist + m_NumSortedServers, CSortWrap(this, &CServerBrowser::SortComparePing));
+		return &CServerBrowser::SortComparePing;
 	else if(g_Config.m_BrSort == IServerBrowser::SORT_MAP)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist + m_NumSortedServers, CSortWrap(this, &CServerBrowser::SortCompareMap));
+		return &CServerBrowser::SortCompareMap;
 	else if(g_Config.m_BrSort == IServerBrowser::SORT_NUMPLAYERS)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist + m_NumSortedServers, CSortWrap(this, &CServerBrowser::SortCompareNumPlayers));
+		return &CServerBrowser::SortCompareNumPlayers;
 	else if(g_Config.m_BrSort == IServerBrowser::SORT_GAMETYPE)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist + m_NumSortedServers, CSortWrap(this, &CServerBrowser::SortCompareGametype));
+		return &CServerBrowser::SortCompareGametype;
+	return nullptr;
+}
+
+void CServerBrowser::Sort()
+{
+	// create filtered list
+	Filter();
+
+	// sort
+	FSortCompare pfnCompare = SortCompare();
+	if(pfnCompare)
+		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist + m_NumSortedServers, CSortWrap(this, pfnCompare));
 
 	m_Sorthash = SortHash();
 }
 
+void CServerBrowser::SortChanged()
+{
+	ReserveSorted();
+
+	// take the changed servers out, then filter them again and insert the
+	// remaining ones at their new position
+	int *pEnd = std::remove_if(m_pSortedServerlist, m_pSortedServerlist + m_NumSortedServers, [this](int Index) {
+		return m_ppServerlist[Index]->m_Changed;
+	});
+	m_NumSortedServers = pEnd - m_pSortedServerlist;
+
+	FSortCompare pfnCompare = SortCompare();
+	for(int Index : m_vChangedServers)
+	{
+		CServerEntry *pEntry = m_ppServerlist[Index];
+		pEntry->m_Changed = false;
+		if(Filtered(pEntry))
+			continue;
+
+		int *pPos;
+		if(pfnCompare)
+			pPos = std::upper_bound(m_pSortedServerlist, m_pSortedServerlist + m_NumSortedServers, Index, CSortWrap(this, pfnCompare));
+		else
+			pPos = std::upper_bound(m_pSortedServerlist, m_pSortedServerlist + m_NumSortedServers, Index);
+		mem_move(pPos + 1, pPos, (m_pSortedServerlist + m_NumSortedServers - pPos) * sizeof(int));
+		*pPos = Index;
+		m_NumSortedServers++;
+	}
+	m_vChangedServers.clear();
+
+	m_NumSortedPlayers = 0;
+	for(int i = 0; i < m_NumSortedServers; i++)
+		m_NumSortedPlayers += m_ppServerlist[m_pSortedServerlist[i]]->m_Info.m_NumFilteredPlayers;
+}
+
+void CServerBrowser::MarkChanged(CServerEntry *pEntry)
+{
+	pEntry->m_FilterGeneration = 0;
+	if(!pEntry->m_Changed)
+	{
+		pEntry->m_Changed = true;
+		m_vChangedServers.push_back(pEntry->m_Info.m_ServerIndex);
+	}
+}
+
 void CServerBrowser::RemoveRequest(CServerEntry *pEntry)
 {
 	if(pEntry->m_pPrevReq || pEntry->m_pNextReq || m_pFirstReqServer == pEntry)
@@ -541,6 +633,7 @@ void CServerBrowser::SetInfo(CServerEntry *pEntry, const CServerInfo &Info)
 	pEntry->m_Info.m_Favorite = TmpInfo.m_Favorite;
 	pEntry->m_Info.m_FavoriteAllowPing = TmpInfo.m_FavoriteAllowPing;
 	pEntry->m_Info.m_Official = TmpInfo.m_Official;
+	pEntry->m_Info.m_ServerIndex = TmpInfo.m_ServerIndex;
 	mem_copy(pEntry->m_Info.m_aAddresses, TmpInfo.m_aAddresses, sizeof(pEntry->m_Info.m_aAddresses));
 	pEntry->m_Info.m_NumAddresses = TmpInfo.m_NumAddresses;
 	ServerBrowserFormatAddresses(pEntry->m_Info.m_aAddress, sizeof(pEntry->m_Info.m_aAddress), pEntry->m_Info.m_aAddresses, pEntry->m_Info.m_NumAddresses);
@@ -603,6 +696,7 @@ void CServerBrowser::SetInfo(CServerEntry *pEntry, const CServerInfo &Info)
 	std::sort(pEntry->m_Info.m_aClients, pEntry->m_Info.m_aClients + Info.m_NumReceivedClients, CPlayerScoreNameLess(pEntry->m_Info.m_ClientScoreKind));
 
 	pEntry->m_GotInfo = 1;
+	MarkChanged(pEntry);
 }
 
 void CServerBrowser::SetLatency(NETADDR Addr, int Latency)
@@ -638,6 +732,7 @@ void CServerBrowser::SetLatency(NETADDR Addr, int Latency)
 		}
 		m_ppServerlist[i]->m_Info.m_Latency = Ping;
 		m_ppServerlist[i]->m_Info.m_LatencyIsEstimated = false;
+		MarkChanged(m_ppServerlist[i]);
 	}
 }
 
@@ -707,6 +802,7 @@ CServerBrowser::CServerEntry *CServerBrowser::Add(const NETADDR *pAddrs, int Num
 	m_ppServerlist[m_NumServers] = pEntry;
 	pEntry->m_Info.m_ServerIndex = m_NumServers;
 	m_NumServers++;
+	MarkChanged(pEntry);
 
 	return pEntry;
 }
@@ -782,8 +878,8 @@ void CServerBrowser::OnServerInfoUpdate(const NETADDR &Addr, int Token, const CS
 		}
 		pEntry->m_RequestTime = -1; // Request has been answered
 	}
+	// the entry is sorted in again on the next update
 	RemoveRequest(pEntry);
-	RequestResort();
 }
 
 void CServerBrowser::Refresh(int Type)
@@ -1058,6 +1154,7 @@ void CServerBrowser::CleanUp()
 	m_NumSortedServers = 0;
 	m_NumSortedPlayers = 0;
 	m_ByAddr.clear();
+	m_vChangedServers.clear();
 	m_pFirstReqServer = nullptr;
 	m_pLastReqServer = nullptr;
 	m_NumRequests = 0;
@@ -1154,6 +1251,10 @@ void CServerBrowser::Update()
 		Sort();
 		m_NeedResort = false;
 	}
+	else if(!m_vChangedServers.empty())
+	{
+		SortChanged();
+	}
 }
 
 void CServerBrowser::LoadDDNetServers()
@@ -1257,8 +1358,16 @@ void CServerBrowser::LoadDDNetRanks()
 {
 	for(int i = 0; i < m_NumServers; i++)
 	{
-		if(m_ppServerlist[i]->m_Info.m_aMap[0])
-			m_ppServerlist[i]->m_Info.m_HasRank = HasRank(m_ppServerlist[i]->m_Info.m_aMap);
+		CServerEntry *pEntry = m_ppServerlist[i];
+		if(!pEntry->m_Info.m_aMap[0])
+			continue;
+		const CServerInfo::ERankState Rank = HasRank(pEntry->m_Info.m_aMap);
+		if(Rank != pEntry->m_Info.m_HasRank)
+		{
+			pEntry->m_Info.m_HasRank = Rank;
+			// the rank is used by the unfinished map filter
+			MarkChanged(pEntry);
+		}
 	}
 }
 
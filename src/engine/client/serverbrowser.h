@@ -9,7 +9,9 @@
 #include <engine/serverbrowser.h>
 #include <engine/shared/memheap.h>
 
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 typedef struct _json_value json_value;
 class CNetClient;
@@ -24,6 +26,9 @@ class IStorage;
 
 class CServerBrowser : public IServerBrowser
 {
+	// compares the incremental filtering and sorting with a full pass
+	friend class ServerBrowserSort;
+
 public:
 	class CServerEntry
 	{
@@ -35,6 +40,12 @@ public:
 
 		CServerEntry *m_pPrevReq; // request list
 		CServerEntry *m_pNextReq;
+
+		// filter result, valid while this matches the browser's generation
+		int m_FilterGeneration;
+		bool m_Filtered;
+		// queued for being filtered and sorted in again
+		bool m_Changed;
 	};
 
 	CServerBrowser();
@@ -121,6 +132,21 @@ private:
 	bool m_NeedResort;
 	int m_Sorthash;
 
+	// Filter settings the cached filter results of the entries belong to.
+	// The generation is increased whenever they change.
+	std::string m_FilterKey;
+	int m_FilterGeneration;
+	class CSearchToken
+	{
+	public:
+		std::string m_String;
+		bool (*m_pfnMatches)(const char *pHaystack, const char *pToken);
+	};
+	std::vector<CSearchToken> m_vFilterTokens;
+	std::vector<CSearchToken> m_vExcludeTokens;
+	// servers whose info changed since the last sort
+	std::vector<int> m_vChangedServers;
+
 	// used instead of g_Config.br_max_requests to get more servers
 	int m_CurrentMaxRequests;
 
@@ -139,6 +165,8 @@ private:
 	static int GetExtraToken(int Token);
 
 	// sorting criteria
+	typedef bool (CServerBrowser::*FSortCompare)(int Index1, int Index2) const;
+	FSortCompare SortCompare() const;
 	bool SortCompareName(int Index1, int Index2) const;
 	bool SortCompareMap(int Index1, int Index2) const;
 	bool SortComparePing(int Index1, int Index2) const;
@@ -148,8 +176,15 @@ private:
 	bool SortCompareNumPlayersAndPing(int Index1, int Index2) const;
 
 	//
+	std::string FilterKey() const;
+	static void ParseSearchTokens(const char *pStr, std::vector<CSearchToken> *pvTokens);
+	bool IsFiltered(CServerInfo &Info) const;
+	bool Filtered(CServerEntry *pEntry) const;
+	void ReserveSorted();
 	void Filter();
 	void Sort();
+	void SortChanged();
+	void MarkChanged(CServerEntry *pEntry);
 	int SortHash() const;
 
 	void CleanUp();
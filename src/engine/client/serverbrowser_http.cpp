@@ -2,7 +2,6 @@
 
 #include <engine/console.h>
 #include <engine/engine.h>
-#include <engine/external/json-parser/json.h>
 #include <engine/serverbrowser.h>
 #include <engine/shared/http.h>
 #include <engine/shared/jobs.h>
@@ -20,16 +19,43 @@
 
 using namespace std::chrono_literals;
 
-class CChooseMaster
+// Feeds the serverlist to the parser while it is downloaded. The request
+// fails if the serverlist is invalid.
+class CServerListRequest : public CHttpRequest
 {
+	CServerListParser m_Parser;
+
+	size_t OnData(char *pData, size_t DataSize) override
+	{
+		return m_Parser.Feed(pData, DataSize) ? 0 : DataSize;
+	}
+
+	int OnCompletion(int State) override
+	{
+		if(State == HTTP_DONE && m_Parser.Finish(&m_vServers, &m_vLegacyServers))
+		{
+			dbg_msg("serverbrowse_http", "invalid serverlist, url='%s'", Url());
+			State = HTTP_ERROR;
+		}
+		return CHttpRequest::OnCompletion(State);
+	}
+
 public:
-	typedef bool (*VALIDATOR)(json_value *pJson);
+	CServerListRequest(const char *pUrl) :
+		CHttpRequest(pUrl) {}
+
+	std::vector<CServerInfo> m_vServers;
+	std::vector<NETADDR> m_vLegacyServers;
+};
 
+class CChooseMaster
+{
+public:
 	enum
 	{
 		MAX_URLS = 16,
 	};
-	CChooseMaster(IEngine *pEngine, VALIDATOR pfnValidator, const char **ppUrls, int NumUrls, int PreviousBestIndex);
+	CChooseMaster(IEngine *pEngine, const char **ppUrls, int NumUrls, int PreviousBestIndex);
 	virtual ~CChooseMaster();
 
 	bool GetBestUrl(const char **pBestUrl) const;
@@ -45,7 +71,6 @@ private:
 	public:
 		std::atomic_int m_BestIndex{-1};
 		// Constant after construction.
-		VALIDATOR m_pfnValidator;
 		int m_NumUrls;
 		char m_aaUrls[MAX_URLS][256];
 	};
@@ -70,7 +95,7 @@ private:
 	std::shared_ptr<CJob> m_pJob;
 };
 
-CChooseMaster::CChooseMaster(IEngine *pEngine, VALIDATOR pfnValidator, const char **ppUrls, int NumUrls, int PreviousBestIndex) :
+CChooseMaster::CChooseMaster(IEngine *pEngine, const char **ppUrls, int NumUrls, int PreviousBestIndex) :
 	m_pEngine(pEngine),
 	m_PreviousBestIndex(PreviousBestIndex)
 {
@@ -79,7 +104,6 @@ CChooseMaster::CChooseMaster(IEngine *pEngine, VALIDATOR pfnValidator, const cha
 	dbg_assert(PreviousBestIndex >= -1, "previous best index negative and not -1");
 	dbg_assert(PreviousBestIndex < NumUrls, "previous best index too high");
 	m_pData = std::make_shared<CData>();
-	m_pData->m_pfnValidator = pfnValidator;
 	m_pData->m_NumUrls = NumUrls;
 	for(int i = 0; i < m_pData->m_NumUrls; i++)
 	{
@@ -190,7 +214,8 @@ void CChooseMaster::CJob::Run()
 			continue;
 		}
 		auto StartTime = time_get_nanoseconds();
-		CHttpRequest *pGet = HttpGet(pUrl).release();
+		// the serverlist is validated while it is downloaded
+		CHttpRequest *pGet = new CServerListRequest(pUrl);
 		pGet->Timeout(Timeout);
 		pGet->LogProgress(HTTPLOG::FAILURE);
 		{
@@ -208,17 +233,6 @@ void CChooseMaster::CJob::Run()
 		{
 			continue;
 		}
-		json_value *pJson = pGet->ResultJson();
-		if(!pJson)
-		{
-			continue;
-		}
-		bool ParseFailure = m_pData->m_pfnValidator(pJson);
-		json_value_free(pJson);
-		if(ParseFailure)
-		{
-			continue;
-		}
 		dbg_msg("serverbrowse_http", "found master, url='%s' time=%dms", pUrl, (int)Time.count());
 		aTimeMs[i] = Time.count();
 	}
@@ -249,7 +263,7 @@ void CChooseMaster::CJob::Run()
 class CServerBrowserHttp : public IServerBrowserHttp
 {
 public:
-	CServerBrowserHttp(IEngine *pEngine, IConsole *pConsole, const char **ppUrls, int NumUrls, int PreviousBestIndex);
+	CServerBrowserHttp(IEngine *pEngine, IConsole *pConsole, IStorage *pStorage, const char **ppUrls, int NumUrls, int PreviousBestIndex);
 	~CServerBrowserHttp() override;
 	void Update() override;
 	bool IsRefreshing() override { return m_State != STATE_DONE; }
@@ -282,24 +296,23 @@ private:
 		STATE_NO_MASTER,
 	};
 
-	static bool Validate(json_value *pJson);
-	static bool Parse(json_value *pJson, std::vector<CServerInfo> *pvServers, std::vector<NETADDR> *pvLegacyServers);
-
 	IEngine *m_pEngine;
 	IConsole *m_pConsole;
+	IStorage *m_pStorage;
 
 	int m_State = STATE_DONE;
-	std::shared_ptr<CHttpRequest> m_pGetServers;
+	std::shared_ptr<CServerListRequest> m_pGetServers;
 	std::unique_ptr<CChooseMaster> m_pChooseMaster;
 
 	std::vector<CServerInfo> m_vServers;
 	std::vector<NETADDR> m_vLegacyServers;
 };
 
-CServerBrowserHttp::CServerBrowserHttp(IEngine *pEngine, IConsole *pConsole, const char **ppUrls, int NumUrls, int PreviousBestIndex) :
+CServerBrowserHttp::CServerBrowserHttp(IEngine *pEngine, IConsole *pConsole, IStorage *pStorage, const char **ppUrls, int NumUrls, int PreviousBestIndex) :
 	m_pEngine(pEngine),
 	m_pConsole(pConsole),
-	m_pChooseMaster(new CChooseMaster(pEngine, Validate, ppUrls, NumUrls, PreviousBestIndex))
+	m_pStorage(pStorage),
+	m_pChooseMaster(new CChooseMaster(pEngine, ppUrls, NumUrls, PreviousBestIndex))
 {
 	m_pChooseMaster->Refresh();
 }
@@ -326,10 +339,13 @@ void CServerBrowserHttp::Update()
 			}
 			return;
 		}
-		m_pGetServers = HttpGet(pBestUrl);
+		m_pGetServers = std::make_shared<CServerListRequest>(pBestUrl);
 		// 10 seconds connection timeout, lower than 8KB/s for 10 seconds to fail.
 		m_pGetServers->Timeout(CTimeout{10000, 0, 8000, 10});
-		m_pEngine->AddJob(m_pGetServers);
+		// the list only has to be transferred again once it changed
+		m_pGetServers->UseCache(m_pStorage);
+		m_pGetServers->SetPriority(IJob::PRIORITY_HIGH);
+		HttpRun(m_pGetServers);
 		m_State = STATE_REFRESHING;
 	}
 	else if(m_State == STATE_REFRESHING)
@@ -339,15 +355,15 @@ void CServerBrowserHttp::Update()
 			return;
 		}
 		m_State = STATE_DONE;
-		std::shared_ptr<CHttpRequest> pGetServers = nullptr;
+		std::shared_ptr<CServerListRequest> pGetServers = nullptr;
 		std::swap(m_pGetServers, pGetServers);
 
-		bool Success = true;
-		json_value *pJson = pGetServers->ResultJson();
-		Success = Success && pJson;
-		Success = Success && !Parse(pJson, &m_vServers, &m_vLegacyServers);
-		json_value_free(pJson);
-		if(!Success)
+		if(pGetServers->State() == HTTP_DONE)
+		{
+			m_vServers = std::move(pGetServers->m_vServers);
+			m_vLegacyServers = std::move(pGetServers->m_vLegacyServers);
+		}
+		else
 		{
 			m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "serverbrowse_http", "failed getting serverlist, trying to find best URL");
 			m_pChooseMaster->Reset();
@@ -371,95 +387,393 @@ bool ServerbrowserParseUrl(NETADDR *pOut, const char *pUrl)
 {
 	return net_addr_from_url(pOut, pUrl, nullptr, 0) != 0;
 }
-bool CServerBrowserHttp::Validate(json_value *pJson)
+enum
 {
-	std::vector<CServerInfo> vServers;
-	std::vector<NETADDR> vLegacyServers;
-	return Parse(pJson, &vServers, &vLegacyServers);
-}
-bool CServerBrowserHttp::Parse(json_value *pJson, std::vector<CServerInfo> *pvServers, std::vector<NETADDR> *pvLegacyServers)
+	ROLE_IGNORED,
+	ROLE_ROOT,
+	ROLE_SERVERS,
+	ROLE_LEGACY_SERVERS,
+	ROLE_LEGACY_SERVER,
+	ROLE_SERVER,
+	ROLE_ADDRESSES,
+	ROLE_ADDRESS,
+	ROLE_LOCATION,
+	ROLE_INFO,
+
+	// required fields of the info, in the order of their bits
+	ROLE_MAX_CLIENTS,
+	ROLE_MAX_PLAYERS,
+	ROLE_PASSWORDED,
+	ROLE_GAME_TYPE,
+	ROLE_NAME,
+	ROLE_MAP_NAME,
+	ROLE_VERSION,
+	ROLE_CLIENTS,
+	ROLE_CLIENT_SCORE_KIND,
+	ROLE_MAP,
+	ROLE_CLIENT,
+
+	// required fields of the clients, in the order of their bits
+	ROLE_CLIENT_NAME,
+	ROLE_CLAN,
+	ROLE_COUNTRY,
+	ROLE_SCORE,
+	ROLE_IS_PLAYER,
+	ROLE_AFK,
+	ROLE_SKIN,
+	ROLE_SKIN_NAME,
+	ROLE_SKIN_COLOR_BODY,
+	ROLE_SKIN_COLOR_FEET,
+
+	ALL_INFO_FIELDS = (1 << (ROLE_CLIENTS - ROLE_MAX_CLIENTS + 1)) - 1,
+	ALL_CLIENT_FIELDS = (1 << (ROLE_IS_PLAYER - ROLE_CLIENT_NAME + 1)) - 1,
+};
+
+int CServerListParser::ValueRole() const
 {
-	std::vector<CServerInfo> vServers;
-	std::vector<NETADDR> vLegacyServers;
+	static const struct
+	{
+		int m_Frame;
+		const char *m_pKey;
+		int m_Role;
+	} s_aKeys[] = {
+		{FRAME_ROOT, "servers", ROLE_SERVERS},
+		{FRAME_ROOT, "servers_legacy", ROLE_LEGACY_SERVERS},
+		{FRAME_SERVER, "addresses", ROLE_ADDRESSES},
+		{FRAME_SERVER, "location", ROLE_LOCATION},
+		{FRAME_SERVER, "info", ROLE_INFO},
+		{FRAME_INFO, "max_clients", ROLE_MAX_CLIENTS},
+		{FRAME_INFO, "max_players", ROLE_MAX_PLAYERS},
+		{FRAME_INFO, "passworded", ROLE_PASSWORDED},
+		{FRAME_INFO, "game_type", ROLE_GAME_TYPE},
+		{FRAME_INFO, "name", ROLE_NAME},
+		{FRAME_INFO, "version", ROLE_VERSION},
+		{FRAME_INFO, "clients", ROLE_CLIENTS},
+		{FRAME_INFO, "client_score_kind", ROLE_CLIENT_SCORE_KIND},
+		{FRAME_INFO, "map", ROLE_MAP},
+		{FRAME_MAP, "name", ROLE_MAP_NAME},
+		{FRAME_CLIENT, "name", ROLE_CLIENT_NAME},
+		{FRAME_CLIENT, "clan", ROLE_CLAN},
+		{FRAME_CLIENT, "country", ROLE_COUNTRY},
+		{FRAME_CLIENT, "score", ROLE_SCORE},
+		{FRAME_CLIENT, "is_player", ROLE_IS_PLAYER},
+		{FRAME_CLIENT, "afk", ROLE_AFK},
+		{FRAME_CLIENT, "skin", ROLE_SKIN},
+		{FRAME_SKIN, "name", ROLE_SKIN_NAME},
+		{FRAME_SKIN, "color_body", ROLE_SKIN_COLOR_BODY},
+		{FRAME_SKIN, "color_feet", ROLE_SKIN_COLOR_FEET},
+	};
+
+	if(m_vFrames.empty())
+		return ROLE_ROOT;
+	switch(m_vFrames.back())
+	{
+	case FRAME_SERVERS: return ROLE_SERVER;
+	case FRAME_ADDRESSES: return ROLE_ADDRESS;
+	case FRAME_CLIENTS: return ROLE_CLIENT;
+	case FRAME_LEGACY_SERVERS: return ROLE_LEGACY_SERVER;
+	case FRAME_IGNORED: return ROLE_IGNORED;
+	}
+	for(const auto &Key : s_aKeys)
+	{
+		if(Key.m_Frame == m_vFrames.back() && str_comp(Key.m_pKey, m_aKey) == 0)
+			return Key.m_Role;
+	}
+	return ROLE_IGNORED;
+}
 
-	const json_value &Json = *pJson;
-	const json_value &Servers = Json["servers"];
-	const json_value &LegacyServers = Json["servers_legacy"];
-	if(Servers.type != json_array || (LegacyServers.type != json_array && LegacyServers.type != json_none))
+bool CServerListParser::Mismatch(int Role)
+{
+	switch(Role)
 	{
+	case ROLE_IGNORED:
+	case ROLE_AFK:
+	case ROLE_SKIN:
+	case ROLE_SKIN_NAME:
+	case ROLE_SKIN_COLOR_BODY:
+	case ROLE_SKIN_COLOR_FEET:
+		// optional
+		return false;
+	case ROLE_ADDRESS:
+		// only an error if the server isn't skipped for its info
+		m_InvalidAddress = true;
+		return false;
+	case ROLE_ROOT:
+	case ROLE_SERVERS:
+	case ROLE_LEGACY_SERVERS:
+	case ROLE_LEGACY_SERVER:
+	case ROLE_SERVER:
+	case ROLE_ADDRESSES:
+	case ROLE_LOCATION:
 		return true;
+	default:
+		// the server info is "user input" by the game server and can be
+		// set to arbitrary values, only skip this server
+		m_InvalidInfo = true;
+		return false;
 	}
-	for(unsigned int i = 0; i < Servers.u.array.length; i++)
+}
+
+CServerInfo2::CClient *CServerListParser::Client()
+{
+	if(m_Info.m_NumClients < SERVERINFO_MAX_CLIENTS)
+		return &m_Info.m_aClients[m_Info.m_NumClients];
+	return &m_IgnoredClient;
+}
+
+bool CServerListParser::Begin(int Frame)
+{
+	switch(Frame)
 	{
-		const json_value &Server = Servers[i];
-		const json_value &Addresses = Server["addresses"];
-		const json_value &Info = Server["info"];
-		const json_value &Location = Server["location"];
-		int ParsedLocation = CServerInfo::LOC_UNKNOWN;
-		CServerInfo2 ParsedInfo;
-		if(Addresses.type != json_array || (Location.type != json_string && Location.type != json_none))
-		{
-			return true;
-		}
-		if(Location.type == json_string)
-		{
-			if(CServerInfo::ParseLocation(&ParsedLocation, Location))
-			{
-				return true;
-			}
-		}
-		if(CServerInfo2::FromJson(&ParsedInfo, &Info))
+	case FRAME_SERVERS:
+		m_GotServers = true;
+		break;
+	case FRAME_SERVER:
+		m_GotAddresses = false;
+		m_InvalidAddress = false;
+		m_NumAddresses = 0;
+		m_Location = CServerInfo::LOC_UNKNOWN;
+		m_GotInfo = false;
+		break;
+	case FRAME_ADDRESSES:
+		m_GotAddresses = true;
+		break;
+	case FRAME_INFO:
+		mem_zero(&m_Info, sizeof(m_Info));
+		m_Info.m_ClientScoreKind = CServerInfo::CLIENT_SCORE_KIND_UNSPECIFIED;
+		m_GotInfo = true;
+		m_InvalidInfo = false;
+		m_InfoFields = 0;
+		break;
+	case FRAME_CLIENTS:
+		m_InfoFields |= 1 << (ROLE_CLIENTS - ROLE_MAX_CLIENTS);
+		break;
+	case FRAME_CLIENT:
+		mem_zero(Client(), sizeof(*Client()));
+		m_ClientFields = 0;
+		m_GotSkin = false;
+		m_GotSkinColors[0] = m_GotSkinColors[1] = false;
+		break;
+	}
+	m_vFrames.push_back(Frame);
+	return false;
+}
+
+bool CServerListParser::End()
+{
+	const int Frame = m_vFrames.back();
+	m_vFrames.pop_back();
+	switch(Frame)
+	{
+	case FRAME_CLIENT:
+	{
+		CServerInfo2::CClient *pClient = Client();
+		if(m_ClientFields != ALL_CLIENT_FIELDS)
 		{
-			//dbg_msg("dbg/serverbrowser", "skipped due to info, i=%d", i);
-			// Only skip the current server on parsing
-			// failure; the server info is "user input" by
-			// the game server and can be set to arbitrary
-			// values.
-			continue;
+			m_InvalidInfo = true;
+			return false;
 		}
-		CServerInfo SetInfo = ParsedInfo;
-		SetInfo.m_Location = ParsedLocation;
-		SetInfo.m_NumAddresses = 0;
-		for(unsigned int a = 0; a < Addresses.u.array.length; a++)
+		if(m_GotSkin)
 		{
-			const json_value &Address = Addresses[a];
-			if(Address.type != json_string)
-			{
-				return true;
-			}
-			NETADDR ParsedAddr;
-			if(ServerbrowserParseUrl(&ParsedAddr, Addresses[a]))
-			{
-				//dbg_msg("dbg/serverbrowser", "unknown address, i=%d a=%d", i, a);
-				// Skip unknown addresses.
-				continue;
-			}
-			if(SetInfo.m_NumAddresses < (int)std::size(SetInfo.m_aAddresses))
+			// if the skin existed, then always at least default to "default"
+			if(pClient->m_aSkin[0] == '\0')
+				str_copy(pClient->m_aSkin, "default");
+			pClient->m_CustomSkinColors = m_GotSkinColors[0] && m_GotSkinColors[1];
+			if(pClient->m_CustomSkinColors)
 			{
-				SetInfo.m_aAddresses[SetInfo.m_NumAddresses] = ParsedAddr;
-				SetInfo.m_NumAddresses += 1;
+				pClient->m_CustomSkinColorBody = m_aSkinColors[0];
+				pClient->m_CustomSkinColorFeet = m_aSkinColors[1];
 			}
 		}
-		if(SetInfo.m_NumAddresses > 0)
-		{
-			vServers.push_back(SetInfo);
-		}
+		if(pClient->m_IsPlayer)
+			m_Info.m_NumPlayers++;
+		m_Info.m_NumClients++;
+		return false;
 	}
-	if(LegacyServers.type == json_array)
+	case FRAME_INFO:
+		if(m_InfoFields != ALL_INFO_FIELDS || m_Info.Validate())
+			m_InvalidInfo = true;
+		return false;
+	case FRAME_SERVER:
 	{
-		for(unsigned int i = 0; i < LegacyServers.u.array.length; i++)
-		{
-			const json_value &Address = LegacyServers[i];
-			NETADDR ParsedAddr;
-			if(Address.type != json_string || net_addr_from_str(&ParsedAddr, Address))
-			{
-				return true;
-			}
-			vLegacyServers.push_back(ParsedAddr);
-		}
+		if(!m_GotAddresses)
+			return true;
+		if(!m_GotInfo || m_InvalidInfo)
+			return false;
+		if(m_InvalidAddress)
+			return true;
+		if(m_NumAddresses == 0)
+			return false;
+		CServerInfo Info = m_Info;
+		Info.m_Location = m_Location;
+		Info.m_NumAddresses = m_NumAddresses;
+		mem_copy(Info.m_aAddresses, m_aAddresses, m_NumAddresses * sizeof(m_aAddresses[0]));
+		m_vServers.push_back(Info);
+		return false;
+	}
+	default:
+		return false;
+	}
+}
+
+bool CServerListParser::OnBeginObject()
+{
+	const int Role = ValueRole();
+	switch(Role)
+	{
+	case ROLE_ROOT: return Begin(FRAME_ROOT);
+	case ROLE_SERVER: return Begin(FRAME_SERVER);
+	case ROLE_INFO: return Begin(FRAME_INFO);
+	case ROLE_MAP: return Begin(FRAME_MAP);
+	case ROLE_CLIENT: return Begin(FRAME_CLIENT);
+	case ROLE_SKIN: return Begin(FRAME_SKIN);
+	default: return Mismatch(Role) || Begin(FRAME_IGNORED);
+	}
+}
+
+bool CServerListParser::OnBeginArray()
+{
+	const int Role = ValueRole();
+	switch(Role)
+	{
+	case ROLE_SERVERS: return Begin(FRAME_SERVERS);
+	case ROLE_LEGACY_SERVERS: return Begin(FRAME_LEGACY_SERVERS);
+	case ROLE_ADDRESSES: return Begin(FRAME_ADDRESSES);
+	case ROLE_CLIENTS: return Begin(FRAME_CLIENTS);
+	default: return Mismatch(Role) || Begin(FRAME_IGNORED);
+	}
+}
+
+bool CServerListParser::OnKey(const char *pKey)
+{
+	str_copy(m_aKey, pKey);
+	return false;
+}
+
+bool CServerListParser::OnString(const char *pValue)
+{
+	const int Role = ValueRole();
+	switch(Role)
+	{
+	case ROLE_ADDRESS:
+	{
+		NETADDR Addr;
+		// skip unknown addresses
+		if(!ServerbrowserParseUrl(&Addr, pValue) && m_NumAddresses < (int)std::size(m_aAddresses))
+			m_aAddresses[m_NumAddresses++] = Addr;
+		return false;
+	}
+	case ROLE_LOCATION:
+		return CServerInfo::ParseLocation(&m_Location, pValue);
+	case ROLE_LEGACY_SERVER:
+	{
+		NETADDR Addr;
+		if(net_addr_from_str(&Addr, pValue))
+			return true;
+		m_vLegacyServers.push_back(Addr);
+		return false;
+	}
+	case ROLE_CLIENT_SCORE_KIND:
+		if(str_startswith(pValue, "points"))
+			m_Info.m_ClientScoreKind = CServerInfo::CLIENT_SCORE_KIND_POINTS;
+		else if(str_startswith(pValue, "time"))
+			m_Info.m_ClientScoreKind = CServerInfo::CLIENT_SCORE_KIND_TIME;
+		return false;
+	case ROLE_GAME_TYPE:
+	case ROLE_NAME:
+	case ROLE_MAP_NAME:
+	case ROLE_VERSION:
+		if(str_has_cc(pValue))
+			return Mismatch(Role);
+		if(Role == ROLE_GAME_TYPE)
+			str_copy(m_Info.m_aGameType, pValue);
+		else if(Role == ROLE_NAME)
+			str_copy(m_Info.m_aName, pValue);
+		else if(Role == ROLE_MAP_NAME)
+			str_copy(m_Info.m_aMapName, pValue);
+		else
+			str_copy(m_Info.m_aVersion, pValue);
+		m_InfoFields |= 1 << (Role - ROLE_MAX_CLIENTS);
+		return false;
+	case ROLE_CLIENT_NAME:
+		if(str_has_cc(pValue))
+			return Mismatch(Role);
+		str_copy(Client()->m_aName, pValue);
+		m_ClientFields |= 1 << (Role - ROLE_CLIENT_NAME);
+		return false;
+	case ROLE_CLAN:
+		str_copy(Client()->m_aClan, pValue);
+		m_ClientFields |= 1 << (Role - ROLE_CLIENT_NAME);
+		return false;
+	case ROLE_SKIN_NAME:
+		str_copy(Client()->m_aSkin, pValue);
+		m_GotSkin = true;
+		return false;
+	default:
+		return Mismatch(Role);
+	}
+}
+
+bool CServerListParser::OnInt(int64_t Value)
+{
+	const int Role = ValueRole();
+	switch(Role)
+	{
+	case ROLE_MAX_CLIENTS:
+		m_Info.m_MaxClients = Value;
+		m_InfoFields |= 1 << (Role - ROLE_MAX_CLIENTS);
+		return false;
+	case ROLE_MAX_PLAYERS:
+		m_Info.m_MaxPlayers = Value;
+		m_InfoFields |= 1 << (Role - ROLE_MAX_CLIENTS);
+		return false;
+	case ROLE_COUNTRY:
+		Client()->m_Country = Value;
+		m_ClientFields |= 1 << (Role - ROLE_CLIENT_NAME);
+		return false;
+	case ROLE_SCORE:
+		Client()->m_Score = Value;
+		m_ClientFields |= 1 << (Role - ROLE_CLIENT_NAME);
+		return false;
+	case ROLE_SKIN_COLOR_BODY:
+	case ROLE_SKIN_COLOR_FEET:
+		m_aSkinColors[Role - ROLE_SKIN_COLOR_BODY] = Value;
+		m_GotSkinColors[Role - ROLE_SKIN_COLOR_BODY] = true;
+		return false;
+	default:
+		return Mismatch(Role);
+	}
+}
+
+bool CServerListParser::OnBool(bool Value)
+{
+	const int Role = ValueRole();
+	switch(Role)
+	{
+	case ROLE_PASSWORDED:
+		m_Info.m_Passworded = Value;
+		m_InfoFields |= 1 << (Role - ROLE_MAX_CLIENTS);
+		return false;
+	case ROLE_IS_PLAYER:
+		Client()->m_IsPlayer = Value;
+		m_ClientFields |= 1 << (Role - ROLE_CLIENT_NAME);
+		return false;
+	case ROLE_AFK:
+		Client()->m_IsAfk = Value;
+		return false;
+	default:
+		return Mismatch(Role);
+	}
+}
+
+bool CServerListParser::Finish(std::vector<CServerInfo> *pvServers, std::vector<NETADDR> *pvLegacyServers)
+{
+	if(CJsonReader::Finish() || !m_GotServers)
+	{
+		return true;
 	}
-	*pvServers = vServers;
-	*pvLegacyServers = vLegacyServers;
+	*pvServers = std::move(m_vServers);
+	*pvLegacyServers = std::move(m_vLegacyServers);
 	return false;
 }
 
@@ -507,5 +821,5 @@ IServerBrowserHttp *CreateServerBrowserHttp(IEngine *pEngine, IConsole *pConsole
 			break;
 		}
 	}
-	return new CServerBrowserHttp(pEngine, pConsole, ppUrls, NumUrls, PreviousBestIndex);
+	return new CServerBrowserHttp(pEngine, pConsole, pStorage, ppUrls, NumUrls, PreviousBestIndex);
 }
@@ -2,7 +2,12 @@
 #define ENGINE_CLIENT_SERVERBROWSER_HTTP_H
 #include <base/system.h>
 
-class CServerInfo;
+#include <engine/serverbrowser.h>
+#include <engine/shared/jsonreader.h>
+#include <engine/shared/serverinfo.h>
+
+#include <vector>
+
 class IConsole;
 class IEngine;
 class IStorage;
@@ -25,5 +30,82 @@ public:
 	virtual const NETADDR &LegacyServer(int Index) const = 0;
 };
 
+// Reads the serverlist of the masters while it is being downloaded, without
+// building a JSON document first. Servers with invalid info are skipped,
+// anything else that doesn't match the format is an error.
+class CServerListParser : public CJsonReader
+{
+	friend class ServerListParser;
+
+	enum
+	{
+		FRAME_IGNORED,
+		FRAME_ROOT,
+		FRAME_SERVERS,
+		FRAME_SERVER,
+		FRAME_ADDRESSES,
+		FRAME_INFO,
+		FRAME_MAP,
+		FRAME_CLIENTS,
+		FRAME_CLIENT,
+		FRAME_SKIN,
+		FRAME_LEGACY_SERVERS,
+	};
+
+	// what the open objects and arrays are
+	std::vector<int> m_vFrames;
+	// last key of the innermost object
+	char m_aKey[32];
+	bool m_GotServers = false;
+
+	// server that is being read
+	bool m_GotAddresses;
+	bool m_InvalidAddress;
+	int m_NumAddresses;
+	NETADDR m_aAddresses[MAX_SERVER_ADDRESSES];
+	int m_Location;
+
+	// its info, invalid if not all required fields were present
+	bool m_GotInfo;
+	bool m_InvalidInfo;
+	unsigned m_InfoFields;
+	CServerInfo2 m_Info;
+
+	// client of the info that is being read, beyond the maximum number of
+	// clients it is only validated
+	unsigned m_ClientFields;
+	CServerInfo2::CClient m_IgnoredClient;
+	bool m_GotSkin;
+	bool m_GotSkinColors[2];
+	int m_aSkinColors[2];
+
+	std::vector<CServerInfo> m_vServers;
+	std::vector<NETADDR> m_vLegacyServers;
+
+	// what the next value is, depending on where it is
+	int ValueRole() const;
+	bool Mismatch(int Role);
+	bool Begin(int Frame);
+	bool End();
+	CServerInfo2::CClient *Client();
+
+protected:
+	bool OnBeginObject() override;
+	bool OnEndObject() override { return End(); }
+	bool OnBeginArray() override;
+	bool OnEndArray() override { return End(); }
+	bool OnKey(const char *pKey) override;
+	bool OnString(const char *pValue) override;
+	bool OnInt(int64_t Value) override;
+	bool OnDouble(double Value) override { return Mismatch(ValueRole()); }
+	bool OnBool(bool Value) override;
+	bool OnNull() override { return Mismatch(ValueRole()); }
+
+public:
+	// Returns true if the serverlist was invalid or incomplete, the parsed
+	// servers are only returned otherwise.
+	bool Finish(std::vector<CServerInfo> *pvServers, std::vector<NETADDR> *pvLegacyServers);
+};
+
 IServerBrowserHttp *CreateServerBrowserHttp(IEngine *pEngine, IConsole *pConsole, IStorage *pStorage, const char *pPreviousBestUrl);
 #endif // ENGINE_CLIENT_SERVERBROWSER_HTTP_H
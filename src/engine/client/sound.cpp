@@ -10,6 +10,7 @@
 #include <engine/storage.h>
 
 #include "sound.h"
+#include "sound_mix.h"
 
 #if defined(CONF_VIDEORECORDER)
 #include <engine/shared/video.h>
@@ -36,13 +37,6 @@ void CSound::Mix(short *pFinalOut, unsigned Frames)
 		if(!Voice.m_pSample)
 			continue;
 
-		// mix voice
-		int *pOut = m_pMixBuffer;
-
-		const int Step = Voice.m_pSample->m_Channels; // setup input sources
-		short *pInL = &Voice.m_pSample->m_pData[Voice.m_Tick * Step];
-		short *pInR = &Voice.m_pSample->m_pData[Voice.m_Tick * Step + 1];
-
 		unsigned End = Voice.m_pSample->m_NumFrames - Voice.m_Tick;
 
 		int VolumeR = round_truncate(Voice.m_pChannel->m_Vol * (Voice.m_Vol / 255.0f));
@@ -52,10 +46,6 @@ void CSound::Mix(short *pFinalOut, unsigned Frames)
 		if(Frames < End)
 			End = Frames;
 
-		// check if we have a mono sound
-		if(Voice.m_pSample->m_Channels == 1)
-			pInR = pInL;
-
 		// volume calculation
 		if(Voice.m_Flags & ISound::FLAG_POS && Voice.m_pChannel->m_Pan)
 		{
@@ -146,15 +136,20 @@ void CSound::Mix(short *pFinalOut, unsigned Frames)
 			}
 		}
 
-		// process all frames
-		for(unsigned s = 0; s < End; s++)
+		// inaudible voices only advance
+		if(VolumeL != 0 || VolumeR != 0)
 		{
-			*pOut++ += (*pInL) * VolumeL;
-			*pOut++ += (*pInR) * VolumeR;
-			pInL += Step;
-			pInR += Step;
-			Voice.m_Tick++;
+			if(Voice.m_pSample->m_pData)
+			{
+				const int Channels = Voice.m_pSample->m_Channels;
+				MixVoice(m_pMixBuffer, &Voice.m_pSample->m_pData[Voice.m_Tick * Channels], Channels, End, VolumeL, VolumeR);
+			}
+			else if(const short *pData = DecodeStream(Voice, End))
+			{
+				MixVoice(m_pMixBuffer, pData, 2, End, VolumeL, VolumeR);
+			}
 		}
+		Voice.m_Tick += End;
 
 		// free voice if not used any more
 		if(Voice.m_Tick == Voice.m_pSample->m_NumFrames)
@@ -172,8 +167,7 @@ void CSound::Mix(short *pFinalOut, unsigned Frames)
 	m_SoundLock.unlock();
 
 	// clamp accumulated values
-	for(unsigned i = 0; i < Frames * 2; i++)
-		pFinalOut[i] = clamp<int>(((m_pMixBuffer[i] * MasterVol) / 101) >> 8, std::numeric_limits<short>::min(), std::numeric_limits<short>::max());
+	MixFinish(pFinalOut, m_pMixBuffer, Frames * 2, MasterVol);
 
 #if defined(CONF_ARCH_ENDIAN_BIG)
 	swap_endian(pFinalOut, sizeof(short), Frames * 2);
@@ -272,6 +266,11 @@ void CSound::Shutdown()
 	SDL_QuitSubSystem(SDL_INIT_AUDIO);
 	free(m_pMixBuffer);
 	m_pMixBuffer = nullptr;
+	for(auto &Voice : m_aVoices)
+	{
+		free(Voice.m_pStreamBuffer);
+		Voice.m_pStreamBuffer = nullptr;
+	}
 }
 
 int CSound::AllocID()
@@ -279,7 +278,7 @@ int CSound::AllocID()
 	// TODO: linear search, get rid of it
 	for(unsigned SampleID = 0; SampleID < NUM_SAMPLES; SampleID++)
 	{
-		if(m_aSamples[SampleID].m_pData == nullptr)
+		if(m_aSamples[SampleID].m_pData == nullptr && m_aSamples[SampleID].m_pOpusData == nullptr)
 			return SampleID;
 	}
 
@@ -334,9 +333,30 @@ bool CSound::DecodeOpus(CSample &Sample, const void *pData, unsigned DataSize)
 		if(Sample.m_Channels > 2)
 		{
 			dbg_msg("sound/opus", "file is not mono or stereo.");
+			op_free(pOpusFile);
 			return false;
 		}
 
+		Sample.m_LoopStart = -1;
+		Sample.m_LoopEnd = -1;
+		Sample.m_PausedAt = 0;
+
+		// long samples are decoded while they play, which requires them to
+		// be at the mixing rate already
+		const size_t DecodedSize = (size_t)maximum(NumSamples, 0) * NumChannels * sizeof(short);
+		if(m_SoundEnabled && g_Config.m_SndStreamThreshold > 0 && m_MixingRate == 48000 && DecodedSize > (size_t)g_Config.m_SndStreamThreshold * 1024)
+		{
+			op_free(pOpusFile);
+			Sample.m_pOpusData = (unsigned char *)malloc(DataSize);
+			mem_copy(Sample.m_pOpusData, pData, DataSize);
+			Sample.m_OpusDataSize = DataSize;
+			Sample.m_NumFrames = NumSamples;
+			Sample.m_Rate = 48000;
+			if(g_Config.m_Debug)
+				dbg_msg("sound/opus", "streaming sample, %d KiB instead of %d KiB", DataSize / 1024, (int)(DecodedSize / 1024));
+			return true;
+		}
+
 		Sample.m_pData = (short *)calloc((size_t)NumSamples * NumChannels, sizeof(short));
 
 		int Pos = 0;
@@ -346,19 +366,19 @@ bool CSound::DecodeOpus(CSample &Sample, const void *pData, unsigned DataSize)
 			if(Read < 0)
 			{
 				free(Sample.m_pData);
+				Sample.m_pData = nullptr;
 				dbg_msg("sound/opus", "op_read error %d at %d", Read, Pos);
+				op_free(pOpusFile);
 				return false;
 			}
 			else if(Read == 0) // EOF
 				break;
 			Pos += Read;
 		}
+		op_free(pOpusFile);
 
 		Sample.m_NumFrames = Pos;
 		Sample.m_Rate = 48000;
-		Sample.m_LoopStart = -1;
-		Sample.m_LoopEnd = -1;
-		Sample.m_PausedAt = 0;
 	}
 	else
 	{
@@ -369,6 +389,64 @@ bool CSound::DecodeOpus(CSample &Sample, const void *pData, unsigned DataSize)
 	return true;
 }
 
+bool CSound::OpenStream(CVoice &Voice)
+{
+	if(Voice.m_pOpusFile && Voice.m_pStreamSample == Voice.m_pSample)
+		return true;
+
+	CloseStream(Voice);
+	if(!Voice.m_pStreamBuffer)
+		Voice.m_pStreamBuffer = (short *)calloc((size_t)m_MaxFrames * 2, sizeof(short));
+	Voice.m_pOpusFile = op_open_memory(Voice.m_pSample->m_pOpusData, Voice.m_pSample->m_OpusDataSize, nullptr);
+	if(!Voice.m_pOpusFile)
+	{
+		dbg_msg("sound/opus", "failed to open stream");
+		return false;
+	}
+	Voice.m_pStreamSample = Voice.m_pSample;
+	Voice.m_StreamTick = 0;
+	return true;
+}
+
+void CSound::CloseStream(CVoice &Voice)
+{
+	if(Voice.m_pOpusFile)
+		op_free(Voice.m_pOpusFile);
+	Voice.m_pOpusFile = nullptr;
+	Voice.m_pStreamSample = nullptr;
+}
+
+const short *CSound::DecodeStream(CVoice &Voice, unsigned Frames)
+{
+	short *pBuffer = Voice.m_pStreamBuffer;
+	if(!pBuffer)
+		return nullptr;
+
+	unsigned Decoded = 0;
+	if(Voice.m_pOpusFile && Voice.m_pStreamSample == Voice.m_pSample)
+	{
+		// the voice was moved, looped or not decoded while it was inaudible
+		if(Voice.m_StreamTick != Voice.m_Tick)
+			Voice.m_StreamTick = op_pcm_seek(Voice.m_pOpusFile, Voice.m_Tick) == 0 ? Voice.m_Tick : -1;
+
+		if(Voice.m_StreamTick == Voice.m_Tick)
+		{
+			while(Decoded < Frames)
+			{
+				const int Read = op_read_stereo(Voice.m_pOpusFile, &pBuffer[Decoded * 2], (Frames - Decoded) * 2);
+				if(Read <= 0)
+					break;
+				Decoded += Read;
+			}
+			Voice.m_StreamTick += Decoded;
+		}
+	}
+
+	// play silence for what could not be decoded
+	mem_zero(&pBuffer[Decoded * 2], (size_t)(Frames - Decoded) * 2 * sizeof(short));
+	return pBuffer;
+}
+
 // TODO: Update WavPack to get rid of these global variables
 static const void *s_pWVBuffer = nullptr;
 static int s_WVBufferPosition = 0;
@@ -614,8 +692,20 @@ void CSound::UnloadSample(int SampleID)
 		return;
 
 	Stop(SampleID);
+	{
+		// decoders read the compressed data directly
+		std::unique_lock<std::mutex> Lock(m_SoundLock);
+		for(auto &Voice : m_aVoices)
+		{
+			if(Voice.m_pStreamSample == &m_aSamples[SampleID])
+				CloseStream(Voice);
+		}
+	}
 	free(m_aSamples[SampleID].m_pData);
 	m_aSamples[SampleID].m_pData = nullptr;
+	free(m_aSamples[SampleID].m_pOpusData);
+	m_aSamples[SampleID].m_pOpusData = nullptr;
+	m_aSamples[SampleID].m_OpusDataSize = 0;
 }
 
 float CSound::GetSampleTotalTime(int SampleID)
@@ -833,6 +923,8 @@ ISound::CVoiceHandle CSound::Play(int ChannelID, int SampleID, int Flags, float
 		m_aVoices[VoiceID].m_Falloff = 0.0f;
 		m_aVoices[VoiceID].m_Shape = ISound::SHAPE_CIRCLE;
 		m_aVoices[VoiceID].m_Circle.m_Radius = 1500;
+		if(m_aSamples[SampleID].m_pOpusData)
+			OpenStream(m_aVoices[VoiceID]);
 		Age = m_aVoices[VoiceID].m_Age;
 	}
 
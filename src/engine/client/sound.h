@@ -10,9 +10,15 @@
 #include <atomic>
 #include <mutex>
 
+struct OggOpusFile;
+
 struct CSample
 {
 	short *m_pData;
+	// compressed data of long Opus samples, which are decoded while they
+	// play instead of being stored in `m_pData`
+	unsigned char *m_pOpusData;
+	unsigned m_OpusDataSize;
 	int m_NumFrames;
 	int m_Rate;
 	int m_Channels;
@@ -44,6 +50,12 @@ struct CVoice
 		ISound::CVoiceShapeCircle m_Circle;
 		ISound::CVoiceShapeRectangle m_Rectangle;
 	};
+
+	// decoder of streamed samples, kept until the voice plays another one
+	OggOpusFile *m_pOpusFile;
+	const CSample *m_pStreamSample;
+	int m_StreamTick; // next frame the decoder returns
+	short *m_pStreamBuffer; // one mixing block of stereo frames
 };
 
 class CSound : public IEngineSound
@@ -79,6 +91,9 @@ class CSound : public IEngineSound
 	void RateConvert(CSample &Sample);
 
 	bool DecodeOpus(CSample &Sample, const void *pData, unsigned DataSize);
+	bool OpenStream(CVoice &Voice);
+	void CloseStream(CVoice &Voice);
+	const short *DecodeStream(CVoice &Voice, unsigned Frames);
 	bool DecodeWV(CSample &Sample, const void *pData, unsigned DataSize);
 
 	void UpdateVolume();
@@ -0,0 +1,75 @@
+#include "sound_mix.h"
+
+#include <base/math.h>
+
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SOUND_MIX_SSE2
+#endif
+
+#if defined(SOUND_MIX_SSE2)
+// adds the products of eight samples and volumes to eight values of the mix buffer
+static inline void MixProducts(int *pOut, __m128i Samples, __m128i Volumes)
+{
+	const __m128i Low = _mm_mullo_epi16(Samples, Volumes);
+	const __m128i High = _mm_mulhi_epi16(Samples, Volumes);
+	__m128i *pOut128 = (__m128i *)pOut;
+	_mm_storeu_si128(pOut128, _mm_add_epi32(_mm_loadu_si128(pOut128), _mm_unpacklo_epi16(Low, High)));
+	_mm_storeu_si128(pOut128 + 1, _mm_add_epi32(_mm_loadu_si128(pOut128 + 1), _mm_unpackhi_epi16(Low, High)));
+}
+#endif
+
+void MixVoice(int *pOut, const short *pIn, int Channels, unsigned Frames, int VolumeL, int VolumeR)
+{
+	unsigned Frame = 0;
+#if defined(SOUND_MIX_SSE2)
+	// the volumes are multiplied as 16 bit values
+	const auto &&FitsShort = [](int Volume) {
+		return Volume >= std::numeric_limits<short>::min() && Volume <= std::numeric_limits<short>::max();
+	};
+	if(FitsShort(VolumeL) && FitsShort(VolumeR))
+	{
+		const __m128i Volumes = _mm_set_epi16(VolumeR, VolumeL, VolumeR, VolumeL, VolumeR, VolumeL, VolumeR, VolumeL);
+		if(Channels == 1)
+		{
+			for(; Frame + 8 <= Frames; Frame += 8)
+			{
+				const __m128i Samples = _mm_loadu_si128((const __m128i *)&pIn[Frame]);
+				MixProducts(&pOut[Frame * 2], _mm_unpacklo_epi16(Samples, Samples), Volumes);
+				MixProducts(&pOut[Frame * 2 + 8], _mm_unpackhi_epi16(Samples, Samples), Volumes);
+			}
+		}
+		else
+		{
+			for(; Frame + 4 <= Frames; Frame += 4)
+				MixProducts(&pOut[Frame * 2], _mm_loadu_si128((const __m128i *)&pIn[Frame * 2]), Volumes);
+		}
+	}
+#endif
+
+	// remaining frames, or all of them without SSE2
+	if(Channels == 1)
+	{
+		for(; Frame < Frames; Frame++)
+		{
+			pOut[Frame * 2] += pIn[Frame] * VolumeL;
+			pOut[Frame * 2 + 1] += pIn[Frame] * VolumeR;
+		}
+	}
+	else
+	{
+		for(; Frame < Frames; Frame++)
+		{
+			pOut[Frame * 2] += pIn[Frame * 2] * VolumeL;
+			pOut[Frame * 2 + 1] += pIn[Frame * 2 + 1] * VolumeR;
+		}
+	}
+}
+
+void MixFinish(short *pOut, const int *pIn, unsigned Samples, int MasterVolume)
+{
+	for(unsigned i = 0; i < Samples; i++)
+		pOut[i] = clamp<int>(((pIn[i] * MasterVolume) / 101) >> 8, std::numeric_limits<short>::min(), std::numeric_limits<short>::max());
+}
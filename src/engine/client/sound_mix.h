@@ -0,0 +1,23 @@
+#ifndef ENGINE_CLIENT_SOUND_MIX_H
+#define ENGINE_CLIENT_SOUND_MIX_H
+
+/**
+ * Adds `Frames` frames of the sample data to the stereo mix buffer.
+ *
+ * @param pOut Interleaved stereo mix buffer, `Frames * 2` values.
+ * @param pIn Sample data with `Channels` interleaved channels, 1 or 2.
+ * @param VolumeL Volume of the left channel, 255 is full volume.
+ * @param VolumeR Volume of the right channel, 255 is full volume.
+ */
+void MixVoice(int *pOut, const short *pIn, int Channels, unsigned Frames, int VolumeL, int VolumeR);
+
+/**
+ * Scales the mix buffer by the master volume and clamps it into the output.
+ *
+ * @param pOut Output, `Samples` values.
+ * @param pIn Mix buffer, `Samples` values.
+ * @param MasterVolume Master volume, 100 is full volume.
+ */
+void MixFinish(short *pOut, const int *pIn, unsigned Samples, int MasterVolume);
+
+#endif
@@ -1,11 +1,15 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/hash_ctxt.h>
 #include <base/log.h>
 #include <base/math.h>
 #include <base/system.h>
 
 #include <engine/console.h>
+#include <engine/engine.h>
 #include <engine/graphics.h>
+#include <engine/shared/config.h>
+#include <engine/shared/jobs.h>
 #include <engine/shared/json.h>
 #include <engine/storage.h>
 #include <engine/textrender.h>
@@ -14,9 +18,14 @@
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
+#include <zlib.h>
+
 #include <chrono>
 #include <cstddef>
 #include <limits>
+#include <memory>
+#include <set>
+#include <string>
 #include <tuple>
 #include <unordered_map>
 #include <vector>
@@ -76,6 +85,106 @@ struct SGlyphKeyEquals
 	}
 };
 
+// a glyph rendered by FreeType, padded for the outline
+struct SGlyphBitmap
+{
+	unsigned m_Width;
+	unsigned m_Height;
+	unsigned m_RealWidth;
+	unsigned m_RealHeight;
+	float m_OffsetX;
+	float m_OffsetY;
+	float m_AdvanceX;
+};
+
+static constexpr size_t GLYPH_DATA_SIZE = 64 * 1024;
+
+static void Grow(const unsigned char *pIn, unsigned char *pOut, int w, int h, int OutlineCount)
+{
+	for(int y = 0; y < h; y++)
+	{
+		for(int x = 0; x < w; x++)
+		{
+			int c = pIn[y * w + x];
+
+			for(int sy = -OutlineCount; sy <= OutlineCount; sy++)
+			{
+				for(int sx = -OutlineCount; sx <= OutlineCount; sx++)
+				{
+					int GetX = x + sx;
+					int GetY = y + sy;
+					if(GetX >= 0 && GetY >= 0 && GetX < w && GetY < h)
+					{
+						int Index = GetY * w + GetX;
+						if(pIn[Index] > c)
+							c = pIn[Index];
+					}
+				}
+			}
+
+			pOut[y * w + x] = c;
+		}
+	}
+}
+
+static int AdjustOutlineThicknessToFontSize(int OutlineThickness, int FontSize)
+{
+	if(FontSize > 48)
+		OutlineThickness *= 4;
+	else if(FontSize >= 18)
+		OutlineThickness *= 2;
+	return OutlineThickness;
+}
+
+// Renders the glyph and its outline into `pFill` and `pOutline`, which have
+// to hold `GLYPH_DATA_SIZE` bytes. A face can only be used by one thread.
+static bool RasterizeGlyph(FT_Face Face, FT_UInt GlyphIndex, int FontSize, int Chr, SGlyphBitmap &Bitmap, uint8_t *pFill, uint8_t *pOutline)
+{
+	FT_Set_Pixel_Sizes(Face, 0, FontSize);
+
+	if(FT_Load_Glyph(Face, GlyphIndex, FT_LOAD_RENDER | FT_LOAD_NO_BITMAP))
+	{
+		log_debug("textrender", "Error loading glyph. Chr=%d GlyphIndex=%u", Chr, GlyphIndex);
+		return false;
+	}
+
+	const FT_Bitmap *pBitmap = &Face->glyph->bitmap;
+
+	const unsigned RealWidth = pBitmap->width;
+	const unsigned RealHeight = pBitmap->rows;
+
+	// adjust spacing
+	int OutlineThickness = 0;
+	int x = 0;
+	int y = 0;
+	if(RealWidth > 0)
+	{
+		OutlineThickness = AdjustOutlineThicknessToFontSize(1, FontSize);
+		x += (OutlineThickness + 1);
+		y += (OutlineThickness + 1);
+	}
+
+	Bitmap.m_Width = RealWidth + x * 2;
+	Bitmap.m_Height = RealHeight + y * 2;
+	Bitmap.m_RealWidth = RealWidth;
+	Bitmap.m_RealHeight = RealHeight;
+	Bitmap.m_OffsetX = (Face->glyph->metrics.horiBearingX >> 6);
+	Bitmap.m_OffsetY = -((Face->glyph->metrics.height >> 6) - (Face->glyph->metrics.horiBearingY >> 6));
+	Bitmap.m_AdvanceX = (Face->glyph->advance.x >> 6);
+
+	if(Bitmap.m_Width > 0 && Bitmap.m_Height > 0)
+	{
+		// prepare glyph data
+		mem_zero(pFill, (size_t)Bitmap.m_Width * Bitmap.m_Height * sizeof(uint8_t));
+		for(unsigned py = 0; py < pBitmap->rows; ++py)
+		{
+			mem_copy(&pFill[(py + y) * Bitmap.m_Width + x], &pBitmap->buffer[py * pBitmap->width], pBitmap->width);
+		}
+		Grow(pFill, pOutline, Bitmap.m_Width, Bitmap.m_Height, OutlineThickness);
+	}
+	return true;
+}
+
 class CAtlas
 {
 	struct SSectionKeyHash
@@ -172,6 +281,37 @@ class CAtlas
 	}
 
 public:
+	struct SFreeSection
+	{
+		uint32_t m_X;
+		uint32_t m_Y;
+		uint32_t m_W;
+		uint32_t m_H;
+	};
+
+	// the free space of the atlas, to store and restore it
+	std::vector<SFreeSection> FreeSections() const
+	{
+		std::vector<SFreeSection> vFreeSections;
+		const auto &&AddSections = [&](const std::vector<SSection> &vSections) {
+			for(const SSection &Section : vSections)
+				vFreeSections.push_back({(uint32_t)Section.m_X, (uint32_t)Section.m_Y, (uint32_t)Section.m_W, (uint32_t)Section.m_H});
+		};
+		AddSections(m_vSections);
+		for(const auto &[Size, vSections] : m_SectionsMap)
+			AddSections(vSections);
+		return vFreeSections;
+	}
+
+	void SetFreeSections(size_t TextureDimension, const std::vector<SFreeSection> &vFreeSections)
+	{
+		m_TextureDimension = TextureDimension;
+		m_vSections.clear();
+		m_SectionsMap.clear();
+		for(const SFreeSection &Section : vFreeSections)
+			AddSection(Section.m_X, Section.m_Y, Section.m_W, Section.m_H);
+	}
+
 	void Clear(size_t TextureDimension)
 	{
 		m_TextureDimension = TextureDimension;
@@ -271,6 +411,108 @@ public:
 	}
 };
 
+// the font data of a face, to load it again on another thread
+struct SFaceSource
+{
+	const FT_Byte *m_pData;
+	FT_Long m_DataSize;
+	FT_Long m_FaceIndex;
+};
+
+// renders glyphs with its own FreeType library, so the glyph map only has
+// to put them into the atlas
+class CGlyphPrewarmJob : public IJob
+{
+	std::vector<SFaceSource> m_vFaceSources;
+
+	void Run() override
+	{
+		FT_Library Library;
+		if(FT_Init_FreeType(&Library))
+			return;
+		std::vector<FT_Face> vFaces(m_vFaceSources.size(), nullptr);
+		std::vector<uint8_t> vFill(GLYPH_DATA_SIZE);
+		std::vector<uint8_t> vOutline(GLYPH_DATA_SIZE);
+		for(const SRequest &Request : m_vRequests)
+		{
+			FT_Face &Face = vFaces[Request.m_Face];
+			const SFaceSource &Source = m_vFaceSources[Request.m_Face];
+			if(!Face && FT_New_Memory_Face(Library, Source.m_pData, Source.m_DataSize, Source.m_FaceIndex, &Face))
+			{
+				Face = nullptr;
+				continue;
+			}
+			SResult Result;
+			if(!RasterizeGlyph(Face, Request.m_GlyphIndex, Request.m_FontSize, Request.m_Chr, Result.m_Bitmap, vFill.data(), vOutline.data()))
+				continue;
+			Result.m_Request = Request;
+			const size_t Size = (size_t)Result.m_Bitmap.m_Width * Result.m_Bitmap.m_Height;
+			Result.m_vFill.assign(vFill.begin(), vFill.begin() + Size);
+			Result.m_vOutline.assign(vOutline.begin(), vOutline.begin() + Size);
+			m_vResults.push_back(std::move(Result));
+		}
+		for(FT_Face Face : vFaces)
+			if(Face)
+				FT_Done_Face(Face);
+		FT_Done_FreeType(Library);
+	}
+
+public:
+	CGlyphPrewarmJob(std::vector<SFaceSource> vFaceSources) :
+		m_vFaceSources(std::move(vFaceSources)) {}
+
+	struct SRequest
+	{
+		// index into the faces of the glyph map
+		int m_Face;
+		int m_Chr;
+		FT_UInt m_GlyphIndex;
+		int m_FontSize;
+	};
+	std::vector<SRequest> m_vRequests;
+
+	struct SResult
+	{
+		SRequest m_Request;
+		SGlyphBitmap m_Bitmap;
+		std::vector<uint8_t> m_vFill;
+		std::vector<uint8_t> m_vOutline;
+	};
+	std::vector<SResult> m_vResults;
+};
+
+// stored glyph of the atlas cache
+struct SGlyphRecord
+{
+	// index into the faces of the glyph map
+	int32_t m_Face;
+	int32_t m_Chr;
+	int32_t m_FontSize;
+	uint32_t m_GlyphIndex;
+	float m_Width;
+	float m_Height;
+	float m_CharWidth;
+	float m_CharHeight;
+	float m_OffsetX;
+	float m_OffsetY;
+	float m_AdvanceX;
+	float m_aUVs[4];
+};
+
+// The atlas cache stores the header, followed by the glyphs, the free
+// sections of the atlas and the compressed textures.
+struct SAtlasCacheHeader
+{
+	char m_aMagic[8];
+	SHA256_DIGEST m_Key;
+	uint32_t m_TextureDimension;
+	uint32_t m_NumGlyphs;
+	uint32_t m_NumSections;
+	uint32_t m_aCompressedSizes[2];
+};
+
+static const char ATLAS_CACHE_MAGIC[8] = {'D', 'D', 'G', 'L', 'Y', 'P', 'H', '1'};
+
 class CGlyphMap
 {
 public:
@@ -320,9 +562,11 @@ private:
 	uint8_t *m_apTextureData[NUM_FONT_TEXTURES];
 	CAtlas m_TextureAtlas;
 	std::unordered_map<std::tuple<FT_Face, int, int>, SGlyph, SGlyphKeyHash, SGlyphKeyEquals> m_Glyphs;
+	// changes whenever glyphs are moved or removed from the atlas
+	int m_AtlasGeneration = 0;
 
 	// Data used for rendering glyphs
-	uint8_t m_aaGlyphData[NUM_FONT_TEXTURES][64 * 1024];
+	uint8_t m_aaGlyphData[NUM_FONT_TEXTURES][GLYPH_DATA_SIZE];
 
 	// Font faces
 	FT_Face m_DefaultFace = nullptr;
@@ -331,6 +575,11 @@ private:
 	FT_Face m_SelectedFace = nullptr;
 	std::vector<FT_Face> m_vFallbackFaces;
 	std::vector<FT_Face> m_vFtFaces;
+	std::vector<SFaceSource> m_vFaceSources;
+
+	// whether glyphs were added since the atlas was loaded from the cache
+	bool m_CacheChanged = false;
+	std::shared_ptr<CGlyphPrewarmJob> m_pPrewarmJob;
 
 	FT_Face GetFaceByName(const char *pFamilyName)
 	{
@@ -383,6 +632,7 @@ private:
 		m_TextureAtlas.IncreaseDimension(NewTextureDimension);
 
 		m_TextureDimension = NewTextureDimension;
+		++m_AtlasGeneration;
 
 		UploadTextures();
 		return true;
@@ -448,43 +698,6 @@ private:
 		return GlyphIndex;
 	}
 
-	void Grow(const unsigned char *pIn, unsigned char *pOut, int w, int h, int OutlineCount) const
-	{
-		for(int y = 0; y < h; y++)
-		{
-			for(int x = 0; x < w; x++)
-			{
-				int c = pIn[y * w + x];
-
-				for(int sy = -OutlineCount; sy <= OutlineCount; sy++)
-				{
-					for(int sx = -OutlineCount; sx <= OutlineCount; sx++)
-					{
-						int GetX = x + sx;
-						int GetY = y + sy;
-						if(GetX >= 0 && GetY >= 0 && GetX < w && GetY < h)
-						{
-							int Index = GetY * w + GetX;
-							if(pIn[Index] > c)
-								c = pIn[Index];
-						}
-					}
-				}
-
-				pOut[y * w + x] = c;
-			}
-		}
-	}
-
-	int AdjustOutlineThicknessToFontSize(int OutlineThickness, int FontSize) const
-	{
-		if(FontSize > 48)
-			OutlineThickness *= 4;
-		else if(FontSize >= 18)
-			OutlineThickness *= 2;
-		return OutlineThickness;
-	}
-
 	void UploadGlyph(int TextureIndex, int PosX, int PosY, size_t Width, size_t Height, const unsigned char *pData)
 	{
 		for(size_t y = 0; y < Height; ++y)
@@ -499,42 +712,16 @@ private:
 		return m_TextureAtlas.Add(Width, Height, PosX, PosY);
 	}
 
-	bool RenderGlyph(SGlyph &Glyph)
+	// puts the glyph into the atlas, the textures are only updated if `Upload` is set
+	bool AddGlyph(SGlyph &Glyph, const SGlyphBitmap &Bitmap, const uint8_t *pFill, const uint8_t *pOutline, bool Upload)
 	{
-		FT_Set_Pixel_Sizes(Glyph.m_Face, 0, Glyph.m_FontSize);
-
-		if(FT_Load_Glyph(Glyph.m_Face, Glyph.m_GlyphIndex, FT_LOAD_RENDER | FT_LOAD_NO_BITMAP))
-		{
-			log_debug("textrender", "Error loading glyph. Chr=%d GlyphIndex=%u", Glyph.m_Chr, Glyph.m_GlyphIndex);
-			return false;
-		}
-
-		const FT_Bitmap *pBitmap = &Glyph.m_Face->glyph->bitmap;
-
-		const unsigned RealWidth = pBitmap->width;
-		const unsigned RealHeight = pBitmap->rows;
-
-		// adjust spacing
-		int OutlineThickness = 0;
-		int x = 0;
-		int y = 0;
-		if(RealWidth > 0)
-		{
-			OutlineThickness = AdjustOutlineThicknessToFontSize(1, Glyph.m_FontSize);
-			x += (OutlineThickness + 1);
-			y += (OutlineThickness + 1);
-		}
-
-		const unsigned Width = RealWidth + x * 2;
-		const unsigned Height = RealHeight + y * 2;
-
 		int X = 0;
 		int Y = 0;
 
-		if(Width > 0 && Height > 0)
+		if(Bitmap.m_Width > 0 && Bitmap.m_Height > 0)
 		{
 			// find space in atlas, or increase size if necessary
-			while(!FitGlyph(Width, Height, X, Y))
+			while(!FitGlyph(Bitmap.m_Width, Bitmap.m_Height, X, Y))
 			{
 				if(!IncreaseGlyphMapSize())
 				{
@@ -543,40 +730,76 @@ private:
 				}
 			}
 
-			// prepare glyph data
-			mem_zero(m_aaGlyphData[FONT_TEXTURE_FILL], (size_t)Width * Height * sizeof(uint8_t));
-			for(unsigned py = 0; py < pBitmap->rows; ++py)
+			if(Upload)
 			{
-				mem_copy(&m_aaGlyphData[FONT_TEXTURE_FILL][(py + y) * Width + x], &pBitmap->buffer[py * pBitmap->width], pBitmap->width);
+				UploadGlyph(FONT_TEXTURE_FILL, X, Y, Bitmap.m_Width, Bitmap.m_Height, pFill);
+				UploadGlyph(FONT_TEXTURE_OUTLINE, X, Y, Bitmap.m_Width, Bitmap.m_Height, pOutline);
+			}
+			else
+			{
+				for(size_t y = 0; y < Bitmap.m_Height; ++y)
+				{
+					mem_copy(&m_apTextureData[FONT_TEXTURE_FILL][X + ((y + Y) * m_TextureDimension)], &pFill[y * Bitmap.m_Width], Bitmap.m_Width);
+					mem_copy(&m_apTextureData[FONT_TEXTURE_OUTLINE][X + ((y + Y) * m_TextureDimension)], &pOutline[y * Bitmap.m_Width], Bitmap.m_Width);
+				}
 			}
-
-			// upload the glyph
-			UploadGlyph(FONT_TEXTURE_FILL, X, Y, Width, Height, m_aaGlyphData[FONT_TEXTURE_FILL]);
-			Grow(m_aaGlyphData[FONT_TEXTURE_FILL], m_aaGlyphData[FONT_TEXTURE_OUTLINE], Width, Height, OutlineThickness);
-			UploadGlyph(FONT_TEXTURE_OUTLINE, X, Y, Width, Height, m_aaGlyphData[FONT_TEXTURE_OUTLINE]);
 		}
 
 		// set glyph info
-		{
-			const int BmpWidth = pBitmap->width + x * 2;
-			const int BmpHeight = pBitmap->rows + y * 2;
+		Glyph.m_Height = Bitmap.m_Height;
+		Glyph.m_Width = Bitmap.m_Width;
+		Glyph.m_CharHeight = Bitmap.m_RealHeight;
+		Glyph.m_CharWidth = Bitmap.m_RealWidth;
+		Glyph.m_OffsetX = Bitmap.m_OffsetX;
+		Glyph.m_OffsetY = Bitmap.m_OffsetY;
+		Glyph.m_AdvanceX = Bitmap.m_AdvanceX;
+
+		Glyph.m_aUVs[0] = X;
+		Glyph.m_aUVs[1] = Y;
+		Glyph.m_aUVs[2] = Glyph.m_aUVs[0] + Bitmap.m_Width;
+		Glyph.m_aUVs[3] = Glyph.m_aUVs[1] + Bitmap.m_Height;
+
+		Glyph.m_State = SGlyph::EState::RENDERED;
+		m_CacheChanged = true;
+		return true;
+	}
 
-			Glyph.m_Height = Height;
-			Glyph.m_Width = Width;
-			Glyph.m_CharHeight = RealHeight;
-			Glyph.m_CharWidth = RealWidth;
-			Glyph.m_OffsetX = (Glyph.m_Face->glyph->metrics.horiBearingX >> 6);
-			Glyph.m_OffsetY = -((Glyph.m_Face->glyph->metrics.height >> 6) - (Glyph.m_Face->glyph->metrics.horiBearingY >> 6));
-			Glyph.m_AdvanceX = (Glyph.m_Face->glyph->advance.x >> 6);
+	bool RenderGlyph(SGlyph &Glyph)
+	{
+		SGlyphBitmap Bitmap;
+		if(!RasterizeGlyph(Glyph.m_Face, Glyph.m_GlyphIndex, Glyph.m_FontSize, Glyph.m_Chr, Bitmap, m_aaGlyphData[FONT_TEXTURE_FILL], m_aaGlyphData[FONT_TEXTURE_OUTLINE]))
+			return false;
+		return AddGlyph(Glyph, Bitmap, m_aaGlyphData[FONT_TEXTURE_FILL], m_aaGlyphData[FONT_TEXTURE_OUTLINE], true);
+	}
 
-			Glyph.m_aUVs[0] = X;
-			Glyph.m_aUVs[1] = Y;
-			Glyph.m_aUVs[2] = Glyph.m_aUVs[0] + BmpWidth;
-			Glyph.m_aUVs[3] = Glyph.m_aUVs[1] + BmpHeight;
+	int FaceIndex(FT_Face Face) const
+	{
+		for(size_t i = 0; i < m_vFtFaces.size(); i++)
+			if(m_vFtFaces[i] == Face)
+				return i;
+		return -1;
+	}
 
-			Glyph.m_State = SGlyph::EState::RENDERED;
+	// uploads the glyphs rendered in the background
+	void FinishPrewarm()
+	{
+		for(auto &Result : m_pPrewarmJob->m_vResults)
+		{
+			const CGlyphPrewarmJob::SRequest &Request = Result.m_Request;
+			SGlyph &Glyph = m_Glyphs[std::make_tuple(m_vFtFaces[Request.m_Face], Request.m_Chr, Request.m_FontSize)];
+			if(Glyph.m_State != SGlyph::EState::UNINITIALIZED)
+				continue;
+			Glyph.m_FontSize = Request.m_FontSize;
+			Glyph.m_Face = m_vFtFaces[Request.m_Face];
+			Glyph.m_Chr = Request.m_Chr;
+			Glyph.m_GlyphIndex = Request.m_GlyphIndex;
+			if(!AddGlyph(Glyph, Result.m_Bitmap, Result.m_vFill.data(), Result.m_vOutline.data(), false))
+				break;
 		}
-		return true;
+		m_pPrewarmJob = nullptr;
+
+		for(size_t TextureIndex = 0; TextureIndex < NUM_FONT_TEXTURES; ++TextureIndex)
+			Graphics()->UpdateTextTexture(m_aTextures[TextureIndex], 0, 0, m_TextureDimension, m_TextureDimension, m_apTextureData[TextureIndex]);
 	}
 
 public:
@@ -595,6 +818,9 @@ public:
 
 	~CGlyphMap()
 	{
+		// the job uses the font data, which is freed afterwards
+		while(m_pPrewarmJob && m_pPrewarmJob->Status() != IJob::STATE_DONE)
+			thread_yield();
 		UnloadTextures();
 		for(auto &pTextureData : m_apTextureData)
 		{
@@ -612,9 +838,10 @@ public:
 		return m_IconFace;
 	}
 
-	void AddFace(FT_Face Face)
+	void AddFace(FT_Face Face, const FT_Byte *pData, FT_Long DataSize)
 	{
 		m_vFtFaces.push_back(Face);
+		m_vFaceSources.push_back({pData, DataSize, Face->face_index});
 		if(!m_DefaultFace)
 			m_DefaultFace = Face;
 	}
@@ -648,6 +875,227 @@ public:
 		}
 	}
 
+	FT_Face SelectedFace() const
+	{
+		return m_SelectedFace;
+	}
+
+	int AtlasGeneration() const
+	{
+		return m_AtlasGeneration;
+	}
+
+	// Loads the atlas of the last session if it was stored for the same
+	// `Key`, which identifies the fonts and the way glyphs are rendered.
+	bool LoadCache(IStorage *pStorage, const char *pFilename, const SHA256_DIGEST &Key)
+	{
+		void *pFileData;
+		unsigned FileSize;
+		if(!pStorage->ReadFile(pFilename, IStorage::TYPE_SAVE, &pFileData, &FileSize))
+			return false;
+
+		const uint8_t *pData = (const uint8_t *)pFileData;
+		const uint8_t *pEnd = pData + FileSize;
+		const auto &&Read = [&](void *pDest, size_t Size) {
+			if((size_t)(pEnd - pData) < Size)
+				return false;
+			mem_copy(pDest, pData, Size);
+			pData += Size;
+			return true;
+		};
+
+		SAtlasCacheHeader Header;
+		bool Valid = Read(&Header, sizeof(Header)) &&
+			     mem_comp(Header.m_aMagic, ATLAS_CACHE_MAGIC, sizeof(Header.m_aMagic)) == 0 &&
+			     Header.m_Key == Key &&
+			     Header.m_TextureDimension >= INITIAL_ATLAS_DIMENSION && Header.m_TextureDimension <= MAXIMUM_ATLAS_DIMENSION &&
+			     (Header.m_TextureDimension & (Header.m_TextureDimension - 1)) == 0;
+
+		// the counts must fit into the file before anything is allocated for them
+		Valid = Valid && (uint64_t)Header.m_NumGlyphs * sizeof(SGlyphRecord) + (uint64_t)Header.m_NumSections * sizeof(CAtlas::SFreeSection) <= (uint64_t)(pEnd - pData);
+
+		std::vector<SGlyphRecord> vGlyphs(Valid ? Header.m_NumGlyphs : 0);
+		std::vector<CAtlas::SFreeSection> vSections(Valid ? Header.m_NumSections : 0);
+		Valid = Valid && Read(vGlyphs.data(), vGlyphs.size() * sizeof(SGlyphRecord)) && Read(vSections.data(), vSections.size() * sizeof(CAtlas::SFreeSection));
+
+		// glyphs and free sections must lie inside the atlas
+		const uint32_t Dimension = Header.m_TextureDimension;
+		const auto &&InsideAtlas = [Dimension](float Start, float End) {
+			return Start >= 0.0f && Start <= End && End <= (float)Dimension;
+		};
+		for(const SGlyphRecord &Record : vGlyphs)
+		{
+			Valid = Valid && Record.m_Face >= 0 && Record.m_Face < (int)m_vFtFaces.size() &&
+				InsideAtlas(Record.m_aUVs[0], Record.m_aUVs[2]) && InsideAtlas(Record.m_aUVs[1], Record.m_aUVs[3]);
+		}
+		for(const CAtlas::SFreeSection &Section : vSections)
+		{
+			Valid = Valid && Section.m_X <= Dimension && Section.m_W <= Dimension - Section.m_X &&
+				Section.m_Y <= Dimension && Section.m_H <= Dimension - Section.m_Y;
+		}
+
+		const size_t TextureSize = (size_t)Header.m_TextureDimension * Header.m_TextureDimension;
+		uint8_t *apTextureData[NUM_FONT_TEXTURES] = {nullptr};
+		for(size_t TextureIndex = 0; TextureIndex < NUM_FONT_TEXTURES && Valid; ++TextureIndex)
+		{
+			unsigned long UncompressedSize = TextureSize;
+			apTextureData[TextureIndex] = new uint8_t[TextureSize];
+			Valid = (size_t)(pEnd - pData) >= Header.m_aCompressedSizes[TextureIndex] &&
+				uncompress(apTextureData[TextureIndex], &UncompressedSize, pData, Header.m_aCompressedSizes[TextureIndex]) == Z_OK &&
+				UncompressedSize == TextureSize;
+			pData += Header.m_aCompressedSizes[TextureIndex];
+		}
+		free(pFileData);
+
+		if(!Valid)
+		{
+			for(auto *pTextureData : apTextureData)
+				delete[] pTextureData;
+			log_debug("textrender", "Glyph atlas cache is outdated or invalid");
+			return false;
+		}
+
+		UnloadTextures();
+		for(size_t TextureIndex = 0; TextureIndex < NUM_FONT_TEXTURES; ++TextureIndex)
+		{
+			delete[] m_apTextureData[TextureIndex];
+			m_apTextureData[TextureIndex] = apTextureData[TextureIndex];
+		}
+		m_TextureDimension = Header.m_TextureDimension;
+		m_TextureAtlas.SetFreeSections(m_TextureDimension, vSections);
+		UploadTextures();
+
+		m_Glyphs.clear();
+		for(const SGlyphRecord &Record : vGlyphs)
+		{
+			SGlyph &Glyph = m_Glyphs[std::make_tuple(m_vFtFaces[Record.m_Face], Record.m_Chr, Record.m_FontSize)];
+			Glyph.m_State = SGlyph::EState::RENDERED;
+			Glyph.m_FontSize = Record.m_FontSize;
+			Glyph.m_Face = m_vFtFaces[Record.m_Face];
+			Glyph.m_Chr = Record.m_Chr;
+			Glyph.m_GlyphIndex = Record.m_GlyphIndex;
+			Glyph.m_Width = Record.m_Width;
+			Glyph.m_Height = Record.m_Height;
+			Glyph.m_CharWidth = Record.m_CharWidth;
+			Glyph.m_CharHeight = Record.m_CharHeight;
+			Glyph.m_OffsetX = Record.m_OffsetX;
+			Glyph.m_OffsetY = Record.m_OffsetY;
+			Glyph.m_AdvanceX = Record.m_AdvanceX;
+			mem_copy(Glyph.m_aUVs, Record.m_aUVs, sizeof(Glyph.m_aUVs));
+		}
+		++m_AtlasGeneration;
+		m_CacheChanged = false;
+		log_debug("textrender", "Loaded %" PRIzu " glyphs from the glyph atlas cache", vGlyphs.size());
+		return true;
+	}
+
+	void SaveCache(IStorage *pStorage, const char *pFilename, const SHA256_DIGEST &Key)
+	{
+		if(!m_CacheChanged)
+			return;
+
+		std::vector<SGlyphRecord> vGlyphs;
+		for(const auto &[GlyphKey, Glyph] : m_Glyphs)
+		{
+			// replacement characters are stored under their own key
+			const int Face = FaceIndex(Glyph.m_Face);
+			if(Glyph.m_State != SGlyph::EState::RENDERED || Face < 0 || std::get<0>(GlyphKey) != Glyph.m_Face || std::get<1>(GlyphKey) != Glyph.m_Chr)
+				continue;
+			SGlyphRecord Record;
+			Record.m_Face = Face;
+			Record.m_Chr = Glyph.m_Chr;
+			Record.m_FontSize = Glyph.m_FontSize;
+			Record.m_GlyphIndex = Glyph.m_GlyphIndex;
+			Record.m_Width = Glyph.m_Width;
+			Record.m_Height = Glyph.m_Height;
+			Record.m_CharWidth = Glyph.m_CharWidth;
+			Record.m_CharHeight = Glyph.m_CharHeight;
+			Record.m_OffsetX = Glyph.m_OffsetX;
+			Record.m_OffsetY = Glyph.m_OffsetY;
+			Record.m_AdvanceX = Glyph.m_AdvanceX;
+			mem_copy(Record.m_aUVs, Glyph.m_aUVs, sizeof(Record.m_aUVs));
+			vGlyphs.push_back(Record);
+		}
+		const std::vector<CAtlas::SFreeSection> vSections = m_TextureAtlas.FreeSections();
+
+		SAtlasCacheHeader Header;
+		mem_zero(&Header, sizeof(Header));
+		mem_copy(Header.m_aMagic, ATLAS_CACHE_MAGIC, sizeof(Header.m_aMagic));
+		Header.m_Key = Key;
+		Header.m_TextureDimension = m_TextureDimension;
+		Header.m_NumGlyphs = vGlyphs.size();
+		Header.m_NumSections = vSections.size();
+
+		const size_t TextureSize = m_TextureDimension * m_TextureDimension;
+		std::vector<uint8_t> avCompressed[NUM_FONT_TEXTURES];
+		for(size_t TextureIndex = 0; TextureIndex < NUM_FONT_TEXTURES; ++TextureIndex)
+		{
+			unsigned long CompressedSize = compressBound(TextureSize);
+			avCompressed[TextureIndex].resize(CompressedSize);
+			if(compress(avCompressed[TextureIndex].data(), &CompressedSize, m_apTextureData[TextureIndex], TextureSize) != Z_OK)
+				return;
+			avCompressed[TextureIndex].resize(CompressedSize);
+			Header.m_aCompressedSizes[TextureIndex] = CompressedSize;
+		}
+
+		char aPath[IO_MAX_PATH_LENGTH];
+		pStorage->GetCompletePath(IStorage::TYPE_SAVE, pFilename, aPath, sizeof(aPath));
+		char aTmpPath[IO_MAX_PATH_LENGTH];
+		IStorage::FormatTmpPath(aTmpPath, sizeof(aTmpPath), aPath);
+		IOHANDLE File = fs_makedir_rec_for(aTmpPath) == 0 ? io_open(aTmpPath, IOFLAG_WRITE) : nullptr;
+		if(!File)
+		{
+			log_error("textrender", "Failed to write the glyph atlas cache '%s'", aTmpPath);
+			return;
+		}
+		bool Success = io_write(File, &Header, sizeof(Header)) == sizeof(Header);
+		Success &= io_write(File, vGlyphs.data(), vGlyphs.size() * sizeof(SGlyphRecord)) == vGlyphs.size() * sizeof(SGlyphRecord);
+		Success &= io_write(File, vSections.data(), vSections.size() * sizeof(CAtlas::SFreeSection)) == vSections.size() * sizeof(CAtlas::SFreeSection);
+		for(const auto &vCompressed : avCompressed)
+			Success &= io_write(File, vCompressed.data(), vCompressed.size()) == vCompressed.size();
+		Success &= io_close(File) == 0;
+		if(!Success || fs_rename(aTmpPath, aPath) != 0)
+		{
+			log_error("textrender", "Failed to write the glyph atlas cache '%s'", aPath);
+			fs_remove(aTmpPath);
+			return;
+		}
+		m_CacheChanged = false;
+	}
+
+	// Renders the given characters in the background for all font sizes
+	// that are already in the atlas, which are likely to be used again.
+	void Prewarm(IEngine *pEngine, const std::vector<std::pair<int, int>> &vCharacterRanges)
+	{
+		std::set<int> FontSizes;
+		for(const auto &[Key, Glyph] : m_Glyphs)
+			if(Glyph.m_State == SGlyph::EState::RENDERED)
+				FontSizes.insert(Glyph.m_FontSize);
+
+		auto pJob = std::make_shared<CGlyphPrewarmJob>(m_vFaceSources);
+		for(const int FontSize : FontSizes)
+		{
+			for(const auto &[First, Last] : vCharacterRanges)
+			{
+				for(int Chr = First; Chr <= Last; Chr++)
+				{
+					FT_Face Face;
+					const FT_UInt GlyphIndex = GetCharGlyph(Chr, &Face, false);
+					if(GlyphIndex == 0 || m_Glyphs.find(std::make_tuple(Face, Chr, FontSize)) != m_Glyphs.end())
+						continue;
+					pJob->m_vRequests.push_back({FaceIndex(Face), Chr, GlyphIndex, FontSize});
+				}
+			}
+		}
+		if(pJob->m_vRequests.empty())
+			return;
+
+		log_debug("textrender", "Prewarming %" PRIzu " glyphs", pJob->m_vRequests.size());
+		pJob->SetPriority(IJob::PRIORITY_LOW);
+		pEngine->AddJob(pJob);
+		m_pPrewarmJob = pJob;
+	}
+
 	void SetFontPreset(EFontPreset FontPreset)
 	{
 		switch(FontPreset)
@@ -671,6 +1119,8 @@ public:
 
 		m_TextureAtlas.Clear(m_TextureDimension);
 		m_Glyphs.clear();
+		++m_AtlasGeneration;
+		m_CacheChanged = true;
 	}
 
 	const SGlyph *GetGlyph(int Chr, int FontSize)
@@ -694,6 +1144,14 @@ public:
 		else if(Glyph.m_State == SGlyph::EState::ERROR)
 			return nullptr;
 
+		// The glyph might have been rendered in the background.
+		if(m_pPrewarmJob && m_pPrewarmJob->Status() == IJob::STATE_DONE)
+		{
+			FinishPrewarm();
+			if(Glyph.m_State == SGlyph::EState::RENDERED)
+				return &Glyph;
+		}
+
 		// Else, render it.
 		Glyph.m_FontSize = FontSize;
 		Glyph.m_Face = Face;
@@ -901,15 +1359,36 @@ struct STextContainer
 	}
 };
 
+// the result of laying out a string with `TextEx`, which can be moved
+// to a different position
+struct STextLayout
+{
+	// false while the string was only used once, it is then rendered with a
+	// one-time-use buffer like uncached text
+	bool m_LaidOut = false;
+	// invalid if nothing was rendered
+	STextContainerIndex m_TextContainerIndex;
+	// the cursor before and after the layout
+	float m_X;
+	float m_Y;
+	CTextCursor m_Cursor;
+	std::chrono::nanoseconds m_LastUse;
+};
+
 struct SFontLanguageVariant
 {
 	char m_aLanguageFile[IO_MAX_PATH_LENGTH];
 	char m_aFamilyName[FONT_NAME_SIZE];
 };
 
+static const char *const GLYPH_ATLAS_CACHE_FILE = "cache/glyph_atlas.bin";
+// increase when the rendering of glyphs or the format of the cache changes
+static constexpr int GLYPH_ATLAS_CACHE_VERSION = 1;
+
 class CTextRender : public IEngineTextRender
 {
 	IConsole *m_pConsole;
+	IEngine *m_pEngine;
 	IGraphics *m_pGraphics;
 	IStorage *m_pStorage;
 	IConsole *Console() { return m_pConsole; }
@@ -919,6 +1398,10 @@ class CTextRender : public IEngineTextRender
 	CGlyphMap *m_pGlyphMap;
 	std::vector<void *> m_vpFontData;
 
+	// hash of the loaded font faces, to identify the glyph atlas cache
+	SHA256_CTX m_FontsHash;
+	bool m_AtlasCacheLoaded = false;
+
 	std::vector<SFontLanguageVariant> m_vVariants;
 
 	unsigned m_RenderFlags;
@@ -937,6 +1420,91 @@ class CTextRender : public IEngineTextRender
 
 	std::chrono::nanoseconds m_CursorRenderTime;
 
+	enum
+	{
+		MAX_TEXT_LAYOUTS = 1024,
+	};
+
+	// layouts of the strings rendered or measured with `TextEx`, keyed by
+	// the layout parameters followed by the string
+	std::unordered_map<std::string, STextLayout> m_TextLayouts;
+	int m_TextLayoutsAtlasGeneration = 0;
+	std::chrono::nanoseconds m_LastTextLayoutCleanup{0};
+
+	void ClearTextLayouts()
+	{
+		for(auto &[Key, Layout] : m_TextLayouts)
+			DeleteTextContainer(Layout.m_TextContainerIndex);
+		m_TextLayouts.clear();
+	}
+
+	// removes the layouts that were not used for a second
+	void CleanupTextLayouts(std::chrono::nanoseconds Now)
+	{
+		if(m_pGlyphMap->AtlasGeneration() != m_TextLayoutsAtlasGeneration)
+		{
+			ClearTextLayouts();
+			m_TextLayoutsAtlasGeneration = m_pGlyphMap->AtlasGeneration();
+		}
+		if(Now - m_LastTextLayoutCleanup < 1s)
+			return;
+		m_LastTextLayoutCleanup = Now;
+		for(auto It = m_TextLayouts.begin(); It != m_TextLayouts.end();)
+		{
+			if(Now - It->second.m_LastUse > 1s)
+			{
+				DeleteTextContainer(It->second.m_TextContainerIndex);
+				It = m_TextLayouts.erase(It);
+			}
+			else
+				++It;
+		}
+	}
+
+	// Only layouts of a fresh cursor without selection are cached. The
+	// layout doesn't depend on the position of such a cursor, apart from the
+	// pixel alignment, which is applied when the layout is rendered.
+	bool IsTextLayoutCacheable(const CTextCursor *pCursor) const
+	{
+		return g_Config.m_GfxTextLayoutCache &&
+		       (m_RenderFlags & TEXT_RENDER_FLAG_NO_AUTOMATIC_QUAD_UPLOAD) == 0 &&
+		       pCursor->m_CalculateSelectionMode == TEXT_CURSOR_SELECTION_MODE_NONE &&
+		       pCursor->m_CursorMode == TEXT_CURSOR_CURSOR_MODE_NONE &&
+		       pCursor->m_X == pCursor->m_StartX && pCursor->m_Y == pCursor->m_StartY &&
+		       pCursor->m_LineCount == 1 && pCursor->m_GlyphCount == 0 && pCursor->m_CharCount == 0 &&
+		       pCursor->m_MaxCharacterHeight == 0.0f && pCursor->m_LongestLineWidth == 0.0f;
+	}
+
+	void TextLayoutKey(std::string &Key, const CTextCursor *pCursor, const char *pText, int Length, vec2 FakeToScreen) const
+	{
+		struct
+		{
+			FT_Face m_Face;
+			float m_FontSize;
+			float m_LineWidth;
+			int m_MaxLines;
+			int m_Flags;
+			unsigned m_RenderFlags;
+			float m_aFakeToScreen[2];
+			float m_aColor[4];
+		} Params;
+		mem_zero(&Params, sizeof(Params));
+		Params.m_Face = m_pGlyphMap->SelectedFace();
+		Params.m_FontSize = pCursor->m_FontSize;
+		Params.m_LineWidth = pCursor->m_LineWidth;
+		Params.m_MaxLines = pCursor->m_MaxLines;
+		Params.m_Flags = pCursor->m_Flags;
+		Params.m_RenderFlags = m_RenderFlags & ~TEXT_RENDER_FLAG_ONE_TIME_USE;
+		Params.m_aFakeToScreen[0] = FakeToScreen.x;
+		Params.m_aFakeToScreen[1] = FakeToScreen.y;
+		Params.m_aColor[0] = m_Color.r;
+		Params.m_aColor[1] = m_Color.g;
+		Params.m_aColor[2] = m_Color.b;
+		Params.m_aColor[3] = m_Color.a;
+		Key.assign((const char *)&Params, sizeof(Params));
+		Key.append(pText, Length);
+	}
+
 	int GetFreeTextContainerIndex()
 	{
 		if(m_FirstFreeTextContainerIndex == -1)
@@ -1011,6 +1579,9 @@ class CTextRender : public IEngineTextRender
 		const FT_Long NumFaces = FtFace->num_faces;
 		FT_Done_Face(FtFace);
 
+		const SHA256_DIGEST FontHash = sha256(pFontData, FontDataSize);
+		sha256_update(&m_FontsHash, &FontHash, sizeof(FontHash));
+
 		bool LoadedAny = false;
 		for(FT_Long FaceIndex = 0; FaceIndex < NumFaces; ++FaceIndex)
 		{
@@ -1024,7 +1595,8 @@ class CTextRender : public IEngineTextRender
 				continue;
 			}
 
-			m_pGlyphMap->AddFace(FtFace);
+			m_pGlyphMap->AddFace(FtFace, pFontData, FontDataSize);
+			sha256_update(&m_FontsHash, &FaceIndex, sizeof(FaceIndex));
 
 			char aBuf[256];
 			str_format(aBuf, sizeof(aBuf), "Loaded font face %ld '%s %s' from font file '%s'", FaceIndex, FtFace->family_name, FtFace->style_name, pFontName);
@@ -1043,6 +1615,31 @@ class CTextRender : public IEngineTextRender
 		return true;
 	}
 
+	SHA256_DIGEST AtlasCacheKey() const
+	{
+		SHA256_CTX Ctx = m_FontsHash;
+		int aVersion[4] = {GLYPH_ATLAS_CACHE_VERSION};
+		FT_Library_Version(m_FTLibrary, &aVersion[1], &aVersion[2], &aVersion[3]);
+		sha256_update(&Ctx, aVersion, sizeof(aVersion));
+		return sha256_finish(&Ctx);
+	}
+
+	// The atlas cache is loaded once all faces are known, which is after
+	// the first language variant has been selected.
+	void LoadAtlasCache()
+	{
+		if(m_AtlasCacheLoaded || m_vpFontData.empty() || !g_Config.m_GfxGlyphAtlasCache)
+			return;
+		m_AtlasCacheLoaded = true;
+		if(!m_pGlyphMap->LoadCache(Storage(), GLYPH_ATLAS_CACHE_FILE, AtlasCacheKey()))
+			return;
+		static const std::vector<std::pair<int, int>> s_vPrewarmRanges = {
+			{0x20, 0x7E}, // Basic Latin
+			{0xA0, 0xFF}, // Latin-1 Supplement
+		};
+		m_pGlyphMap->Prewarm(m_pEngine, s_vPrewarmRanges);
+	}
+
 	void SetRenderFlags(unsigned Flags) override
 	{
 		m_RenderFlags = Flags;
@@ -1057,6 +1654,7 @@ public:
 	CTextRender()
 	{
 		m_pConsole = nullptr;
+		m_pEngine = nullptr;
 		m_pGraphics = nullptr;
 		m_pStorage = nullptr;
 		m_pGlyphMap = nullptr;
@@ -1074,6 +1672,7 @@ public:
 	void Init() override
 	{
 		m_pConsole = Kernel()->RequestInterface<IConsole>();
+		m_pEngine = Kernel()->RequestInterface<IEngine>();
 		m_pGraphics = Kernel()->RequestInterface<IGraphics>();
 		m_pStorage = Kernel()->RequestInterface<IStorage>();
 		FT_Init_FreeType(&m_FTLibrary);
@@ -1120,10 +1719,13 @@ public:
 
 	void Shutdown() override
 	{
+		ClearTextLayouts();
 		for(auto *pTextCont : m_vpTextContainers)
 			delete pTextCont;
 		m_vpTextContainers.clear();
 
+		if(m_AtlasCacheLoaded && g_Config.m_GfxGlyphAtlasCache)
+			m_pGlyphMap->SaveCache(Storage(), GLYPH_ATLAS_CACHE_FILE, AtlasCacheKey());
 		delete m_pGlyphMap;
 		m_pGlyphMap = nullptr;
 
@@ -1138,12 +1740,17 @@ public:
 		m_DefaultTextContainerInfo.m_vAttributes.clear();
 
 		m_pConsole = nullptr;
+		m_pEngine = nullptr;
 		m_pGraphics = nullptr;
 		m_pStorage = nullptr;
 	}
 
 	void LoadFonts() override
 	{
+		ClearTextLayouts();
+		sha256_init(&m_FontsHash);
+		m_AtlasCacheLoaded = false;
+
 		// read file data into buffer
 		const char *pFilename = "fonts/index.json";
 		void *pFileData;
@@ -1255,10 +1862,12 @@ public:
 			if(str_comp(pLanguageFile, Variant.m_aLanguageFile) == 0)
 			{
 				m_pGlyphMap->SetVariantFaceByName(Variant.m_aFamilyName);
+				LoadAtlasCache();
 				return;
 			}
 		}
 		m_pGlyphMap->SetVariantFaceByName(nullptr);
+		LoadAtlasCache();
 	}
 
 	void SetCursor(CTextCursor *pCursor, float x, float y, float FontSize, int Flags) const override
@@ -1394,6 +2003,14 @@ public:
 	}
 
 	void TextEx(CTextCursor *pCursor, const char *pText, int Length = -1) override
+	{
+		if(IsTextLayoutCacheable(pCursor))
+			TextExCached(pCursor, pText, Length);
+		else
+			TextExUncached(pCursor, pText, Length);
+	}
+
+	void TextExUncached(CTextCursor *pCursor, const char *pText, int Length)
 	{
 		const unsigned OldRenderFlags = m_RenderFlags;
 		m_RenderFlags |= TEXT_RENDER_FLAG_ONE_TIME_USE;
@@ -1412,6 +2029,84 @@ public:
 		}
 	}
 
+	void TextExCached(CTextCursor *pCursor, const char *pText, int Length)
+	{
+		const auto Now = time_get_nanoseconds();
+		CleanupTextLayouts(Now);
+
+		float ScreenX0, ScreenY0, ScreenX1, ScreenY1;
+		Graphics()->GetScreen(&ScreenX0, &ScreenY0, &ScreenX1, &ScreenY1);
+		const vec2 FakeToScreen = vec2(Graphics()->ScreenWidth() / (ScreenX1 - ScreenX0), Graphics()->ScreenHeight() / (ScreenY1 - ScreenY0));
+		const bool PixelAligned = (m_RenderFlags & TEXT_RENDER_FLAG_NO_PIXEL_ALIGMENT) == 0;
+		const auto &&Align = [&](float Value, float Scale) {
+			return PixelAligned ? round_to_int(Value * Scale) / Scale : Value;
+		};
+
+		if(Length < 0)
+			Length = str_length(pText);
+		else
+			Length = minimum(Length, str_length(pText));
+
+		std::string Key;
+		TextLayoutKey(Key, pCursor, pText, Length, FakeToScreen);
+		auto It = m_TextLayouts.find(Key);
+		if(It == m_TextLayouts.end())
+		{
+			// strings that change every frame, like timers, would otherwise
+			// each get a persistent buffer
+			TextExUncached(pCursor, pText, Length);
+			if((int)m_TextLayouts.size() < MAX_TEXT_LAYOUTS)
+			{
+				STextLayout Layout;
+				Layout.m_LastUse = Now;
+				m_TextLayouts.emplace(std::move(Key), std::move(Layout));
+			}
+			return;
+		}
+
+		STextLayout &Layout = It->second;
+		Layout.m_LastUse = Now;
+		if(!Layout.m_LaidOut)
+		{
+			Layout.m_X = pCursor->m_X;
+			Layout.m_Y = pCursor->m_Y;
+			// the layout is kept, even if it is measured while laying out other text
+			const unsigned OldRenderFlags = m_RenderFlags;
+			m_RenderFlags &= ~TEXT_RENDER_FLAG_ONE_TIME_USE;
+			CreateTextContainer(Layout.m_TextContainerIndex, pCursor, pText, Length);
+			m_RenderFlags = OldRenderFlags;
+			if(Layout.m_TextContainerIndex.Valid() && (pCursor->m_Flags & TEXTFLAG_RENDER) != 0)
+				RenderTextContainer(Layout.m_TextContainerIndex, DefaultTextColor(), DefaultTextOutlineColor());
+			else
+				DeleteTextContainer(Layout.m_TextContainerIndex);
+			// the atlas might have changed while this text was laid out, then
+			// the next call clears all layouts
+			if(m_pGlyphMap->AtlasGeneration() != m_TextLayoutsAtlasGeneration)
+			{
+				DeleteTextContainer(Layout.m_TextContainerIndex);
+				return;
+			}
+			Layout.m_Cursor = *pCursor;
+			Layout.m_LaidOut = true;
+			return;
+		}
+
+		const float OffsetX = Align(pCursor->m_X, FakeToScreen.x) - Align(Layout.m_X, FakeToScreen.x);
+		const float OffsetY = Align(pCursor->m_Y, FakeToScreen.y) - Align(Layout.m_Y, FakeToScreen.y);
+		if(Layout.m_TextContainerIndex.Valid())
+			RenderTextContainer(Layout.m_TextContainerIndex, DefaultTextColor(), DefaultTextOutlineColor(), pCursor->m_X - Layout.m_X, pCursor->m_Y - Layout.m_Y);
+
+		const float StartX = pCursor->m_StartX;
+		const float StartY = pCursor->m_StartY;
+		const float Y = pCursor->m_Y;
+		*pCursor = Layout.m_Cursor;
+		pCursor->m_StartX = StartX;
+		pCursor->m_StartY = StartY;
+		pCursor->m_X += OffsetX;
+		// the cursor only moves down if the text contains a new line
+		pCursor->m_Y = Layout.m_Cursor.m_Y == Layout.m_Y ? Y : pCursor->m_Y + OffsetY;
+	}
+
 	bool CreateTextContainer(STextContainerIndex &TextContainerIndex, CTextCursor *pCursor, const char *pText, int Length = -1) override
 	{
 		dbg_assert(!TextContainerIndex.Valid(), "Text container index was not cleared.");
@@ -2225,6 +2920,7 @@ public:
 
 	void OnPreWindowResize() override
 	{
+		ClearTextLayouts();
 		for(auto *pTextContainer : m_vpTextContainers)
 		{
 			if(pTextContainer->m_ContainerIndex.Valid() && pTextContainer->m_ContainerIndex.m_UseCount.use_count() <= 1)
@@ -138,7 +138,9 @@ int CUpdater::GetCurrentPercent()
 
 void CUpdater::FetchFile(const char *pFile, const char *pDestPath)
 {
-	m_pEngine->AddJob(std::make_shared<CUpdaterFetchTask>(this, pFile, pDestPath));
+	auto pTask = std::make_shared<CUpdaterFetchTask>(this, pFile, pDestPath);
+	pTask->SetPriority(IJob::PRIORITY_LOW);
+	HttpRun(std::move(pTask));
 }
 
 bool CUpdater::MoveFile(const char *pFile)
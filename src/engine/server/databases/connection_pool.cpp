@@ -62,8 +62,23 @@ struct CSqlExecData
 		} m_Print;
 	} m_Ptr;
 
+	// only set for WRITE_ACCESS queued with ExecuteWriteBatched
+	bool m_Batched = false;
+	CDbConnectionPool::FWriteBatch m_pWriteBatchFunc = nullptr;
+
 	std::unique_ptr<const ISqlData> m_pThreadData;
 	const char *m_pName;
+	// time_get() when the query was queued
+	int64_t m_QueueTime = time_get();
+
+	void SetResult(bool Success)
+	{
+		if(m_pThreadData != nullptr && m_pThreadData->m_pResult != nullptr)
+		{
+			m_pThreadData->m_pResult->m_Success = Success;
+			m_pThreadData->m_pResult->m_Completed.store(true);
+		}
+	}
 };
 
 CSqlExecData::CSqlExecData(
@@ -117,15 +132,68 @@ CSqlExecData::CSqlExecData(IConsole *pConsole, CDbConnectionPool::Mode m) :
 	m_Ptr.m_Print.m_Mode = m;
 }
 
+void CDbConnectionPool::CLaneStats::Queued()
+{
+	const int Depth = m_Depth.fetch_add(1) + 1;
+	int MaxDepth = m_MaxDepth.load();
+	while(Depth > MaxDepth && !m_MaxDepth.compare_exchange_weak(MaxDepth, Depth))
+	{
+	}
+}
+
+void CDbConnectionPool::CLaneStats::Done(int64_t QueueTime)
+{
+	const int64_t Latency = (time_get() - QueueTime) * 1000000 / time_freq();
+	m_Depth.fetch_sub(1);
+	m_NumQueries.fetch_add(1);
+	m_TotalLatency.fetch_add(Latency);
+	int64_t MaxLatency = m_MaxLatency.load();
+	while(Latency > MaxLatency && !m_MaxLatency.compare_exchange_weak(MaxLatency, Latency))
+	{
+	}
+}
+
+void CDbConnectionPool::CLaneStats::Print(IConsole *pConsole, const char *pLane, int NumWorkers) const
+{
+	const int64_t NumQueries = m_NumQueries.load();
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf),
+		"%s queries: %d worker(s), queue depth %d (max %d), %" PRId64 " done, latency avg %.1fms max %.1fms",
+		pLane, NumWorkers, m_Depth.load(), m_MaxDepth.load(), NumQueries,
+		NumQueries > 0 ? m_TotalLatency.load() / (double)NumQueries / 1000.0 : 0.0,
+		m_MaxLatency.load() / 1000.0);
+	pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+}
+
 void CDbConnectionPool::Print(IConsole *pConsole, Mode DatabaseMode)
 {
+	// the read connections belong to the read workers
+	if(DatabaseMode == Mode::READ)
+	{
+		QueueRead(std::make_unique<CSqlExecData>(pConsole, DatabaseMode));
+		return;
+	}
 	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(pConsole, DatabaseMode);
 	m_InsertIdx %= std::size(m_pShared->m_aQueries);
 	m_pShared->m_NumBackup.Signal();
 }
 
+void CDbConnectionPool::SetNumReadWorkers(int NumWorkers)
+{
+	m_NumReadWorkers = clamp(NumWorkers, 1, (int)MAX_READ_WORKERS);
+	// workers can be added to the running ones, but not removed
+	if(!m_vpReadWorkerThreads.empty())
+		StartReadWorkers();
+}
+
 void CDbConnectionPool::RegisterSqliteDatabase(Mode DatabaseMode, const char aFileName[64])
 {
+	if(DatabaseMode == Mode::READ)
+	{
+		std::lock_guard<std::mutex> Lock(m_pShared->m_ReadLock);
+		m_pShared->m_vpReadDatabases.push_back(std::make_unique<CSqlExecData>(DatabaseMode, aFileName));
+		return;
+	}
 	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(DatabaseMode, aFileName);
 	m_InsertIdx %= std::size(m_pShared->m_aQueries);
 	m_pShared->m_NumBackup.Signal();
@@ -133,6 +201,12 @@ void CDbConnectionPool::RegisterSqliteDatabase(Mode DatabaseMode, const char aFi
 
 void CDbConnectionPool::RegisterMysqlDatabase(Mode DatabaseMode, const CMysqlConfig *pMysqlConfig)
 {
+	if(DatabaseMode == Mode::READ)
+	{
+		std::lock_guard<std::mutex> Lock(m_pShared->m_ReadLock);
+		m_pShared->m_vpReadDatabases.push_back(std::make_unique<CSqlExecData>(DatabaseMode, pMysqlConfig));
+		return;
+	}
 	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(DatabaseMode, pMysqlConfig);
 	m_InsertIdx %= std::size(m_pShared->m_aQueries);
 	m_pShared->m_NumBackup.Signal();
@@ -143,21 +217,70 @@ void CDbConnectionPool::Execute(
 	std::unique_ptr<const ISqlData> pSqlRequestData,
 	const char *pName)
 {
+	m_pShared->m_ReadStats.Queued();
+	QueueRead(std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName));
+}
+
+void CDbConnectionPool::QueueRead(std::unique_ptr<CSqlExecData> pData)
+{
+	if(m_vpReadWorkerThreads.empty())
+		StartReadWorkers();
+	{
+		std::lock_guard<std::mutex> Lock(m_pShared->m_ReadLock);
+		m_pShared->m_ReadQueries.push_back(std::move(pData));
+	}
+	m_pShared->m_NumRead.Signal();
+}
+
+void CDbConnectionPool::ExecuteWrite(
+	FWrite pFunc,
+	std::unique_ptr<const ISqlData> pSqlRequestData,
+	const char *pName)
+{
+	m_pShared->m_WriteStats.Queued();
 	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName);
 	m_InsertIdx %= std::size(m_pShared->m_aQueries);
 	m_pShared->m_NumBackup.Signal();
 }
 
-void CDbConnectionPool::ExecuteWrite(
+void CDbConnectionPool::ExecuteWriteBatched(
 	FWrite pFunc,
+	FWriteBatch pBatchFunc,
 	std::unique_ptr<const ISqlData> pSqlRequestData,
 	const char *pName)
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName);
+	auto pData = std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName);
+	pData->m_Batched = true;
+	pData->m_pWriteBatchFunc = pBatchFunc;
+	m_pShared->m_WriteStats.Queued();
+	m_pShared->m_aQueries[m_InsertIdx++] = std::move(pData);
 	m_InsertIdx %= std::size(m_pShared->m_aQueries);
 	m_pShared->m_NumBackup.Signal();
 }
 
+/* static */
+int CDbConnectionPool::CollectWriteBatch(CSharedData *pShared, CSemaphore *pSemaphore, int JobNum, CSqlExecData *pFirst, CSqlExecData **ppBatch, bool *pNextClaimed)
+{
+	ppBatch[0] = pFirst;
+	int NumBatch = 1;
+	*pNextClaimed = false;
+	if(!pFirst->m_Batched)
+		return NumBatch;
+	// a query may only be looked at after its signal was taken from the
+	// semaphore, which orders the read after the store of the query
+	while(NumBatch < MAX_WRITE_BATCH && pSemaphore->TryWait())
+	{
+		CSqlExecData *pNext = pShared->m_aQueries[(JobNum + NumBatch) % std::size(pShared->m_aQueries)].get();
+		if(pNext == nullptr || pNext->m_Mode != CSqlExecData::WRITE_ACCESS || !pNext->m_Batched || pNext->m_Ptr.m_pWriteFunc != pFirst->m_Ptr.m_pWriteFunc)
+		{
+			*pNextClaimed = true;
+			break;
+		}
+		ppBatch[NumBatch++] = pNext;
+	}
+	return NumBatch;
+}
+
 void CDbConnectionPool::OnShutdown()
 {
 	if(m_Shutdown)
@@ -165,6 +288,10 @@ void CDbConnectionPool::OnShutdown()
 	m_Shutdown = true;
 	m_pShared->m_Shutdown.store(true);
 	m_pShared->m_NumBackup.Signal();
+	// read workers stop at the first empty query, after dismissing the
+	// queries in front of it
+	for(size_t i = 0; i < m_vpReadWorkerThreads.size(); i++)
+		QueueRead(nullptr);
 	int i = 0;
 	while(m_pShared->m_Shutdown.load())
 	{
@@ -208,9 +335,13 @@ void CBackup::Start(void *pUser)
 
 void CBackup::ProcessQueries()
 {
+	// set if the next query was already taken from the semaphore
+	bool NextClaimed = false;
 	for(int JobNum = 0;; JobNum++)
 	{
-		m_pShared->m_NumBackup.Wait();
+		if(!NextClaimed)
+			m_pShared->m_NumBackup.Wait();
+		NextClaimed = false;
 		CSqlExecData *pThreadData = m_pShared->m_aQueries[JobNum % std::size(m_pShared->m_aQueries)].get();
 
 		// work through all database jobs after OnShutdown is called before exiting the thread
@@ -227,8 +358,23 @@ void CBackup::ProcessQueries()
 		}
 		else if(pThreadData->m_Mode == CSqlExecData::WRITE_ACCESS && m_pWriteBackup.get())
 		{
-			bool Success = CDbConnectionPool::ExecSqlFunc(m_pWriteBackup.get(), pThreadData, Write::BACKUP_FIRST);
-			dbg_msg("sql", "[%i] %s done on write backup database, Success=%i", JobNum, pThreadData->m_pName, Success);
+			CSqlExecData *apBatch[CDbConnectionPool::MAX_WRITE_BATCH];
+			const int NumBatch = CDbConnectionPool::CollectWriteBatch(m_pShared.get(), &m_pShared->m_NumBackup, JobNum, pThreadData, apBatch, &NextClaimed);
+			if(NumBatch > 1 && CDbConnectionPool::ExecSqlBatch(m_pWriteBackup.get(), apBatch, NumBatch, Write::BACKUP_FIRST))
+			{
+				dbg_msg("sql", "[%i] %s done on write backup database in a batch of %d", JobNum, pThreadData->m_pName, NumBatch);
+			}
+			else
+			{
+				for(int i = 0; i < NumBatch; i++)
+				{
+					bool Success = CDbConnectionPool::ExecSqlFunc(m_pWriteBackup.get(), apBatch[i], Write::BACKUP_FIRST);
+					dbg_msg("sql", "[%i] %s done on write backup database, Success=%i", JobNum + i, apBatch[i]->m_pName, Success);
+				}
+			}
+			for(int i = 1; i < NumBatch; i++)
+				m_pShared->m_NumWorker.Signal();
+			JobNum += NumBatch - 1;
 		}
 		m_pShared->m_NumWorker.Signal();
 	}
@@ -248,6 +394,7 @@ public:
 
 private:
 	void Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode);
+	bool ExecuteWrite(int JobNum, CSqlExecData *pThreadData, bool *pFailMode);
 
 	// There are two possible configurations
 	//  * sqlite mode: There exists exactly one READ and the same WRITE server
@@ -256,8 +403,8 @@ private:
 	//                most one WRITE server. The WRITE server for all DDNet
 	//                Servers must be the same (to counteract double loads).
 	//                There may be one WRITE_BACKUP sqlite server.
+	// The READ servers are used by the read workers.
 	// This variable should only change, before the worker threads
-	std::vector<std::unique_ptr<IDbConnection>> m_vpReadConnections;
 	std::unique_ptr<IDbConnection> m_pWriteConnection;
 	std::unique_ptr<IDbConnection> m_pWriteBackup;
 
@@ -274,18 +421,20 @@ void CWorker::Start(void *pUser)
 
 void CWorker::ProcessQueries()
 {
-	// remember last working server and try to connect to it first
-	int ReadServer = 0;
 	// enter fail mode when a sql request fails, skip read request during it and
 	// write to the backup database until all requests are handled
 	bool FailMode = false;
+	// set if the next query was already taken from the semaphore
+	bool NextClaimed = false;
 	for(int JobNum = 0;; JobNum++)
 	{
-		if(FailMode && m_pShared->m_NumWorker.GetApproximateValue() == 0)
+		if(FailMode && !NextClaimed && m_pShared->m_NumWorker.GetApproximateValue() == 0)
 		{
 			FailMode = false;
 		}
-		m_pShared->m_NumWorker.Wait();
+		if(!NextClaimed)
+			m_pShared->m_NumWorker.Wait();
+		NextClaimed = false;
 		auto pThreadData = std::move(m_pShared->m_aQueries[JobNum % std::size(m_pShared->m_aQueries)]);
 		// work through all database jobs after OnShutdown is called before exiting the thread
 		if(pThreadData == nullptr)
@@ -294,60 +443,56 @@ void CWorker::ProcessQueries()
 			return;
 		}
 		bool Success = false;
+		// number of queries handled in this iteration
+		int NumJobs = 1;
 		switch(pThreadData->m_Mode)
 		{
 		case CSqlExecData::READ_ACCESS:
+			dbg_assert(false, "read queries are executed by the read workers");
+			break;
+		case CSqlExecData::WRITE_ACCESS:
 		{
-			for(size_t i = 0; i < m_vpReadConnections.size(); i++)
+			CSqlExecData *apBatch[CDbConnectionPool::MAX_WRITE_BATCH];
+			const int NumBatch = CDbConnectionPool::CollectWriteBatch(m_pShared.get(), &m_pShared->m_NumWorker, JobNum, pThreadData.get(), apBatch, &NextClaimed);
+			std::vector<std::unique_ptr<CSqlExecData>> vpBatch;
+			for(int i = 1; i < NumBatch; i++)
+				vpBatch.push_back(std::move(m_pShared->m_aQueries[(JobNum + i) % std::size(m_pShared->m_aQueries)]));
+
+			const bool SkipToBackup = m_pWriteBackup != nullptr && (m_pShared->m_Shutdown || FailMode);
+			if(NumBatch > 1 && !SkipToBackup && CDbConnectionPool::ExecSqlBatch(m_pWriteConnection.get(), apBatch, NumBatch, Write::NORMAL))
 			{
-				if(m_pShared->m_Shutdown)
-				{
-					dbg_msg("sql", "[%i] %s dismissed read request during shutdown", JobNum, pThreadData->m_pName);
-					break;
-				}
-				if(FailMode)
-				{
-					dbg_msg("sql", "[%i] %s dismissed read request during FailMode", JobNum, pThreadData->m_pName);
-					break;
-				}
-				int CurServer = (ReadServer + i) % (int)m_vpReadConnections.size();
-				if(CDbConnectionPool::ExecSqlFunc(m_vpReadConnections[CurServer].get(), pThreadData.get(), Write::NORMAL))
+				dbg_msg("sql", "[%i] %s done on write database in a batch of %d", JobNum, pThreadData->m_pName, NumBatch);
+				if(m_pWriteBackup)
 				{
-					ReadServer = CurServer;
-					dbg_msg("sql", "[%i] %s done on read database %d", JobNum, pThreadData->m_pName, CurServer);
-					Success = true;
-					break;
+					if(CDbConnectionPool::ExecSqlBatch(m_pWriteBackup.get(), apBatch, NumBatch, Write::NORMAL_SUCCEEDED))
+					{
+						dbg_msg("sql", "[%i] %s done move write on backup database to non-backup table in a batch of %d", JobNum, pThreadData->m_pName, NumBatch);
+					}
+					else
+					{
+						for(int i = 0; i < NumBatch; i++)
+							CDbConnectionPool::ExecSqlFunc(m_pWriteBackup.get(), apBatch[i], Write::NORMAL_SUCCEEDED);
+					}
 				}
-			}
-			if(!Success)
-			{
-				FailMode = true;
-			}
-		}
-		break;
-		case CSqlExecData::WRITE_ACCESS:
-		{
-			if(m_pShared->m_Shutdown && m_pWriteBackup != nullptr)
-			{
-				dbg_msg("sql", "[%i] %s skipped to backup database during shutdown", JobNum, pThreadData->m_pName);
-			}
-			else if(FailMode && m_pWriteBackup != nullptr)
-			{
-				dbg_msg("sql", "[%i] %s skipped to backup database during FailMode", JobNum, pThreadData->m_pName);
-			}
-			else if(CDbConnectionPool::ExecSqlFunc(m_pWriteConnection.get(), pThreadData.get(), Write::NORMAL))
-			{
-				dbg_msg("sql", "[%i] %s done on write database", JobNum, pThreadData->m_pName);
 				Success = true;
+				for(int i = 1; i < NumBatch; i++)
+					apBatch[i]->SetResult(true);
 			}
-			// enter fail mode if not successful
-			FailMode = FailMode || !Success;
-			const Write w = Success ? Write::NORMAL_SUCCEEDED : Write::NORMAL_FAILED;
-			if(m_pWriteBackup && CDbConnectionPool::ExecSqlFunc(m_pWriteBackup.get(), pThreadData.get(), w))
+			else
 			{
-				dbg_msg("sql", "[%i] %s done move write on backup database to non-backup table", JobNum, pThreadData->m_pName);
-				Success = true;
+				// retry one by one, a failing write enters fail mode as usual
+				Success = ExecuteWrite(JobNum, pThreadData.get(), &FailMode);
+				for(int i = 1; i < NumBatch; i++)
+				{
+					const bool BatchSuccess = ExecuteWrite(JobNum + i, apBatch[i], &FailMode);
+					if(!BatchSuccess)
+						dbg_msg("sql", "[%i] %s failed on all databases", JobNum + i, apBatch[i]->m_pName);
+					apBatch[i]->SetResult(BatchSuccess);
+				}
 			}
+			for(int i = 0; i < NumBatch; i++)
+				m_pShared->m_WriteStats.Done(apBatch[i]->m_QueueTime);
+			NumJobs = NumBatch;
 		}
 		break;
 		case CSqlExecData::ADD_MYSQL:
@@ -355,15 +500,13 @@ void CWorker::ProcessQueries()
 			auto pMysql = CreateMysqlConnection(pThreadData->m_Ptr.m_MySql.m_Config);
 			switch(pThreadData->m_Ptr.m_MySql.m_Mode)
 			{
-			case CDbConnectionPool::Mode::READ:
-				m_vpReadConnections.push_back(std::move(pMysql));
-				break;
 			case CDbConnectionPool::Mode::WRITE:
 				m_pWriteConnection = std::move(pMysql);
 				break;
 			case CDbConnectionPool::Mode::WRITE_BACKUP:
 				m_pWriteBackup = std::move(pMysql);
 				break;
+			case CDbConnectionPool::Mode::READ:
 			case CDbConnectionPool::Mode::NUM_MODES:
 				break;
 			}
@@ -375,15 +518,13 @@ void CWorker::ProcessQueries()
 			auto pSqlite = CreateSqliteConnection(pThreadData->m_Ptr.m_Sqlite.m_FileName, true);
 			switch(pThreadData->m_Ptr.m_Sqlite.m_Mode)
 			{
-			case CDbConnectionPool::Mode::READ:
-				m_vpReadConnections.push_back(std::move(pSqlite));
-				break;
 			case CDbConnectionPool::Mode::WRITE:
 				m_pWriteConnection = std::move(pSqlite);
 				break;
 			case CDbConnectionPool::Mode::WRITE_BACKUP:
 				m_pWriteBackup = std::move(pSqlite);
 				break;
+			case CDbConnectionPool::Mode::READ:
 			case CDbConnectionPool::Mode::NUM_MODES:
 				break;
 			}
@@ -397,29 +538,47 @@ void CWorker::ProcessQueries()
 		}
 		if(!Success)
 			dbg_msg("sql", "[%i] %s failed on all databases", JobNum, pThreadData->m_pName);
-		if(pThreadData->m_pThreadData != nullptr && pThreadData->m_pThreadData->m_pResult != nullptr)
-		{
-			pThreadData->m_pThreadData->m_pResult->m_Success = Success;
-			pThreadData->m_pThreadData->m_pResult->m_Completed.store(true);
-		}
+		pThreadData->SetResult(Success);
+		JobNum += NumJobs - 1;
 	}
 }
 
-void CWorker::Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode)
+bool CWorker::ExecuteWrite(int JobNum, CSqlExecData *pThreadData, bool *pFailMode)
 {
-	if(DatabaseMode == CDbConnectionPool::Mode::READ)
+	bool Success = false;
+	if(m_pShared->m_Shutdown && m_pWriteBackup != nullptr)
 	{
-		for(auto &pReadConnection : m_vpReadConnections)
-			pReadConnection->Print(pConsole, "Read");
-		if(m_vpReadConnections.empty())
-			pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "There are no read databases");
+		dbg_msg("sql", "[%i] %s skipped to backup database during shutdown", JobNum, pThreadData->m_pName);
 	}
-	else if(DatabaseMode == CDbConnectionPool::Mode::WRITE)
+	else if(*pFailMode && m_pWriteBackup != nullptr)
+	{
+		dbg_msg("sql", "[%i] %s skipped to backup database during FailMode", JobNum, pThreadData->m_pName);
+	}
+	else if(CDbConnectionPool::ExecSqlFunc(m_pWriteConnection.get(), pThreadData, Write::NORMAL))
+	{
+		dbg_msg("sql", "[%i] %s done on write database", JobNum, pThreadData->m_pName);
+		Success = true;
+	}
+	// enter fail mode if not successful
+	*pFailMode = *pFailMode || !Success;
+	const Write w = Success ? Write::NORMAL_SUCCEEDED : Write::NORMAL_FAILED;
+	if(m_pWriteBackup && CDbConnectionPool::ExecSqlFunc(m_pWriteBackup.get(), pThreadData, w))
+	{
+		dbg_msg("sql", "[%i] %s done move write on backup database to non-backup table", JobNum, pThreadData->m_pName);
+		Success = true;
+	}
+	return Success;
+}
+
+void CWorker::Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode)
+{
+	if(DatabaseMode == CDbConnectionPool::Mode::WRITE)
 	{
 		if(m_pWriteConnection)
 			m_pWriteConnection->Print(pConsole, "Write");
 		else
 			pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "There are no write databases");
+		m_pShared->m_WriteStats.Print(pConsole, "Write", 1);
 	}
 	else if(DatabaseMode == CDbConnectionPool::Mode::WRITE_BACKUP)
 	{
@@ -430,6 +589,116 @@ void CWorker::Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode)
 	}
 }
 
+// The read workers execute read queries in parallel, in any order. Each of
+// them has its own connection to every READ server, so a slow query only
+// holds up one of them.
+class CReadWorker
+{
+public:
+	CReadWorker(std::shared_ptr<CDbConnectionPool::CSharedData> pShared) :
+		m_pShared(std::move(pShared)) {}
+	static void Start(void *pUser);
+	void ProcessQueries();
+
+private:
+	void Print(IConsole *pConsole);
+
+	std::vector<std::unique_ptr<IDbConnection>> m_vpReadConnections;
+
+	std::shared_ptr<CDbConnectionPool::CSharedData> m_pShared;
+};
+
+/* static */
+void CReadWorker::Start(void *pUser)
+{
+	CReadWorker *pThis = (CReadWorker *)pUser;
+	pThis->ProcessQueries();
+	delete pThis;
+}
+
+void CReadWorker::ProcessQueries()
+{
+	// remember last working server and try to connect to it first
+	int ReadServer = 0;
+	// enter fail mode when a sql request fails, skip read request during it
+	// until all queued read requests are handled
+	bool FailMode = false;
+	while(true)
+	{
+		if(FailMode && m_pShared->m_NumRead.GetApproximateValue() == 0)
+		{
+			FailMode = false;
+		}
+		m_pShared->m_NumRead.Wait();
+		std::unique_ptr<CSqlExecData> pThreadData;
+		{
+			std::lock_guard<std::mutex> Lock(m_pShared->m_ReadLock);
+			pThreadData = std::move(m_pShared->m_ReadQueries.front());
+			m_pShared->m_ReadQueries.pop_front();
+
+			// databases registered since the last query
+			for(size_t i = m_vpReadConnections.size(); i < m_pShared->m_vpReadDatabases.size(); i++)
+			{
+				const CSqlExecData *pDatabase = m_pShared->m_vpReadDatabases[i].get();
+				if(pDatabase->m_Mode == CSqlExecData::ADD_MYSQL)
+					m_vpReadConnections.push_back(CreateMysqlConnection(pDatabase->m_Ptr.m_MySql.m_Config));
+				else
+					m_vpReadConnections.push_back(CreateSqliteConnection(pDatabase->m_Ptr.m_Sqlite.m_FileName, true));
+			}
+		}
+		// queued by OnShutdown for every read worker
+		if(pThreadData == nullptr)
+		{
+			return;
+		}
+		if(pThreadData->m_Mode == CSqlExecData::PRINT)
+		{
+			Print(pThreadData->m_Ptr.m_Print.m_pConsole);
+			continue;
+		}
+
+		bool Success = false;
+		for(size_t i = 0; i < m_vpReadConnections.size(); i++)
+		{
+			if(m_pShared->m_Shutdown)
+			{
+				dbg_msg("sql", "%s dismissed read request during shutdown", pThreadData->m_pName);
+				break;
+			}
+			if(FailMode)
+			{
+				dbg_msg("sql", "%s dismissed read request during FailMode", pThreadData->m_pName);
+				break;
+			}
+			int CurServer = (ReadServer + i) % (int)m_vpReadConnections.size();
+			if(CDbConnectionPool::ExecSqlFunc(m_vpReadConnections[CurServer].get(), pThreadData.get(), Write::NORMAL))
+			{
+				ReadServer = CurServer;
+				dbg_msg("sql", "%s done on read database %d", pThreadData->m_pName, CurServer);
+				Success = true;
+				break;
+			}
+		}
+		if(!Success)
+		{
+			FailMode = true;
+			dbg_msg("sql", "%s failed on all databases", pThreadData->m_pName);
+		}
+		pThreadData->SetResult(Success);
+		m_pShared->m_ReadStats.Done(pThreadData->m_QueueTime);
+	}
+}
+
+void CReadWorker::Print(IConsole *pConsole)
+{
+	// only the connections of the worker taking the print query
+	for(auto &pReadConnection : m_vpReadConnections)
+		pReadConnection->Print(pConsole, "Read");
+	if(m_vpReadConnections.empty())
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "There are no read databases");
+	m_pShared->m_ReadStats.Print(pConsole, "Read", m_pShared->m_NumReadWorkers.load());
+}
+
 /* static */
 bool CDbConnectionPool::ExecSqlFunc(IDbConnection *pConnection, CSqlExecData *pData, Write w)
 {
@@ -464,6 +733,52 @@ bool CDbConnectionPool::ExecSqlFunc(IDbConnection *pConnection, CSqlExecData *pD
 	return Success;
 }
 
+/* static */
+bool CDbConnectionPool::ExecSqlBatch(IDbConnection *pConnection, CSqlExecData *const *ppData, int NumData, Write w)
+{
+	if(pConnection == nullptr)
+	{
+		dbg_msg("sql", "No database given");
+		return false;
+	}
+	char aError[256] = "unknown error";
+	if(pConnection->Connect(aError, sizeof(aError)))
+	{
+		dbg_msg("sql", "failed connecting to db: %s", aError);
+		return false;
+	}
+	bool Success = !pConnection->StartTransaction(aError, sizeof(aError));
+	if(Success)
+	{
+		if(ppData[0]->m_pWriteBatchFunc != nullptr)
+		{
+			const ISqlData *apData[MAX_WRITE_BATCH];
+			for(int i = 0; i < NumData; i++)
+				apData[i] = ppData[i]->m_pThreadData.get();
+			Success = !ppData[0]->m_pWriteBatchFunc(pConnection, apData, NumData, w, aError, sizeof(aError));
+		}
+		else
+		{
+			for(int i = 0; i < NumData && Success; i++)
+				Success = !ppData[i]->m_Ptr.m_pWriteFunc(pConnection, ppData[i]->m_pThreadData.get(), w, aError, sizeof(aError));
+		}
+		if(Success)
+			Success = !pConnection->CommitTransaction(aError, sizeof(aError));
+		if(!Success)
+		{
+			char aRollbackError[256];
+			if(pConnection->RollbackTransaction(aRollbackError, sizeof(aRollbackError)))
+				dbg_msg("sql", "failed rolling back transaction: %s", aRollbackError);
+		}
+	}
+	pConnection->Disconnect();
+	if(!Success)
+	{
+		dbg_msg("sql", "batch of %d %s failed: %s", NumData, ppData[0]->m_pName, aError);
+	}
+	return Success;
+}
+
 CDbConnectionPool::CDbConnectionPool()
 {
 	m_pShared = std::make_shared<CSharedData>();
@@ -478,4 +793,13 @@ CDbConnectionPool::~CDbConnectionPool()
 		thread_wait(m_pWorkerThread);
 	if(m_pBackupThread)
 		thread_wait(m_pBackupThread);
+	for(void *pThread : m_vpReadWorkerThreads)
+		thread_wait(pThread);
+}
+
+void CDbConnectionPool::StartReadWorkers()
+{
+	while((int)m_vpReadWorkerThreads.size() < m_NumReadWorkers)
+		m_vpReadWorkerThreads.push_back(thread_init(CReadWorker::Start, new CReadWorker(m_pShared), "database read worker thread"));
+	m_pShared->m_NumReadWorkers.store(m_vpReadWorkerThreads.size());
 }
@@ -3,7 +3,9 @@
 
 #include <atomic>
 #include <base/tl/threading.h>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 class IDbConnection;
@@ -67,6 +69,14 @@ public:
 	// Returns false on success.
 	typedef bool (*FRead)(IDbConnection *, const ISqlData *, char *pError, int ErrorSize);
 	typedef bool (*FWrite)(IDbConnection *, const ISqlData *, Write, char *pError, int ErrorSize);
+	typedef bool (*FWriteBatch)(IDbConnection *, const ISqlData *const *ppData, int NumData, Write, char *pError, int ErrorSize);
+
+	enum
+	{
+		// maximum number of queued writes executed in one transaction
+		MAX_WRITE_BATCH = 32,
+		MAX_READ_WORKERS = 16,
+	};
 
 	enum Mode
 	{
@@ -78,9 +88,16 @@ public:
 
 	void Print(IConsole *pConsole, Mode DatabaseMode);
 
+	// Number of threads executing read queries in parallel, each with its
+	// own connections. The server sets it from sv_sql_read_workers, without
+	// calling this there is one. Running workers aren't stopped when the
+	// number is reduced.
+	void SetNumReadWorkers(int NumWorkers);
+
 	void RegisterSqliteDatabase(Mode DatabaseMode, const char FileName[64]);
 	void RegisterMysqlDatabase(Mode DatabaseMode, const CMysqlConfig *pMysqlConfig);
 
+	// read queries run on the read workers, unordered with writes
 	void Execute(
 		FRead pFunc,
 		std::unique_ptr<const ISqlData> pSqlRequestData,
@@ -91,14 +108,25 @@ public:
 		FWrite pFunc,
 		std::unique_ptr<const ISqlData> pSqlRequestData,
 		const char *pName);
+	// Like ExecuteWrite, but writes queued directly after each other with the
+	// same pFunc are executed in a single transaction. pBatchFunc may combine
+	// them into fewer statements and can be nullptr to call pFunc for each
+	// write. If the transaction fails, the writes are retried one by one.
+	void ExecuteWriteBatched(
+		FWrite pFunc,
+		FWriteBatch pBatchFunc,
+		std::unique_ptr<const ISqlData> pSqlRequestData,
+		const char *pName);
 
 	void OnShutdown();
 
 	friend class CWorker;
 	friend class CBackup;
+	friend class CReadWorker;
 
 private:
 	static bool ExecSqlFunc(IDbConnection *pConnection, struct CSqlExecData *pData, Write w);
+	static bool ExecSqlBatch(IDbConnection *pConnection, struct CSqlExecData *const *ppData, int NumData, Write w);
 
 	// Only the main thread accesses this variable. It points to the index,
 	// where the next query is added to the queue.
@@ -106,6 +134,22 @@ private:
 
 	bool m_Shutdown = false;
 
+	// queue depth and time from queuing to completion of the queries of
+	// one lane, updated by all threads
+	struct CLaneStats
+	{
+		std::atomic_int m_Depth{0};
+		std::atomic_int m_MaxDepth{0};
+		std::atomic<int64_t> m_NumQueries{0};
+		// in microseconds
+		std::atomic<int64_t> m_TotalLatency{0};
+		std::atomic<int64_t> m_MaxLatency{0};
+
+		void Queued();
+		void Done(int64_t QueueTime);
+		void Print(IConsole *pConsole, const char *pLane, int NumWorkers) const;
+	};
+
 	struct CSharedData
 	{
 		// Used as signal that shutdown is in progress from main thread to
@@ -123,11 +167,34 @@ private:
 
 		// spsc queue with additional backup worker to look at queries first.
 		std::unique_ptr<struct CSqlExecData> m_aQueries[512];
+		CLaneStats m_WriteStats;
+
+		// Read queries don't depend on each other, so they are taken by
+		// any of the read workers from this queue.
+		std::mutex m_ReadLock;
+		std::deque<std::unique_ptr<struct CSqlExecData>> m_ReadQueries;
+		// registered READ databases, each read worker connects to all of them
+		std::vector<std::unique_ptr<struct CSqlExecData>> m_vpReadDatabases;
+		CSemaphore m_NumRead;
+		std::atomic_int m_NumReadWorkers{0};
+		CLaneStats m_ReadStats;
 	};
 
+	// Collects the writes queued directly after pFirst (at JobNum) which can
+	// be executed in the same transaction. It takes each following query
+	// from pSemaphore without blocking before looking at it. If a taken
+	// query can't be batched, *pNextClaimed is set and the caller must
+	// handle it next without waiting for it again.
+	static int CollectWriteBatch(CSharedData *pShared, CSemaphore *pSemaphore, int JobNum, struct CSqlExecData *pFirst, struct CSqlExecData **ppBatch, bool *pNextClaimed);
+
+	void QueueRead(std::unique_ptr<struct CSqlExecData> pData);
+	void StartReadWorkers();
+
 	std::shared_ptr<CSharedData> m_pShared;
 	void *m_pWorkerThread = nullptr;
 	void *m_pBackupThread = nullptr;
+	int m_NumReadWorkers = 1;
+	std::vector<void *> m_vpReadWorkerThreads;
 };
 
 #endif // ENGINE_SERVER_DATABASES_CONNECTION_POOL_H
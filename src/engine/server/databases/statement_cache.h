@@ -0,0 +1,76 @@
+#ifndef ENGINE_SERVER_DATABASES_STATEMENT_CACHE_H
+#define ENGINE_SERVER_DATABASES_STATEMENT_CACHE_H
+
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+// Least recently used prepared statements of one connection, keyed by their
+// SQL text. `TStmt` owns a statement, e.g. a `std::unique_ptr` with a deleter
+// closing it, so evicted statements are released automatically.
+template<typename TStmt>
+class CStatementCache
+{
+public:
+	enum
+	{
+		DEFAULT_SIZE = 32,
+	};
+
+	CStatementCache(int Size = DEFAULT_SIZE) :
+		m_Size(Size)
+	{
+	}
+
+	// returns nullptr if the statement isn't cached
+	TStmt *Find(const char *pSql)
+	{
+		auto Entry = m_Index.find(pSql);
+		if(Entry == m_Index.end())
+		{
+			m_Misses++;
+			return nullptr;
+		}
+		m_Hits++;
+		m_Entries.splice(m_Entries.begin(), m_Entries, Entry->second);
+		return &Entry->second->second;
+	}
+
+	// evicts the least recently used statement if the cache is full
+	TStmt *Add(const char *pSql, TStmt Stmt)
+	{
+		if((int)m_Entries.size() >= m_Size)
+		{
+			m_Index.erase(m_Entries.back().first);
+			m_Entries.pop_back();
+		}
+		m_Entries.emplace_front(pSql, std::move(Stmt));
+		m_Index.emplace(m_Entries.front().first, m_Entries.begin());
+		return &m_Entries.front().second;
+	}
+
+	void Clear()
+	{
+		m_Index.clear();
+		m_Entries.clear();
+	}
+
+	int Size() const { return m_Entries.size(); }
+	int Hits() const { return m_Hits; }
+	int Misses() const { return m_Misses; }
+
+private:
+	typedef std::list<std::pair<std::string, TStmt>> CEntries;
+
+	int m_Size;
+	int m_Hits = 0;
+	int m_Misses = 0;
+	// most recently used first
+	CEntries m_Entries;
+	// views into the keys of m_Entries, which don't move
+	std::unordered_map<std::string_view, typename CEntries::iterator> m_Index;
+};
+
+#endif // ENGINE_SERVER_DATABASES_STATEMENT_CACHE_H
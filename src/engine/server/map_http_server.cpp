@@ -0,0 +1,310 @@
+#include "map_http_server.h"
+
+#include <engine/shared/netban.h>
+
+CMapHttpServer::CMapHttpServer()
+{
+	m_Socket = nullptr;
+	m_pNetBan = nullptr;
+	m_MaxConnections = 0;
+	for(auto &Map : m_aMaps)
+	{
+		Map.m_Sha256 = SHA256_ZEROED;
+		Map.m_pData = nullptr;
+		Map.m_Size = 0;
+	}
+}
+
+CMapHttpServer::~CMapHttpServer()
+{
+	Close();
+}
+
+bool CMapHttpServer::Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxConnections)
+{
+	dbg_assert(!IsOpen(), "map http server already open");
+
+	m_Socket = net_tcp_create(BindAddr);
+	if(!m_Socket)
+		return false;
+	if(net_tcp_listen(m_Socket, MaxConnections))
+	{
+		net_tcp_close(m_Socket);
+		m_Socket = nullptr;
+		return false;
+	}
+	net_set_non_blocking(m_Socket);
+
+	m_pNetBan = pNetBan;
+	m_MaxConnections = MaxConnections;
+	return true;
+}
+
+void CMapHttpServer::Close()
+{
+	while(!m_vConnections.empty())
+		Drop(m_vConnections.size() - 1);
+	if(m_Socket)
+	{
+		net_tcp_close(m_Socket);
+		m_Socket = nullptr;
+	}
+}
+
+void CMapHttpServer::SetMap(int Index, const SHA256_DIGEST &Sha256, const unsigned char *pData, unsigned Size)
+{
+	dbg_assert(Index >= 0 && Index < MAX_MAPS, "invalid map index");
+
+	// the data of responses in progress is about to go away
+	for(int i = m_vConnections.size() - 1; i >= 0; i--)
+	{
+		if(m_vConnections[i].m_Map == Index)
+			Drop(i);
+	}
+
+	CMap &Map = m_aMaps[Index];
+	Map.m_Sha256 = Sha256;
+	Map.m_pData = pData;
+	Map.m_Size = pData ? Size : 0;
+}
+
+void CMapHttpServer::Drop(int Index)
+{
+	net_tcp_close(m_vConnections[Index].m_Socket);
+	m_vConnections[Index] = std::move(m_vConnections.back());
+	m_vConnections.pop_back();
+}
+
+void CMapHttpServer::Accept()
+{
+	while(true)
+	{
+		NETSOCKET Socket;
+		NETADDR Addr;
+		if(net_tcp_accept(m_Socket, &Socket, &Addr) <= 0)
+			break;
+
+		char aBuf[128];
+		if((m_pNetBan && m_pNetBan->IsBanned(&Addr, aBuf, sizeof(aBuf))) || (int)m_vConnections.size() >= m_MaxConnections)
+		{
+			net_tcp_close(Socket);
+			continue;
+		}
+
+		net_set_non_blocking(Socket);
+		CConnection &Connection = m_vConnections.emplace_back();
+		Connection.m_Socket = Socket;
+		Connection.m_Addr = Addr;
+		Connection.m_LastActivity = time_get();
+		Connection.m_RequestSize = 0;
+		Connection.m_Responding = false;
+		Connection.m_HeaderSent = 0;
+		Connection.m_Map = -1;
+		Connection.m_BodySent = 0;
+	}
+}
+
+int CMapHttpServer::ParseRequest(const char *pRequest, bool *pHead, char *pPath, int PathSize)
+{
+	const char *pRest;
+	if((pRest = str_startswith(pRequest, "GET ")))
+		*pHead = false;
+	else if((pRest = str_startswith(pRequest, "HEAD ")))
+		*pHead = true;
+	else
+		return 405;
+
+	const char *pPathEnd = str_find(pRest, " ");
+	const char *pLineEnd = str_find(pRest, "\r\n");
+	if(!pPathEnd || !pLineEnd || pPathEnd > pLineEnd || !str_startswith(pPathEnd + 1, "HTTP/1."))
+		return 400;
+	if(pPathEnd - pRest >= PathSize)
+		return 414;
+
+	str_truncate(pPath, PathSize, pRest, pPathEnd - pRest);
+	return 200;
+}
+
+bool CMapHttpServer::ParsePath(const char *pPath, SHA256_DIGEST *pSha256)
+{
+	// only `/<sha256>.map` is served, a query string is ignored
+	char aSha256[SHA256_MAXSTRSIZE];
+	const char *pQuery = str_find(pPath, "?");
+	const int Length = pQuery ? pQuery - pPath : str_length(pPath);
+	if(pPath[0] != '/' || Length != 1 + SHA256_MAXSTRSIZE - 1 + 4 || str_comp_num(pPath + Length - 4, ".map", 4) != 0)
+		return false;
+	str_truncate(aSha256, sizeof(aSha256), pPath + 1, SHA256_MAXSTRSIZE - 1);
+	return sha256_from_str(pSha256, aSha256) == 0;
+}
+
+void CMapHttpServer::Respond(CConnection *pConnection)
+{
+	bool Head = false;
+	char aPath[256];
+	int Status = ParseRequest(pConnection->m_aRequest, &Head, aPath, sizeof(aPath));
+
+	int MapIndex = -1;
+	char aSha256[SHA256_MAXSTRSIZE] = "";
+	if(Status == 200)
+	{
+		SHA256_DIGEST Sha256;
+		if(ParsePath(aPath, &Sha256))
+		{
+			for(int i = 0; i < MAX_MAPS; i++)
+			{
+				if(m_aMaps[i].m_pData && m_aMaps[i].m_Sha256 == Sha256)
+				{
+					MapIndex = i;
+					break;
+				}
+			}
+		}
+		if(MapIndex == -1)
+			Status = 404;
+	}
+	if(Status == 200)
+	{
+		// maps never change, the hash is a strong validator
+		sha256_str(m_aMaps[MapIndex].m_Sha256, aSha256, sizeof(aSha256));
+		const char *pIfNoneMatch = str_find_nocase(pConnection->m_aRequest, "\r\nIf-None-Match:");
+		if(pIfNoneMatch)
+		{
+			const char *pLineEnd = str_find(pIfNoneMatch + 2, "\r\n");
+			const char *pMatch = str_find(pIfNoneMatch + 2, aSha256);
+			if(pMatch && pMatch < pLineEnd)
+			{
+				Status = 304;
+				MapIndex = -1;
+			}
+		}
+	}
+
+	const char *pStatus;
+	switch(Status)
+	{
+	case 200: pStatus = "OK"; break;
+	case 304: pStatus = "Not Modified"; break;
+	case 400: pStatus = "Bad Request"; break;
+	case 404: pStatus = "Not Found"; break;
+	case 405: pStatus = "Method Not Allowed"; break;
+	case 414: pStatus = "URI Too Long"; break;
+	default: pStatus = "Error"; break;
+	}
+
+	char aEtag[SHA256_MAXSTRSIZE + 16] = "";
+	if(aSha256[0])
+		str_format(aEtag, sizeof(aEtag), "ETag: \"%s\"\r\n", aSha256);
+	char aHeader[384];
+	if(Status == 304)
+	{
+		// no body, not even an empty one
+		str_format(aHeader, sizeof(aHeader),
+			"HTTP/1.1 %d %s\r\n"
+			"%s"
+			"Connection: close\r\n"
+			"\r\n",
+			Status, pStatus, aEtag);
+	}
+	else
+	{
+		str_format(aHeader, sizeof(aHeader),
+			"HTTP/1.1 %d %s\r\n"
+			"Content-Type: %s\r\n"
+			"Content-Length: %u\r\n"
+			"%s"
+			"Connection: close\r\n"
+			"\r\n",
+			Status, pStatus,
+			MapIndex != -1 ? "application/octet-stream" : "text/plain",
+			MapIndex != -1 ? m_aMaps[MapIndex].m_Size : 0,
+			aEtag);
+	}
+
+	pConnection->m_Responding = true;
+	pConnection->m_Header = aHeader;
+	pConnection->m_HeaderSent = 0;
+	pConnection->m_Map = Head ? -1 : MapIndex;
+	pConnection->m_BodySent = 0;
+}
+
+bool CMapHttpServer::Receive(CConnection *pConnection)
+{
+	while(pConnection->m_RequestSize < MAX_REQUEST_SIZE - 1)
+	{
+		int Bytes = net_tcp_recv(pConnection->m_Socket, pConnection->m_aRequest + pConnection->m_RequestSize, MAX_REQUEST_SIZE - 1 - pConnection->m_RequestSize);
+		if(Bytes < 0)
+			return net_would_block();
+		if(Bytes == 0)
+			return false;
+
+		pConnection->m_LastActivity = time_get();
+		pConnection->m_RequestSize += Bytes;
+		pConnection->m_aRequest[pConnection->m_RequestSize] = '\0';
+		if(str_find(pConnection->m_aRequest, "\r\n\r\n"))
+		{
+			Respond(pConnection);
+			return true;
+		}
+	}
+
+	// request headers too large
+	return false;
+}
+
+bool CMapHttpServer::Send(CConnection *pConnection)
+{
+	// send directly from the map buffer until the socket is full
+	while(true)
+	{
+		const void *pData;
+		int Size;
+		if(pConnection->m_HeaderSent < (int)pConnection->m_Header.size())
+		{
+			pData = pConnection->m_Header.data() + pConnection->m_HeaderSent;
+			Size = pConnection->m_Header.size() - pConnection->m_HeaderSent;
+		}
+		else if(pConnection->m_Map != -1 && pConnection->m_BodySent < m_aMaps[pConnection->m_Map].m_Size)
+		{
+			const CMap &Map = m_aMaps[pConnection->m_Map];
+			pData = Map.m_pData + pConnection->m_BodySent;
+			Size = minimum(Map.m_Size - pConnection->m_BodySent, 1024u * 1024u);
+		}
+		else
+			return false; // done
+
+		int Bytes = net_tcp_send(pConnection->m_Socket, pData, Size);
+		if(Bytes < 0)
+			return net_would_block();
+
+		pConnection->m_LastActivity = time_get();
+		if(pConnection->m_HeaderSent < (int)pConnection->m_Header.size())
+			pConnection->m_HeaderSent += Bytes;
+		else
+			pConnection->m_BodySent += Bytes;
+		if(Bytes < Size)
+			return true;
+	}
+}
+
+void CMapHttpServer::Update()
+{
+	if(!IsOpen())
+		return;
+
+	Accept();
+
+	const int64_t Now = time_get();
+	for(int i = m_vConnections.size() - 1; i >= 0; i--)
+	{
+		CConnection *pConnection = &m_vConnections[i];
+		bool Keep = true;
+		if(!pConnection->m_Responding)
+			Keep = Receive(pConnection);
+		if(Keep && pConnection->m_Responding)
+			Keep = Send(pConnection);
+		if(Keep && Now - pConnection->m_LastActivity > CONNECTION_TIMEOUT * time_freq())
+			Keep = false;
+		if(!Keep)
+			Drop(i);
+	}
+}
@@ -0,0 +1,85 @@
+#ifndef ENGINE_SERVER_MAP_HTTP_SERVER_H
+#define ENGINE_SERVER_MAP_HTTP_SERVER_H
+
+#include <base/hash.h>
+#include <base/system.h>
+
+#include <string>
+#include <vector>
+
+class CNetBan;
+
+// Minimal HTTP/1.1 server that hands out the maps of the server by their
+// SHA-256, as `GET /<sha256>.map`. It is polled from the server loop like
+// the external console. The map data is sent straight from the buffers
+// passed to `SetMap`, which have to stay valid until the map is replaced.
+class CMapHttpServer
+{
+public:
+	enum
+	{
+		MAX_MAPS = 2,
+		MAX_REQUEST_SIZE = 2048,
+		CONNECTION_TIMEOUT = 10, // seconds without progress
+	};
+
+private:
+	struct CMap
+	{
+		SHA256_DIGEST m_Sha256;
+		const unsigned char *m_pData;
+		unsigned m_Size;
+	};
+
+	struct CConnection
+	{
+		NETSOCKET m_Socket;
+		NETADDR m_Addr;
+		int64_t m_LastActivity;
+
+		char m_aRequest[MAX_REQUEST_SIZE];
+		int m_RequestSize;
+
+		// response, `m_Map` is -1 if there is no body
+		bool m_Responding;
+		std::string m_Header;
+		int m_HeaderSent;
+		int m_Map;
+		unsigned m_BodySent;
+	};
+
+	NETSOCKET m_Socket;
+	CNetBan *m_pNetBan;
+	int m_MaxConnections;
+	CMap m_aMaps[MAX_MAPS];
+	std::vector<CConnection> m_vConnections;
+
+	void Accept();
+	// returns false if the connection should be closed
+	bool Receive(CConnection *pConnection);
+	bool Send(CConnection *pConnection);
+	void Respond(CConnection *pConnection);
+	void Drop(int Index);
+
+public:
+	CMapHttpServer();
+	~CMapHttpServer();
+
+	bool Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxConnections);
+	void Close();
+	bool IsOpen() const { return m_Socket != nullptr; }
+
+	// Sets the map served at the given slot, `pData` may be null to stop
+	// serving it. Downloads of the previous map in the slot are aborted.
+	void SetMap(int Index, const SHA256_DIGEST &Sha256, const unsigned char *pData, unsigned Size);
+	void Update();
+
+	int NumConnections() const { return m_vConnections.size(); }
+
+	// Parses the request line and returns the path of a GET or HEAD
+	// request, or the status code to respond with on failure.
+	static int ParseRequest(const char *pRequest, bool *pHead, char *pPath, int PathSize);
+	static bool ParsePath(const char *pPath, SHA256_DIGEST *pSha256);
+};
+
+#endif
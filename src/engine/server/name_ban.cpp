@@ -1,5 +1,9 @@
 #include "name_ban.h"
 
+#include <base/math.h>
+
+#include <algorithm>
+
 CNameBan *IsNameBanned(const char *pName, std::vector<CNameBan> &vNameBans)
 {
 	char aTrimmed[MAX_NAME_LENGTH];
@@ -19,3 +23,314 @@ CNameBan *IsNameBanned(const char *pName, std::vector<CNameBan> &vNameBans)
 	}
 	return pResult;
 }
+
+static int SkeletonDistance(const int *pA, int LengthA, const int *pB, int LengthB)
+{
+	int aBuffer[MAX_NAME_SKELETON_LENGTH * 2 + 2];
+	return str_utf32_dist_buffer(pA, LengthA, pB, LengthB, aBuffer, std::size(aBuffer));
+}
+
+// FNV-1a, extended one codepoint at a time while searching
+static uint64_t PieceHash(uint64_t Hash, int Codepoint)
+{
+	return (Hash ^ (uint32_t)Codepoint) * 1099511628211u;
+}
+
+static const uint64_t PIECE_HASH_START = 14695981039346656037u;
+
+static uint64_t AcEdge(int Node, int Codepoint)
+{
+	return ((uint64_t)Node << 32) | (uint32_t)Codepoint;
+}
+
+template<typename F>
+static void ForEachPiece(const CNameBan *pBan, F &&Function)
+{
+	// edits can only touch `Distance` of the `Distance + 1` pieces
+	const int NumPieces = pBan->m_Distance + 1;
+	for(int i = 0; i < NumPieces; i++)
+	{
+		uint64_t Hash = PIECE_HASH_START;
+		for(int j = i * pBan->m_SkeletonLength / NumPieces; j < (i + 1) * pBan->m_SkeletonLength / NumPieces; j++)
+			Hash = PieceHash(Hash, pBan->m_aSkeleton[j]);
+		Function(Hash);
+	}
+}
+
+CNameBan *CNameBans::Get(const char *pName)
+{
+	// names are truncated like in `CNameBan`
+	char aName[MAX_NAME_LENGTH];
+	str_copy(aName, pName);
+	auto Entry = m_Names.find(aName);
+	return Entry == m_Names.end() ? nullptr : Entry->second;
+}
+
+void CNameBans::Ban(const char *pName, int Distance, int IsSubstring, const char *pReason)
+{
+	CNameBan *pBan = Get(pName);
+	if(pBan)
+	{
+		// the name stays the same, so only the pieces can change
+		const int Order = RemoveDistanceBan(pBan);
+		pBan->m_Distance = Distance;
+		pBan->m_IsSubstring = IsSubstring;
+		str_copy(pBan->m_aReason, pReason);
+		AddDistanceBan(pBan, Order);
+		return;
+	}
+
+	pBan = &m_Bans.emplace_back(pName, Distance, IsSubstring, pReason);
+	m_Names[pBan->m_aName] = pBan;
+	AddDistanceBan(pBan, m_NextOrder);
+	m_vAcNodes[AcFindOrAdd(pBan->m_aName, true)].m_vBans.emplace_back(pBan, m_NextOrder);
+	m_AcLinksValid = false;
+	m_NextOrder++;
+}
+
+void CNameBans::Unban(const char *pName)
+{
+	CNameBan *pBan = Get(pName);
+	if(!pBan)
+		return;
+
+	RemoveDistanceBan(pBan);
+	std::vector<CEntry> &vAcBans = m_vAcNodes[AcFindOrAdd(pBan->m_aName, false)].m_vBans;
+	vAcBans.erase(std::find_if(vAcBans.begin(), vAcBans.end(), [pBan](const CEntry &Entry) { return Entry.first == pBan; }));
+	m_NumRemovedAcBans++;
+
+	m_Names.erase(pBan->m_aName);
+	m_Bans.remove_if([pBan](const CNameBan &Ban) { return &Ban == pBan; });
+
+	// the automaton keeps the nodes of removed names
+	if(m_NumRemovedAcBans > (int)m_Bans.size())
+		Rebuild();
+}
+
+void CNameBans::Rebuild()
+{
+	m_DistancePieces.clear();
+	m_vShortDistanceBans.clear();
+	m_vAcNodes.clear();
+	m_AcEdges.clear();
+	m_AcLinksValid = false;
+	m_NumRemovedAcBans = 0;
+
+	m_NextOrder = 0;
+	for(CNameBan &Ban : m_Bans)
+	{
+		AddDistanceBan(&Ban, m_NextOrder);
+		m_vAcNodes[AcFindOrAdd(Ban.m_aName, true)].m_vBans.emplace_back(&Ban, m_NextOrder);
+		m_NextOrder++;
+	}
+}
+
+void CNameBans::AddDistanceBan(CNameBan *pBan, int Order)
+{
+	// the distance is never negative
+	if(pBan->m_Distance < 0)
+		return;
+	if(pBan->m_Distance >= pBan->m_SkeletonLength)
+	{
+		m_vShortDistanceBans.emplace_back(pBan, Order);
+		return;
+	}
+	ForEachPiece(pBan, [&](uint64_t Hash) { m_DistancePieces[Hash].emplace_back(pBan, Order); });
+}
+
+int CNameBans::RemoveDistanceBan(const CNameBan *pBan)
+{
+	auto &&IsBan = [pBan](const CEntry &Entry) { return Entry.first == pBan; };
+	int Order = -1;
+	auto &&Remove = [&](std::vector<CEntry> &vEntries) {
+		auto Entry = std::find_if(vEntries.begin(), vEntries.end(), IsBan);
+		if(Entry != vEntries.end())
+			Order = Entry->second;
+		vEntries.erase(std::remove_if(vEntries.begin(), vEntries.end(), IsBan), vEntries.end());
+	};
+
+	if(pBan->m_Distance >= pBan->m_SkeletonLength)
+	{
+		Remove(m_vShortDistanceBans);
+	}
+	else if(pBan->m_Distance >= 0)
+	{
+		ForEachPiece(pBan, [&](uint64_t Hash) {
+			auto Bucket = m_DistancePieces.find(Hash);
+			if(Bucket == m_DistancePieces.end())
+				return;
+			Remove(Bucket->second);
+			if(Bucket->second.empty())
+				m_DistancePieces.erase(Bucket);
+		});
+	}
+
+	if(Order == -1)
+	{
+		// bans with a negative distance aren't in the distance index
+		const std::vector<CEntry> &vAcBans = m_vAcNodes[AcFindOrAdd(pBan->m_aName, false)].m_vBans;
+		Order = std::find_if(vAcBans.begin(), vAcBans.end(), IsBan)->second;
+	}
+	return Order;
+}
+
+int CNameBans::AcChild(int Node, int Codepoint) const
+{
+	auto Edge = m_AcEdges.find(AcEdge(Node, Codepoint));
+	return Edge == m_AcEdges.end() ? -1 : Edge->second;
+}
+
+int CNameBans::AcFindOrAdd(const char *pName, bool Add)
+{
+	if(m_vAcNodes.empty())
+		m_vAcNodes.push_back({-1, 0, 0, 0, -1, {}});
+
+	int Current = 0;
+	while(*pName)
+	{
+		const int Codepoint = str_utf8_tolower(str_utf8_decode(&pName));
+		int Child = AcChild(Current, Codepoint);
+		if(Child == -1)
+		{
+			dbg_assert(Add, "name ban missing from index");
+			Child = m_vAcNodes.size();
+			m_vAcNodes.push_back({Current, Codepoint, m_vAcNodes[Current].m_Depth + 1, 0, -1, {}});
+			m_AcEdges[AcEdge(Current, Codepoint)] = Child;
+			m_AcLinksValid = false;
+		}
+		Current = Child;
+	}
+	return Current;
+}
+
+void CNameBans::UpdateAcLinks()
+{
+	// breadth first, so the failure links of the parents are known
+	std::vector<int> vOrder(m_vAcNodes.size());
+	for(size_t i = 0; i < vOrder.size(); i++)
+		vOrder[i] = i;
+	std::stable_sort(vOrder.begin(), vOrder.end(), [this](int a, int b) { return m_vAcNodes[a].m_Depth < m_vAcNodes[b].m_Depth; });
+
+	for(int Index : vOrder)
+	{
+		CAcNode &Node = m_vAcNodes[Index];
+		if(Node.m_Depth == 0)
+			continue;
+
+		Node.m_Fail = 0;
+		if(Node.m_Parent != 0)
+		{
+			int Fail = m_vAcNodes[Node.m_Parent].m_Fail;
+			while(true)
+			{
+				const int Child = AcChild(Fail, Node.m_Codepoint);
+				if(Child != -1)
+				{
+					Node.m_Fail = Child;
+					break;
+				}
+				if(Fail == 0)
+					break;
+				Fail = m_vAcNodes[Fail].m_Fail;
+			}
+		}
+
+		// bans at the root are handled separately
+		const CAcNode &Fail = m_vAcNodes[Node.m_Fail];
+		Node.m_Output = Node.m_Fail != 0 && !Fail.m_vBans.empty() ? Node.m_Fail : Fail.m_Output;
+	}
+	m_AcLinksValid = true;
+}
+
+CNameBan *CNameBans::IsBanned(const char *pName)
+{
+	CNameBan *pResult = nullptr;
+	int ResultOrder = -1;
+
+	if(!m_vAcNodes.empty())
+	{
+		if(!m_AcLinksValid)
+			UpdateAcLinks();
+
+		auto &&MatchSubstrings = [&](const CAcNode &Node) {
+			for(const CEntry &Entry : Node.m_vBans)
+			{
+				if(Entry.first->m_IsSubstring == 1 && Entry.second > ResultOrder)
+				{
+					pResult = Entry.first;
+					ResultOrder = Entry.second;
+				}
+			}
+		};
+
+		// an empty substring is found in every non-empty name
+		const char *pSearch = pName;
+		if(*pSearch)
+			MatchSubstrings(m_vAcNodes[0]);
+
+		int Current = 0;
+		while(*pSearch)
+		{
+			const int Codepoint = str_utf8_tolower(str_utf8_decode(&pSearch));
+			while(true)
+			{
+				const int Child = AcChild(Current, Codepoint);
+				if(Child != -1)
+				{
+					Current = Child;
+					break;
+				}
+				if(Current == 0)
+					break;
+				Current = m_vAcNodes[Current].m_Fail;
+			}
+			for(int Output = Current; Output > 0; Output = m_vAcNodes[Output].m_Output)
+				MatchSubstrings(m_vAcNodes[Output]);
+		}
+	}
+
+	char aTrimmed[MAX_NAME_LENGTH];
+	str_copy(aTrimmed, str_utf8_skip_whitespaces(pName));
+	str_utf8_trim_right(aTrimmed);
+
+	int aSkeleton[MAX_NAME_SKELETON_LENGTH];
+	int SkeletonLength = str_utf8_to_skeleton(aTrimmed, aSkeleton, std::size(aSkeleton));
+
+	// only bans added after the best match so far can change the result
+	std::vector<CEntry> vCandidates;
+	for(const CEntry &Entry : m_vShortDistanceBans)
+	{
+		if(Entry.second > ResultOrder)
+			vCandidates.push_back(Entry);
+	}
+	if(!m_DistancePieces.empty())
+	{
+		for(int Start = 0; Start < SkeletonLength; Start++)
+		{
+			uint64_t Hash = PIECE_HASH_START;
+			for(int End = Start; End < SkeletonLength; End++)
+			{
+				Hash = PieceHash(Hash, aSkeleton[End]);
+				auto Bucket = m_DistancePieces.find(Hash);
+				if(Bucket == m_DistancePieces.end())
+					continue;
+				for(const CEntry &Entry : Bucket->second)
+				{
+					if(Entry.second > ResultOrder)
+						vCandidates.push_back(Entry);
+				}
+			}
+		}
+	}
+
+	// the first match from the back is the last added one
+	std::sort(vCandidates.begin(), vCandidates.end(), [](const CEntry &a, const CEntry &b) { return a.second > b.second; });
+	vCandidates.erase(std::unique(vCandidates.begin(), vCandidates.end()), vCandidates.end());
+	for(const CEntry &Entry : vCandidates)
+	{
+		const CNameBan *pBan = Entry.first;
+		if(SkeletonDistance(aSkeleton, SkeletonLength, pBan->m_aSkeleton, pBan->m_SkeletonLength) <= pBan->m_Distance)
+			return Entry.first;
+	}
+	return pResult;
+}
@@ -4,6 +4,9 @@
 #include <base/system.h>
 #include <engine/shared/protocol.h>
 
+#include <list>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 enum
@@ -33,4 +36,63 @@ public:
 
 CNameBan *IsNameBanned(const char *pName, std::vector<CNameBan> &vNameBans);
 
+// Name bans with an index to match names without comparing them against
+// every ban. A skeleton within the distance `t` of a ban contains one of
+// the `t + 1` pieces the ban's skeleton is split into, so only bans with a
+// piece in the name are compared. Substring bans are looked up with an
+// Aho-Corasick automaton over the lowercase codepoints. `IsBanned` gives
+// the same result as `IsNameBanned` on the bans in the order they were
+// added.
+class CNameBans
+{
+	// a ban and its position in the order they were added
+	typedef std::pair<CNameBan *, int> CEntry;
+
+	class CAcNode
+	{
+	public:
+		int m_Parent;
+		int m_Codepoint;
+		int m_Depth;
+		int m_Fail;
+		// next node on the failure chain that has bans, or -1
+		int m_Output;
+		// bans whose name ends here
+		std::vector<CEntry> m_vBans;
+	};
+
+	std::list<CNameBan> m_Bans;
+	std::unordered_map<std::string, CNameBan *> m_Names;
+	int m_NextOrder = 0;
+
+	// distance bans by the hashes of their pieces
+	std::unordered_map<uint64_t, std::vector<CEntry>> m_DistancePieces;
+	// distance bans too short to be split, compared against every name
+	std::vector<CEntry> m_vShortDistanceBans;
+
+	std::vector<CAcNode> m_vAcNodes;
+	// child node by parent node and codepoint
+	std::unordered_map<uint64_t, int> m_AcEdges;
+	bool m_AcLinksValid = false;
+	int m_NumRemovedAcBans = 0;
+
+	void Rebuild();
+	void AddDistanceBan(CNameBan *pBan, int Order);
+	// returns the order of the removed ban
+	int RemoveDistanceBan(const CNameBan *pBan);
+	int AcChild(int Node, int Codepoint) const;
+	int AcFindOrAdd(const char *pName, bool Add);
+	void UpdateAcLinks();
+
+public:
+	// the ban of exactly this name, or nullptr
+	CNameBan *Get(const char *pName);
+	// adds a ban, or changes the ban with the same name
+	void Ban(const char *pName, int Distance, int IsSubstring, const char *pReason);
+	void Unban(const char *pName);
+	CNameBan *IsBanned(const char *pName);
+
+	const std::list<CNameBan> &Bans() const { return m_Bans; }
+};
+
 #endif // ENGINE_SERVER_NAME_BAN_H
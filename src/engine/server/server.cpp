@@ -201,9 +201,8 @@ int CServerBan::BanExt(T *pBanPool, const typename T::CDataType *pData, int Seco
 
 		if(NetMatch(&Data, Server()->m_NetServer.ClientAddr(i)))
 		{
-			CNetHash NetHash(&Data);
 			char aBuf[256];
-			MakeBanInfo(pBanPool->Find(&Data, &NetHash), aBuf, sizeof(aBuf), MSGTYPE_PLAYER);
+			MakeBanInfo(pBanPool->Find(&Data), aBuf, sizeof(aBuf), MSGTYPE_PLAYER);
 			Server()->m_NetServer.Drop(i, aBuf);
 		}
 	}
@@ -315,6 +314,7 @@ CServer::CServer()
 	for(int i = 0; i < MAX_CLIENTS; i++)
 		m_aDemoRecorder[i] = CDemoRecorder(&m_SnapshotDelta, true);
 	m_aDemoRecorder[MAX_CLIENTS] = CDemoRecorder(&m_SnapshotDelta, false);
+	m_NumPlayerDemos = 0;
 
 	m_TickSpeed = SERVER_TICK_SPEED;
 
@@ -404,7 +404,7 @@ bool CServer::SetClientNameImpl(int ClientID, const char *pNameRequest, bool Set
 	if(m_aClients[ClientID].m_State < CClient::STATE_READY)
 		return false;
 
-	CNameBan *pBanned = IsNameBanned(pNameRequest, m_vNameBans);
+	CNameBan *pBanned = m_NameBans.IsBanned(pNameRequest);
 	if(pBanned)
 	{
 		if(m_aClients[ClientID].m_State == CClient::STATE_READY && Set)
@@ -1152,7 +1152,10 @@ void CServer::InitDnsbl(int ClientID)
 	}
 
 	IEngine *pEngine = Kernel()->RequestInterface<IEngine>();
-	pEngine->AddJob(m_aClients[ClientID].m_pDnsblLookup = std::make_shared<CHostLookup>(aBuf, NETTYPE_IPV4));
+	m_aClients[ClientID].m_pDnsblLookup = std::make_shared<CHostLookup>(aBuf, NETTYPE_IPV4);
+	// blacklisted clients can play until the lookup is done
+	m_aClients[ClientID].m_pDnsblLookup->SetPriority(IJob::PRIORITY_HIGH);
+	pEngine->AddJob(m_aClients[ClientID].m_pDnsblLookup);
 	m_aClients[ClientID].m_DnsblState = CClient::DNSBL_STATE_PENDING;
 }
 
@@ -1235,16 +1238,41 @@ void CServer::SendCapabilities(int ClientID)
 	SendMsg(&Msg, MSGFLAG_VITAL, ClientID);
 }
 
+void CServer::GetMapDownloadUrl(int MapType, char *pBuf, int BufSize)
+{
+	pBuf[0] = '\0';
+	if(!m_MapHttpServer.IsOpen() || !m_apCurrentMapData[MapType])
+		return;
+
+	// the map details carry an https url, clients drop everything else, so
+	// the url of the tls proxy in front of the map http server is required
+	if(!str_startswith(Config()->m_SvMapHttpUrl, "https://"))
+		return;
+
+	char aBase[256];
+	str_copy(aBase, Config()->m_SvMapHttpUrl);
+	int Length = str_length(aBase);
+	if(Length > 0 && aBase[Length - 1] == '/')
+		aBase[Length - 1] = '\0';
+
+	char aSha256[SHA256_MAXSTRSIZE];
+	sha256_str(m_aCurrentMapSha256[MapType], aSha256, sizeof(aSha256));
+	str_format(pBuf, BufSize, "%s/%s.map", aBase, aSha256);
+}
+
 void CServer::SendMap(int ClientID)
 {
 	int MapType = IsSixup(ClientID) ? MAP_TYPE_SIXUP : MAP_TYPE_SIX;
 	{
+		char aMapUrl[256];
+		GetMapDownloadUrl(MapType, aMapUrl, sizeof(aMapUrl));
+
 		CMsgPacker Msg(NETMSG_MAP_DETAILS, true);
 		Msg.AddString(GetMapName(), 0);
 		Msg.AddRaw(&m_aCurrentMapSha256[MapType].data, sizeof(m_aCurrentMapSha256[MapType].data));
 		Msg.AddInt(m_aCurrentMapCrc[MapType]);
 		Msg.AddInt(m_aCurrentMapSize[MapType]);
-		Msg.AddString("", 0); // HTTPS map download URL
+		Msg.AddString(aMapUrl, 0); // HTTPS map download URL
 		SendMsg(&Msg, MSGFLAG_VITAL, ClientID);
 	}
 	{
@@ -2504,6 +2532,7 @@ void CServer::PumpNetwork(bool PacketWaiting)
 
 	m_ServerBan.Update();
 	m_Econ.Update();
+	m_MapHttpServer.Update();
 }
 
 const char *CServer::GetMapName() const
@@ -2541,15 +2570,8 @@ int CServer::LoadMap(const char *pMapName)
 		if(!m_aDemoRecorder[i].IsRecording())
 			continue;
 
-		m_aDemoRecorder[i].Stop();
-
 		// remove tmp demos
-		if(i < MAX_CLIENTS)
-		{
-			char aPath[256];
-			str_format(aPath, sizeof(aPath), "demos/%s_%d_%d_tmp.demo", m_aCurrentMap, m_NetServer.Address().port, i);
-			Storage()->RemoveFile(aPath, IStorage::TYPE_SAVE);
-		}
+		m_aDemoRecorder[i].Stop(i < MAX_CLIENTS ? CDemoRecorder::STOP_REMOVE_FILE : CDemoRecorder::STOP_KEEP_FILE);
 	}
 
 	// reinit snapshot ids
@@ -2608,6 +2630,10 @@ int CServer::LoadMap(const char *pMapName)
 		m_apCurrentMapData[MAP_TYPE_SIXUP] = 0;
 	}
 
+	// serve the new map data over http
+	for(int i = 0; i < NUM_MAP_TYPES; i++)
+		m_MapHttpServer.SetMap(i, m_aCurrentMapSha256[i], m_apCurrentMapData[i], m_aCurrentMapSize[i]);
+
 	for(int i = 0; i < MAX_CLIENTS; i++)
 		m_aPrevStates[i] = m_aClients[i].m_State;
 
@@ -2643,6 +2669,7 @@ int CServer::Run()
 		return -1;
 	}
 
+	DbPool()->SetNumReadWorkers(Config()->m_SvSqlReadWorkers);
 	if(Config()->m_SvSqliteFile[0] != '\0')
 	{
 		char aFullPath[IO_MAX_PATH_LENGTH];
@@ -2696,12 +2723,33 @@ int CServer::Run()
 
 	m_Econ.Init(Config(), Console(), &m_ServerBan);
 
+	if(Config()->m_SvMapHttpPort)
+	{
+		NETADDR HttpBindAddr = BindAddr;
+		HttpBindAddr.port = Config()->m_SvMapHttpPort;
+		if(m_MapHttpServer.Open(HttpBindAddr, &m_ServerBan, Config()->m_SvMapHttpMaxConnections))
+		{
+			dbg_msg("server", "serving maps over http on port %d", HttpBindAddr.port);
+			if(!str_startswith(Config()->m_SvMapHttpUrl, "https://"))
+				dbg_msg("server", "sv_map_http_url is not an https url, the map download url is not sent to clients");
+		}
+		else
+			dbg_msg("server", "couldn't open map http socket. port %d might already be in use", HttpBindAddr.port);
+	}
+
 	m_Fifo.Init(Console(), Config()->m_SvInputFifo, CFGFLAG_SERVER);
 
 	char aBuf[256];
 	str_format(aBuf, sizeof(aBuf), "server name is '%s'", Config()->m_SvName);
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 
+	if(Config()->m_SvDemoRecordThread)
+	{
+		m_pDemoRecorderThread = std::make_unique<CDemoRecorderThread>(m_SnapshotDelta, Config()->m_SvDemoRecordQueueSize * 1024);
+		for(auto &Recorder : m_aDemoRecorder)
+			Recorder.SetThread(m_pDemoRecorderThread.get());
+	}
+
 	Antibot()->Init();
 	GameServer()->OnInit(nullptr);
 	if(ErrorShutdown())
@@ -2985,12 +3033,24 @@ int CServer::Run()
 	}
 
 	m_Econ.Shutdown();
+	m_MapHttpServer.Close();
 
 	m_Fifo.Shutdown();
 
 	GameServer()->OnShutdown(nullptr);
 	m_pMap->Unload();
 
+	if(m_pDemoRecorderThread)
+	{
+		// finish the demos before the recording thread goes away
+		for(auto &Recorder : m_aDemoRecorder)
+		{
+			Recorder.Stop();
+			Recorder.SetThread(nullptr);
+		}
+		m_pDemoRecorderThread = nullptr;
+	}
+
 	DbPool()->OnShutdown();
 
 #if defined(CONF_UPNP)
@@ -3000,6 +3060,8 @@ int CServer::Run()
 	m_NetServer.Close();
 
 	m_pRegister->OnShutdown();
+	// give the delete requests of the register a moment to finish
+	HttpShutdown(1000);
 
 	return ErrorShutdown();
 }
@@ -3312,20 +3374,16 @@ void CServer::ConNameBan(IConsole::IResult *pResult, void *pUser)
 	int Distance = pResult->NumArguments() > 1 ? pResult->GetInteger(1) : str_length(pName) / 3;
 	int IsSubstring = pResult->NumArguments() > 2 ? pResult->GetInteger(2) : 0;
 
-	for(auto &Ban : pThis->m_vNameBans)
+	CNameBan *pBan = pThis->m_NameBans.Get(pName);
+	if(pBan)
 	{
-		if(str_comp(Ban.m_aName, pName) == 0)
-		{
-			str_format(aBuf, sizeof(aBuf), "changed name='%s' distance=%d old_distance=%d is_substring=%d old_is_substring=%d reason='%s' old_reason='%s'", pName, Distance, Ban.m_Distance, IsSubstring, Ban.m_IsSubstring, pReason, Ban.m_aReason);
-			pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "name_ban", aBuf);
-			Ban.m_Distance = Distance;
-			Ban.m_IsSubstring = IsSubstring;
-			str_copy(Ban.m_aReason, pReason);
-			return;
-		}
+		str_format(aBuf, sizeof(aBuf), "changed name='%s' distance=%d old_distance=%d is_substring=%d old_is_substring=%d reason='%s' old_reason='%s'", pName, Distance, pBan->m_Distance, IsSubstring, pBan->m_IsSubstring, pReason, pBan->m_aReason);
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "name_ban", aBuf);
+		pThis->m_NameBans.Ban(pName, Distance, IsSubstring, pReason);
+		return;
 	}
 
-	pThis->m_vNameBans.emplace_back(pName, Distance, IsSubstring, pReason);
+	pThis->m_NameBans.Ban(pName, Distance, IsSubstring, pReason);
 	str_format(aBuf, sizeof(aBuf), "added name='%s' distance=%d is_substring=%d reason='%s'", pName, Distance, IsSubstring, pReason);
 	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "name_ban", aBuf);
 }
@@ -3335,16 +3393,13 @@ void CServer::ConNameUnban(IConsole::IResult *pResult, void *pUser)
 	CServer *pThis = (CServer *)pUser;
 	const char *pName = pResult->GetString(0);
 
-	for(size_t i = 0; i < pThis->m_vNameBans.size(); i++)
+	CNameBan *pBan = pThis->m_NameBans.Get(pName);
+	if(pBan)
 	{
-		CNameBan *pBan = &pThis->m_vNameBans[i];
-		if(str_comp(pBan->m_aName, pName) == 0)
-		{
-			char aBuf[128];
-			str_format(aBuf, sizeof(aBuf), "removed name='%s' distance=%d is_substring=%d reason='%s'", pBan->m_aName, pBan->m_Distance, pBan->m_IsSubstring, pBan->m_aReason);
-			pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "name_ban", aBuf);
-			pThis->m_vNameBans.erase(pThis->m_vNameBans.begin() + i);
-		}
+		char aBuf[128];
+		str_format(aBuf, sizeof(aBuf), "removed name='%s' distance=%d is_substring=%d reason='%s'", pBan->m_aName, pBan->m_Distance, pBan->m_IsSubstring, pBan->m_aReason);
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "name_ban", aBuf);
+		pThis->m_NameBans.Unban(pName);
 	}
 }
 
@@ -3352,7 +3407,7 @@ void CServer::ConNameBans(IConsole::IResult *pResult, void *pUser)
 {
 	CServer *pThis = (CServer *)pUser;
 
-	for(auto &Ban : pThis->m_vNameBans)
+	for(const CNameBan &Ban : pThis->m_NameBans.Bans())
 	{
 		char aBuf[128];
 		str_format(aBuf, sizeof(aBuf), "name='%s' distance=%d is_substring=%d reason='%s'", Ban.m_aName, Ban.m_Distance, Ban.m_IsSubstring, Ban.m_aReason);
@@ -3394,14 +3449,10 @@ void CServer::SaveDemo(int ClientID, float Time)
 {
 	if(IsRecording(ClientID))
 	{
-		m_aDemoRecorder[ClientID].Stop();
-
 		// rename the demo
-		char aOldFilename[IO_MAX_PATH_LENGTH];
 		char aNewFilename[IO_MAX_PATH_LENGTH];
-		str_format(aOldFilename, sizeof(aOldFilename), "demos/%s_%d_%d_tmp.demo", m_aCurrentMap, m_NetServer.Address().port, ClientID);
 		str_format(aNewFilename, sizeof(aNewFilename), "demos/%s_%s_%05.2f.demo", m_aCurrentMap, m_aClients[ClientID].m_aName, Time);
-		Storage()->RenameFile(aOldFilename, aNewFilename, IStorage::TYPE_SAVE);
+		m_aDemoRecorder[ClientID].Stop(CDemoRecorder::STOP_KEEP_FILE, aNewFilename);
 	}
 }
 
@@ -3410,7 +3461,7 @@ void CServer::StartRecord(int ClientID)
 	if(Config()->m_SvPlayerDemoRecord)
 	{
 		char aFilename[IO_MAX_PATH_LENGTH];
-		str_format(aFilename, sizeof(aFilename), "demos/%s_%d_%d_tmp.demo", m_aCurrentMap, m_NetServer.Address().port, ClientID);
+		str_format(aFilename, sizeof(aFilename), "demos/%s_%d_%d_%d_tmp.demo", m_aCurrentMap, m_NetServer.Address().port, ClientID, m_NumPlayerDemos++);
 		m_aDemoRecorder[ClientID].Start(Storage(), Console(), aFilename, GameServer()->NetVersion(), m_aCurrentMap, &m_aCurrentMapSha256[MAP_TYPE_SIX], m_aCurrentMapCrc[MAP_TYPE_SIX], "server", m_aCurrentMapSize[MAP_TYPE_SIX], m_apCurrentMapData[MAP_TYPE_SIX]);
 	}
 }
@@ -3419,11 +3470,7 @@ void CServer::StopRecord(int ClientID)
 {
 	if(IsRecording(ClientID))
 	{
-		m_aDemoRecorder[ClientID].Stop();
-
-		char aFilename[IO_MAX_PATH_LENGTH];
-		str_format(aFilename, sizeof(aFilename), "demos/%s_%d_%d_tmp.demo", m_aCurrentMap, m_NetServer.Address().port, ClientID);
-		Storage()->RemoveFile(aFilename, IStorage::TYPE_SAVE);
+		m_aDemoRecorder[ClientID].Stop(CDemoRecorder::STOP_REMOVE_FILE);
 	}
 }
 
@@ -3853,6 +3900,8 @@ void *CServer::SnapNewItem(int Type, int ID, int Size)
 void CServer::SnapSetStaticsize(int ItemType, int Size)
 {
 	m_SnapshotDelta.SetStaticsize(ItemType, Size);
+	if(m_pDemoRecorderThread)
+		m_pDemoRecorderThread->SetStaticsize(ItemType, Size);
 }
 
 CServer *CreateServer() { return new CServer(); }
@@ -24,6 +24,7 @@
 
 #include "antibot.h"
 #include "authmanager.h"
+#include "map_http_server.h"
 #include "name_ban.h"
 
 #if defined(CONF_UPNP)
@@ -225,6 +226,7 @@ public:
 	CSnapIDPool m_IDPool;
 	CNetServer m_NetServer;
 	CEcon m_Econ;
+	CMapHttpServer m_MapHttpServer;
 	CFifo m_Fifo;
 	CServerBan m_ServerBan;
 
@@ -264,6 +266,10 @@ public:
 	unsigned int m_aCurrentMapSize[NUM_MAP_TYPES];
 
 	CDemoRecorder m_aDemoRecorder[MAX_CLIENTS + 1];
+	std::unique_ptr<CDemoRecorderThread> m_pDemoRecorderThread;
+	// makes the names of player demos unique, a stopped demo may still be
+	// written by the recording thread while the player records the next one
+	int m_NumPlayerDemos;
 	CAuthManager m_AuthManager;
 
 	int64_t m_ServerInfoFirstRequest;
@@ -271,7 +277,7 @@ public:
 
 	char m_aErrorShutdownReason[128];
 
-	std::vector<CNameBan> m_vNameBans;
+	CNameBans m_NameBans;
 
 	size_t m_AnnouncementLastLine;
 	std::vector<std::string> m_vAnnouncements;
@@ -336,6 +342,7 @@ public:
 
 	void SendRconType(int ClientID, bool UsernameReq);
 	void SendCapabilities(int ClientID);
+	void GetMapDownloadUrl(int MapType, char *pBuf, int BufSize);
 	void SendMap(int ClientID);
 	void SendMapData(int ClientID, int Chunk);
 	void SendConnectionReady(int ClientID);
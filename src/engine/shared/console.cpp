@@ -14,6 +14,7 @@
 #include "console.h"
 #include "linereader.h"
 
+#include <algorithm>
 #include <iterator> // std::size
 #include <new>
 
@@ -441,17 +442,22 @@ void CConsole::ExecuteLineStroked(int Stroke, const char *pStr, int ClientID, bo
 			pEnd++;
 		}
 
-		if(ParseStart(&Result, pStr, (pEnd - pStr) + 1) != 0)
-			return;
-
-		if(!*Result.m_pCommand)
-			return;
+		// the part of the line `ParseStart` copies
+		const int Length = minimum((int)(pEnd - pStr), (int)sizeof(Result.m_aStringStorage) - 1);
+		const int FlagMask = ClientID == IConsole::CLIENT_ID_GAME ? m_FlagMask | CFGFLAG_GAME : m_FlagMask;
 
 		CCommand *pCommand;
-		if(ClientID == IConsole::CLIENT_ID_GAME)
-			pCommand = FindCommand(Result.m_pCommand, m_FlagMask | CFGFLAG_GAME);
-		else
-			pCommand = FindCommand(Result.m_pCommand, m_FlagMask);
+		const bool Parsed = FindParsedLine(pStr, Length, FlagMask, &Result, &pCommand);
+		if(!Parsed)
+		{
+			if(ParseStart(&Result, pStr, Length + 1) != 0)
+				return;
+
+			if(!*Result.m_pCommand)
+				return;
+
+			pCommand = FindCommand(Result.m_pCommand, FlagMask);
+		}
 
 		if(pCommand)
 		{
@@ -487,7 +493,16 @@ void CConsole::ExecuteLineStroked(int Stroke, const char *pStr, int ClientID, bo
 
 				if(Stroke || IsStrokeCommand)
 				{
-					if(ParseArgs(&Result, pCommand->m_pParams))
+					bool Error = false;
+					if(!Parsed)
+					{
+						Error = ParseArgs(&Result, pCommand->m_pParams);
+						// stroke commands have an argument outside of the parsed string
+						if(!Error && !IsStrokeCommand)
+							AddParsedLine(pStr, Length, FlagMask, pCommand, &Result);
+					}
+
+					if(Error)
 					{
 						char aBuf[256];
 						str_format(aBuf, sizeof(aBuf), "Invalid arguments... Usage: %s %s", pCommand->m_pName, pCommand->m_pParams);
@@ -572,7 +587,11 @@ int CConsole::PossibleCommands(const char *pStr, int FlagMask, bool Temp, FPossi
 
 CConsole::CCommand *CConsole::FindCommand(const char *pName, int FlagMask)
 {
-	for(CCommand *pCommand = m_pFirstCommand; pCommand; pCommand = pCommand->m_pNext)
+	auto Bucket = m_CommandIndex.find(CommandHash(pName));
+	if(Bucket == m_CommandIndex.end())
+		return 0x0;
+
+	for(CCommand *pCommand : Bucket->second)
 	{
 		if(pCommand->m_Flags & FlagMask)
 		{
@@ -584,6 +603,97 @@ CConsole::CCommand *CConsole::FindCommand(const char *pName, int FlagMask)
 	return 0x0;
 }
 
+unsigned CConsole::CommandHash(const char *pName)
+{
+	// FNV-1a of the lowercase name, matching `str_comp_nocase`
+	unsigned Hash = 2166136261u;
+	for(; *pName; pName++)
+	{
+		unsigned char c = *pName;
+		if(c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		Hash = (Hash ^ c) * 16777619u;
+	}
+	return Hash;
+}
+
+void CConsole::AddToIndex(CCommand *pCommand)
+{
+	// insert in front of the first command with the same name that follows
+	// it in the sorted command list, like `AddCommandSorted` does
+	std::vector<CCommand *> &vpBucket = m_CommandIndex[CommandHash(pCommand->m_pName)];
+	auto Pos = vpBucket.begin();
+	for(; Pos != vpBucket.end(); ++Pos)
+	{
+		if(str_comp_nocase(pCommand->m_pName, (*Pos)->m_pName) == 0 && str_comp(pCommand->m_pName, (*Pos)->m_pName) <= 0)
+			break;
+	}
+	vpBucket.insert(Pos, pCommand);
+}
+
+void CConsole::RemoveFromIndex(CCommand *pCommand)
+{
+	auto Bucket = m_CommandIndex.find(CommandHash(pCommand->m_pName));
+	if(Bucket == m_CommandIndex.end())
+		return;
+	std::vector<CCommand *> &vpBucket = Bucket->second;
+	vpBucket.erase(std::remove(vpBucket.begin(), vpBucket.end(), pCommand), vpBucket.end());
+	if(vpBucket.empty())
+		m_CommandIndex.erase(Bucket);
+}
+
+bool CConsole::FindParsedLine(const char *pLine, int Length, int FlagMask, CResult *pResult, CCommand **ppCommand)
+{
+	for(int i = 0; i < m_NumParsedLines; i++)
+	{
+		CParsedLine &Parsed = m_aParsedLines[i];
+		if(Parsed.m_FlagMask != FlagMask || (int)Parsed.m_Line.size() != Length || mem_comp(Parsed.m_Line.data(), pLine, Length) != 0)
+			continue;
+
+		Parsed.m_LastUse = ++m_ParsedLineUse;
+		mem_copy(pResult->m_aStringStorage, Parsed.m_Storage.data(), Parsed.m_Storage.size());
+		pResult->m_pCommand = pResult->m_aStringStorage + Parsed.m_CommandOffset;
+		pResult->m_pArgsStart = pResult->m_aStringStorage + Parsed.m_ArgsStartOffset;
+		for(int Offset : Parsed.m_vArgOffsets)
+			pResult->AddArgument(pResult->m_aStringStorage + Offset);
+		pResult->m_Victim = Parsed.m_Victim;
+		*ppCommand = Parsed.m_pCommand;
+		return true;
+	}
+	return false;
+}
+
+void CConsole::AddParsedLine(const char *pLine, int Length, int FlagMask, CCommand *pCommand, const CResult *pResult)
+{
+	// replace the least recently used line once the cache is full
+	int Index = m_NumParsedLines;
+	if(m_NumParsedLines < PARSED_LINE_CACHE_SIZE)
+		m_NumParsedLines++;
+	else
+	{
+		Index = 0;
+		for(int i = 1; i < m_NumParsedLines; i++)
+		{
+			if(m_aParsedLines[i].m_LastUse < m_aParsedLines[Index].m_LastUse)
+				Index = i;
+		}
+	}
+
+	CParsedLine &Parsed = m_aParsedLines[Index];
+	Parsed.m_Line.assign(pLine, Length);
+	Parsed.m_FlagMask = FlagMask;
+	Parsed.m_pCommand = pCommand;
+	// the parsed string has the same length as the line, plus the terminator
+	Parsed.m_Storage.assign(pResult->m_aStringStorage, Length + 1);
+	Parsed.m_CommandOffset = pResult->m_pCommand - pResult->m_aStringStorage;
+	Parsed.m_ArgsStartOffset = pResult->m_pArgsStart - pResult->m_aStringStorage;
+	Parsed.m_vArgOffsets.clear();
+	for(int i = 0; i < pResult->NumArguments(); i++)
+		Parsed.m_vArgOffsets.push_back(pResult->m_apArgs[i] - pResult->m_aStringStorage);
+	Parsed.m_Victim = pResult->m_Victim;
+	Parsed.m_LastUse = ++m_ParsedLineUse;
+}
+
 void CConsole::ExecuteLine(const char *pStr, int ClientID, bool InterpretSemicolons)
 {
 	CConsole::ExecuteLineStroked(1, pStr, ClientID, InterpretSemicolons); // press it
@@ -968,6 +1078,8 @@ CConsole::CConsole(int FlagMask)
 	m_apStrokeStr[1] = "1";
 	m_ExecutionQueue.Reset();
 	m_pFirstCommand = 0;
+	m_NumParsedLines = 0;
+	m_ParsedLineUse = 0;
 	m_pFirstExec = 0;
 	m_pfnTeeHistorianCommandCallback = 0;
 	m_pTeeHistorianCommandUserdata = 0;
@@ -1079,12 +1191,12 @@ void CConsole::ParseArguments(int NumArgs, const char **ppArguments)
 
 void CConsole::AddCommandSorted(CCommand *pCommand)
 {
+	AddToIndex(pCommand);
+	ClearParsedLines();
+
 	if(!m_pFirstCommand || str_comp(pCommand->m_pName, m_pFirstCommand->m_pName) <= 0)
 	{
-		if(m_pFirstCommand && m_pFirstCommand->m_pNext)
-			pCommand->m_pNext = m_pFirstCommand;
-		else
-			pCommand->m_pNext = 0;
+		pCommand->m_pNext = m_pFirstCommand;
 		m_pFirstCommand = pCommand;
 	}
 	else
@@ -1123,6 +1235,8 @@ void CConsole::Register(const char *pName, const char *pParams,
 
 	if(DoAdd)
 		AddCommandSorted(pCommand);
+	else
+		ClearParsedLines();
 
 	if(pCommand->m_Flags & CFGFLAG_CHAT)
 		pCommand->SetAccessLevel(ACCESS_LEVEL_USER);
@@ -1189,6 +1303,8 @@ void CConsole::DeregisterTemp(const char *pName)
 	// add to recycle list
 	if(pRemoved)
 	{
+		RemoveFromIndex(pRemoved);
+		ClearParsedLines();
 		pRemoved->m_pNext = m_pRecycleList;
 		m_pRecycleList = pRemoved;
 	}
@@ -1196,6 +1312,13 @@ void CConsole::DeregisterTemp(const char *pName)
 
 void CConsole::DeregisterTempAll()
 {
+	for(CCommand *pCommand = m_pFirstCommand; pCommand; pCommand = pCommand->m_pNext)
+	{
+		if(pCommand->m_Temp)
+			RemoveFromIndex(pCommand);
+	}
+	ClearParsedLines();
+
 	// set non temp as first one
 	for(; m_pFirstCommand && m_pFirstCommand->m_Temp; m_pFirstCommand = m_pFirstCommand->m_pNext)
 		;
@@ -1260,7 +1383,11 @@ void CConsole::StoreCommands(bool Store)
 
 const IConsole::CCommandInfo *CConsole::GetCommandInfo(const char *pName, int FlagMask, bool Temp)
 {
-	for(CCommand *pCommand = m_pFirstCommand; pCommand; pCommand = pCommand->m_pNext)
+	auto Bucket = m_CommandIndex.find(CommandHash(pName));
+	if(Bucket == m_CommandIndex.end())
+		return 0;
+
+	for(CCommand *pCommand : Bucket->second)
 	{
 		if(pCommand->m_Flags & FlagMask && pCommand->m_Temp == Temp)
 		{
@@ -8,6 +8,10 @@
 #include <engine/console.h>
 #include <engine/storage.h>
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 class CConsole : public IConsole
 {
 	class CCommand : public CCommandInfo
@@ -89,12 +93,12 @@ class CConsole : public IConsole
 		const char *m_apArgs[MAX_PARTS];
 
 		CResult()
-
 		{
-			mem_zero(m_aStringStorage, sizeof(m_aStringStorage));
+			// arguments beyond `m_NumArgs` are never read, so only the
+			// string needs to be terminated
+			m_aStringStorage[0] = '\0';
 			m_pArgsStart = 0;
 			m_pCommand = 0;
-			mem_zero(m_apArgs, sizeof(m_apArgs));
 		}
 
 		CResult &operator=(const CResult &Other)
@@ -188,6 +192,44 @@ class CConsole : public IConsole
 		}
 	} m_ExecutionQueue;
 
+	// commands by the case-insensitive hash of their name, each bucket in
+	// the order of the command list
+	std::unordered_map<unsigned, std::vector<CCommand *>> m_CommandIndex;
+
+	static unsigned CommandHash(const char *pName);
+	void AddToIndex(CCommand *pCommand);
+	void RemoveFromIndex(CCommand *pCommand);
+
+	// Recently executed command lines after `ParseArgs`, so repeated lines
+	// like binds, votes or per-tick commands skip parsing and lookup. The
+	// arguments are stored as offsets into the parsed string.
+	class CParsedLine
+	{
+	public:
+		std::string m_Line;
+		int m_FlagMask;
+		CCommand *m_pCommand;
+		std::string m_Storage;
+		int m_CommandOffset;
+		int m_ArgsStartOffset;
+		std::vector<int> m_vArgOffsets;
+		int m_Victim;
+		int64_t m_LastUse;
+	};
+
+	enum
+	{
+		PARSED_LINE_CACHE_SIZE = 16,
+	};
+
+	CParsedLine m_aParsedLines[PARSED_LINE_CACHE_SIZE];
+	int m_NumParsedLines;
+	int64_t m_ParsedLineUse;
+
+	bool FindParsedLine(const char *pLine, int Length, int FlagMask, CResult *pResult, CCommand **ppCommand);
+	void AddParsedLine(const char *pLine, int Length, int FlagMask, CCommand *pCommand, const CResult *pResult);
+	void ClearParsedLines() { m_NumParsedLines = 0; }
+
 	void AddCommandSorted(CCommand *pCommand);
 	CCommand *FindCommand(const char *pName, int FlagMask);
 
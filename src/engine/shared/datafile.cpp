@@ -311,6 +311,8 @@ void *CDataFileReader::GetDataImpl(int Index, bool Swap)
 	if(Index < 0 || Index >= m_pDataFile->m_Header.m_NumRawData)
 		return nullptr;
 
+	std::unique_lock<std::mutex> Lock(m_DataLock);
+
 	// load it if needed
 	if(!m_pDataFile->m_ppDataPtrs[Index])
 	{
@@ -346,19 +348,29 @@ void *CDataFileReader::GetDataImpl(int Index, bool Swap)
 				return nullptr;
 			}
 
-			// decompress the data
-			m_pDataFile->m_ppDataPtrs[Index] = (char *)malloc(UncompressedSize);
-			m_pDataFile->m_pDataSizes[Index] = UncompressedSize;
-			const int Result = uncompress((Bytef *)m_pDataFile->m_ppDataPtrs[Index], &UncompressedSize, (Bytef *)pCompressedData, DataSize);
+			// decompress the data, other data can be loaded meanwhile
+			Lock.unlock();
+			char *pData = (char *)malloc(UncompressedSize);
+			const int Result = uncompress((Bytef *)pData, &UncompressedSize, (Bytef *)pCompressedData, DataSize);
 			free(pCompressedData);
+			Lock.lock();
+
+			if(m_pDataFile->m_ppDataPtrs[Index])
+			{
+				// loaded by another thread in the meantime
+				free(pData);
+				return m_pDataFile->m_ppDataPtrs[Index];
+			}
 			if(Result != Z_OK || UncompressedSize != OriginalUncompressedSize)
 			{
 				log_error("datafile", "uncompress error. result=%d wanted=%u got=%lu", Result, OriginalUncompressedSize, UncompressedSize);
-				free(m_pDataFile->m_ppDataPtrs[Index]);
+				free(pData);
 				m_pDataFile->m_ppDataPtrs[Index] = nullptr;
 				m_pDataFile->m_pDataSizes[Index] = -1;
 				return nullptr;
 			}
+			m_pDataFile->m_ppDataPtrs[Index] = pData;
+			m_pDataFile->m_pDataSizes[Index] = UncompressedSize;
 
 #if defined(CONF_ARCH_ENDIAN_BIG)
 			SwapSize = UncompressedSize;
@@ -419,6 +431,8 @@ void CDataFileReader::ReplaceData(int Index, char *pData, size_t Size)
 {
 	dbg_assert(Index >= 0 && Index < m_pDataFile->m_Header.m_NumRawData, "Index invalid");
 
+	const std::unique_lock<std::mutex> Lock(m_DataLock);
+
 	free(m_pDataFile->m_ppDataPtrs[Index]);
 	m_pDataFile->m_ppDataPtrs[Index] = pData;
 	m_pDataFile->m_pDataSizes[Index] = Size;
@@ -429,6 +443,7 @@ void CDataFileReader::UnloadData(int Index)
 	if(Index < 0 || Index >= m_pDataFile->m_Header.m_NumRawData)
 		return;
 
+	const std::unique_lock<std::mutex> Lock(m_DataLock);
 	free(m_pDataFile->m_ppDataPtrs[Index]);
 	m_pDataFile->m_ppDataPtrs[Index] = nullptr;
 	m_pDataFile->m_pDataSizes[Index] = 0;
@@ -10,6 +10,8 @@
 
 #include <zlib.h>
 
+#include <mutex>
+
 enum
 {
 	ITEMTYPE_EX = 0xffff,
@@ -19,6 +21,9 @@ enum
 class CDataFileReader
 {
 	struct CDatafile *m_pDataFile;
+	// guards the loaded data and the file position, data is decompressed
+	// without holding it
+	std::mutex m_DataLock;
 	void *GetDataImpl(int Index, bool Swap);
 	int GetFileDataSize(int Index) const;
 
@@ -43,6 +48,8 @@ public:
 	IOHANDLE File() const;
 
 	int GetDataSize(int Index) const;
+	// `GetData`, `GetDataSwapped`, `ReplaceData` and `UnloadData` can be
+	// called from multiple threads
 	void *GetData(int Index);
 	void *GetDataSwapped(int Index); // makes sure that the data is 32bit LE ints when saved
 	const char *GetDataString(int Index);
@@ -1,5 +1,6 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/lock_scope.h>
 #include <base/math.h>
 #include <base/system.h>
 
@@ -18,6 +19,8 @@
 #include "network.h"
 #include "snapshot.h"
 
+#include <limits>
+
 const double g_aSpeeds[g_DemoSpeeds] = {0.1, 0.25, 0.5, 0.75, 1.0, 1.25, 1.5, 2.0, 3.0, 4.0, 6.0, 8.0, 12.0, 16.0, 20.0, 24.0, 28.0, 32.0, 40.0, 48.0, 56.0, 64.0};
 const CUuid SHA256_EXTENSION =
 	{{0x6b, 0xe6, 0xda, 0x4a, 0xce, 0xbd, 0x38, 0x0c,
@@ -30,28 +33,36 @@ static const unsigned char gs_VersionTickCompression = 5; // demo files with thi
 static const int gs_LengthOffset = 152;
 static const int gs_NumMarkersOffset = 176;
 
+// The keyframe index is appended as the last chunk of a demo, followed by a
+// trailer that points back to the start of that chunk.
+static const unsigned char gs_aKeyFrameIndexMarker[8] = {'T', 'W', 'D', 'E', 'M', 'I', 'D', 'X'};
+static const int gs_KeyFrameIndexVersion = 1;
+static const int gs_KeyFrameIndexTrailerSize = sizeof(int32_t) + sizeof(gs_aKeyFrameIndexMarker);
+
 static const ColorRGBA gs_DemoPrintColor{0.75f, 0.7f, 0.7f, 1.0f};
 
 CDemoRecorder::CDemoRecorder(class CSnapshotDelta *pSnapshotDelta, bool NoMapData)
 {
-	m_File = 0;
 	m_aCurrentFilename[0] = '\0';
 	m_pfnFilter = 0;
 	m_pUser = 0;
-	m_LastTickMarker = -1;
+	m_LastTick = -1;
+	m_FirstTick = -1;
 	m_pSnapshotDelta = pSnapshotDelta;
 	m_NoMapData = NoMapData;
+	m_pThread = nullptr;
+	m_NumDropped = 0;
 }
 
 CDemoRecorder::~CDemoRecorder()
 {
-	dbg_assert(m_File == 0, "Demo recorder was not stopped");
+	dbg_assert(m_pWriter == nullptr, "Demo recorder was not stopped");
 }
 
 // Record
 int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetVersion, const char *pMap, SHA256_DIGEST *pSha256, unsigned Crc, const char *pType, unsigned MapSize, unsigned char *pMapData, IOHANDLE MapFile, DEMOFUNC_FILTER pfnFilter, void *pUser)
 {
-	dbg_assert(m_File == 0, "Demo recorder already recording");
+	dbg_assert(m_pWriter == nullptr, "Demo recorder already recording");
 
 	m_pfnFilter = pfnFilter;
 	m_pUser = pUser;
@@ -174,10 +185,10 @@ int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, con
 			io_seek(MapFile, 0, IOSEEK_START);
 	}
 
-	m_LastKeyFrame = -1;
-	m_LastTickMarker = -1;
+	m_LastTick = -1;
 	m_FirstTick = -1;
 	m_NumTimelineMarkers = 0;
+	m_NumDropped = 0;
 
 	if(m_pConsole)
 	{
@@ -185,7 +196,10 @@ int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, con
 		str_format(aBuf, sizeof(aBuf), "Recording to '%s'", pFilename);
 		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", aBuf, gs_DemoPrintColor);
 	}
-	m_File = DemoFile;
+	m_pWriter = std::make_shared<CWriter>();
+	m_pWriter->m_File = DemoFile;
+	m_pWriter->m_pStorage = pStorage;
+	str_copy(m_pWriter->m_aFilename, pFilename);
 	str_copy(m_aCurrentFilename, pFilename);
 
 	return 0;
@@ -201,6 +215,15 @@ int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, con
 		7 = Not set
 		5-6	= Type
 		0-4	= Size
+
+	Keyframe index (type 0, always the last chunk)
+		Compressed like a normal chunk, the packed ints are:
+		version, first tick, last tick, number of keyframes and then
+		the file position and tick of each keyframe, delta encoded.
+		After the end of the huffman data follows a raw trailer:
+		file position of this chunk (4 bytes) and `gs_aKeyFrameIndexMarker`.
+		Older demo players ignore chunks of type 0 and the huffman
+		decoder stops before reaching the trailer.
 */
 
 enum
@@ -214,12 +237,13 @@ enum
 	CHUNKMASK_TYPE = 0x60,
 	CHUNKMASK_SIZE = 0x1f,
 
+	CHUNKTYPE_KEYFRAME_INDEX = 0,
 	CHUNKTYPE_SNAPSHOT = 1,
 	CHUNKTYPE_MESSAGE = 2,
 	CHUNKTYPE_DELTA = 3,
 };
 
-void CDemoRecorder::WriteTickMarker(int Tick, int Keyframe)
+void CDemoRecorder::CWriter::WriteTickMarker(int Tick, int Keyframe)
 {
 	if(m_LastTickMarker == -1 || Tick - m_LastTickMarker > CHUNKMASK_TICK || Keyframe)
 	{
@@ -228,8 +252,16 @@ void CDemoRecorder::WriteTickMarker(int Tick, int Keyframe)
 		uint_to_bytes_be(aChunk + 1, Tick);
 
 		if(Keyframe)
+		{
 			aChunk[0] |= CHUNKTICKFLAG_KEYFRAME;
 
+			const long Filepos = io_tell(m_File);
+			if(Filepos < 0 || Filepos > std::numeric_limits<int>::max())
+				m_KeyFrameIndexValid = false;
+			else
+				m_vKeyFrames.push_back({(int)Filepos, Tick});
+		}
+
 		io_write(m_File, aChunk, sizeof(aChunk));
 	}
 	else
@@ -244,7 +276,7 @@ void CDemoRecorder::WriteTickMarker(int Tick, int Keyframe)
 		m_FirstTick = Tick;
 }
 
-void CDemoRecorder::Write(int Type, const void *pData, int Size)
+void CDemoRecorder::CWriter::Write(int Type, const void *pData, int Size)
 {
 	if(!m_File)
 		return;
@@ -267,6 +299,12 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 	if(Size < 0)
 		return;
 
+	WriteChunkHeader(Type, Size);
+	io_write(m_File, aBuffer2, Size);
+}
+
+void CDemoRecorder::CWriter::WriteChunkHeader(int Type, int Size)
+{
 	unsigned char aChunk[3];
 	aChunk[0] = ((Type & 0x3) << 5);
 	if(Size < 30)
@@ -290,11 +328,79 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 			io_write(m_File, aChunk, 3);
 		}
 	}
+}
+
+void CDemoRecorder::CWriter::WriteKeyFrameIndex()
+{
+	const int NumKeyFrames = m_vKeyFrames.size();
+	const int NumInts = 4 + 2 * NumKeyFrames;
+	if(!m_KeyFrameIndexValid || m_FirstTick < 0 || NumInts * (int)sizeof(int) > CSnapshot::MAX_SIZE)
+		return;
+
+	const long IndexPos = io_tell(m_File);
+	if(IndexPos < 0 || IndexPos > std::numeric_limits<int>::max())
+		return;
+
+	std::vector<int> vIndex;
+	vIndex.reserve(NumInts);
+	vIndex.push_back(gs_KeyFrameIndexVersion);
+	vIndex.push_back(m_FirstTick);
+	vIndex.push_back(m_LastTickMarker);
+	vIndex.push_back(NumKeyFrames);
+	int PrevFilepos = 0;
+	int PrevTick = 0;
+	for(const CKeyFrame &KeyFrame : m_vKeyFrames)
+	{
+		vIndex.push_back(KeyFrame.m_Filepos - PrevFilepos);
+		vIndex.push_back(KeyFrame.m_Tick - PrevTick);
+		PrevFilepos = KeyFrame.m_Filepos;
+		PrevTick = KeyFrame.m_Tick;
+	}
+
+	char aBuffer[64 * 1024];
+	char aBuffer2[64 * 1024];
+	int Size = CVariableInt::Compress(vIndex.data(), NumInts * sizeof(int), aBuffer, sizeof(aBuffer)); // index -> buffer
+	if(Size < 0)
+		return;
+
+	Size = CNetBase::Compress(aBuffer, Size, aBuffer2, sizeof(aBuffer2) - gs_KeyFrameIndexTrailerSize); // buffer -> buffer2
+	if(Size < 0 || Size + gs_KeyFrameIndexTrailerSize > 0xffff)
+		return;
 
+	uint_to_bytes_be((unsigned char *)aBuffer2 + Size, IndexPos);
+	mem_copy(aBuffer2 + Size + sizeof(int32_t), gs_aKeyFrameIndexMarker, sizeof(gs_aKeyFrameIndexMarker));
+	Size += gs_KeyFrameIndexTrailerSize;
+
+	WriteChunkHeader(CHUNKTYPE_KEYFRAME_INDEX, Size);
 	io_write(m_File, aBuffer2, Size);
 }
 
+void CDemoRecorder::SetThread(CDemoRecorderThread *pThread)
+{
+	dbg_assert(m_pWriter == nullptr, "Demo recorder thread changed while recording");
+	m_pThread = pThread;
+}
+
 void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
+{
+	if(!m_pWriter)
+		return;
+
+	// the writer's ticks belong to the recording thread
+	m_LastTick = Tick;
+	if(m_FirstTick < 0)
+		m_FirstTick = Tick;
+
+	if(m_pThread)
+	{
+		if(!m_pThread->Enqueue(CDemoRecorderThread::QUEUED_SNAPSHOT, m_pWriter, Tick, pData, Size))
+			m_NumDropped++;
+		return;
+	}
+	m_pWriter->RecordSnapshot(Tick, pData, Size, m_pSnapshotDelta);
+}
+
+void CDemoRecorder::CWriter::RecordSnapshot(int Tick, const void *pData, int Size, CSnapshotDelta *pSnapshotDelta)
 {
 	if(m_LastKeyFrame == -1 || (Tick - m_LastKeyFrame) > SERVER_TICK_SPEED * 5)
 	{
@@ -316,7 +422,7 @@ void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
 		// write tickmarker
 		WriteTickMarker(Tick, 0);
 
-		DeltaSize = m_pSnapshotDelta->CreateDelta((CSnapshot *)m_aLastSnapshotData, (CSnapshot *)pData, &aDeltaData);
+		DeltaSize = pSnapshotDelta->CreateDelta((CSnapshot *)m_aLastSnapshotData, (CSnapshot *)pData, &aDeltaData);
 		if(DeltaSize)
 		{
 			// record delta
@@ -328,6 +434,9 @@ void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
 
 void CDemoRecorder::RecordMessage(const void *pData, int Size)
 {
+	if(!m_pWriter)
+		return;
+
 	if(m_pfnFilter)
 	{
 		if(m_pfnFilter(pData, Size, m_pUser))
@@ -335,45 +444,89 @@ void CDemoRecorder::RecordMessage(const void *pData, int Size)
 			return;
 		}
 	}
+	if(m_pThread)
+	{
+		if(!m_pThread->Enqueue(CDemoRecorderThread::QUEUED_MESSAGE, m_pWriter, -1, pData, Size))
+			m_NumDropped++;
+		return;
+	}
+	m_pWriter->RecordMessage(pData, Size);
+}
+
+void CDemoRecorder::CWriter::RecordMessage(const void *pData, int Size)
+{
 	Write(CHUNKTYPE_MESSAGE, pData, Size);
 }
 
-int CDemoRecorder::Stop()
+void CDemoRecorder::CWriter::Finish()
 {
-	if(!m_File)
-		return -1;
+	// append the keyframe index, so players don't have to scan the file
+	WriteKeyFrameIndex();
 
 	// add the demo length to the header
 	io_seek(m_File, gs_LengthOffset, IOSEEK_START);
 	unsigned char aLength[sizeof(int32_t)];
-	uint_to_bytes_be(aLength, Length());
+	uint_to_bytes_be(aLength, (m_LastTickMarker - m_FirstTick) / SERVER_TICK_SPEED);
 	io_write(m_File, aLength, sizeof(aLength));
 
 	// add the timeline markers to the header
 	io_seek(m_File, gs_NumMarkersOffset, IOSEEK_START);
 	unsigned char aNumMarkers[sizeof(int32_t)];
-	uint_to_bytes_be(aNumMarkers, m_NumTimelineMarkers);
+	uint_to_bytes_be(aNumMarkers, m_vTimelineMarkers.size());
 	io_write(m_File, aNumMarkers, sizeof(aNumMarkers));
-	for(int i = 0; i < m_NumTimelineMarkers; i++)
+	for(int Marker : m_vTimelineMarkers)
 	{
 		unsigned char aMarker[sizeof(int32_t)];
-		uint_to_bytes_be(aMarker, m_aTimelineMarkers[i]);
+		uint_to_bytes_be(aMarker, Marker);
 		io_write(m_File, aMarker, sizeof(aMarker));
 	}
 
 	io_close(m_File);
 	m_File = 0;
+
+	if(m_StopMode == STOP_REMOVE_FILE)
+		m_pStorage->RemoveFile(m_aFilename, IStorage::TYPE_SAVE);
+	else if(m_aTargetFilename[0])
+		m_pStorage->RenameFile(m_aFilename, m_aTargetFilename, IStorage::TYPE_SAVE);
+}
+
+int CDemoRecorder::Stop(EStopMode Mode, const char *pTargetFilename)
+{
+	if(!m_pWriter)
+		return -1;
+
+	m_pWriter->m_vTimelineMarkers.assign(m_aTimelineMarkers, m_aTimelineMarkers + m_NumTimelineMarkers);
+	m_pWriter->m_StopMode = Mode;
+	if(pTargetFilename)
+		str_copy(m_pWriter->m_aTargetFilename, pTargetFilename);
+
+	// the recording thread finishes the file after the chunks queued
+	// before, so stopping doesn't wait for the whole queue
+	if(m_pThread)
+		m_pThread->Finish(std::move(m_pWriter));
+	else
+		m_pWriter->Finish();
+	m_pWriter = nullptr;
+
 	if(m_pConsole)
+	{
+		if(m_NumDropped)
+		{
+			char aBuf[128];
+			str_format(aBuf, sizeof(aBuf), "Dropped %d chunks because the recording thread fell behind", m_NumDropped);
+			m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", aBuf, gs_DemoPrintColor);
+		}
 		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", "Stopped recording", gs_DemoPrintColor);
+	}
 
 	return 0;
 }
 
 void CDemoRecorder::AddDemoMarker()
 {
-	if(m_LastTickMarker < 0)
+	if(m_LastTick < 0)
 		return;
-	AddDemoMarker(m_LastTickMarker);
+	AddDemoMarker(m_LastTick);
 }
 
 void CDemoRecorder::AddDemoMarker(int Tick)
@@ -396,6 +549,117 @@ void CDemoRecorder::AddDemoMarker(int Tick)
 		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", "Added timeline marker", gs_DemoPrintColor);
 }
 
+CDemoRecorderThread::CDemoRecorderThread(const CSnapshotDelta &SnapshotDelta, int MaxQueuedSize) :
+	m_SnapshotDelta(SnapshotDelta)
+{
+	m_Lock = lock_create();
+	sphore_init(&m_Semaphore);
+	m_Shutdown = false;
+	m_QueuedSize = 0;
+	m_MaxQueuedSize = MaxQueuedSize;
+	m_pThread = thread_init(ThreadFunc, this, "demo recorder");
+}
+
+CDemoRecorderThread::~CDemoRecorderThread()
+{
+	{
+		CLockScope ls(m_Lock);
+		m_Shutdown = true;
+	}
+	sphore_signal(&m_Semaphore);
+	thread_wait(m_pThread);
+	lock_destroy(m_Lock);
+	sphore_destroy(&m_Semaphore);
+}
+
+bool CDemoRecorderThread::Enqueue(int Type, const std::shared_ptr<CDemoRecorder::CWriter> &pWriter, int Tick, const void *pData, int Size)
+{
+	{
+		CLockScope ls(m_Lock);
+		if(m_QueuedSize + Size > m_MaxQueuedSize)
+			return false;
+		m_QueuedSize += Size;
+	}
+
+	// copy the data outside of the lock, the recording thread only
+	// sees the chunk once it is in the queue
+	auto pChunk = std::make_unique<CQueuedChunk>();
+	pChunk->m_Type = Type;
+	pChunk->m_pWriter = pWriter;
+	pChunk->m_Tick = Tick;
+	pChunk->m_vData.assign((const unsigned char *)pData, (const unsigned char *)pData + Size);
+	Push(std::move(pChunk));
+	return true;
+}
+
+void CDemoRecorderThread::Push(std::unique_ptr<CQueuedChunk> pChunk)
+{
+	{
+		CLockScope ls(m_Lock);
+		m_vpQueue.push_back(std::move(pChunk));
+	}
+	sphore_signal(&m_Semaphore);
+}
+
+void CDemoRecorderThread::SetStaticsize(int ItemType, int Size)
+{
+	auto pChunk = std::make_unique<CQueuedChunk>();
+	pChunk->m_Type = QUEUED_STATICSIZE;
+	pChunk->m_ItemType = ItemType;
+	pChunk->m_ItemSize = Size;
+	Push(std::move(pChunk));
+}
+
+void CDemoRecorderThread::Finish(std::shared_ptr<CDemoRecorder::CWriter> pWriter)
+{
+	// never dropped, the queue is processed in order
+	auto pChunk = std::make_unique<CQueuedChunk>();
+	pChunk->m_Type = QUEUED_FINISH;
+	pChunk->m_pWriter = std::move(pWriter);
+	Push(std::move(pChunk));
+}
+
+void CDemoRecorderThread::ThreadFunc(void *pUser)
+{
+	CDemoRecorderThread *pThis = (CDemoRecorderThread *)pUser;
+
+	while(true)
+	{
+		std::unique_ptr<CQueuedChunk> pChunk;
+
+		sphore_wait(&pThis->m_Semaphore);
+		{
+			CLockScope ls(pThis->m_Lock);
+			if(pThis->m_vpQueue.empty())
+			{
+				// only stop once everything is written
+				if(pThis->m_Shutdown)
+					break;
+				continue;
+			}
+			pChunk = std::move(pThis->m_vpQueue.front());
+			pThis->m_vpQueue.pop_front();
+			pThis->m_QueuedSize -= pChunk->m_vData.size();
+		}
+
+		switch(pChunk->m_Type)
+		{
+		case QUEUED_SNAPSHOT:
+			pChunk->m_pWriter->RecordSnapshot(pChunk->m_Tick, pChunk->m_vData.data(), pChunk->m_vData.size(), &pThis->m_SnapshotDelta);
+			break;
+		case QUEUED_MESSAGE:
+			pChunk->m_pWriter->RecordMessage(pChunk->m_vData.data(), pChunk->m_vData.size());
+			break;
+		case QUEUED_STATICSIZE:
+			pThis->m_SnapshotDelta.SetStaticsize(pChunk->m_ItemType, pChunk->m_ItemSize);
+			break;
+		case QUEUED_FINISH:
+			pChunk->m_pWriter->Finish();
+			break;
+		}
+	}
+}
+
 CDemoPlayer::CDemoPlayer(class CSnapshotDelta *pSnapshotDelta, bool UseVideo, TUpdateIntraTimesFunc &&UpdateIntraTimesFunc)
 {
 	Construct(pSnapshotDelta, UseVideo);
@@ -411,6 +675,8 @@ CDemoPlayer::CDemoPlayer(class CSnapshotDelta *pSnapshotDelta, bool UseVideo)
 CDemoPlayer::~CDemoPlayer()
 {
 	dbg_assert(m_File == 0, "Demo player not stopped");
+	sphore_destroy(&m_FreeChunks);
+	sphore_destroy(&m_DecodedChunks);
 }
 
 void CDemoPlayer::Construct(class CSnapshotDelta *pSnapshotDelta, bool UseVideo)
@@ -423,6 +689,18 @@ void CDemoPlayer::Construct(class CSnapshotDelta *pSnapshotDelta, bool UseVideo)
 	m_LastSnapshotDataSize = -1;
 	m_pListener = nullptr;
 	m_UseVideo = UseVideo;
+
+	m_DecoderTick = -1;
+	m_pDecoderSnapshotDelta = pSnapshotDelta;
+	m_UseDecodeThread = false;
+	m_pDecodeThread = nullptr;
+	sphore_init(&m_FreeChunks);
+	sphore_init(&m_DecodedChunks);
+	m_StopDecoding = false;
+	m_DecodeIndex = 0;
+	m_ConsumeIndex = 0;
+	m_ConsumingChunk = false;
+	m_NextCachedState = 0;
 }
 
 void CDemoPlayer::SetListener(IListener *pListener)
@@ -546,12 +824,308 @@ void CDemoPlayer::ScanFile()
 	io_seek(m_File, StartPos, IOSEEK_START);
 }
 
+// Reads the packed ints of the keyframe index at the end of the file, if
+// there is one. The index cannot start before `StartPos`. Only the
+// header of the index is checked, not the keyframes.
+static bool ReadKeyFrameIndexData(IOHANDLE File, long StartPos, std::vector<int> &vIndex, long &IndexPos)
+{
+	const long FileLength = io_length(File);
+	if(StartPos < 0 || FileLength < StartPos + gs_KeyFrameIndexTrailerSize || FileLength > std::numeric_limits<int>::max())
+		return false;
+
+	// read the trailer at the very end of the file
+	unsigned char aTrailer[gs_KeyFrameIndexTrailerSize];
+	if(io_seek(File, FileLength - gs_KeyFrameIndexTrailerSize, IOSEEK_START) != 0 ||
+		io_read(File, aTrailer, sizeof(aTrailer)) != sizeof(aTrailer) ||
+		mem_comp(aTrailer + sizeof(int32_t), gs_aKeyFrameIndexMarker, sizeof(gs_aKeyFrameIndexMarker)) != 0)
+		return false;
+
+	IndexPos = bytes_be_to_uint(aTrailer);
+	if(IndexPos < StartPos || IndexPos >= FileLength - gs_KeyFrameIndexTrailerSize)
+		return false;
+
+	// the index is a normal chunk of type 0 that spans exactly to the end of the file
+	unsigned char aChunk[3];
+	if(io_seek(File, IndexPos, IOSEEK_START) != 0 || io_read(File, aChunk, 1) != 1 ||
+		(aChunk[0] & CHUNKTYPEFLAG_TICKMARKER) || ((aChunk[0] & CHUNKMASK_TYPE) >> 5) != CHUNKTYPE_KEYFRAME_INDEX)
+		return false;
+	int ChunkSize = aChunk[0] & CHUNKMASK_SIZE;
+	if(ChunkSize == 30)
+	{
+		if(io_read(File, aChunk + 1, 1) != 1)
+			return false;
+		ChunkSize = aChunk[1];
+	}
+	else if(ChunkSize == 31)
+	{
+		if(io_read(File, aChunk + 1, 2) != 2)
+			return false;
+		ChunkSize = (aChunk[2] << 8) | aChunk[1];
+	}
+	if(io_tell(File) + ChunkSize != FileLength)
+		return false;
+
+	std::vector<unsigned char> vCompressed(ChunkSize);
+	std::vector<unsigned char> vDecompressed(CSnapshot::MAX_SIZE);
+	vIndex.resize(CSnapshot::MAX_SIZE / sizeof(int));
+	if(io_read(File, vCompressed.data(), ChunkSize) != (unsigned)ChunkSize)
+		return false;
+	int DataSize = CNetBase::Decompress(vCompressed.data(), ChunkSize, vDecompressed.data(), vDecompressed.size());
+	if(DataSize < 0)
+		return false;
+	DataSize = CVariableInt::Decompress(vDecompressed.data(), DataSize, vIndex.data(), vIndex.size() * sizeof(int));
+	if(DataSize < 0)
+		return false;
+	vIndex.resize(DataSize / sizeof(int));
+
+	// version, first tick, last tick and number of keyframes
+	return vIndex.size() >= 4 && vIndex[0] == gs_KeyFrameIndexVersion &&
+	       vIndex[1] >= 0 && vIndex[2] >= vIndex[1] && vIndex[3] >= 0 && vIndex.size() == 4 + 2 * (size_t)vIndex[3];
+}
+
+bool CDemoPlayer::ReadKeyFrameIndex()
+{
+	const long StartPos = io_tell(m_File);
+	std::vector<int> vIndex;
+	long IndexPos;
+	if(!ReadKeyFrameIndexData(m_File, StartPos, vIndex, IndexPos))
+		return false;
+
+	const int *pIndex = vIndex.data();
+	const int FirstTick = pIndex[1];
+	const int LastTick = pIndex[2];
+	const int NumKeyFrames = pIndex[3];
+
+	CKeyFrame *pKeyFrames = (CKeyFrame *)calloc(maximum(NumKeyFrames, 1), sizeof(CKeyFrame));
+	long Filepos = 0;
+	int Tick = 0;
+	for(int i = 0; i < NumKeyFrames; i++)
+	{
+		const int FileposDelta = pIndex[4 + 2 * i];
+		const int TickDelta = pIndex[4 + 2 * i + 1];
+		Filepos += FileposDelta;
+		Tick += TickDelta;
+		if((i > 0 && (FileposDelta <= 0 || TickDelta < 0)) || Filepos < StartPos || Filepos >= IndexPos || Tick < FirstTick || Tick > LastTick)
+		{
+			free(pKeyFrames);
+			return false;
+		}
+		pKeyFrames[i].m_Filepos = Filepos;
+		pKeyFrames[i].m_Tick = Tick;
+	}
+
+	m_pKeyFrames = pKeyFrames;
+	m_Info.m_SeekablePoints = NumKeyFrames;
+	m_Info.m_Info.m_FirstTick = FirstTick;
+	m_Info.m_Info.m_LastTick = LastTick;
+	return true;
+}
+
+void CDemoPlayer::DecodeChunk(CDecodedChunk *pChunk)
+{
+	pChunk->m_Filepos = m_File ? io_tell(m_File) : 0;
+	pChunk->m_PrevTick = m_DecoderTick;
+	pChunk->m_aError[0] = '\0';
+	pChunk->m_vData.clear();
+
+	int ChunkType, ChunkSize;
+	if(ReadChunkHeader(&ChunkType, &ChunkSize, &m_DecoderTick))
+	{
+		pChunk->m_Type = DECODED_END;
+		return;
+	}
+	pChunk->m_Tick = m_DecoderTick;
+
+	// read the chunk
+	int DataSize = 0;
+	if(ChunkSize)
+	{
+		if(io_read(m_File, m_aCompressedSnapshotData, ChunkSize) != (unsigned)ChunkSize)
+		{
+			pChunk->m_Type = DECODED_ERROR;
+			str_copy(pChunk->m_aError, "error reading chunk");
+			return;
+		}
+
+		DataSize = CNetBase::Decompress(m_aCompressedSnapshotData, ChunkSize, m_aDecompressedSnapshotData, sizeof(m_aDecompressedSnapshotData));
+		if(DataSize < 0)
+		{
+			pChunk->m_Type = DECODED_ERROR;
+			str_copy(pChunk->m_aError, "error during network decompression");
+			return;
+		}
+
+		DataSize = CVariableInt::Decompress(m_aDecompressedSnapshotData, DataSize, m_aCurrentSnapshotData, sizeof(m_aCurrentSnapshotData));
+		if(DataSize < 0)
+		{
+			pChunk->m_Type = DECODED_ERROR;
+			str_copy(pChunk->m_aError, "error during intpack decompression");
+			return;
+		}
+	}
+
+	if(ChunkType == CHUNKTYPE_DELTA)
+	{
+		// process delta snapshot
+		CSnapshot *pNewsnap = (CSnapshot *)m_aDeltaSnapshotData;
+		DataSize = m_pDecoderSnapshotDelta->UnpackDelta((CSnapshot *)m_aDecoderSnapshotData, pNewsnap, m_aCurrentSnapshotData, DataSize);
+
+		if(DataSize < 0)
+		{
+			pChunk->m_Type = DECODED_WARNING;
+			str_format(pChunk->m_aError, sizeof(pChunk->m_aError), "error during unpacking of delta, err=%d", DataSize);
+		}
+		else if(!pNewsnap->IsValid(DataSize))
+		{
+			pChunk->m_Type = DECODED_WARNING;
+			str_format(pChunk->m_aError, sizeof(pChunk->m_aError), "snapshot delta invalid. DataSize=%d", DataSize);
+		}
+		else
+		{
+			pChunk->m_Type = DECODED_SNAPSHOT;
+			pChunk->m_vData.assign(m_aDeltaSnapshotData, m_aDeltaSnapshotData + DataSize);
+			mem_copy(m_aDecoderSnapshotData, m_aDeltaSnapshotData, DataSize);
+		}
+	}
+	else if(ChunkType == CHUNKTYPE_SNAPSHOT)
+	{
+		// process full snapshot
+		CSnapshot *pSnap = (CSnapshot *)m_aCurrentSnapshotData;
+		if(!pSnap->IsValid(DataSize))
+		{
+			pChunk->m_Type = DECODED_WARNING;
+			str_format(pChunk->m_aError, sizeof(pChunk->m_aError), "snapshot invalid. DataSize=%d", DataSize);
+		}
+		else
+		{
+			pChunk->m_Type = DECODED_SNAPSHOT;
+			pChunk->m_vData.assign(m_aCurrentSnapshotData, m_aCurrentSnapshotData + DataSize);
+			mem_copy(m_aDecoderSnapshotData, m_aCurrentSnapshotData, DataSize);
+		}
+	}
+	else if(ChunkType & CHUNKTYPEFLAG_TICKMARKER)
+	{
+		pChunk->m_Type = DECODED_TICKMARKER;
+	}
+	else if(ChunkType == CHUNKTYPE_MESSAGE)
+	{
+		pChunk->m_Type = DECODED_MESSAGE;
+		pChunk->m_vData.assign(m_aCurrentSnapshotData, m_aCurrentSnapshotData + DataSize);
+	}
+	else
+	{
+		pChunk->m_Type = DECODED_OTHER;
+	}
+}
+
+void CDemoPlayer::DecodeThread(void *pUser)
+{
+	CDemoPlayer *pSelf = (CDemoPlayer *)pUser;
+	while(true)
+	{
+		sphore_wait(&pSelf->m_FreeChunks);
+		if(pSelf->m_StopDecoding)
+			break;
+
+		CDecodedChunk *pChunk = &pSelf->m_aDecodedChunks[pSelf->m_DecodeIndex];
+		pSelf->DecodeChunk(pChunk);
+		pSelf->m_DecodeIndex = (pSelf->m_DecodeIndex + 1) % NUM_DECODED_CHUNKS;
+		const bool Done = pChunk->m_Type == DECODED_END || pChunk->m_Type == DECODED_ERROR;
+		sphore_signal(&pSelf->m_DecodedChunks);
+		if(Done)
+			break;
+	}
+}
+
+void CDemoPlayer::StartDecoder()
+{
+	dbg_assert(!m_pDecodeThread, "decode thread already running");
+	if(!m_pThreadSnapshotDelta)
+		m_pThreadSnapshotDelta = std::make_unique<CSnapshotDelta>(*m_pSnapshotDelta);
+	m_pDecoderSnapshotDelta = m_pThreadSnapshotDelta.get();
+
+	m_StopDecoding = false;
+	m_DecodeIndex = 0;
+	m_ConsumeIndex = 0;
+	m_ConsumingChunk = false;
+	for(int i = 0; i < NUM_DECODED_CHUNKS; i++)
+		sphore_signal(&m_FreeChunks);
+	m_pDecodeThread = thread_init(DecodeThread, this, "demo decoder");
+}
+
+void CDemoPlayer::StopDecoder()
+{
+	if(!m_pDecodeThread)
+		return;
+
+	// wake the thread up in case it waits for a free chunk, the
+	// semaphores are recreated afterwards to drop what was decoded
+	m_StopDecoding = true;
+	sphore_signal(&m_FreeChunks);
+	thread_wait(m_pDecodeThread);
+	m_pDecodeThread = nullptr;
+
+	sphore_destroy(&m_FreeChunks);
+	sphore_destroy(&m_DecodedChunks);
+	sphore_init(&m_FreeChunks);
+	sphore_init(&m_DecodedChunks);
+	m_ConsumingChunk = false;
+}
+
+CDemoPlayer::CDecodedChunk *CDemoPlayer::NextChunk()
+{
+	// the listener might have stopped the playback
+	if(!m_UseDecodeThread || !m_File)
+	{
+		DecodeChunk(&m_SyncChunk);
+		return &m_SyncChunk;
+	}
+
+	if(!m_pDecodeThread)
+		StartDecoder();
+
+	// hand the previously consumed chunk back to the decode thread, unless
+	// it ended the decoding
+	if(m_ConsumingChunk)
+	{
+		CDecodedChunk *pChunk = &m_aDecodedChunks[m_ConsumeIndex];
+		if(pChunk->m_Type == DECODED_END || pChunk->m_Type == DECODED_ERROR)
+			return pChunk;
+
+		m_ConsumeIndex = (m_ConsumeIndex + 1) % NUM_DECODED_CHUNKS;
+		sphore_signal(&m_FreeChunks);
+	}
+	sphore_wait(&m_DecodedChunks);
+	m_ConsumingChunk = true;
+	return &m_aDecodedChunks[m_ConsumeIndex];
+}
+
+void CDemoPlayer::CacheState(const CDecodedChunk *pTickMarker)
+{
+	if(!m_UseStateCache || m_LastSnapshotDataSize == -1)
+		return;
+	for(const auto &State : m_vCachedStates)
+	{
+		if(absolute(State.m_Tick - pTickMarker->m_Tick) < CACHED_STATE_INTERVAL)
+			return;
+	}
+
+	if((int)m_vCachedStates.size() < NUM_CACHED_STATES)
+		m_vCachedStates.emplace_back();
+	CCachedState &State = m_vCachedStates[m_NextCachedState];
+	m_NextCachedState = (m_NextCachedState + 1) % NUM_CACHED_STATES;
+
+	State.m_Tick = pTickMarker->m_Tick;
+	State.m_Filepos = pTickMarker->m_Filepos;
+	State.m_PrevTick = pTickMarker->m_PrevTick;
+	State.m_vSnapshotData.assign(m_aLastSnapshotData, m_aLastSnapshotData + m_LastSnapshotDataSize);
+}
+
 void CDemoPlayer::DoTick()
 {
 	// update ticks
 	m_Info.m_PreviousTick = m_Info.m_Info.m_CurrentTick;
 	m_Info.m_Info.m_CurrentTick = m_Info.m_NextTick;
-	int ChunkTick = m_Info.m_Info.m_CurrentTick;
 
 	int64_t Freq = time_freq();
 	int64_t CurtickStart = (m_Info.m_Info.m_CurrentTick) * Freq / SERVER_TICK_SPEED;
@@ -565,8 +1139,8 @@ void CDemoPlayer::DoTick()
 	bool GotSnapshot = false;
 	while(true)
 	{
-		int ChunkType, ChunkSize;
-		if(ReadChunkHeader(&ChunkType, &ChunkSize, &ChunkTick))
+		CDecodedChunk *pChunk = NextChunk();
+		if(pChunk->m_Type == DECODED_END)
 		{
 			// stop on error or eof
 			if(m_pConsole)
@@ -585,97 +1159,28 @@ void CDemoPlayer::DoTick()
 				Pause();
 			break;
 		}
-
-		// read the chunk
-		int DataSize = 0;
-		if(ChunkSize)
+		else if(pChunk->m_Type == DECODED_ERROR)
 		{
-			if(io_read(m_File, m_aCompressedSnapshotData, ChunkSize) != (unsigned)ChunkSize)
-			{
-				// stop on error or eof
-				if(m_pConsole)
-					m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_player", "error reading chunk");
-				Stop();
-				break;
-			}
-
-			DataSize = CNetBase::Decompress(m_aCompressedSnapshotData, ChunkSize, m_aDecompressedSnapshotData, sizeof(m_aDecompressedSnapshotData));
-			if(DataSize < 0)
-			{
-				// stop on error or eof
-				if(m_pConsole)
-					m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_player", "error during network decompression");
-				Stop();
-				break;
-			}
-
-			DataSize = CVariableInt::Decompress(m_aDecompressedSnapshotData, DataSize, m_aCurrentSnapshotData, sizeof(m_aCurrentSnapshotData));
-
-			if(DataSize < 0)
-			{
-				if(m_pConsole)
-					m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_player", "error during intpack decompression");
-				Stop();
-				break;
-			}
+			// stop on error or eof
+			if(m_pConsole)
+				m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_player", pChunk->m_aError);
+			Stop();
+			break;
 		}
-
-		if(ChunkType == CHUNKTYPE_DELTA)
+		else if(pChunk->m_Type == DECODED_WARNING)
 		{
-			// process delta snapshot
-			CSnapshot *pNewsnap = (CSnapshot *)m_aDeltaSnapshotData;
-			DataSize = m_pSnapshotDelta->UnpackDelta((CSnapshot *)m_aLastSnapshotData, pNewsnap, m_aCurrentSnapshotData, DataSize);
-
-			if(DataSize < 0)
-			{
-				if(m_pConsole)
-				{
-					char aBuf[256];
-					str_format(aBuf, sizeof(aBuf), "error during unpacking of delta, err=%d", DataSize);
-					m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_player", aBuf);
-				}
-			}
-			else if(!pNewsnap->IsValid(DataSize))
-			{
-				if(m_pConsole)
-				{
-					char aBuf[256];
-					str_format(aBuf, sizeof(aBuf), "snapshot delta invalid. DataSize=%d", DataSize);
-					m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_player", aBuf);
-				}
-			}
-			else
-			{
-				if(m_pListener)
-					m_pListener->OnDemoPlayerSnapshot(m_aDeltaSnapshotData, DataSize);
-
-				m_LastSnapshotDataSize = DataSize;
-				mem_copy(m_aLastSnapshotData, m_aDeltaSnapshotData, DataSize);
-				GotSnapshot = true;
-			}
+			if(m_pConsole)
+				m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_player", pChunk->m_aError);
 		}
-		else if(ChunkType == CHUNKTYPE_SNAPSHOT)
+		else if(pChunk->m_Type == DECODED_SNAPSHOT)
 		{
-			// process full snapshot
-			CSnapshot *pSnap = (CSnapshot *)m_aCurrentSnapshotData;
-			if(!pSnap->IsValid(DataSize))
-			{
-				if(m_pConsole)
-				{
-					char aBuf[256];
-					str_format(aBuf, sizeof(aBuf), "snapshot invalid. DataSize=%d", DataSize);
-					m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_player", aBuf);
-				}
-			}
-			else
-			{
-				GotSnapshot = true;
+			const int DataSize = pChunk->m_vData.size();
+			m_LastSnapshotDataSize = DataSize;
+			mem_copy(m_aLastSnapshotData, pChunk->m_vData.data(), DataSize);
+			GotSnapshot = true;
 
-				m_LastSnapshotDataSize = DataSize;
-				mem_copy(m_aLastSnapshotData, m_aCurrentSnapshotData, DataSize);
-				if(m_pListener)
-					m_pListener->OnDemoPlayerSnapshot(m_aCurrentSnapshotData, DataSize);
-			}
+			if(m_pListener)
+				m_pListener->OnDemoPlayerSnapshot(pChunk->m_vData.data(), DataSize);
 		}
 		else
 		{
@@ -687,15 +1192,16 @@ void CDemoPlayer::DoTick()
 			}
 
 			// check the remaining types
-			if(ChunkType & CHUNKTYPEFLAG_TICKMARKER)
+			if(pChunk->m_Type == DECODED_TICKMARKER)
 			{
-				m_Info.m_NextTick = ChunkTick;
+				m_Info.m_NextTick = pChunk->m_Tick;
+				CacheState(pChunk);
 				break;
 			}
-			else if(ChunkType == CHUNKTYPE_MESSAGE)
+			else if(pChunk->m_Type == DECODED_MESSAGE)
 			{
 				if(m_pListener)
-					m_pListener->OnDemoPlayerMessage(m_aCurrentSnapshotData, DataSize);
+					m_pListener->OnDemoPlayerMessage(pChunk->m_vData.data(), pChunk->m_vData.size());
 			}
 		}
 	}
@@ -738,6 +1244,7 @@ int CDemoPlayer::Load(class IStorage *pStorage, class IConsole *pConsole, const
 
 	// store the filename
 	str_copy(m_aFilename, pFilename);
+	m_StorageType = StorageType;
 
 	// clear the playback info
 	mem_zero(&m_Info, sizeof(m_Info));
@@ -750,6 +1257,12 @@ int CDemoPlayer::Load(class IStorage *pStorage, class IConsole *pConsole, const
 	m_SpeedIndex = 4;
 
 	m_LastSnapshotDataSize = -1;
+	m_DecoderTick = -1;
+	m_pDecoderSnapshotDelta = m_pSnapshotDelta;
+	m_UseDecodeThread = g_Config.m_ClDemoDecodeThread;
+	m_UseStateCache = g_Config.m_ClDemoStateCache;
+	m_vCachedStates.clear();
+	m_NextCachedState = 0;
 
 	// read the header
 	if(io_read(m_File, &m_Info.m_Header, sizeof(m_Info.m_Header)) != sizeof(m_Info.m_Header) || !m_Info.m_Header.Valid())
@@ -834,8 +1347,12 @@ int CDemoPlayer::Load(class IStorage *pStorage, class IConsole *pConsole, const
 		}
 	}
 
-	// scan the file for interesting points
-	ScanFile();
+	// use the keyframe index if the demo has one, otherwise scan the file for interesting points
+	const long ChunksPos = io_tell(m_File);
+	const bool HasKeyFrameIndex = ReadKeyFrameIndex();
+	io_seek(m_File, ChunksPos, IOSEEK_START);
+	if(!HasKeyFrameIndex)
+		ScanFile();
 
 	// reset slice markers
 	g_Config.m_ClDemoSliceBegin = -1;
@@ -850,13 +1367,33 @@ unsigned char *CDemoPlayer::GetMapData(class IStorage *pStorage)
 	if(!m_MapInfo.m_Size)
 		return 0;
 
-	long CurSeek = io_tell(m_File);
+	// the decode thread owns the file position, read from another handle
+	IOHANDLE File = m_File;
+	long CurSeek = -1;
+	if(m_pDecodeThread)
+	{
+		File = pStorage->OpenFile(m_aFilename, IOFLAG_READ, m_StorageType);
+		if(!File)
+			return 0;
+	}
+	else
+		CurSeek = io_tell(m_File);
 
-	// get map data
-	io_seek(m_File, m_MapOffset, IOSEEK_START);
-	unsigned char *pMapData = (unsigned char *)malloc(m_MapInfo.m_Size);
-	io_read(m_File, pMapData, m_MapInfo.m_Size);
-	io_seek(m_File, CurSeek, IOSEEK_START);
+	unsigned char *pMapData = 0;
+	if(io_seek(File, m_MapOffset, IOSEEK_START) == 0)
+	{
+		pMapData = (unsigned char *)malloc(m_MapInfo.m_Size);
+		if(io_read(File, pMapData, m_MapInfo.m_Size) != (unsigned)m_MapInfo.m_Size)
+		{
+			free(pMapData);
+			pMapData = 0;
+		}
+	}
+
+	if(m_pDecodeThread)
+		io_close(File);
+	else
+		io_seek(m_File, CurSeek, IOSEEK_START);
 	return pMapData;
 }
 
@@ -989,8 +1526,30 @@ int CDemoPlayer::SetPos(int WantedTick)
 	while(KeyFrame > 0 && m_pKeyFrames[KeyFrame].m_Tick > KeyFrameWantedTick)
 		KeyFrame--;
 
-	// seek to the correct key frame
-	io_seek(m_File, m_pKeyFrames[KeyFrame].m_Filepos, IOSEEK_START);
+	StopDecoder();
+
+	// resume from a cached state if it is closer than the key frame
+	const CCachedState *pState = nullptr;
+	for(const auto &State : m_vCachedStates)
+	{
+		if(State.m_Tick > m_pKeyFrames[KeyFrame].m_Tick && State.m_Tick <= KeyFrameWantedTick && (!pState || State.m_Tick > pState->m_Tick))
+			pState = &State;
+	}
+
+	if(pState)
+	{
+		io_seek(m_File, pState->m_Filepos, IOSEEK_START);
+		m_DecoderTick = pState->m_PrevTick;
+		m_LastSnapshotDataSize = pState->m_vSnapshotData.size();
+		mem_copy(m_aLastSnapshotData, pState->m_vSnapshotData.data(), m_LastSnapshotDataSize);
+		mem_copy(m_aDecoderSnapshotData, pState->m_vSnapshotData.data(), m_LastSnapshotDataSize);
+	}
+	else
+	{
+		// seek to the correct key frame
+		io_seek(m_File, m_pKeyFrames[KeyFrame].m_Filepos, IOSEEK_START);
+		m_DecoderTick = -1;
+	}
 
 	m_Info.m_NextTick = -1;
 	m_Info.m_Info.m_CurrentTick = -1;
@@ -1084,6 +1643,8 @@ int CDemoPlayer::Stop()
 	if(!m_File)
 		return -1;
 
+	StopDecoder();
+
 	if(m_pConsole)
 		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_player", "Stopped playback");
 	io_close(m_File);
@@ -1157,6 +1718,13 @@ bool CDemoPlayer::GetDemoInfo(class IStorage *pStorage, const char *pFilename, i
 
 	pMapInfo->m_Size = bytes_be_to_uint(pDemoHeader->m_aMapSize);
 
+	// the keyframe index has the exact length, even if the header was not updated
+	std::vector<int> vIndex;
+	long IndexPos;
+	const long StartPos = io_tell(File);
+	if(ReadKeyFrameIndexData(File, StartPos, vIndex, IndexPos))
+		uint_to_bytes_be(pDemoHeader->m_aLength, (vIndex[2] - vIndex[1]) / SERVER_TICK_SPEED);
+
 	io_close(File);
 	return true;
 }
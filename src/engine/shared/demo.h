@@ -7,21 +7,72 @@
 
 #include <engine/demo.h>
 #include <engine/shared/protocol.h>
+
+#include <atomic>
+#include <deque>
 #include <functional>
+#include <memory>
+#include <vector>
 
 #include "snapshot.h"
 
 typedef std::function<void()> TUpdateIntraTimesFunc;
 
+class CDemoRecorderThread;
+
 class CDemoRecorder : public IDemoRecorder
 {
+	friend CDemoRecorderThread;
+
+public:
+	enum EStopMode
+	{
+		STOP_KEEP_FILE,
+		STOP_REMOVE_FILE,
+	};
+
+private:
+	struct CKeyFrame
+	{
+		int m_Filepos;
+		int m_Tick;
+	};
+
+	// The file that is recorded to and the state needed to write its
+	// chunks. With a recording thread, the queued chunks share it and the
+	// thread finishes the file after the recorder was stopped.
+	class CWriter
+	{
+	public:
+		IOHANDLE m_File;
+		class IStorage *m_pStorage;
+		char m_aFilename[IO_MAX_PATH_LENGTH];
+		int m_LastTickMarker = -1;
+		int m_LastKeyFrame = -1;
+		int m_FirstTick = -1;
+		unsigned char m_aLastSnapshotData[CSnapshot::MAX_SIZE];
+		std::vector<CKeyFrame> m_vKeyFrames;
+		bool m_KeyFrameIndexValid = true;
+
+		// set by `CDemoRecorder::Stop`
+		std::vector<int> m_vTimelineMarkers;
+		EStopMode m_StopMode = STOP_KEEP_FILE;
+		char m_aTargetFilename[IO_MAX_PATH_LENGTH] = "";
+
+		void WriteTickMarker(int Tick, int Keyframe);
+		void WriteChunkHeader(int Type, int Size);
+		void Write(int Type, const void *pData, int Size);
+		void WriteKeyFrameIndex();
+		void RecordSnapshot(int Tick, const void *pData, int Size, class CSnapshotDelta *pSnapshotDelta);
+		void RecordMessage(const void *pData, int Size);
+		void Finish();
+	};
+
 	class IConsole *m_pConsole;
-	IOHANDLE m_File;
+	std::shared_ptr<CWriter> m_pWriter;
 	char m_aCurrentFilename[IO_MAX_PATH_LENGTH];
-	int m_LastTickMarker;
-	int m_LastKeyFrame;
+	int m_LastTick;
 	int m_FirstTick;
-	unsigned char m_aLastSnapshotData[CSnapshot::MAX_SIZE];
 	class CSnapshotDelta *m_pSnapshotDelta;
 	int m_NumTimelineMarkers;
 	int m_aTimelineMarkers[MAX_TIMELINE_MARKERS];
@@ -31,8 +82,8 @@ class CDemoRecorder : public IDemoRecorder
 	DEMOFUNC_FILTER m_pfnFilter;
 	void *m_pUser;
 
-	void WriteTickMarker(int Tick, int Keyframe);
-	void Write(int Type, const void *pData, int Size);
+	CDemoRecorderThread *m_pThread;
+	int m_NumDropped;
 
 public:
 	CDemoRecorder(class CSnapshotDelta *pSnapshotDelta, bool NoMapData = false);
@@ -40,7 +91,16 @@ public:
 	~CDemoRecorder() override;
 
 	int Start(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetversion, const char *pMap, SHA256_DIGEST *pSha256, unsigned MapCrc, const char *pType, unsigned MapSize, unsigned char *pMapData, IOHANDLE MapFile = nullptr, DEMOFUNC_FILTER pfnFilter = nullptr, void *pUser = nullptr);
-	int Stop() override;
+	int Stop() override { return Stop(STOP_KEEP_FILE); }
+	// Stops recording and then removes the file or, if `pTargetFilename`
+	// is given, renames it. With a recording thread, this happens on the
+	// thread once the chunks queued before are written.
+	int Stop(EStopMode Mode, const char *pTargetFilename = nullptr);
+
+	// Hands snapshots and messages to the given thread instead of
+	// compressing and writing them on the calling thread. Must not be
+	// changed while recording.
+	void SetThread(CDemoRecorderThread *pThread);
 
 	void AddDemoMarker();
 	void AddDemoMarker(int Tick);
@@ -48,11 +108,62 @@ public:
 	void RecordSnapshot(int Tick, const void *pData, int Size);
 	void RecordMessage(const void *pData, int Size);
 
-	bool IsRecording() const override { return m_File != nullptr; }
+	bool IsRecording() const override { return m_pWriter != nullptr; }
 	char *GetCurrentFilename() override { return m_aCurrentFilename; }
 	void ClearCurrentFilename() { m_aCurrentFilename[0] = '\0'; }
 
-	int Length() const override { return (m_LastTickMarker - m_FirstTick) / SERVER_TICK_SPEED; }
+	int Length() const override { return (m_LastTick - m_FirstTick) / SERVER_TICK_SPEED; }
+};
+
+// Creates the snapshot deltas, compresses and writes the chunks of
+// CDemoRecorders on a separate thread. The queue is bounded, chunks that
+// don't fit are dropped and counted per recorder.
+class CDemoRecorderThread
+{
+	friend CDemoRecorder;
+
+	enum
+	{
+		QUEUED_SNAPSHOT,
+		QUEUED_MESSAGE,
+		QUEUED_STATICSIZE,
+		QUEUED_FINISH,
+	};
+
+	struct CQueuedChunk
+	{
+		int m_Type;
+		std::shared_ptr<CDemoRecorder::CWriter> m_pWriter;
+		int m_Tick = -1;
+		int m_ItemType = 0;
+		int m_ItemSize = 0;
+		std::vector<unsigned char> m_vData;
+	};
+
+	// only used by the recording thread
+	CSnapshotDelta m_SnapshotDelta;
+
+	void *m_pThread;
+	LOCK m_Lock;
+	SEMAPHORE m_Semaphore;
+	bool m_Shutdown GUARDED_BY(m_Lock);
+	std::deque<std::unique_ptr<CQueuedChunk>> m_vpQueue GUARDED_BY(m_Lock);
+	int m_QueuedSize GUARDED_BY(m_Lock);
+	int m_MaxQueuedSize;
+
+	void Push(std::unique_ptr<CQueuedChunk> pChunk) REQUIRES(!m_Lock);
+	bool Enqueue(int Type, const std::shared_ptr<CDemoRecorder::CWriter> &pWriter, int Tick, const void *pData, int Size) REQUIRES(!m_Lock);
+	void Finish(std::shared_ptr<CDemoRecorder::CWriter> pWriter) REQUIRES(!m_Lock);
+	static void ThreadFunc(void *pUser) NO_THREAD_SAFETY_ANALYSIS;
+
+public:
+	CDemoRecorderThread(const CSnapshotDelta &SnapshotDelta, int MaxQueuedSize);
+	// Writes everything that is still queued before returning.
+	~CDemoRecorderThread();
+
+	// Forwards `CSnapshotDelta::SetStaticsize` to the delta state of the
+	// recording thread, in order with the queued snapshots.
+	void SetStaticsize(int ItemType, int Size) REQUIRES(!m_Lock);
 };
 
 class CDemoPlayer : public IDemoPlayer
@@ -108,6 +219,7 @@ private:
 	IOHANDLE m_File;
 	long m_MapOffset;
 	char m_aFilename[IO_MAX_PATH_LENGTH];
+	int m_StorageType;
 	CKeyFrame *m_pKeyFrames;
 	CMapInfo m_MapInfo;
 	int m_SpeedIndex;
@@ -125,9 +237,76 @@ private:
 	bool m_UseVideo;
 	bool m_WasRecording = false;
 
+	// Decoding, either done in DoTick or ahead of it on the decode thread
+	enum
+	{
+		DECODED_SNAPSHOT,
+		DECODED_MESSAGE,
+		DECODED_TICKMARKER,
+		DECODED_OTHER,
+		DECODED_WARNING,
+		DECODED_ERROR,
+		DECODED_END,
+
+		NUM_DECODED_CHUNKS = 512,
+	};
+
+	struct CDecodedChunk
+	{
+		int m_Type;
+		int m_Tick;
+		// where decoding has to resume to get this chunk again
+		long m_Filepos;
+		int m_PrevTick;
+		char m_aError[64];
+		std::vector<unsigned char> m_vData;
+	};
+
+	// only used by whoever decodes, the decode thread while it runs
+	int m_DecoderTick;
+	unsigned char m_aDecoderSnapshotData[CSnapshot::MAX_SIZE];
+	class CSnapshotDelta *m_pDecoderSnapshotDelta;
+	std::unique_ptr<class CSnapshotDelta> m_pThreadSnapshotDelta;
+
+	bool m_UseDecodeThread;
+	void *m_pDecodeThread;
+	SEMAPHORE m_FreeChunks;
+	SEMAPHORE m_DecodedChunks;
+	std::atomic_bool m_StopDecoding;
+	CDecodedChunk m_aDecodedChunks[NUM_DECODED_CHUNKS];
+	int m_DecodeIndex; // decode thread only
+	int m_ConsumeIndex;
+	bool m_ConsumingChunk;
+	CDecodedChunk m_SyncChunk;
+
+	// Decoded states for seeking back without replaying from the keyframe
+	enum
+	{
+		NUM_CACHED_STATES = 64,
+		CACHED_STATE_INTERVAL = SERVER_TICK_SPEED,
+	};
+
+	struct CCachedState
+	{
+		int m_Tick;
+		long m_Filepos;
+		int m_PrevTick;
+		std::vector<unsigned char> m_vSnapshotData;
+	};
+	std::vector<CCachedState> m_vCachedStates;
+	int m_NextCachedState;
+	bool m_UseStateCache;
+
 	int ReadChunkHeader(int *pType, int *pSize, int *pTick);
+	void DecodeChunk(CDecodedChunk *pChunk);
+	CDecodedChunk *NextChunk();
+	void StartDecoder();
+	void StopDecoder();
+	static void DecodeThread(void *pUser);
+	void CacheState(const CDecodedChunk *pTickMarker);
 	void DoTick();
 	void ScanFile();
+	bool ReadKeyFrameIndex();
 
 	int64_t Time();
 
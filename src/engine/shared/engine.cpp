@@ -56,6 +56,22 @@ public:
 		}
 	}
 
+	static void Con_DbgJobs(IConsole::IResult *pResult, void *pUserData)
+	{
+		CEngine *pEngine = static_cast<CEngine *>(pUserData);
+
+		static const char *s_apPriorities[] = {"low", "normal", "high"};
+		char aBuf[256];
+		for(int Priority = IJob::NUM_PRIORITIES - 1; Priority >= 0; Priority--)
+		{
+			const CJobPool::CStats Stats = pEngine->m_JobPool.Stats(Priority);
+			str_format(aBuf, sizeof(aBuf), "%s priority: jobs=%" PRId64 " stolen=%" PRId64 " avg_latency=%.3fms max_latency=%.3fms",
+				s_apPriorities[Priority], Stats.m_NumJobs, Stats.m_NumStolen,
+				Stats.m_NumJobs ? Stats.m_TotalLatency / (float)Stats.m_NumJobs / 1000.0f : 0.0f, Stats.m_MaxLatency / 1000.0f);
+			pEngine->m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "jobs", aBuf);
+		}
+	}
+
 	CEngine(bool Test, const char *pAppname, std::shared_ptr<CFutureLogger> pFutureLogger, int Jobs) :
 		m_pFutureLogger(std::move(pFutureLogger))
 	{
@@ -104,6 +120,7 @@ public:
 		char aFullPath[IO_MAX_PATH_LENGTH];
 		m_pStorage->GetCompletePath(IStorage::TYPE_SAVE, "dumps/", aFullPath, sizeof(aFullPath));
 		m_pConsole->Register("dbg_lognetwork", "", CFGFLAG_SERVER | CFGFLAG_CLIENT, Con_DbgLognetwork, this, "Log the network");
+		m_pConsole->Register("dbg_jobs", "", CFGFLAG_SERVER | CFGFLAG_CLIENT, Con_DbgJobs, this, "Print how long jobs waited in the queue per priority");
 	}
 
 	void AddJob(std::shared_ptr<IJob> pJob) override
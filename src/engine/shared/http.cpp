@@ -1,10 +1,12 @@
 #include "http.h"
 
+#include <base/hash.h>
 #include <base/log.h>
 #include <base/math.h>
 #include <base/system.h>
 #include <engine/external/json-parser/json.h>
 #include <engine/shared/config.h>
+#include <engine/shared/linereader.h>
 #include <engine/storage.h>
 #include <game/version.h>
 
@@ -12,13 +14,62 @@
 #include <csignal>
 #endif
 
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <unordered_map>
+
 #define WIN32_LEAN_AND_MEAN
 #include <curl/curl.h>
 
+// Drives all transfers from one thread with a curl multi handle, so a
+// request doesn't occupy a thread while it waits for the network. At most
+// `MAX_RUNNING_REQUESTS` transfers run at once, the others wait in a queue
+// per job priority.
+class CHttpRunner
+{
+	enum
+	{
+		MAX_RUNNING_REQUESTS = 32,
+	};
+
+	struct CEntry
+	{
+		CHttpRequest *m_pRequest;
+		// set for requests started by `HttpRun`
+		std::shared_ptr<CHttpRequest> m_pKeepAlive;
+	};
+
+	CURLM *m_pMultiH = nullptr;
+	void *m_pThread = nullptr;
+
+	std::mutex m_Lock;
+	std::deque<CEntry> m_PendingRequests GUARDED_BY(m_Lock);
+	bool m_Shutdown GUARDED_BY(m_Lock) = false;
+	int64_t m_ShutdownDeadline GUARDED_BY(m_Lock) = 0;
+
+	// only accessed by the HTTP thread
+	std::deque<CEntry> m_aQueuedRequests[IJob::NUM_PRIORITIES];
+	std::unordered_map<CURL *, CEntry> m_RunningRequests;
+
+	static void ThreadFunc(void *pUser);
+	void Loop();
+	void StartQueued();
+	void Start(CEntry Entry);
+	static void Complete(CEntry Entry, int State);
+
+public:
+	~CHttpRunner() { Shutdown(0); }
+	bool Init();
+	void Queue(CHttpRequest *pRequest, std::shared_ptr<CHttpRequest> pKeepAlive);
+	void Shutdown(int TimeoutMs);
+};
+
 // TODO: Non-global pls?
 static CURLSH *gs_pShare;
 static LOCK gs_aLocks[CURL_LOCK_DATA_LAST + 1];
 static bool gs_Initialized = false;
+static CHttpRunner gs_Runner;
 
 static int GetLockIndex(int Data)
 {
@@ -71,8 +122,205 @@ int CurlDebug(CURL *pHandle, curl_infotype Type, char *pData, size_t DataSize, v
 	return 0;
 }
 
+bool CHttpRunner::Init()
+{
+	if(m_pThread)
+	{
+		return true;
+	}
+	m_pMultiH = curl_multi_init();
+	if(!m_pMultiH)
+	{
+		return false;
+	}
+	{
+		std::lock_guard<std::mutex> Lock(m_Lock);
+		m_Shutdown = false;
+	}
+	m_pThread = thread_init(ThreadFunc, this, "http");
+	return true;
+}
+
+void CHttpRunner::ThreadFunc(void *pUser)
+{
+	static_cast<CHttpRunner *>(pUser)->Loop();
+}
+
+void CHttpRunner::Loop()
+{
+	while(true)
+	{
+		std::deque<CEntry> NewRequests;
+		bool Shutdown;
+		int64_t ShutdownDeadline;
+		{
+			std::lock_guard<std::mutex> Lock(m_Lock);
+			std::swap(NewRequests, m_PendingRequests);
+			Shutdown = m_Shutdown;
+			ShutdownDeadline = m_ShutdownDeadline;
+		}
+		for(auto &Entry : NewRequests)
+		{
+			m_aQueuedRequests[Entry.m_pRequest->Priority()].push_back(std::move(Entry));
+		}
+		StartQueued();
+		if(Shutdown && (m_RunningRequests.empty() || time_get() >= ShutdownDeadline))
+		{
+			break;
+		}
+
+		int NumRunning;
+		CURLMcode Result = curl_multi_perform(m_pMultiH, &NumRunning);
+		if(Result != CURLM_OK)
+		{
+			dbg_msg("http", "curl_multi_perform failed: %s", curl_multi_strerror(Result));
+		}
+		CURLMsg *pMsg;
+		int NumMessages;
+		while((pMsg = curl_multi_info_read(m_pMultiH, &NumMessages)))
+		{
+			if(pMsg->msg != CURLMSG_DONE)
+			{
+				continue;
+			}
+			CURL *pHandle = pMsg->easy_handle;
+			const CURLcode TransferResult = pMsg->data.result;
+			auto Entry = m_RunningRequests.find(pHandle);
+			dbg_assert(Entry != m_RunningRequests.end(), "unknown curl handle");
+			CEntry Done = std::move(Entry->second);
+			m_RunningRequests.erase(Entry);
+			curl_multi_remove_handle(m_pMultiH, pHandle);
+			const int State = Done.m_pRequest->OnTransferDone(pHandle, TransferResult);
+			curl_easy_cleanup(pHandle);
+			Complete(std::move(Done), State);
+		}
+		StartQueued();
+
+		// curl calls the progress callback at least once per second, that's
+		// where aborted requests are noticed
+		int TimeoutMs = 1000;
+		if(Shutdown)
+		{
+			TimeoutMs = clamp((int)((ShutdownDeadline - time_get()) * 1000 / time_freq()), 0, TimeoutMs);
+		}
+		Result = curl_multi_poll(m_pMultiH, nullptr, 0, TimeoutMs, nullptr);
+		if(Result != CURLM_OK)
+		{
+			dbg_msg("http", "curl_multi_poll failed: %s", curl_multi_strerror(Result));
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	}
+
+	for(auto &[pHandle, Entry] : m_RunningRequests)
+	{
+		curl_multi_remove_handle(m_pMultiH, pHandle);
+		curl_easy_cleanup(pHandle);
+		Complete(std::move(Entry), HTTP_ABORTED);
+	}
+	m_RunningRequests.clear();
+	for(auto &Queue : m_aQueuedRequests)
+	{
+		for(auto &Entry : Queue)
+		{
+			Complete(std::move(Entry), HTTP_ABORTED);
+		}
+		Queue.clear();
+	}
+}
+
+void CHttpRunner::StartQueued()
+{
+	for(int Priority = IJob::NUM_PRIORITIES - 1; Priority >= 0; Priority--)
+	{
+		std::deque<CEntry> &Queue = m_aQueuedRequests[Priority];
+		while(!Queue.empty() && m_RunningRequests.size() < MAX_RUNNING_REQUESTS)
+		{
+			CEntry Entry = std::move(Queue.front());
+			Queue.pop_front();
+			Start(std::move(Entry));
+		}
+	}
+}
+
+void CHttpRunner::Start(CEntry Entry)
+{
+	CHttpRequest *pRequest = Entry.m_pRequest;
+	if(!pRequest->BeforeInit())
+	{
+		Complete(std::move(Entry), HTTP_ERROR);
+		return;
+	}
+	CURL *pHandle = curl_easy_init();
+	if(!pHandle || !pRequest->ConfigureHandle(pHandle))
+	{
+		curl_easy_cleanup(pHandle);
+		Complete(std::move(Entry), HTTP_ERROR);
+		return;
+	}
+	CURLMcode Result = curl_multi_add_handle(m_pMultiH, pHandle);
+	if(Result != CURLM_OK)
+	{
+		dbg_msg("http", "curl_multi_add_handle failed: %s", curl_multi_strerror(Result));
+		curl_easy_cleanup(pHandle);
+		Complete(std::move(Entry), HTTP_ERROR);
+		return;
+	}
+	m_RunningRequests.emplace(pHandle, std::move(Entry));
+}
+
+void CHttpRunner::Complete(CEntry Entry, int State)
+{
+	// requests run as a job are finished by the job pool
+	Entry.m_pRequest->Complete(State, Entry.m_pKeepAlive != nullptr);
+}
+
+void CHttpRunner::Queue(CHttpRequest *pRequest, std::shared_ptr<CHttpRequest> pKeepAlive)
+{
+	{
+		std::lock_guard<std::mutex> Lock(m_Lock);
+		if(pKeepAlive)
+		{
+			pRequest->MarkRunning();
+		}
+		if(!m_Shutdown)
+		{
+			m_PendingRequests.push_back(CEntry{pRequest, std::move(pKeepAlive)});
+			curl_multi_wakeup(m_pMultiH);
+			return;
+		}
+	}
+	Complete(CEntry{pRequest, std::move(pKeepAlive)}, HTTP_ABORTED);
+}
+
+void CHttpRunner::Shutdown(int TimeoutMs)
+{
+	if(!m_pThread)
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> Lock(m_Lock);
+		if(m_Shutdown)
+		{
+			return;
+		}
+		m_Shutdown = true;
+		m_ShutdownDeadline = time_get() + TimeoutMs * time_freq() / 1000;
+		curl_multi_wakeup(m_pMultiH);
+	}
+	thread_wait(m_pThread);
+	m_pThread = nullptr;
+	curl_multi_cleanup(m_pMultiH);
+	m_pMultiH = nullptr;
+}
+
 bool HttpInit(IStorage *pStorage)
 {
+	if(gs_Initialized)
+	{
+		// restarts the HTTP thread after `HttpShutdown`
+		return !gs_Runner.Init();
+	}
 	if(curl_global_init(CURL_GLOBAL_DEFAULT))
 	{
 		return true;
@@ -104,11 +352,31 @@ bool HttpInit(IStorage *pStorage)
 	signal(SIGPIPE, SIG_IGN);
 #endif
 
+	if(!gs_Runner.Init())
+	{
+		return true;
+	}
+
 	gs_Initialized = true;
 
 	return false;
 }
 
+void HttpShutdown(int TimeoutMs)
+{
+	if(gs_Initialized)
+	{
+		gs_Runner.Shutdown(TimeoutMs);
+	}
+}
+
+void HttpRun(std::shared_ptr<CHttpRequest> pRequest)
+{
+	dbg_assert(gs_Initialized, "must initialize HTTP before running HTTP requests");
+	CHttpRequest *pRawRequest = pRequest.get();
+	gs_Runner.Queue(pRawRequest, std::move(pRequest));
+}
+
 void EscapeUrl(char *pBuf, int Size, const char *pStr)
 {
 	char *pEsc = curl_easy_escape(0, pStr, 0);
@@ -150,19 +418,26 @@ CHttpRequest::~CHttpRequest()
 void CHttpRequest::Run()
 {
 	dbg_assert(gs_Initialized, "must initialize HTTP before running HTTP requests");
-	int FinalState;
-	if(!BeforeInit())
-	{
-		FinalState = HTTP_ERROR;
-	}
-	else
+	gs_Runner.Queue(this, nullptr);
+	Wait();
+}
+
+void CHttpRequest::Wait()
+{
+	std::unique_lock<std::mutex> Lock(m_WaitLock);
+	m_WaitCondition.wait(Lock, [this]() { return m_Completed; });
+}
+
+void CHttpRequest::Complete(int State, bool FinishJob)
+{
+	m_State = OnCompletion(State);
+	if(FinishJob)
 	{
-		CURL *pHandle = curl_easy_init();
-		FinalState = RunImpl(pHandle);
-		curl_easy_cleanup(pHandle);
+		Finish();
 	}
-
-	m_State = OnCompletion(FinalState);
+	std::lock_guard<std::mutex> Lock(m_WaitLock);
+	m_Completed = true;
+	m_WaitCondition.notify_all();
 }
 
 bool CHttpRequest::BeforeInit()
@@ -185,13 +460,9 @@ bool CHttpRequest::BeforeInit()
 	return true;
 }
 
-int CHttpRequest::RunImpl(CURL *pUser)
+bool CHttpRequest::ConfigureHandle(CURL *pUser)
 {
 	CURL *pHandle = (CURL *)pUser;
-	if(!pHandle)
-	{
-		return HTTP_ERROR;
-	}
 
 	if(g_Config.m_DbgCurl)
 	{
@@ -203,8 +474,9 @@ int CHttpRequest::RunImpl(CURL *pUser)
 	{
 		Protocols |= CURLPROTO_HTTP;
 	}
-	char aErr[CURL_ERROR_SIZE];
-	curl_easy_setopt(pHandle, CURLOPT_ERRORBUFFER, aErr);
+	static_assert(CURL_ERROR_SIZE <= sizeof(m_aErr), "curl error buffer too small");
+	m_aErr[0] = '\0';
+	curl_easy_setopt(pHandle, CURLOPT_ERRORBUFFER, m_aErr);
 
 	curl_easy_setopt(pHandle, CURLOPT_CONNECTTIMEOUT_MS, m_Timeout.ConnectTimeoutMs);
 	curl_easy_setopt(pHandle, CURLOPT_TIMEOUT_MS, m_Timeout.TimeoutMs);
@@ -236,6 +508,18 @@ int CHttpRequest::RunImpl(CURL *pUser)
 
 	curl_easy_setopt(pHandle, CURLOPT_WRITEDATA, this);
 	curl_easy_setopt(pHandle, CURLOPT_WRITEFUNCTION, WriteCallback);
+	if(m_aCachePath[0] != '\0' && m_Type == REQUEST::GET)
+	{
+		curl_easy_setopt(pHandle, CURLOPT_HEADERDATA, this);
+		curl_easy_setopt(pHandle, CURLOPT_HEADERFUNCTION, HeaderCallback);
+		if(ReadCacheMeta())
+		{
+			if(m_aEtag[0] != '\0')
+				HeaderString("If-None-Match", m_aEtag);
+			if(m_aLastModified[0] != '\0')
+				HeaderString("If-Modified-Since", m_aLastModified);
+		}
+	}
 	curl_easy_setopt(pHandle, CURLOPT_NOPROGRESS, 0L);
 	curl_easy_setopt(pHandle, CURLOPT_PROGRESSDATA, this);
 	// ‘CURLOPT_PROGRESSFUNCTION’ is deprecated: since 7.32.0. Use CURLOPT_XFERINFOFUNCTION
@@ -292,22 +576,39 @@ int CHttpRequest::RunImpl(CURL *pUser)
 	if(g_Config.m_DbgCurl || m_LogProgress >= HTTPLOG::ALL)
 		dbg_msg("http", "fetching %s", m_aUrl);
 	m_State = HTTP_RUNNING;
-	int Ret = curl_easy_perform(pHandle);
-	if(Ret != CURLE_OK)
+	return true;
+}
+
+int CHttpRequest::OnTransferDone(CURL *pHandle, int Result)
+{
+	if(Result != CURLE_OK)
 	{
 		if(g_Config.m_DbgCurl || m_LogProgress >= HTTPLOG::FAILURE)
-			dbg_msg("http", "%s failed. libcurl error (%d): %s", m_aUrl, (int)Ret, aErr);
-		return (Ret == CURLE_ABORTED_BY_CALLBACK) ? HTTP_ABORTED : HTTP_ERROR;
+			dbg_msg("http", "%s failed. libcurl error (%d): %s", m_aUrl, Result, m_aErr);
+		return (Result == CURLE_ABORTED_BY_CALLBACK) ? HTTP_ABORTED : HTTP_ERROR;
 	}
-	else
+
+	long StatusCode = 0;
+	curl_easy_getinfo(pHandle, CURLINFO_RESPONSE_CODE, &StatusCode);
+	if(StatusCode == 304)
 	{
+		if(!ServeFromCache())
+		{
+			if(g_Config.m_DbgCurl || m_LogProgress >= HTTPLOG::FAILURE)
+				dbg_msg("http", "%s failed. cached response is not available", m_aUrl);
+			return HTTP_ERROR;
+		}
 		if(g_Config.m_DbgCurl || m_LogProgress >= HTTPLOG::ALL)
-			dbg_msg("http", "task done %s", m_aUrl);
+			dbg_msg("http", "task done %s (not modified)", m_aUrl);
 		return HTTP_DONE;
 	}
+
+	if(g_Config.m_DbgCurl || m_LogProgress >= HTTPLOG::ALL)
+		dbg_msg("http", "task done %s", m_aUrl);
+	return HTTP_DONE;
 }
 
-size_t CHttpRequest::OnData(char *pData, size_t DataSize)
+size_t CHttpRequest::Receive(char *pData, size_t DataSize)
 {
 	// Need to check for the maximum response size here as curl can only
 	// guarantee it if the server sets a Content-Length header.
@@ -315,6 +616,20 @@ size_t CHttpRequest::OnData(char *pData, size_t DataSize)
 	{
 		return 0;
 	}
+	if(m_aCachePath[0] != '\0' && !m_FromCache && DataSize > 0)
+	{
+		WriteCache(pData, DataSize);
+	}
+	if(OnData(pData, DataSize) != DataSize)
+	{
+		return 0;
+	}
+	m_ResponseLength += DataSize;
+	return DataSize;
+}
+
+size_t CHttpRequest::OnData(char *pData, size_t DataSize)
+{
 	if(!m_WriteToFile)
 	{
 		if(DataSize == 0)
@@ -332,19 +647,186 @@ size_t CHttpRequest::OnData(char *pData, size_t DataSize)
 			m_BufferSize = NewBufferSize;
 		}
 		mem_copy(m_pBuffer + m_ResponseLength, pData, DataSize);
-		m_ResponseLength += DataSize;
 		return DataSize;
 	}
 	else
 	{
-		m_ResponseLength += DataSize;
 		return io_write(m_File, pData, DataSize);
 	}
 }
 
 size_t CHttpRequest::WriteCallback(char *pData, size_t Size, size_t Number, void *pUser)
 {
-	return ((CHttpRequest *)pUser)->OnData(pData, Size * Number);
+	return ((CHttpRequest *)pUser)->Receive(pData, Size * Number);
+}
+
+size_t CHttpRequest::HeaderCallback(char *pData, size_t Size, size_t Number, void *pUser)
+{
+	CHttpRequest *pRequest = (CHttpRequest *)pUser;
+	const size_t DataSize = Size * Number;
+	char aLine[256];
+	if(DataSize >= sizeof(aLine))
+	{
+		return DataSize;
+	}
+	str_truncate(aLine, sizeof(aLine), pData, DataSize);
+	str_utf8_trim_right(aLine);
+
+	// every response starts with a status line, also after redirects
+	const char *pValue;
+	if(str_startswith(aLine, "HTTP/"))
+	{
+		pRequest->m_aEtag[0] = '\0';
+		pRequest->m_aLastModified[0] = '\0';
+	}
+	else if((pValue = str_startswith_nocase(aLine, "ETag:")) && str_length(str_skip_whitespaces_const(pValue)) < (int)sizeof(pRequest->m_aEtag))
+	{
+		str_copy(pRequest->m_aEtag, str_skip_whitespaces_const(pValue));
+	}
+	else if((pValue = str_startswith_nocase(aLine, "Last-Modified:")) && str_length(str_skip_whitespaces_const(pValue)) < (int)sizeof(pRequest->m_aLastModified))
+	{
+		str_copy(pRequest->m_aLastModified, str_skip_whitespaces_const(pValue));
+	}
+	return DataSize;
+}
+
+bool CHttpRequest::ReadCacheMeta()
+{
+	char aPath[IO_MAX_PATH_LENGTH];
+	str_format(aPath, sizeof(aPath), "%s.meta", m_aCachePath);
+	IOHANDLE File = io_open(aPath, IOFLAG_READ);
+	if(!File)
+	{
+		return false;
+	}
+	// the validators in the same format as the response headers
+	CLineReader Reader;
+	Reader.Init(File);
+	while(const char *pLine = Reader.Get())
+	{
+		const char *pValue;
+		if((pValue = str_startswith(pLine, "ETag: ")))
+			str_copy(m_aEtag, pValue);
+		else if((pValue = str_startswith(pLine, "Last-Modified: ")))
+			str_copy(m_aLastModified, pValue);
+	}
+	io_close(File);
+	return m_aEtag[0] != '\0' || m_aLastModified[0] != '\0';
+}
+
+bool CHttpRequest::ServeFromCache()
+{
+	char aPath[IO_MAX_PATH_LENGTH];
+	str_format(aPath, sizeof(aPath), "%s.body", m_aCachePath);
+	IOHANDLE File = io_open(aPath, IOFLAG_READ);
+	if(!File)
+	{
+		return false;
+	}
+	const int64_t Size = io_length(File);
+	m_Size.store(maximum(Size, (int64_t)0), std::memory_order_relaxed);
+
+	// passed on in chunks like a download, so the body isn't loaded at once
+	m_FromCache = true;
+	char aChunk[16 * 1024];
+	bool Success = true;
+	int64_t Read = 0;
+	while(unsigned ChunkSize = io_read(File, aChunk, sizeof(aChunk)))
+	{
+		if(Receive(aChunk, ChunkSize) != ChunkSize)
+		{
+			Success = false;
+			break;
+		}
+		Read += ChunkSize;
+		m_Current.store(Read, std::memory_order_relaxed);
+	}
+	io_close(File);
+	if(!Success || Read != Size)
+	{
+		m_FromCache = false;
+		return false;
+	}
+	m_Progress.store(100, std::memory_order_relaxed);
+	return true;
+}
+
+void CHttpRequest::WriteCache(const char *pData, size_t DataSize)
+{
+	// the body is written as it arrives, so it doesn't have to be kept
+	// around until the request is done
+	char aPath[IO_MAX_PATH_LENGTH];
+	str_format(aPath, sizeof(aPath), "%s.body.tmp", m_aCachePath);
+	if(!m_CacheFile)
+	{
+		if(fs_makedir_rec_for(aPath) < 0 || !(m_CacheFile = io_open(aPath, IOFLAG_WRITE)))
+		{
+			m_aCachePath[0] = '\0';
+			return;
+		}
+	}
+	if(io_write(m_CacheFile, pData, DataSize) != DataSize)
+	{
+		io_close(m_CacheFile);
+		m_CacheFile = nullptr;
+		fs_remove(aPath);
+		m_aCachePath[0] = '\0';
+	}
+}
+
+void CHttpRequest::StoreInCache()
+{
+	char aMetaPath[IO_MAX_PATH_LENGTH];
+	char aBodyPath[IO_MAX_PATH_LENGTH];
+	char aTmpPath[IO_MAX_PATH_LENGTH];
+	str_format(aMetaPath, sizeof(aMetaPath), "%s.meta", m_aCachePath);
+	str_format(aBodyPath, sizeof(aBodyPath), "%s.body", m_aCachePath);
+	str_format(aTmpPath, sizeof(aTmpPath), "%s.tmp", aBodyPath);
+
+	// empty bodies never opened the file
+	if(!m_CacheFile && fs_makedir_rec_for(aTmpPath) == 0)
+	{
+		m_CacheFile = io_open(aTmpPath, IOFLAG_WRITE);
+	}
+	const bool Written = m_CacheFile && io_close(m_CacheFile) == 0;
+	m_CacheFile = nullptr;
+	if(!Written || m_Type != REQUEST::GET || (m_aEtag[0] == '\0' && m_aLastModified[0] == '\0'))
+	{
+		fs_remove(aTmpPath);
+		return;
+	}
+
+	// the old validators must not be used with the new body
+	fs_remove(aMetaPath);
+	if(fs_rename(aTmpPath, aBodyPath) != 0)
+	{
+		fs_remove(aTmpPath);
+		return;
+	}
+
+	str_format(aTmpPath, sizeof(aTmpPath), "%s.tmp", aMetaPath);
+	IOHANDLE File = io_open(aTmpPath, IOFLAG_WRITE);
+	if(!File)
+	{
+		return;
+	}
+	char aLine[256];
+	if(m_aEtag[0] != '\0')
+	{
+		str_format(aLine, sizeof(aLine), "ETag: %s", m_aEtag);
+		io_write(File, aLine, str_length(aLine));
+		io_write_newline(File);
+	}
+	if(m_aLastModified[0] != '\0')
+	{
+		str_format(aLine, sizeof(aLine), "Last-Modified: %s", m_aLastModified);
+		io_write(File, aLine, str_length(aLine));
+		io_write_newline(File);
+	}
+	if(io_close(File) != 0 || fs_rename(aTmpPath, aMetaPath) != 0)
+	{
+		fs_remove(aTmpPath);
+	}
 }
 
 int CHttpRequest::ProgressCallback(void *pUser, double DlTotal, double DlCurr, double UlTotal, double UlCurr)
@@ -375,6 +857,21 @@ int CHttpRequest::OnCompletion(int State)
 			fs_remove(m_aDestAbsolute);
 		}
 	}
+	if(m_aCachePath[0] != '\0' && !m_FromCache)
+	{
+		if(State == HTTP_DONE)
+		{
+			StoreInCache();
+		}
+		else if(m_CacheFile)
+		{
+			io_close(m_CacheFile);
+			m_CacheFile = nullptr;
+			char aPath[IO_MAX_PATH_LENGTH];
+			str_format(aPath, sizeof(aPath), "%s.body.tmp", m_aCachePath);
+			fs_remove(aPath);
+		}
+	}
 	return State;
 }
 
@@ -392,6 +889,15 @@ void CHttpRequest::WriteToFile(IStorage *pStorage, const char *pDest, int Storag
 	}
 }
 
+void CHttpRequest::UseCache(IStorage *pStorage)
+{
+	char aSha256[SHA256_MAXSTRSIZE];
+	sha256_str(sha256(m_aUrl, str_length(m_aUrl)), aSha256, sizeof(aSha256));
+	char aPath[IO_MAX_PATH_LENGTH];
+	str_format(aPath, sizeof(aPath), "cache/http/%s", aSha256);
+	pStorage->GetCompletePath(IStorage::TYPE_SAVE, aPath, m_aCachePath, sizeof(m_aCachePath));
+}
+
 void CHttpRequest::Header(const char *pNameColonValue)
 {
 	m_pHeaders = curl_slist_append((curl_slist *)m_pHeaders, pNameColonValue);
@@ -406,7 +912,8 @@ void CHttpRequest::Result(unsigned char **ppResult, size_t *pResultLength) const
 		return;
 	}
 	*ppResult = m_pBuffer;
-	*pResultLength = m_ResponseLength;
+	// requests handling the data themselves don't keep it
+	*pResultLength = m_pBuffer ? m_ResponseLength : 0;
 }
 
 json_value *CHttpRequest::ResultJson() const
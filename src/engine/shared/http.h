@@ -3,7 +3,9 @@
 
 #include <algorithm>
 #include <atomic>
+#include <condition_variable>
 #include <engine/shared/jobs.h>
+#include <mutex>
 
 typedef struct _json_value json_value;
 class IStorage;
@@ -39,8 +41,14 @@ struct CTimeout
 	long LowSpeedTime;
 };
 
+// Requests are run by a single HTTP thread driving all transfers. Use
+// `HttpRun` to start a request without occupying a job pool thread. Running
+// the request as a job, e.g. via `IEngine::RunJobBlocking`, blocks that
+// thread until the request is done.
 class CHttpRequest : public IJob
 {
+	friend class CHttpRunner;
+
 	enum class REQUEST
 	{
 		GET = 0,
@@ -71,6 +79,15 @@ class CHttpRequest : public IJob
 	char m_aDestAbsolute[IO_MAX_PATH_LENGTH] = {0};
 	char m_aDest[IO_MAX_PATH_LENGTH] = {0};
 
+	// Absolute path of the cache entry without extension, empty if the
+	// response isn't cached. `.meta` holds the validators, `.body` the body.
+	char m_aCachePath[IO_MAX_PATH_LENGTH] = {0};
+	// validators of the response, from the cache if it was not modified
+	char m_aEtag[128] = {0};
+	char m_aLastModified[64] = {0};
+	bool m_FromCache = false;
+	IOHANDLE m_CacheFile = nullptr;
+
 	std::atomic<double> m_Size{0.0};
 	std::atomic<double> m_Current{0.0};
 	std::atomic<int> m_Progress{0};
@@ -80,19 +97,35 @@ class CHttpRequest : public IJob
 	std::atomic<int> m_State{HTTP_QUEUED};
 	std::atomic<bool> m_Abort{false};
 
+	char m_aErr[256];
+	std::mutex m_WaitLock;
+	std::condition_variable m_WaitCondition;
+	bool m_Completed = false;
+
 	void Run() override;
 	// Abort the request with an error if `BeforeInit()` returns false.
 	bool BeforeInit();
-	int RunImpl(void *pUser);
-
-	// Abort the request if `OnData()` returns something other than
-	// `DataSize`.
-	size_t OnData(char *pData, size_t DataSize);
+	bool ConfigureHandle(void *pHandle);
+	// returns the state for the result of the transfer
+	int OnTransferDone(void *pHandle, int Result);
+	bool ReadCacheMeta();
+	bool ServeFromCache();
+	void WriteCache(const char *pData, size_t DataSize);
+	void StoreInCache();
+	void Complete(int State, bool FinishJob);
+
+	// checks the response size and passes the data on to `OnData()`
+	size_t Receive(char *pData, size_t DataSize);
 
 	static int ProgressCallback(void *pUser, double DlTotal, double DlCurr, double UlTotal, double UlCurr);
 	static size_t WriteCallback(char *pData, size_t Size, size_t Number, void *pUser);
+	static size_t HeaderCallback(char *pData, size_t Size, size_t Number, void *pUser);
 
 protected:
+	// Receives the response body as it arrives. Abort the request if this
+	// returns something other than `DataSize`. Keeps the body in memory or
+	// writes it to the file by default.
+	virtual size_t OnData(char *pData, size_t DataSize);
 	virtual void OnProgress() {}
 	virtual int OnCompletion(int State);
 
@@ -105,6 +138,10 @@ public:
 	void LogProgress(HTTPLOG LogProgress) { m_LogProgress = LogProgress; }
 	void IpResolve(IPRESOLVE IpResolve) { m_IpResolve = IpResolve; }
 	void WriteToFile(IStorage *pStorage, const char *pDest, int StorageType);
+	// Keeps the body of GET responses with an ETag or Last-Modified header
+	// in the cache directory and revalidates it on the next request. If
+	// the server answers 304 Not Modified, the cached body is used.
+	void UseCache(IStorage *pStorage);
 	void Head() { m_Type = REQUEST::HEAD; }
 	void Post(const unsigned char *pData, size_t DataLength)
 	{
@@ -146,11 +183,16 @@ public:
 		}
 	}
 
+	const char *Url() const { return m_aUrl; }
 	double Current() const { return m_Current.load(std::memory_order_relaxed); }
 	double Size() const { return m_Size.load(std::memory_order_relaxed); }
 	int Progress() const { return m_Progress.load(std::memory_order_relaxed); }
 	int State() const { return m_State; }
+	// whether the body was served from the cache
+	bool FromCache() const { return m_FromCache; }
 	void Abort() { m_Abort = true; }
+	// blocks until the request is done, aborted or failed
+	void Wait();
 
 	void Result(unsigned char **ppResult, size_t *pResultLength) const;
 	json_value *ResultJson() const;
@@ -193,6 +235,10 @@ inline std::unique_ptr<CHttpRequest> HttpPostJson(const char *pUrl, const char *
 }
 
 bool HttpInit(IStorage *pStorage);
+// Requests still running after `TimeoutMs` are aborted, requests started
+// after the shutdown are aborted immediately until `HttpInit` is called again.
+void HttpShutdown(int TimeoutMs);
+void HttpRun(std::shared_ptr<CHttpRequest> pRequest);
 void EscapeUrl(char *pBuf, int Size, const char *pStr);
 bool HttpHasIpresolveBug();
 #endif // ENGINE_SHARED_HTTP_H
@@ -2,10 +2,14 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include "jobs.h"
 
-#include <base/lock_scope.h>
+thread_local CJobPool::CWorker *CJobPool::ms_pCurrentWorker = nullptr;
 
 IJob::IJob() :
-	m_Status(STATE_PENDING)
+	m_Status(STATE_PENDING),
+	m_Priority(PRIORITY_NORMAL),
+	m_QueueTime(0),
+	m_NumPendingDependencies(1),
+	m_pPool(nullptr)
 {
 }
 
@@ -16,15 +20,57 @@ int IJob::Status()
 	return m_Status.load();
 }
 
+void IJob::SetPriority(int Priority)
+{
+	dbg_assert(Priority >= 0 && Priority < NUM_PRIORITIES, "invalid job priority");
+	dbg_assert(m_pPool == nullptr, "job priority set after adding the job");
+	m_Priority = Priority;
+}
+
+void IJob::AddDependency(std::shared_ptr<IJob> pJob)
+{
+	dbg_assert(m_pPool == nullptr, "job dependency added after adding the job");
+	m_vpDependencies.push_back(std::move(pJob));
+}
+
+bool IJob::AddDependent(const std::shared_ptr<IJob> &pJob)
+{
+	std::lock_guard<std::mutex> Lock(m_DependentsLock);
+	if(m_Status == STATE_DONE)
+		return false;
+	m_vpDependents.push_back(pJob);
+	return true;
+}
+
+void IJob::Finish()
+{
+	std::vector<std::shared_ptr<IJob>> vpDependents;
+	{
+		std::lock_guard<std::mutex> Lock(m_DependentsLock);
+		m_Status = STATE_DONE;
+		std::swap(vpDependents, m_vpDependents);
+	}
+	for(auto &pDependent : vpDependents)
+	{
+		if(pDependent->m_NumPendingDependencies.fetch_sub(1) == 1)
+			pDependent->m_pPool->Queue(std::move(pDependent));
+	}
+}
+
 CJobPool::CJobPool()
 {
 	// empty the pool
 	m_NumThreads = 0;
 	m_Shutdown = false;
-	m_Lock = lock_create();
-	sphore_init(&m_Semaphore);
-	m_pFirstJob = 0;
-	m_pLastJob = 0;
+	m_NextWorker = 0;
+	for(auto &NumQueued : m_aNumQueued)
+		NumQueued = 0;
+	for(int i = 0; i < MAX_THREADS; i++)
+	{
+		m_aWorkers[i].m_pPool = this;
+		m_aWorkers[i].m_Index = i;
+		m_aWorkers[i].m_pThread = nullptr;
+	}
 }
 
 CJobPool::~CJobPool()
@@ -37,75 +83,146 @@ CJobPool::~CJobPool()
 
 void CJobPool::WorkerThread(void *pUser)
 {
-	CJobPool *pPool = (CJobPool *)pUser;
+	CWorker *pWorker = (CWorker *)pUser;
+	CJobPool *pPool = pWorker->m_pPool;
+	ms_pCurrentWorker = pWorker;
 
-	while(!pPool->m_Shutdown)
+	while(true)
 	{
-		std::shared_ptr<IJob> pJob = 0;
+		pPool->m_NumQueued.Wait();
+		if(pPool->m_Shutdown)
+			break;
 
-		// fetch job from queue
-		sphore_wait(&pPool->m_Semaphore);
+		std::shared_ptr<IJob> pJob = pPool->Take(pWorker);
+		if(pJob)
 		{
-			CLockScope ls(pPool->m_Lock);
-			if(pPool->m_pFirstJob)
-			{
-				pJob = pPool->m_pFirstJob;
-				pPool->m_pFirstJob = pPool->m_pFirstJob->m_pNext;
-				// allow remaining objects in list to destruct, even when current object stays alive
-				pJob->m_pNext = nullptr;
-				if(!pPool->m_pFirstJob)
-					pPool->m_pLastJob = 0;
-			}
+			RunBlocking(pJob.get());
 		}
+	}
+}
 
-		// do the job if we have one
-		if(pJob)
+std::shared_ptr<IJob> CJobPool::Take(CWorker *pWorker)
+{
+	for(int Priority = IJob::NUM_PRIORITIES - 1; Priority >= 0; Priority--)
+	{
+		if(m_aNumQueued[Priority] == 0)
+			continue;
+
+		// own queue first, then steal starting at the next worker
+		for(int i = 0; i < m_NumThreads; i++)
 		{
-			RunBlocking(pJob.get());
+			CWorker *pVictim = &m_aWorkers[(pWorker->m_Index + i) % m_NumThreads];
+			std::shared_ptr<IJob> pJob;
+			{
+				std::lock_guard<std::mutex> Lock(pVictim->m_Lock);
+				std::deque<std::shared_ptr<IJob>> &Queue = pVictim->m_aQueues[Priority];
+				if(Queue.empty())
+					continue;
+				pJob = std::move(Queue.front());
+				Queue.pop_front();
+			}
+			m_aNumQueued[Priority]--;
+
+			CAtomicStats &Stats = m_aStats[Priority];
+			const int64_t Latency = (time_get() - pJob->m_QueueTime) * 1000000 / time_freq();
+			Stats.m_NumJobs++;
+			if(pVictim != pWorker)
+				Stats.m_NumStolen++;
+			Stats.m_TotalLatency += Latency;
+			int64_t MaxLatency = Stats.m_MaxLatency;
+			while(Latency > MaxLatency && !Stats.m_MaxLatency.compare_exchange_weak(MaxLatency, Latency))
+			{
+			}
+			return pJob;
 		}
 	}
+	return nullptr;
 }
 
 void CJobPool::Init(int NumThreads)
 {
 	// start threads
-	m_NumThreads = NumThreads > MAX_THREADS ? MAX_THREADS : NumThreads;
-	for(int i = 0; i < NumThreads; i++)
-		m_apThreads[i] = thread_init(WorkerThread, this, "CJobPool worker");
+	m_NumThreads = clamp(NumThreads, 1, (int)MAX_THREADS);
+	for(int i = 0; i < m_NumThreads; i++)
+		m_aWorkers[i].m_pThread = thread_init(WorkerThread, &m_aWorkers[i], "CJobPool worker");
 }
 
 void CJobPool::Destroy()
 {
 	m_Shutdown = true;
 	for(int i = 0; i < m_NumThreads; i++)
-		sphore_signal(&m_Semaphore);
+		m_NumQueued.Signal();
 	for(int i = 0; i < m_NumThreads; i++)
 	{
-		if(m_apThreads[i])
-			thread_wait(m_apThreads[i]);
+		if(m_aWorkers[i].m_pThread)
+			thread_wait(m_aWorkers[i].m_pThread);
+		m_aWorkers[i].m_pThread = nullptr;
 	}
-	lock_destroy(m_Lock);
-	sphore_destroy(&m_Semaphore);
+
+	// jobs that haven't started are dropped
+	for(int i = 0; i < m_NumThreads; i++)
+	{
+		std::lock_guard<std::mutex> Lock(m_aWorkers[i].m_Lock);
+		for(auto &Queue : m_aWorkers[i].m_aQueues)
+			Queue.clear();
+	}
+}
+
+void CJobPool::Queue(std::shared_ptr<IJob> pJob)
+{
+	if(m_Shutdown)
+		return;
+
+	// stay on the current worker for jobs added by jobs of this pool
+	CWorker *pWorker = ms_pCurrentWorker;
+	if(!pWorker || pWorker->m_pPool != this)
+		pWorker = &m_aWorkers[m_NextWorker++ % m_NumThreads];
+
+	const int Priority = pJob->m_Priority;
+	pJob->m_QueueTime = time_get();
+	{
+		std::lock_guard<std::mutex> Lock(pWorker->m_Lock);
+		pWorker->m_aQueues[Priority].push_back(std::move(pJob));
+	}
+	m_aNumQueued[Priority]++;
+	m_NumQueued.Signal();
 }
 
 void CJobPool::Add(std::shared_ptr<IJob> pJob)
 {
+	dbg_assert(pJob->m_pPool == nullptr, "job added twice");
+	dbg_assert(m_NumThreads > 0, "job added before initializing the pool");
+	pJob->m_pPool = this;
+
+	std::vector<std::shared_ptr<IJob>> vpDependencies;
+	std::swap(vpDependencies, pJob->m_vpDependencies);
+	pJob->m_NumPendingDependencies += vpDependencies.size();
+	for(auto &pDependency : vpDependencies)
 	{
-		CLockScope ls(m_Lock);
-		// add job to queue
-		if(m_pLastJob)
-			m_pLastJob->m_pNext = pJob;
-		m_pLastJob = std::move(pJob);
-		if(!m_pFirstJob)
-			m_pFirstJob = m_pLastJob;
+		if(!pDependency->AddDependent(pJob))
+			pJob->m_NumPendingDependencies--;
 	}
 
-	sphore_signal(&m_Semaphore);
+	// release the count held while registering the dependencies
+	if(pJob->m_NumPendingDependencies.fetch_sub(1) == 1)
+		Queue(std::move(pJob));
 }
 
 void CJobPool::RunBlocking(IJob *pJob)
 {
 	pJob->m_Status = IJob::STATE_RUNNING;
 	pJob->Run();
-	pJob->m_Status = IJob::STATE_DONE;
+	pJob->Finish();
+}
+
+CJobPool::CStats CJobPool::Stats(int Priority) const
+{
+	dbg_assert(Priority >= 0 && Priority < IJob::NUM_PRIORITIES, "invalid job priority");
+	const CAtomicStats &Stats = m_aStats[Priority];
+	CStats Result;
+	Result.m_NumJobs = Stats.m_NumJobs;
+	Result.m_NumStolen = Stats.m_NumStolen;
+	Result.m_TotalLatency = Stats.m_TotalLatency;
+	Result.m_MaxLatency = Stats.m_MaxLatency;
+	return Result;
 }
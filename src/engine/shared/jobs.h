@@ -3,10 +3,15 @@
 #ifndef ENGINE_SHARED_JOBS_H
 #define ENGINE_SHARED_JOBS_H
 
+#include <base/math.h>
 #include <base/system.h>
+#include <base/tl/threading.h>
 
 #include <atomic>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 class CJobPool;
 
@@ -15,10 +20,29 @@ class IJob
 	friend CJobPool;
 
 private:
-	std::shared_ptr<IJob> m_pNext;
-
 	std::atomic<int> m_Status;
+	int m_Priority;
+	int64_t m_QueueTime;
+
+	// jobs that have to be done before this one runs, until it is added
+	std::vector<std::shared_ptr<IJob>> m_vpDependencies;
+	// unfinished dependencies, plus one until the job is added to a pool
+	std::atomic<int> m_NumPendingDependencies;
+	CJobPool *m_pPool;
+
+	// jobs waiting for this one, queued when it is done
+	std::mutex m_DependentsLock;
+	std::vector<std::shared_ptr<IJob>> m_vpDependents;
+
 	virtual void Run() = 0;
+	// returns false if this job is already done
+	bool AddDependent(const std::shared_ptr<IJob> &pJob);
+
+protected:
+	// For jobs that are run outside of a pool, like HTTP requests. Finishing
+	// the job queues the jobs depending on it.
+	void MarkRunning() { m_Status = STATE_RUNNING; }
+	void Finish();
 
 public:
 	IJob();
@@ -33,24 +57,80 @@ public:
 		STATE_RUNNING,
 		STATE_DONE
 	};
+
+	enum
+	{
+		PRIORITY_LOW = 0,
+		PRIORITY_NORMAL,
+		PRIORITY_HIGH,
+		NUM_PRIORITIES
+	};
+
+	// has to be set before the job is added
+	int Priority() const { return m_Priority; }
+	void SetPriority(int Priority);
+	// The job is only queued once `pJob` is done. The dependency has to be
+	// added to a pool as well, otherwise this job never runs.
+	void AddDependency(std::shared_ptr<IJob> pJob);
 };
 
+// Each worker has its own queue per priority. Jobs added from a worker go to
+// its own queue, others are spread over the workers. Idle workers steal from
+// the queues of the others, always taking the highest priority job first.
 class CJobPool
 {
+	friend IJob;
+
+public:
+	struct CStats
+	{
+		int64_t m_NumJobs;
+		int64_t m_NumStolen;
+		// time between being queued and starting to run, in microseconds
+		int64_t m_TotalLatency;
+		int64_t m_MaxLatency;
+	};
+
+private:
 	enum
 	{
 		MAX_THREADS = 32
 	};
+
+	struct CWorker
+	{
+		CJobPool *m_pPool;
+		int m_Index;
+		void *m_pThread;
+		std::mutex m_Lock;
+		std::deque<std::shared_ptr<IJob>> m_aQueues[IJob::NUM_PRIORITIES];
+	};
+
+	struct CAtomicStats
+	{
+		std::atomic<int64_t> m_NumJobs{0};
+		std::atomic<int64_t> m_NumStolen{0};
+		std::atomic<int64_t> m_TotalLatency{0};
+		std::atomic<int64_t> m_MaxLatency{0};
+	};
+
+	// the worker the current thread belongs to, if any
+	static thread_local CWorker *ms_pCurrentWorker;
+
 	int m_NumThreads;
-	void *m_apThreads[MAX_THREADS];
+	CWorker m_aWorkers[MAX_THREADS];
 	std::atomic<bool> m_Shutdown;
+	std::atomic<unsigned> m_NextWorker;
 
-	LOCK m_Lock;
-	SEMAPHORE m_Semaphore;
-	std::shared_ptr<IJob> m_pFirstJob GUARDED_BY(m_Lock);
-	std::shared_ptr<IJob> m_pLastJob GUARDED_BY(m_Lock);
+	// one signal per queued job, workers can find fewer jobs than signals
+	// as jobs are taken by whichever worker gets to them first
+	CSemaphore m_NumQueued;
+	std::atomic<int> m_aNumQueued[IJob::NUM_PRIORITIES];
+	CAtomicStats m_aStats[IJob::NUM_PRIORITIES];
 
-	static void WorkerThread(void *pUser) NO_THREAD_SAFETY_ANALYSIS;
+	static void WorkerThread(void *pUser);
+	void Queue(std::shared_ptr<IJob> pJob);
+	std::shared_ptr<IJob> Take(CWorker *pWorker);
 
 public:
 	CJobPool();
@@ -58,7 +138,10 @@ public:
 
 	void Init(int NumThreads);
 	void Destroy();
-	void Add(std::shared_ptr<IJob> pJob) REQUIRES(!m_Lock);
+	void Add(std::shared_ptr<IJob> pJob);
 	static void RunBlocking(IJob *pJob);
+
+	int NumThreads() const { return m_NumThreads; }
+	CStats Stats(int Priority) const;
 };
 #endif
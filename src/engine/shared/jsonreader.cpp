@@ -0,0 +1,332 @@
+#include "jsonreader.h"
+
+#include <cstdlib>
+
+static bool IsDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static int HexValue(char c)
+{
+	if(c >= '0' && c <= '9')
+		return c - '0';
+	if(c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if(c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+bool CJsonReader::BeginValue(char c)
+{
+	switch(c)
+	{
+	case '{':
+		if(m_vStack.size() >= MAX_DEPTH)
+			return true;
+		m_vStack.push_back('{');
+		m_State = STATE_KEY_OR_END;
+		return OnBeginObject();
+	case '[':
+		if(m_vStack.size() >= MAX_DEPTH)
+			return true;
+		m_vStack.push_back('[');
+		m_State = STATE_VALUE_OR_END;
+		return OnBeginArray();
+	case '"':
+		m_Token.clear();
+		m_StringIsKey = false;
+		m_State = STATE_STRING;
+		return false;
+	case 't':
+	case 'f':
+	case 'n':
+		m_pLiteral = c == 't' ? "true" : c == 'f' ? "false" : "null";
+		m_Token.assign(1, c);
+		m_State = STATE_LITERAL;
+		return false;
+	default:
+		if(c != '-' && !IsDigit(c))
+			return true;
+		m_Token.assign(1, c);
+		m_State = STATE_NUMBER;
+		return false;
+	}
+}
+
+bool CJsonReader::EndValue()
+{
+	m_State = m_vStack.empty() ? STATE_DONE : STATE_COMMA_OR_END;
+	return false;
+}
+
+bool CJsonReader::ReadEscape(char c)
+{
+	if(m_EscapeState == 1)
+	{
+		m_EscapeState = 0;
+		switch(c)
+		{
+		case '"': m_Token.push_back('"'); return false;
+		case '\\': m_Token.push_back('\\'); return false;
+		case '/': m_Token.push_back('/'); return false;
+		case 'b': m_Token.push_back('\b'); return false;
+		case 'f': m_Token.push_back('\f'); return false;
+		case 'n': m_Token.push_back('\n'); return false;
+		case 'r': m_Token.push_back('\r'); return false;
+		case 't': m_Token.push_back('\t'); return false;
+		case 'u':
+			m_Codepoint = 0;
+			m_EscapeState = 2;
+			return false;
+		default: return true;
+		}
+	}
+	else if(m_EscapeState == 6 || m_EscapeState == 7)
+	{
+		// a high surrogate has to be followed by the low one
+		if(c != (m_EscapeState == 6 ? '\\' : 'u'))
+			return true;
+		m_Codepoint = 0;
+		m_EscapeState = m_EscapeState == 6 ? 7 : 2;
+		return false;
+	}
+
+	// one of the four hex digits of \uXXXX
+	const int Value = HexValue(c);
+	if(Value < 0)
+		return true;
+	m_Codepoint = (m_Codepoint << 4) | Value;
+	if(++m_EscapeState < 6)
+		return false;
+
+	const bool LowSurrogate = (m_Codepoint & 0xFC00) == 0xDC00;
+	if(m_HighSurrogate)
+	{
+		if(!LowSurrogate)
+			return true;
+		m_Codepoint = 0x10000 | ((m_HighSurrogate & 0x3FF) << 10) | (m_Codepoint & 0x3FF);
+		m_HighSurrogate = 0;
+	}
+	else if(LowSurrogate)
+	{
+		// a low surrogate without a high one before it
+		return true;
+	}
+	else if((m_Codepoint & 0xFC00) == 0xD800)
+	{
+		m_HighSurrogate = m_Codepoint;
+		return false;
+	}
+	char aEncoded[4];
+	m_Token.append(aEncoded, str_utf8_encode(aEncoded, m_Codepoint));
+	m_EscapeState = 0;
+	return false;
+}
+
+bool CJsonReader::ReadString(const char **ppData, const char *pEnd)
+{
+	const char *pData = *ppData;
+	while(pData < pEnd)
+	{
+		if(m_EscapeState)
+		{
+			if(ReadEscape(*pData++))
+				return true;
+			continue;
+		}
+
+		// copy everything up to the next escape or the end in one go
+		const char *pStart = pData;
+		while(pData < pEnd && *pData != '"' && *pData != '\\')
+			pData++;
+		m_Token.append(pStart, pData - pStart);
+		if(pData == pEnd)
+			break;
+		if(*pData++ == '\\')
+		{
+			m_EscapeState = 1;
+			continue;
+		}
+
+		*ppData = pData;
+		if(m_StringIsKey)
+		{
+			m_State = STATE_COLON;
+			return OnKey(m_Token.c_str());
+		}
+		EndValue();
+		return OnString(m_Token.c_str());
+	}
+	*ppData = pData;
+	return false;
+}
+
+bool CJsonReader::EndNumber()
+{
+	// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+	const char *p = m_Token.c_str();
+	if(*p == '-')
+		p++;
+	if(*p == '0')
+		p++;
+	else if(IsDigit(*p))
+		while(IsDigit(*p))
+			p++;
+	else
+		return true;
+	bool Integer = true;
+	if(*p == '.')
+	{
+		Integer = false;
+		p++;
+		if(!IsDigit(*p))
+			return true;
+		while(IsDigit(*p))
+			p++;
+	}
+	if(*p == 'e' || *p == 'E')
+	{
+		Integer = false;
+		p++;
+		if(*p == '+' || *p == '-')
+			p++;
+		if(!IsDigit(*p))
+			return true;
+		while(IsDigit(*p))
+			p++;
+	}
+	if(*p != '\0')
+		return true;
+
+	EndValue();
+	if(Integer)
+		return OnInt(str_toint64_base(m_Token.c_str()));
+	return OnDouble(strtod(m_Token.c_str(), nullptr));
+}
+
+bool CJsonReader::EndLiteral()
+{
+	EndValue();
+	if(m_pLiteral[0] == 'n')
+		return OnNull();
+	return OnBool(m_pLiteral[0] == 't');
+}
+
+bool CJsonReader::Feed(const char *pData, size_t DataSize)
+{
+	const char *pEnd = pData + DataSize;
+	while(pData < pEnd && m_State != STATE_ERROR)
+	{
+		bool Error = false;
+		if(m_State == STATE_STRING)
+		{
+			if(ReadString(&pData, pEnd))
+				m_State = STATE_ERROR;
+			continue;
+		}
+
+		const char c = *pData++;
+		if(m_State == STATE_NUMBER)
+		{
+			if(IsDigit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')
+			{
+				m_Token.push_back(c);
+				continue;
+			}
+			// the character after the number is read again in the new state
+			pData--;
+			if(EndNumber())
+				m_State = STATE_ERROR;
+			continue;
+		}
+		else if(m_State == STATE_LITERAL)
+		{
+			if(c != m_pLiteral[m_Token.size()])
+			{
+				m_State = STATE_ERROR;
+				continue;
+			}
+			m_Token.push_back(c);
+			if(m_pLiteral[m_Token.size()] == '\0' && EndLiteral())
+				m_State = STATE_ERROR;
+			continue;
+		}
+
+		if(c == ' ' || c == '\t' || c == '\n' || c == '\r')
+		{
+			continue;
+		}
+
+		switch(m_State)
+		{
+		case STATE_VALUE:
+			Error = BeginValue(c);
+			break;
+		case STATE_VALUE_OR_END:
+			if(c == ']')
+			{
+				m_vStack.pop_back();
+				EndValue();
+				Error = OnEndArray();
+			}
+			else
+			{
+				Error = BeginValue(c);
+			}
+			break;
+		case STATE_KEY_OR_END:
+			if(c == '}')
+			{
+				m_vStack.pop_back();
+				EndValue();
+				Error = OnEndObject();
+				break;
+			}
+			[[fallthrough]];
+		case STATE_KEY:
+			Error = c != '"';
+			m_Token.clear();
+			m_StringIsKey = true;
+			m_State = STATE_STRING;
+			break;
+		case STATE_COLON:
+			Error = c != ':';
+			m_State = STATE_VALUE;
+			break;
+		case STATE_COMMA_OR_END:
+			if(c == ',')
+			{
+				m_State = m_vStack.back() == '{' ? STATE_KEY : STATE_VALUE;
+			}
+			else if(c == (m_vStack.back() == '{' ? '}' : ']'))
+			{
+				const bool Object = m_vStack.back() == '{';
+				m_vStack.pop_back();
+				EndValue();
+				Error = Object ? OnEndObject() : OnEndArray();
+			}
+			else
+			{
+				Error = true;
+			}
+			break;
+		default:
+			// nothing may follow the document
+			Error = true;
+			break;
+		}
+		if(Error)
+			m_State = STATE_ERROR;
+	}
+	return m_State == STATE_ERROR;
+}
+
+bool CJsonReader::Finish()
+{
+	// numbers at the top level only end with the input
+	if(m_State == STATE_NUMBER && m_vStack.empty() && EndNumber())
+		m_State = STATE_ERROR;
+	return m_State != STATE_DONE;
+}
@@ -0,0 +1,83 @@
+#ifndef ENGINE_SHARED_JSONREADER_H
+#define ENGINE_SHARED_JSONREADER_H
+
+#include <base/system.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * Event based JSON reader that parses the input as it arrives, in chunks of
+ * any size, without building a document in memory.
+ *
+ * The `On*` functions are called for every element in document order and
+ * abort parsing with an error if they return true.
+ */
+class CJsonReader
+{
+	enum EState
+	{
+		STATE_VALUE,
+		STATE_VALUE_OR_END,
+		STATE_KEY,
+		STATE_KEY_OR_END,
+		STATE_COLON,
+		STATE_COMMA_OR_END,
+		STATE_STRING,
+		STATE_NUMBER,
+		STATE_LITERAL,
+		STATE_DONE,
+		STATE_ERROR,
+	};
+
+	enum
+	{
+		MAX_DEPTH = 64,
+	};
+
+	EState m_State = STATE_VALUE;
+	// '{' or '[' for every open container
+	std::vector<char> m_vStack;
+
+	// string, number or literal that is being read
+	std::string m_Token;
+	bool m_StringIsKey = false;
+	// position in the escape sequence of the string, 0 if there is none
+	int m_EscapeState = 0;
+	unsigned m_Codepoint = 0;
+	unsigned m_HighSurrogate = 0;
+	const char *m_pLiteral = nullptr;
+
+	bool BeginValue(char c);
+	bool EndValue();
+	bool ReadString(const char **ppData, const char *pEnd);
+	bool ReadEscape(char c);
+	bool EndNumber();
+	bool EndLiteral();
+
+protected:
+	virtual bool OnBeginObject() = 0;
+	virtual bool OnEndObject() = 0;
+	virtual bool OnBeginArray() = 0;
+	virtual bool OnEndArray() = 0;
+	// `pKey` and `pValue` are null-terminated and only valid during the call
+	virtual bool OnKey(const char *pKey) = 0;
+	virtual bool OnString(const char *pValue) = 0;
+	virtual bool OnInt(int64_t Value) = 0;
+	virtual bool OnDouble(double Value) = 0;
+	virtual bool OnBool(bool Value) = 0;
+	virtual bool OnNull() = 0;
+
+public:
+	virtual ~CJsonReader() = default;
+
+	// Returns true on syntax errors or if a handler aborted parsing. Nothing
+	// is parsed after an error.
+	bool Feed(const char *pData, size_t DataSize);
+	// Returns true if the input ended before the document was complete.
+	bool Finish();
+	// number of open objects and arrays
+	int Depth() const { return m_vStack.size(); }
+};
+
+#endif
@@ -4,47 +4,255 @@
 #include <engine/shared/config.h>
 #include <engine/storage.h>
 
+#include "linereader.h"
 #include "netban.h"
 
-CNetBan::CNetHash::CNetHash(const NETADDR *pAddr)
+#include <algorithm>
+
+static int AddrBits(const NETADDR *pAddr)
+{
+	return pAddr->type == NETTYPE_IPV4 ? 32 : 128;
+}
+
+static int GetBit(const unsigned char *pBits, int Index)
+{
+	return (pBits[Index / 8] >> (7 - Index % 8)) & 1;
+}
+
+// number of leading bits the prefixes have in common, at most `Length`
+static int CommonBits(const unsigned char *pA, const unsigned char *pB, int Length)
+{
+	int Bits = 0;
+	while(Bits < Length && pA[Bits / 8] == pB[Bits / 8])
+		Bits += 8;
+	while(Bits < Length && GetBit(pA, Bits) == GetBit(pB, Bits))
+		Bits++;
+	return minimum(Bits, Length);
+}
+
+template<class T>
+int CNetBan::CPrefixTrie<T>::NewNode(const unsigned char *pPrefix, int Length)
 {
-	if(pAddr->type == NETTYPE_IPV4)
-		m_Hash = (pAddr->ip[0] + pAddr->ip[1] + pAddr->ip[2] + pAddr->ip[3]) & 0xFF;
+	int Node;
+	if(m_vFreeNodes.empty())
+	{
+		Node = m_vNodes.size();
+		m_vNodes.emplace_back();
+	}
 	else
-		m_Hash = (pAddr->ip[0] + pAddr->ip[1] + pAddr->ip[2] + pAddr->ip[3] + pAddr->ip[4] + pAddr->ip[5] + pAddr->ip[6] + pAddr->ip[7] +
-				 pAddr->ip[8] + pAddr->ip[9] + pAddr->ip[10] + pAddr->ip[11] + pAddr->ip[12] + pAddr->ip[13] + pAddr->ip[14] + pAddr->ip[15]) &
-			 0xFF;
-	m_HashIndex = 0;
+	{
+		Node = m_vFreeNodes.back();
+		m_vFreeNodes.pop_back();
+	}
+	CNode &NewNode = m_vNodes[Node];
+	mem_copy(NewNode.m_aPrefix, pPrefix, sizeof(NewNode.m_aPrefix));
+	NewNode.m_Length = Length;
+	NewNode.m_aChildren[0] = NewNode.m_aChildren[1] = -1;
+	NewNode.m_vpValues.clear();
+	return Node;
 }
 
-CNetBan::CNetHash::CNetHash(const CNetRange *pRange)
+template<class T>
+void CNetBan::CPrefixTrie<T>::FreeNode(int Node)
 {
-	m_Hash = 0;
-	m_HashIndex = 0;
-	for(int i = 0; pRange->m_LB.ip[i] == pRange->m_UB.ip[i]; ++i)
+	m_vNodes[Node].m_vpValues.clear();
+	m_vNodes[Node].m_vpValues.shrink_to_fit();
+	m_vFreeNodes.push_back(Node);
+}
+
+template<class T>
+int CNetBan::CPrefixTrie<T>::Insert(int Node, const unsigned char *pPrefix, int Length, T *pValue)
+{
+	if(Node == -1)
+	{
+		Node = NewNode(pPrefix, Length);
+		m_vNodes[Node].m_vpValues.push_back(pValue);
+		return Node;
+	}
+
+	const int NodeLength = m_vNodes[Node].m_Length;
+	const int Common = CommonBits(m_vNodes[Node].m_aPrefix, pPrefix, minimum(NodeLength, Length));
+	if(Common == NodeLength)
 	{
-		m_Hash += pRange->m_LB.ip[i];
-		++m_HashIndex;
+		if(Length == NodeLength)
+		{
+			m_vNodes[Node].m_vpValues.push_back(pValue);
+		}
+		else
+		{
+			const int Bit = GetBit(pPrefix, NodeLength);
+			const int Child = Insert(m_vNodes[Node].m_aChildren[Bit], pPrefix, Length, pValue);
+			m_vNodes[Node].m_aChildren[Bit] = Child;
+		}
+		return Node;
+	}
+
+	// split the edge to the node at the first differing bit
+	int Parent;
+	if(Common == Length)
+	{
+		Parent = NewNode(pPrefix, Length);
+		m_vNodes[Parent].m_vpValues.push_back(pValue);
+	}
+	else
+	{
+		Parent = NewNode(pPrefix, Common);
+		const int Leaf = Insert(-1, pPrefix, Length, pValue);
+		m_vNodes[Parent].m_aChildren[GetBit(pPrefix, Common)] = Leaf;
 	}
-	m_Hash &= 0xFF;
+	m_vNodes[Parent].m_aChildren[GetBit(m_vNodes[Node].m_aPrefix, Common)] = Node;
+	return Parent;
 }
 
-int CNetBan::CNetHash::MakeHashArray(const NETADDR *pAddr, CNetHash aHash[17])
+template<class T>
+int CNetBan::CPrefixTrie<T>::Remove(int Node, const unsigned char *pPrefix, int Length, T *pValue)
 {
-	int Length = pAddr->type == NETTYPE_IPV4 ? 4 : 16;
-	aHash[0].m_Hash = 0;
-	aHash[0].m_HashIndex = 0;
-	for(int i = 1, Sum = 0; i <= Length; ++i)
+	dbg_assert(Node != -1, "prefix missing from trie");
+	CNode *pNode = &m_vNodes[Node];
+	if(pNode->m_Length == Length)
 	{
-		Sum += pAddr->ip[i - 1];
-		aHash[i].m_Hash = Sum & 0xFF;
-		aHash[i].m_HashIndex = i % Length;
+		auto Value = std::find(pNode->m_vpValues.begin(), pNode->m_vpValues.end(), pValue);
+		dbg_assert(Value != pNode->m_vpValues.end(), "value missing from trie");
+		pNode->m_vpValues.erase(Value);
 	}
-	return Length;
+	else
+	{
+		const int Bit = GetBit(pPrefix, pNode->m_Length);
+		const int Child = Remove(pNode->m_aChildren[Bit], pPrefix, Length, pValue);
+		pNode = &m_vNodes[Node];
+		pNode->m_aChildren[Bit] = Child;
+	}
+
+	// keep the trie compressed, nodes without values need two children
+	if(!pNode->m_vpValues.empty() || (pNode->m_aChildren[0] != -1 && pNode->m_aChildren[1] != -1))
+		return Node;
+	const int Child = pNode->m_aChildren[0] != -1 ? pNode->m_aChildren[0] : pNode->m_aChildren[1];
+	FreeNode(Node);
+	return Child;
 }
 
-template<class T, int HashCount>
-void CNetBan::CBanPool<T, HashCount>::InsertUsed(CBan<T> *pBan)
+template<class T>
+void CNetBan::CPrefixTrie<T>::Insert(const NETADDR *pPrefix, int Length, T *pValue)
+{
+	int &Root = m_aRoots[pPrefix->type == NETTYPE_IPV4 ? 0 : 1];
+	Root = Insert(Root, pPrefix->ip, Length, pValue);
+}
+
+template<class T>
+void CNetBan::CPrefixTrie<T>::Remove(const NETADDR *pPrefix, int Length, T *pValue)
+{
+	int &Root = m_aRoots[pPrefix->type == NETTYPE_IPV4 ? 0 : 1];
+	Root = Remove(Root, pPrefix->ip, Length, pValue);
+}
+
+template<class T>
+void CNetBan::CPrefixTrie<T>::Reset()
+{
+	m_vNodes.clear();
+	m_vNodes.shrink_to_fit();
+	m_vFreeNodes.clear();
+	m_vFreeNodes.shrink_to_fit();
+	m_aRoots[0] = m_aRoots[1] = -1;
+}
+
+template<class T>
+const std::vector<T *> *CNetBan::CPrefixTrie<T>::Find(const NETADDR *pPrefix, int Length) const
+{
+	int Node = m_aRoots[pPrefix->type == NETTYPE_IPV4 ? 0 : 1];
+	while(Node != -1)
+	{
+		const CNode &Current = m_vNodes[Node];
+		if(Current.m_Length > Length || CommonBits(Current.m_aPrefix, pPrefix->ip, Current.m_Length) != Current.m_Length)
+			break;
+		if(Current.m_Length == Length)
+			return &Current.m_vpValues;
+		Node = Current.m_aChildren[GetBit(pPrefix->ip, Current.m_Length)];
+	}
+	return nullptr;
+}
+
+template<class T>
+T *CNetBan::CPrefixTrie<T>::Match(const NETADDR *pAddr) const
+{
+	const int Bits = AddrBits(pAddr);
+	T *pMatch = nullptr;
+	int Node = m_aRoots[pAddr->type == NETTYPE_IPV4 ? 0 : 1];
+	while(Node != -1)
+	{
+		const CNode &Current = m_vNodes[Node];
+		if(CommonBits(Current.m_aPrefix, pAddr->ip, Current.m_Length) != Current.m_Length)
+			break;
+		if(!Current.m_vpValues.empty())
+			pMatch = Current.m_vpValues.back();
+		if(Current.m_Length == Bits)
+			break;
+		Node = Current.m_aChildren[GetBit(pAddr->ip, Current.m_Length)];
+	}
+	return pMatch;
+}
+
+template<class T>
+size_t CNetBan::CPrefixTrie<T>::MemoryUsage() const
+{
+	size_t Size = m_vNodes.capacity() * sizeof(CNode) + m_vFreeNodes.capacity() * sizeof(int);
+	for(const CNode &Node : m_vNodes)
+		Size += Node.m_vpValues.capacity() * sizeof(T *);
+	return Size;
+}
+
+// Calls `Function(Prefix, Length)` for the prefixes that exactly cover the
+// range, at most two per bit.
+template<typename F>
+static void ForEachRangePrefix(const CNetRange *pRange, F &&Function)
+{
+	const int Bits = AddrBits(&pRange->m_LB);
+	const int Bytes = Bits / 8;
+	NETADDR Current = pRange->m_LB;
+	while(true)
+	{
+		// the largest aligned block starting at `Current` inside the range
+		int Size = 0;
+		while(Size < Bits && !GetBit(Current.ip, Bits - 1 - Size))
+			Size++;
+		NETADDR Last;
+		while(true)
+		{
+			Last = Current;
+			for(int i = Bits - Size; i < Bits; i++)
+				Last.ip[i / 8] |= 1 << (7 - i % 8);
+			if(mem_comp(Last.ip, pRange->m_UB.ip, Bytes) <= 0)
+				break;
+			Size--;
+		}
+		Function(&Current, Bits - Size);
+
+		if(mem_comp(Last.ip, pRange->m_UB.ip, Bytes) == 0)
+			break;
+
+		// continue after the block, it can't end the address space as it
+		// is before the upper bound
+		int i = Bytes - 1;
+		for(; Last.ip[i] == 0xff; i--)
+			Last.ip[i] = 0;
+		Last.ip[i]++;
+		Current = Last;
+	}
+}
+
+template<typename F>
+static void ForEachPrefix(const NETADDR *pAddr, F &&Function)
+{
+	Function(pAddr, AddrBits(pAddr));
+}
+
+template<typename F>
+static void ForEachPrefix(const CNetRange *pRange, F &&Function)
+{
+	ForEachRangePrefix(pRange, Function);
+}
+
+template<class T>
+void CNetBan::CBanPool<T>::InsertUsed(CBan<T> *pBan)
 {
 	if(m_pFirstUsed)
 	{
@@ -80,17 +288,25 @@ void CNetBan::CBanPool<T, HashCount>::InsertUsed(CBan<T> *pBan)
 	}
 }
 
-template<class T, int HashCount>
-typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Add(const T *pData, const CBanInfo *pInfo, const CNetHash *pNetHash)
+template<class T>
+typename CNetBan::CBan<T> *CNetBan::CBanPool<T>::Add(const T *pData, const CBanInfo *pInfo)
 {
 	if(!m_pFirstFree)
-		return 0;
+	{
+		// link a new chunk into the free list
+		CBan<T> *pChunk = m_vpChunks.emplace_back(new CBan<T>[CHUNK_SIZE]()).get();
+		for(int i = 0; i < CHUNK_SIZE; ++i)
+		{
+			pChunk[i].m_pPrev = i > 0 ? &pChunk[i - 1] : 0;
+			pChunk[i].m_pNext = i < CHUNK_SIZE - 1 ? &pChunk[i + 1] : 0;
+		}
+		m_pFirstFree = pChunk;
+	}
 
 	// create new ban
 	CBan<T> *pBan = m_pFirstFree;
 	pBan->m_Data = *pData;
 	pBan->m_Info = *pInfo;
-	pBan->m_NetHash = *pNetHash;
 	if(pBan->m_pNext)
 		pBan->m_pNext->m_pPrev = pBan->m_pPrev;
 	if(pBan->m_pPrev)
@@ -98,12 +314,8 @@ typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Add(const T *pData,
 	else
 		m_pFirstFree = pBan->m_pNext;
 
-	// add it to the hash list
-	if(m_aapHashList[pNetHash->m_HashIndex][pNetHash->m_Hash])
-		m_aapHashList[pNetHash->m_HashIndex][pNetHash->m_Hash]->m_pHashPrev = pBan;
-	pBan->m_pHashPrev = 0;
-	pBan->m_pHashNext = m_aapHashList[pNetHash->m_HashIndex][pNetHash->m_Hash];
-	m_aapHashList[pNetHash->m_HashIndex][pNetHash->m_Hash] = pBan;
+	// add it to the index
+	ForEachPrefix(pData, [&](const NETADDR *pPrefix, int Length) { m_Index.Insert(pPrefix, Length, pBan); });
 
 	// insert it into the used list
 	InsertUsed(pBan);
@@ -114,20 +326,14 @@ typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Add(const T *pData,
 	return pBan;
 }
 
-template<class T, int HashCount>
-int CNetBan::CBanPool<T, HashCount>::Remove(CBan<T> *pBan)
+template<class T>
+int CNetBan::CBanPool<T>::Remove(CBan<T> *pBan)
 {
 	if(pBan == 0)
 		return -1;
 
-	// remove from hash list
-	if(pBan->m_pHashNext)
-		pBan->m_pHashNext->m_pHashPrev = pBan->m_pHashPrev;
-	if(pBan->m_pHashPrev)
-		pBan->m_pHashPrev->m_pHashNext = pBan->m_pHashNext;
-	else
-		m_aapHashList[pBan->m_NetHash.m_HashIndex][pBan->m_NetHash.m_Hash] = pBan->m_pHashNext;
-	pBan->m_pHashNext = pBan->m_pHashPrev = 0;
+	// remove from index
+	ForEachPrefix(&pBan->m_Data, [&](const NETADDR *pPrefix, int Length) { m_Index.Remove(pPrefix, Length, pBan); });
 
 	// remove from used list
 	if(pBan->m_pNext)
@@ -150,8 +356,36 @@ int CNetBan::CBanPool<T, HashCount>::Remove(CBan<T> *pBan)
 	return 0;
 }
 
-template<class T, int HashCount>
-void CNetBan::CBanPool<T, HashCount>::Update(CBan<CDataType> *pBan, const CBanInfo *pInfo)
+template<class T>
+typename CNetBan::CBan<T> *CNetBan::CBanPool<T>::Find(const T *pData) const
+{
+	// every ban is stored at its first prefix
+	const std::vector<CBan<T> *> *pvpBans = nullptr;
+	bool First = true;
+	ForEachPrefix(pData, [&](const NETADDR *pPrefix, int Length) {
+		if(First)
+			pvpBans = m_Index.Find(pPrefix, Length);
+		First = false;
+	});
+	if(pvpBans)
+	{
+		for(CBan<T> *pBan : *pvpBans)
+		{
+			if(NetComp(&pBan->m_Data, pData) == 0)
+				return pBan;
+		}
+	}
+	return 0;
+}
+
+template<class T>
+size_t CNetBan::CBanPool<T>::MemoryUsage() const
+{
+	return m_vpChunks.size() * CHUNK_SIZE * sizeof(CBan<T>) + m_Index.MemoryUsage();
+}
+
+template<class T>
+void CNetBan::CBanPool<T>::Update(CBan<CDataType> *pBan, const CBanInfo *pInfo)
 {
 	pBan->m_Info = *pInfo;
 
@@ -173,27 +407,18 @@ void CNetBan::UnbanAll()
 	m_BanRangePool.Reset();
 }
 
-template<class T, int HashCount>
-void CNetBan::CBanPool<T, HashCount>::Reset()
+template<class T>
+void CNetBan::CBanPool<T>::Reset()
 {
-	mem_zero(m_aapHashList, sizeof(m_aapHashList));
-	mem_zero(m_aBans, sizeof(m_aBans));
+	m_vpChunks.clear();
+	m_Index.Reset();
+	m_pFirstFree = 0;
 	m_pFirstUsed = 0;
 	m_CountUsed = 0;
-
-	for(int i = 1; i < MAX_BANS - 1; ++i)
-	{
-		m_aBans[i].m_pNext = &m_aBans[i + 1];
-		m_aBans[i].m_pPrev = &m_aBans[i - 1];
-	}
-
-	m_aBans[0].m_pNext = &m_aBans[1];
-	m_aBans[MAX_BANS - 1].m_pPrev = &m_aBans[MAX_BANS - 2];
-	m_pFirstFree = &m_aBans[0];
 }
 
-template<class T, int HashCount>
-typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Get(int Index) const
+template<class T>
+typename CNetBan::CBan<T> *CNetBan::CBanPool<T>::Get(int Index) const
 {
 	if(Index < 0 || Index >= Num())
 		return 0;
@@ -208,15 +433,28 @@ typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Get(int Index) const
 }
 
 template<class T>
-int CNetBan::Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, const char *pReason)
+int CNetBan::AddBan(T *pBanPool, const typename T::CDataType *pData, const CBanInfo *pInfo, CBan<typename T::CDataType> **ppBan)
 {
 	// do not ban localhost
 	if(NetMatch(pData, &m_LocalhostIPV4) || NetMatch(pData, &m_LocalhostIPV6))
-	{
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban failed (localhost)");
 		return -1;
+
+	// check if it already exists
+	*ppBan = pBanPool->Find(pData);
+	if(*ppBan)
+	{
+		// adjust the ban
+		pBanPool->Update(*ppBan, pInfo);
+		return 1;
 	}
 
+	*ppBan = pBanPool->Add(pData, pInfo);
+	return 0;
+}
+
+template<class T>
+int CNetBan::Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, const char *pReason)
+{
 	int Stamp = Seconds > 0 ? time_timestamp() + Seconds : CBanInfo::EXPIRES_NEVER;
 
 	// set up info
@@ -224,38 +462,25 @@ int CNetBan::Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, c
 	Info.m_Expires = Stamp;
 	str_copy(Info.m_aReason, pReason);
 
-	// check if it already exists
-	CNetHash NetHash(pData);
-	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData, &NetHash);
-	if(pBan)
+	CBan<typename T::CDataType> *pBan;
+	int Result = AddBan(pBanPool, pData, &Info, &pBan);
+	if(Result == -1)
 	{
-		// adjust the ban
-		pBanPool->Update(pBan, &Info);
-		char aBuf[128];
-		MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_LIST);
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
-		return 1;
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban failed (localhost)");
+		return -1;
 	}
 
-	// add ban and print result
-	pBan = pBanPool->Add(pData, &Info, &NetHash);
-	if(pBan)
-	{
-		char aBuf[128];
-		MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_BANADD);
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
-		return 0;
-	}
-	else
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban failed (full banlist)");
-	return -1;
+	// print result
+	char aBuf[128];
+	MakeBanInfo(pBan, aBuf, sizeof(aBuf), Result == 1 ? MSGTYPE_LIST : MSGTYPE_BANADD);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+	return Result;
 }
 
 template<class T>
 int CNetBan::Unban(T *pBanPool, const typename T::CDataType *pData)
 {
-	CNetHash NetHash(pData);
-	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData, &NetHash);
+	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData);
 	if(pBan)
 	{
 		char aBuf[256];
@@ -286,6 +511,7 @@ void CNetBan::Init(IConsole *pConsole, IStorage *pStorage)
 	Console()->Register("unban_all", "", CFGFLAG_SERVER | CFGFLAG_MASTER | CFGFLAG_STORE, ConUnbanAll, this, "Unban all entries");
 	Console()->Register("bans", "?i[page]", CFGFLAG_SERVER | CFGFLAG_MASTER, ConBans, this, "Show banlist (page 0 by default, 20 entries per page)");
 	Console()->Register("bans_save", "s[file]", CFGFLAG_SERVER | CFGFLAG_MASTER | CFGFLAG_STORE, ConBansSave, this, "Save banlist in a file");
+	Console()->Register("bans_load", "s[file] ?i[minutes] ?r[reason]", CFGFLAG_SERVER | CFGFLAG_MASTER | CFGFLAG_STORE, ConBansLoad, this, "Ban all addresses, CIDR prefixes and ranges listed in a file (permanently by default)");
 }
 
 void CNetBan::Update()
@@ -377,11 +603,9 @@ bool CNetBan::IsBanned(const NETADDR *pOrigAddr, char *pBuf, unsigned BufferSize
 		pAddr = &Addr;
 		Addr.type = NETTYPE_IPV4;
 	}
-	CNetHash aHash[17];
-	int Length = CNetHash::MakeHashArray(pAddr, aHash);
 
 	// check ban addresses
-	CBanAddr *pBan = m_BanAddrPool.Find(pAddr, &aHash[Length]);
+	CBanAddr *pBan = m_BanAddrPool.Match(pAddr);
 	if(pBan)
 	{
 		MakeBanInfo(pBan, pBuf, BufferSize, MSGTYPE_PLAYER);
@@ -389,16 +613,11 @@ bool CNetBan::IsBanned(const NETADDR *pOrigAddr, char *pBuf, unsigned BufferSize
 	}
 
 	// check ban ranges
-	for(int i = Length - 1; i >= 0; --i)
+	CBanRange *pBanRange = m_BanRangePool.Match(pAddr);
+	if(pBanRange)
 	{
-		for(CBanRange *pBanRange = m_BanRangePool.First(&aHash[i]); pBanRange; pBanRange = pBanRange->m_pHashNext)
-		{
-			if(NetMatch(&pBanRange->m_Data, pAddr, i, Length))
-			{
-				MakeBanInfo(pBanRange, pBuf, BufferSize, MSGTYPE_PLAYER);
-				return true;
-			}
-		}
+		MakeBanInfo(pBanRange, pBuf, BufferSize, MSGTYPE_PLAYER);
+		return true;
 	}
 
 	return false;
@@ -546,3 +765,101 @@ void CNetBan::ConBansSave(IConsole::IResult *pResult, void *pUser)
 	str_format(aBuf, sizeof(aBuf), "saved banlist to '%s'", pResult->GetString(0));
 	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
 }
+
+void CNetBan::ConBansLoad(IConsole::IResult *pResult, void *pUser)
+{
+	CNetBan *pThis = static_cast<CNetBan *>(pUser);
+
+	const char *pFilename = pResult->GetString(0);
+	int Minutes = pResult->NumArguments() > 1 ? clamp(pResult->GetInteger(1), 0, 525600) : 0;
+	const char *pReason = pResult->NumArguments() > 2 ? pResult->GetString(2) : "No reason given";
+
+	char aBuf[256];
+	IOHANDLE File = pThis->Storage()->OpenFile(pFilename, IOFLAG_READ | IOFLAG_SKIP_BOM, IStorage::TYPE_ALL);
+	if(!File)
+	{
+		str_format(aBuf, sizeof(aBuf), "failed to load banlist from '%s'", pFilename);
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+		return;
+	}
+
+	CBanInfo Info = {0};
+	Info.m_Expires = Minutes > 0 ? time_timestamp() + Minutes * 60 : CBanInfo::EXPIRES_NEVER;
+	str_copy(Info.m_aReason, pReason);
+
+	// one address, CIDR prefix or range `first - last` per line, without
+	// printing every ban like `ban` and `ban_range`
+	int NumAdded = 0;
+	int NumUpdated = 0;
+	int NumInvalid = 0;
+	CLineReader Reader;
+	Reader.Init(File);
+	char *pLine;
+	while((pLine = Reader.Get()))
+	{
+		char *pComment = (char *)str_find(pLine, "#");
+		if(pComment)
+			*pComment = '\0';
+		char aLine[128];
+		str_copy(aLine, str_skip_whitespaces(pLine));
+		str_utf8_trim_right(aLine);
+		if(!aLine[0])
+			continue;
+
+		int Result = -1;
+		CNetRange Range;
+		char *pSeparator = (char *)str_find(aLine, "-");
+		char *pSlash = (char *)str_find(aLine, "/");
+		if(pSeparator)
+		{
+			*pSeparator = '\0';
+			str_utf8_trim_right(aLine);
+			if(net_addr_from_str(&Range.m_LB, aLine) == 0 && net_addr_from_str(&Range.m_UB, str_skip_whitespaces(pSeparator + 1)) == 0 && Range.IsValid())
+			{
+				CBanRange *pBan;
+				Result = pThis->AddBan(&pThis->m_BanRangePool, &Range, &Info, &pBan);
+			}
+		}
+		else if(pSlash)
+		{
+			*pSlash = '\0';
+			const int Length = str_toint(pSlash + 1);
+			if(net_addr_from_str(&Range.m_LB, aLine) == 0 && str_isallnum(pSlash + 1) && Length >= 0 && Length <= AddrBits(&Range.m_LB))
+			{
+				Range.m_UB = Range.m_LB;
+				for(int i = Length; i < AddrBits(&Range.m_LB); i++)
+				{
+					Range.m_LB.ip[i / 8] &= ~(1 << (7 - i % 8));
+					Range.m_UB.ip[i / 8] |= 1 << (7 - i % 8);
+				}
+				if(Range.IsValid())
+				{
+					CBanRange *pBan;
+					Result = pThis->AddBan(&pThis->m_BanRangePool, &Range, &Info, &pBan);
+				}
+				else
+				{
+					CBanAddr *pBan;
+					Result = pThis->AddBan(&pThis->m_BanAddrPool, &Range.m_LB, &Info, &pBan);
+				}
+			}
+		}
+		else if(net_addr_from_str(&Range.m_LB, aLine) == 0)
+		{
+			CBanAddr *pBan;
+			Result = pThis->AddBan(&pThis->m_BanAddrPool, &Range.m_LB, &Info, &pBan);
+		}
+
+		if(Result == 0)
+			NumAdded++;
+		else if(Result == 1)
+			NumUpdated++;
+		else
+			NumInvalid++;
+	}
+	io_close(File);
+
+	const size_t Memory = pThis->m_BanAddrPool.MemoryUsage() + pThis->m_BanRangePool.MemoryUsage();
+	str_format(aBuf, sizeof(aBuf), "loaded banlist from '%s': %d added, %d updated, %d invalid; %d bans using %d KiB", pFilename, NumAdded, NumUpdated, NumInvalid, pThis->m_BanAddrPool.Num() + pThis->m_BanRangePool.Num(), (int)(Memory / 1024));
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+}
@@ -5,6 +5,9 @@
 
 #include <base/system.h>
 
+#include <memory>
+#include <vector>
+
 inline int NetComp(const NETADDR *pAddr1, const NETADDR *pAddr2)
 {
 	return mem_comp(pAddr1, pAddr2, pAddr1->type == NETTYPE_IPV4 ? 8 : 20);
@@ -60,19 +63,6 @@ protected:
 		return pBuffer;
 	}
 
-	class CNetHash
-	{
-	public:
-		int m_Hash;
-		int m_HashIndex; // matching parts for ranges, 0 for addr
-
-		CNetHash() {}
-		CNetHash(const NETADDR *pAddr);
-		CNetHash(const CNetRange *pRange);
-
-		static int MakeHashArray(const NETADDR *pAddr, CNetHash aHash[17]);
-	};
-
 	struct CBanInfo
 	{
 		enum
@@ -89,53 +79,80 @@ protected:
 	{
 		T m_Data;
 		CBanInfo m_Info;
-		CNetHash m_NetHash;
-
-		// hash list
-		CBan *m_pHashNext;
-		CBan *m_pHashPrev;
 
 		// used or free list
 		CBan *m_pNext;
 		CBan *m_pPrev;
 	};
 
-	template<class T, int HashCount>
+	// Path compressed binary trie over IPv4 and IPv6 prefixes. A lookup
+	// follows the bits of the address once, so it takes the same time no
+	// matter how many prefixes there are.
+	template<class T>
+	class CPrefixTrie
+	{
+	public:
+		CPrefixTrie() { Reset(); }
+
+		void Insert(const NETADDR *pPrefix, int Length, T *pValue);
+		void Remove(const NETADDR *pPrefix, int Length, T *pValue);
+		void Reset();
+
+		// values stored for exactly this prefix
+		const std::vector<T *> *Find(const NETADDR *pPrefix, int Length) const;
+		// the last inserted value of the longest prefix of the address
+		T *Match(const NETADDR *pAddr) const;
+		size_t MemoryUsage() const;
+
+	private:
+		struct CNode
+		{
+			unsigned char m_aPrefix[16];
+			int m_Length;
+			int m_aChildren[2];
+			std::vector<T *> m_vpValues;
+		};
+
+		std::vector<CNode> m_vNodes;
+		std::vector<int> m_vFreeNodes;
+		// roots for IPv4 and IPv6
+		int m_aRoots[2];
+
+		int NewNode(const unsigned char *pPrefix, int Length);
+		void FreeNode(int Node);
+		int Insert(int Node, const unsigned char *pPrefix, int Length, T *pValue);
+		int Remove(int Node, const unsigned char *pPrefix, int Length, T *pValue);
+	};
+
+	template<class T>
 	class CBanPool
 	{
 	public:
 		typedef T CDataType;
 
-		CBan<CDataType> *Add(const CDataType *pData, const CBanInfo *pInfo, const CNetHash *pNetHash);
+		CBan<CDataType> *Add(const CDataType *pData, const CBanInfo *pInfo);
 		int Remove(CBan<CDataType> *pBan);
 		void Update(CBan<CDataType> *pBan, const CBanInfo *pInfo);
 		void Reset();
 
 		int Num() const { return m_CountUsed; }
-		bool IsFull() const { return m_CountUsed == MAX_BANS; }
 
 		CBan<CDataType> *First() const { return m_pFirstUsed; }
-		CBan<CDataType> *First(const CNetHash *pNetHash) const { return m_aapHashList[pNetHash->m_HashIndex][pNetHash->m_Hash]; }
-		CBan<CDataType> *Find(const CDataType *pData, const CNetHash *pNetHash) const
-		{
-			for(CBan<CDataType> *pBan = m_aapHashList[pNetHash->m_HashIndex][pNetHash->m_Hash]; pBan; pBan = pBan->m_pHashNext)
-			{
-				if(NetComp(&pBan->m_Data, pData) == 0)
-					return pBan;
-			}
-
-			return 0;
-		}
+		CBan<CDataType> *Find(const CDataType *pData) const;
+		// the most specific ban covering the address
+		CBan<CDataType> *Match(const NETADDR *pAddr) const { return m_Index.Match(pAddr); }
 		CBan<CDataType> *Get(int Index) const;
+		size_t MemoryUsage() const;
 
 	private:
 		enum
 		{
-			MAX_BANS = 1024,
+			CHUNK_SIZE = 1024,
 		};
 
-		CBan<CDataType> *m_aapHashList[HashCount][256];
-		CBan<CDataType> m_aBans[MAX_BANS];
+		// bans are allocated in chunks so their addresses stay the same
+		std::vector<std::unique_ptr<CBan<CDataType>[]>> m_vpChunks;
+		CPrefixTrie<CBan<CDataType>> m_Index;
 		CBan<CDataType> *m_pFirstFree;
 		CBan<CDataType> *m_pFirstUsed;
 		int m_CountUsed;
@@ -143,8 +160,8 @@ protected:
 		void InsertUsed(CBan<CDataType> *pBan);
 	};
 
-	typedef CBanPool<NETADDR, 1> CBanAddrPool;
-	typedef CBanPool<CNetRange, 16> CBanRangePool;
+	typedef CBanPool<NETADDR> CBanAddrPool;
+	typedef CBanPool<CNetRange> CBanRangePool;
 	typedef CBan<NETADDR> CBanAddr;
 	typedef CBan<CNetRange> CBanRange;
 
@@ -154,6 +171,10 @@ protected:
 	int Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, const char *pReason);
 	template<class T>
 	int Unban(T *pBanPool, const typename T::CDataType *pData);
+	// adds the ban or updates an existing one without any output, returns
+	// -1 for localhost, 0 if added and 1 if updated
+	template<class T>
+	int AddBan(T *pBanPool, const typename T::CDataType *pData, const CBanInfo *pInfo, CBan<typename T::CDataType> **ppBan);
 
 	class IConsole *m_pConsole;
 	class IStorage *m_pStorage;
@@ -192,6 +213,7 @@ public:
 	static void ConUnbanAll(class IConsole::IResult *pResult, void *pUser);
 	static void ConBans(class IConsole::IResult *pResult, void *pUser);
 	static void ConBansSave(class IConsole::IResult *pResult, void *pUser);
+	static void ConBansLoad(class IConsole::IResult *pResult, void *pUser);
 };
 
 template<class T>
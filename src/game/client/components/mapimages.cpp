@@ -2,8 +2,11 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <base/log.h>
 
+#include <engine/engine.h>
+#include <engine/gfx/image_loader.h>
 #include <engine/graphics.h>
 #include <engine/map.h>
+#include <engine/shared/jobs.h>
 #include <engine/storage.h>
 #include <engine/textrender.h>
 
@@ -14,6 +17,66 @@
 
 #include "mapimages.h"
 
+class CMapImages::CImageLoadJob : public IJob
+{
+	IMap *m_pMap;
+	IStorage *m_pStorage;
+	int m_DataIndex;
+
+	void Run() override;
+
+public:
+	CImageLoadJob(IMap *pMap, IStorage *pStorage, int DataIndex) :
+		m_pMap(pMap), m_pStorage(pStorage), m_DataIndex(DataIndex) {}
+	~CImageLoadJob() { free(m_Image.m_pData); }
+
+	int m_Index;
+	int m_LoadFlag;
+	bool m_External;
+	// path of external images, texture name of embedded ones
+	char m_aName[IO_MAX_PATH_LENGTH];
+	// the decoded RGBA image, no data if the main thread loads it instead
+	CImageInfo m_Image;
+};
+
+void CMapImages::CImageLoadJob::Run()
+{
+	if(!m_External)
+	{
+		const void *pData = m_pMap->GetData(m_DataIndex);
+		const size_t Size = (size_t)m_Image.m_Width * m_Image.m_Height * CImageInfo::PixelSize(CImageInfo::FORMAT_RGBA);
+		if(pData && m_pMap->GetDataSize(m_DataIndex) >= (int)Size)
+		{
+			m_Image.m_pData = malloc(Size);
+			mem_copy(m_Image.m_pData, pData, Size);
+		}
+		m_pMap->UnloadData(m_DataIndex);
+		return;
+	}
+
+	void *pFileData;
+	unsigned FileSize;
+	if(!m_pStorage->ReadFile(m_aName, IStorage::TYPE_ALL, &pFileData, &FileSize))
+		return;
+	TImageByteBuffer ByteBuffer((uint8_t *)pFileData, (uint8_t *)pFileData + FileSize);
+	free(pFileData);
+
+	SImageByteBuffer ImageByteBuffer(&ByteBuffer);
+	uint8_t *pImgBuffer = nullptr;
+	EImageFormat ImageFormat;
+	int PngliteIncompatible;
+	if(!::LoadPNG(ImageByteBuffer, m_aName, PngliteIncompatible, m_Image.m_Width, m_Image.m_Height, pImgBuffer, ImageFormat))
+		return;
+
+	// the main thread loads the image again to convert it and show the warnings
+	if(ImageFormat != IMAGE_FORMAT_RGBA || PngliteIncompatible != 0)
+	{
+		free(pImgBuffer);
+		return;
+	}
+	m_Image.m_pData = pImgBuffer;
+}
+
 const char *const gs_apModEntitiesNames[] = {
 	"ddnet",
 	"ddrace",
@@ -57,6 +120,8 @@ void CMapImages::OnInit()
 
 void CMapImages::OnMapLoadImpl(class CLayers *pLayers, IMap *pMap)
 {
+	FinishLoad();
+
 	// unload all textures
 	for(int i = 0; i < m_Count; i++)
 	{
@@ -102,7 +167,7 @@ void CMapImages::OnMapLoadImpl(class CLayers *pLayers, IMap *pMap)
 
 	const int TextureLoadFlag = Graphics()->HasTextureArrays() ? IGraphics::TEXLOAD_TO_2D_ARRAY_TEXTURE : IGraphics::TEXLOAD_TO_3D_TEXTURE;
 
-	// load new textures
+	// decode the new textures in parallel
 	for(int i = 0; i < m_Count; i++)
 	{
 		const int LoadFlag = (((m_aTextureUsedByTileOrQuadLayerFlag[i] & 1) != 0) ? TextureLoadFlag : 0) | (((m_aTextureUsedByTileOrQuadLayerFlag[i] & 2) != 0) ? 0 : (Graphics()->IsTileBufferingEnabled() ? IGraphics::TEXLOAD_NO_2D_TEXTURE : 0));
@@ -116,22 +181,51 @@ void CMapImages::OnMapLoadImpl(class CLayers *pLayers, IMap *pMap)
 			continue;
 		}
 
-		if(pImg->m_External)
+		if(pImg->m_External || Format == CImageInfo::FORMAT_RGBA)
+		{
+			auto pJob = std::make_shared<CImageLoadJob>(pMap, Storage(), pImg->m_ImageData);
+			pJob->m_Index = i;
+			pJob->m_LoadFlag = LoadFlag;
+			pJob->m_External = pImg->m_External;
+			if(pImg->m_External)
+			{
+				str_format(pJob->m_aName, sizeof(pJob->m_aName), "mapres/%s.png", pName);
+			}
+			else
+			{
+				str_format(pJob->m_aName, sizeof(pJob->m_aName), "embedded: %s", pName);
+				pJob->m_Image.m_Width = pImg->m_Width;
+				pJob->m_Image.m_Height = pImg->m_Height;
+			}
+			pJob->m_Image.m_Format = CImageInfo::FORMAT_RGBA;
+			pJob->SetPriority(IJob::PRIORITY_HIGH);
+			Engine()->AddJob(pJob);
+			m_vpLoadJobs.push_back(pJob);
+		}
+		pMap->UnloadData(pImg->m_ImageName);
+	}
+}
+
+void CMapImages::FinishLoad()
+{
+	// create the textures in the order of the images
+	for(auto &pJob : m_vpLoadJobs)
+	{
+		while(pJob->Status() != IJob::STATE_DONE)
+			thread_yield();
+
+		CImageInfo &Image = pJob->m_Image;
+		if(Image.m_pData)
 		{
-			char aPath[IO_MAX_PATH_LENGTH];
-			str_format(aPath, sizeof(aPath), "mapres/%s.png", pName);
-			m_aTextures[i] = Graphics()->LoadTexture(aPath, IStorage::TYPE_ALL, LoadFlag);
+			m_aTextures[pJob->m_Index] = Graphics()->LoadTextureRawMove(Image.m_Width, Image.m_Height, Image.m_pData, pJob->m_LoadFlag, pJob->m_aName);
+			Image.m_pData = nullptr;
 		}
-		else if(Format == CImageInfo::FORMAT_RGBA)
+		else if(pJob->m_External)
 		{
-			void *pData = pMap->GetData(pImg->m_ImageData);
-			char aTexName[IO_MAX_PATH_LENGTH];
-			str_format(aTexName, sizeof(aTexName), "embedded: %s", pName);
-			m_aTextures[i] = Graphics()->LoadTextureRaw(pImg->m_Width, pImg->m_Height, Format, pData, LoadFlag, aTexName);
-			pMap->UnloadData(pImg->m_ImageData);
+			m_aTextures[pJob->m_Index] = Graphics()->LoadTexture(pJob->m_aName, IStorage::TYPE_ALL, pJob->m_LoadFlag);
 		}
-		pMap->UnloadData(pImg->m_ImageName);
 	}
+	m_vpLoadJobs.clear();
 }
 
 void CMapImages::OnMapLoad()
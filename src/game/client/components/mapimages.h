@@ -7,6 +7,9 @@
 
 #include <game/client/component.h>
 
+#include <memory>
+#include <vector>
+
 enum EMapImageEntityLayerType
 {
 	MAP_IMAGE_ENTITY_LAYER_TYPE_ALL_EXCEPT_SWITCH = 0,
@@ -41,6 +44,11 @@ class CMapImages : public CComponent
 
 	char m_aEntitiesPath[IO_MAX_PATH_LENGTH];
 
+	// decodes one map image on the job pool
+	class CImageLoadJob;
+	// the images of the last loaded map that are still being decoded
+	std::vector<std::shared_ptr<CImageLoadJob>> m_vpLoadJobs;
+
 	bool HasFrontLayer(EMapImageModType ModType);
 	bool HasSpeedupLayer(EMapImageModType ModType);
 	bool HasSwitchLayer(EMapImageModType ModType);
@@ -55,7 +63,10 @@ public:
 	IGraphics::CTextureHandle Get(int Index) const { return m_aTextures[Index]; }
 	int Num() const { return m_Count; }
 
+	// Starts decoding the images of the map. `FinishLoad` waits for them and
+	// creates the textures, it has to be called before the map is unloaded.
 	void OnMapLoadImpl(class CLayers *pLayers, class IMap *pMap);
+	void FinishLoad();
 	virtual void OnMapLoad() override;
 	virtual void OnInit() override;
 	void LoadBackground(class CLayers *pLayers, class IMap *pMap);
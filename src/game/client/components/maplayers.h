@@ -2,9 +2,12 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #ifndef GAME_CLIENT_COMPONENTS_MAPLAYERS_H
 #define GAME_CLIENT_COMPONENTS_MAPLAYERS_H
+#include <base/vmath.h>
+#include <engine/shared/jobs.h>
 #include <game/client/component.h>
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 #define INDEX_BUFFER_GROUP_WIDTH 12
@@ -27,6 +30,8 @@ class CMapLayers : public CComponent
 {
 	friend class CBackground;
 	friend class CMenuBackground;
+	// compares building the tile layers in parallel and serially
+	friend class MapLayers;
 
 	CLayers *m_pLayers;
 	CMapImages *m_pImages;
@@ -128,6 +133,12 @@ class CMapLayers : public CComponent
 	};
 	std::vector<SQuadLayerVisuals *> m_vpQuadLayerVisuals;
 
+	class CTileLayerBufferJob;
+	// creates the visuals and the jobs building them for all overlays of a
+	// tile layer, the jobs still have to be run
+	static void AddTileLayerJobs(CLayers *pLayers, CMapItemLayerTilemap *pTMap, CMapItemGroup *pGroup, bool As3DTextureCoords, std::vector<STileLayerVisuals *> &vpVisuals, std::vector<std::shared_ptr<CTileLayerBufferJob>> &vpJobs);
+	void UploadTileLayerBuffer(CTileLayerBufferJob *pJob);
+
 	virtual CCamera *GetCurCamera();
 
 	void LayersOfGroupCount(CMapItemGroup *pGroup, int &TileLayerCount, int &QuadLayerCount, bool &PassedGameLayer);
@@ -164,4 +175,50 @@ public:
 	static void EnvelopeEval(int TimeOffsetMillis, int Env, ColorRGBA &Channels, void *pUser);
 };
 
+// Builds the vertices of one overlay of a tile layer, only the upload of the
+// buffer is left to the main thread.
+class CMapLayers::CTileLayerBufferJob : public IJob
+{
+	STileLayerVisuals *m_pVisuals;
+	const CMapItemLayerTilemap *m_pTMap;
+	void *m_pTiles;
+	CMapItemGroup *m_pGroup;
+	int m_CurOverlay;
+	bool m_DoTextureCoords;
+	bool m_As3DTextureCoords;
+
+	void Run() override;
+
+public:
+	bool m_IsEntityLayer = false;
+	bool m_IsGameLayer = false;
+	bool m_IsFrontLayer = false;
+	bool m_IsSwitchLayer = false;
+	bool m_IsTeleLayer = false;
+	bool m_IsSpeedupLayer = false;
+	bool m_IsTuneLayer = false;
+
+	char *m_pUploadData = nullptr;
+	size_t m_UploadDataSize = 0;
+	size_t m_NumTiles = 0;
+
+	CTileLayerBufferJob(STileLayerVisuals *pVisuals, const CMapItemLayerTilemap *pTMap, void *pTiles, CMapItemGroup *pGroup, int CurOverlay, bool DoTextureCoords, bool As3DTextureCoords) :
+		m_pVisuals(pVisuals),
+		m_pTMap(pTMap),
+		m_pTiles(pTiles),
+		m_pGroup(pGroup),
+		m_CurOverlay(CurOverlay),
+		m_DoTextureCoords(DoTextureCoords),
+		m_As3DTextureCoords(As3DTextureCoords)
+	{
+	}
+
+	~CTileLayerBufferJob() override
+	{
+		free(m_pUploadData);
+	}
+
+	STileLayerVisuals *Visuals() const { return m_pVisuals; }
+};
+
 #endif
@@ -0,0 +1,601 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/graphics.h>
+#include <engine/map.h>
+
+#include <game/layers.h>
+#include <game/mapitems.h>
+
+#include "maplayers.h"
+
+#include <cmath>
+#include <limits>
+
+void FillTmpTileSpeedup(SGraphicTile *pTmpTile, SGraphicTileTexureCoords *pTmpTex, bool As3DTextureCoord, unsigned char Flags, unsigned char Index, int x, int y, int Scale, CMapItemGroup *pGroup, short AngleRotate)
+{
+	if(pTmpTex)
+	{
+		unsigned char x0 = 0;
+		unsigned char y0 = 0;
+		unsigned char x1 = x0 + 1;
+		unsigned char y1 = y0;
+		unsigned char x2 = x0 + 1;
+		unsigned char y2 = y0 + 1;
+		unsigned char x3 = x0;
+		unsigned char y3 = y0 + 1;
+
+		pTmpTex->m_TexCoordTopLeft.x = x0;
+		pTmpTex->m_TexCoordTopLeft.y = y0;
+		pTmpTex->m_TexCoordBottomLeft.x = x3;
+		pTmpTex->m_TexCoordBottomLeft.y = y3;
+		pTmpTex->m_TexCoordTopRight.x = x1;
+		pTmpTex->m_TexCoordTopRight.y = y1;
+		pTmpTex->m_TexCoordBottomRight.x = x2;
+		pTmpTex->m_TexCoordBottomRight.y = y2;
+
+		if(As3DTextureCoord)
+		{
+			pTmpTex->m_TexCoordTopLeft.z = ((float)Index + 0.5f) / 256.f;
+			pTmpTex->m_TexCoordBottomLeft.z = ((float)Index + 0.5f) / 256.f;
+			pTmpTex->m_TexCoordTopRight.z = ((float)Index + 0.5f) / 256.f;
+			pTmpTex->m_TexCoordBottomRight.z = ((float)Index + 0.5f) / 256.f;
+		}
+		else
+		{
+			pTmpTex->m_TexCoordTopLeft.z = Index;
+			pTmpTex->m_TexCoordBottomLeft.z = Index;
+			pTmpTex->m_TexCoordTopRight.z = Index;
+			pTmpTex->m_TexCoordBottomRight.z = Index;
+		}
+	}
+
+	//same as in rotate from Graphics()
+	float Angle = (float)AngleRotate * (pi / 180.0f);
+	float c = std::cos(Angle);
+	float s = std::sin(Angle);
+	float xR, yR;
+	int i;
+
+	int ScaleSmaller = 2;
+	pTmpTile->m_TopLeft.x = x * Scale + ScaleSmaller;
+	pTmpTile->m_TopLeft.y = y * Scale + ScaleSmaller;
+	pTmpTile->m_BottomLeft.x = x * Scale + ScaleSmaller;
+	pTmpTile->m_BottomLeft.y = y * Scale + Scale - ScaleSmaller;
+	pTmpTile->m_TopRight.x = x * Scale + Scale - ScaleSmaller;
+	pTmpTile->m_TopRight.y = y * Scale + ScaleSmaller;
+	pTmpTile->m_BottomRight.x = x * Scale + Scale - ScaleSmaller;
+	pTmpTile->m_BottomRight.y = y * Scale + Scale - ScaleSmaller;
+
+	float *pTmpTileVertices = (float *)pTmpTile;
+
+	vec2 Center;
+	Center.x = pTmpTile->m_TopLeft.x + (Scale - ScaleSmaller) / 2.f;
+	Center.y = pTmpTile->m_TopLeft.y + (Scale - ScaleSmaller) / 2.f;
+
+	for(i = 0; i < 4; i++)
+	{
+		xR = pTmpTileVertices[i * 2] - Center.x;
+		yR = pTmpTileVertices[i * 2 + 1] - Center.y;
+		pTmpTileVertices[i * 2] = xR * c - yR * s + Center.x;
+		pTmpTileVertices[i * 2 + 1] = xR * s + yR * c + Center.y;
+	}
+}
+
+void FillTmpTile(SGraphicTile *pTmpTile, SGraphicTileTexureCoords *pTmpTex, bool As3DTextureCoord, unsigned char Flags, unsigned char Index, int x, int y, int Scale, CMapItemGroup *pGroup)
+{
+	if(pTmpTex)
+	{
+		unsigned char x0 = 0;
+		unsigned char y0 = 0;
+		unsigned char x1 = x0 + 1;
+		unsigned char y1 = y0;
+		unsigned char x2 = x0 + 1;
+		unsigned char y2 = y0 + 1;
+		unsigned char x3 = x0;
+		unsigned char y3 = y0 + 1;
+
+		if(Flags & TILEFLAG_XFLIP)
+		{
+			x0 = x2;
+			x1 = x3;
+			x2 = x3;
+			x3 = x0;
+		}
+
+		if(Flags & TILEFLAG_YFLIP)
+		{
+			y0 = y3;
+			y2 = y1;
+			y3 = y1;
+			y1 = y0;
+		}
+
+		if(Flags & TILEFLAG_ROTATE)
+		{
+			unsigned char Tmp = x0;
+			x0 = x3;
+			x3 = x2;
+			x2 = x1;
+			x1 = Tmp;
+			Tmp = y0;
+			y0 = y3;
+			y3 = y2;
+			y2 = y1;
+			y1 = Tmp;
+		}
+
+		pTmpTex->m_TexCoordTopLeft.x = x0;
+		pTmpTex->m_TexCoordTopLeft.y = y0;
+		pTmpTex->m_TexCoordBottomLeft.x = x3;
+		pTmpTex->m_TexCoordBottomLeft.y = y3;
+		pTmpTex->m_TexCoordTopRight.x = x1;
+		pTmpTex->m_TexCoordTopRight.y = y1;
+		pTmpTex->m_TexCoordBottomRight.x = x2;
+		pTmpTex->m_TexCoordBottomRight.y = y2;
+
+		if(As3DTextureCoord)
+		{
+			pTmpTex->m_TexCoordTopLeft.z = ((float)Index + 0.5f) / 256.f;
+			pTmpTex->m_TexCoordBottomLeft.z = ((float)Index + 0.5f) / 256.f;
+			pTmpTex->m_TexCoordTopRight.z = ((float)Index + 0.5f) / 256.f;
+			pTmpTex->m_TexCoordBottomRight.z = ((float)Index + 0.5f) / 256.f;
+		}
+		else
+		{
+			pTmpTex->m_TexCoordTopLeft.z = Index;
+			pTmpTex->m_TexCoordBottomLeft.z = Index;
+			pTmpTex->m_TexCoordTopRight.z = Index;
+			pTmpTex->m_TexCoordBottomRight.z = Index;
+		}
+	}
+
+	pTmpTile->m_TopLeft.x = x * Scale;
+	pTmpTile->m_TopLeft.y = y * Scale;
+	pTmpTile->m_BottomLeft.x = x * Scale;
+	pTmpTile->m_BottomLeft.y = y * Scale + Scale;
+	pTmpTile->m_TopRight.x = x * Scale + Scale;
+	pTmpTile->m_TopRight.y = y * Scale;
+	pTmpTile->m_BottomRight.x = x * Scale + Scale;
+	pTmpTile->m_BottomRight.y = y * Scale + Scale;
+}
+
+bool CMapLayers::STileLayerVisuals::Init(unsigned int Width, unsigned int Height)
+{
+	m_Width = Width;
+	m_Height = Height;
+	if(Width == 0 || Height == 0)
+		return false;
+	if constexpr(sizeof(unsigned int) >= sizeof(ptrdiff_t))
+		if(Width >= std::numeric_limits<std::ptrdiff_t>::max() || Height >= std::numeric_limits<std::ptrdiff_t>::max())
+			return false;
+
+	m_pTilesOfLayer = new CMapLayers::STileLayerVisuals::STileVisual[Height * Width];
+
+	if(Width > 2)
+	{
+		m_pBorderTop = new CMapLayers::STileLayerVisuals::STileVisual[Width - 2];
+		m_pBorderBottom = new CMapLayers::STileLayerVisuals::STileVisual[Width - 2];
+	}
+	if(Height > 2)
+	{
+		m_pBorderLeft = new CMapLayers::STileLayerVisuals::STileVisual[Height - 2];
+		m_pBorderRight = new CMapLayers::STileLayerVisuals::STileVisual[Height - 2];
+	}
+	return true;
+}
+
+CMapLayers::STileLayerVisuals::~STileLayerVisuals()
+{
+	delete[] m_pTilesOfLayer;
+	delete[] m_pBorderTop;
+	delete[] m_pBorderBottom;
+	delete[] m_pBorderLeft;
+	delete[] m_pBorderRight;
+
+	m_pTilesOfLayer = NULL;
+	m_pBorderTop = NULL;
+	m_pBorderBottom = NULL;
+	m_pBorderLeft = NULL;
+	m_pBorderRight = NULL;
+}
+
+bool AddTile(std::vector<SGraphicTile> &vTmpTiles, std::vector<SGraphicTileTexureCoords> &vTmpTileTexCoords, bool As3DTextureCoord, unsigned char Index, unsigned char Flags, int x, int y, CMapItemGroup *pGroup, bool DoTextureCoords, bool FillSpeedup = false, int AngleRotate = -1)
+{
+	if(Index)
+	{
+		vTmpTiles.emplace_back();
+		SGraphicTile &Tile = vTmpTiles.back();
+		SGraphicTileTexureCoords *pTileTex = NULL;
+		if(DoTextureCoords)
+		{
+			vTmpTileTexCoords.emplace_back();
+			SGraphicTileTexureCoords &TileTex = vTmpTileTexCoords.back();
+			pTileTex = &TileTex;
+		}
+		if(FillSpeedup)
+			FillTmpTileSpeedup(&Tile, pTileTex, As3DTextureCoord, Flags, 0, x, y, 32.f, pGroup, AngleRotate);
+		else
+			FillTmpTile(&Tile, pTileTex, As3DTextureCoord, Flags, Index, x, y, 32.f, pGroup);
+
+		return true;
+	}
+	return false;
+}
+
+void mem_copy_special(void *pDest, void *pSource, size_t Size, size_t Count, size_t Steps)
+{
+	size_t CurStep = 0;
+	for(size_t i = 0; i < Count; ++i)
+	{
+		mem_copy(((char *)pDest) + CurStep + i * Size, ((char *)pSource) + i * Size, Size);
+		CurStep += Steps;
+	}
+}
+
+void CMapLayers::CTileLayerBufferJob::Run()
+{
+	STileLayerVisuals &Visuals = *m_pVisuals;
+	const CMapItemLayerTilemap *pTMap = m_pTMap;
+	void *pTiles = m_pTiles;
+	CMapItemGroup *pGroup = m_pGroup;
+	const int CurOverlay = m_CurOverlay;
+	const bool DoTextureCoords = m_DoTextureCoords;
+	const bool As3DTextureCoords = m_As3DTextureCoords;
+	const bool IsEntityLayer = m_IsEntityLayer;
+	const bool IsGameLayer = m_IsGameLayer;
+	const bool IsFrontLayer = m_IsFrontLayer;
+	const bool IsSwitchLayer = m_IsSwitchLayer;
+	const bool IsTeleLayer = m_IsTeleLayer;
+	const bool IsSpeedupLayer = m_IsSpeedupLayer;
+	const bool IsTuneLayer = m_IsTuneLayer;
+
+	std::vector<SGraphicTile> vTmpTiles;
+	std::vector<SGraphicTileTexureCoords> vTmpTileTexCoords;
+	std::vector<SGraphicTile> vTmpBorderTopTiles;
+	std::vector<SGraphicTileTexureCoords> vTmpBorderTopTilesTexCoords;
+	std::vector<SGraphicTile> vTmpBorderLeftTiles;
+	std::vector<SGraphicTileTexureCoords> vTmpBorderLeftTilesTexCoords;
+	std::vector<SGraphicTile> vTmpBorderRightTiles;
+	std::vector<SGraphicTileTexureCoords> vTmpBorderRightTilesTexCoords;
+	std::vector<SGraphicTile> vTmpBorderBottomTiles;
+	std::vector<SGraphicTileTexureCoords> vTmpBorderBottomTilesTexCoords;
+	std::vector<SGraphicTile> vTmpBorderCorners;
+	std::vector<SGraphicTileTexureCoords> vTmpBorderCornersTexCoords;
+
+	if(!DoTextureCoords)
+	{
+		vTmpTiles.reserve((size_t)pTMap->m_Width * pTMap->m_Height);
+		vTmpBorderTopTiles.reserve((size_t)pTMap->m_Width);
+		vTmpBorderBottomTiles.reserve((size_t)pTMap->m_Width);
+		vTmpBorderLeftTiles.reserve((size_t)pTMap->m_Height);
+		vTmpBorderRightTiles.reserve((size_t)pTMap->m_Height);
+		vTmpBorderCorners.reserve((size_t)4);
+	}
+	else
+	{
+		vTmpTileTexCoords.reserve((size_t)pTMap->m_Width * pTMap->m_Height);
+		vTmpBorderTopTilesTexCoords.reserve((size_t)pTMap->m_Width);
+		vTmpBorderBottomTilesTexCoords.reserve((size_t)pTMap->m_Width);
+		vTmpBorderLeftTilesTexCoords.reserve((size_t)pTMap->m_Height);
+		vTmpBorderRightTilesTexCoords.reserve((size_t)pTMap->m_Height);
+		vTmpBorderCornersTexCoords.reserve((size_t)4);
+	}
+
+	int x = 0;
+	int y = 0;
+	for(y = 0; y < pTMap->m_Height; ++y)
+	{
+		for(x = 0; x < pTMap->m_Width; ++x)
+		{
+			unsigned char Index = 0;
+			unsigned char Flags = 0;
+			int AngleRotate = -1;
+			if(IsEntityLayer)
+			{
+				if(IsGameLayer)
+				{
+					Index = ((CTile *)pTiles)[y * pTMap->m_Width + x].m_Index;
+					Flags = ((CTile *)pTiles)[y * pTMap->m_Width + x].m_Flags;
+				}
+				if(IsFrontLayer)
+				{
+					Index = ((CTile *)pTiles)[y * pTMap->m_Width + x].m_Index;
+					Flags = ((CTile *)pTiles)[y * pTMap->m_Width + x].m_Flags;
+				}
+				if(IsSwitchLayer)
+				{
+					Flags = 0;
+					Index = ((CSwitchTile *)pTiles)[y * pTMap->m_Width + x].m_Type;
+					if(CurOverlay == 0)
+					{
+						Flags = ((CSwitchTile *)pTiles)[y * pTMap->m_Width + x].m_Flags;
+						if(Index == TILE_SWITCHTIMEDOPEN)
+							Index = 8;
+					}
+					else if(CurOverlay == 1)
+						Index = ((CSwitchTile *)pTiles)[y * pTMap->m_Width + x].m_Number;
+					else if(CurOverlay == 2)
+						Index = ((CSwitchTile *)pTiles)[y * pTMap->m_Width + x].m_Delay;
+				}
+				if(IsTeleLayer)
+				{
+					Index = ((CTeleTile *)pTiles)[y * pTMap->m_Width + x].m_Type;
+					Flags = 0;
+					if(CurOverlay == 1)
+					{
+						if(IsTeleTileNumberUsed(Index))
+							Index = ((CTeleTile *)pTiles)[y * pTMap->m_Width + x].m_Number;
+						else
+							Index = 0;
+					}
+				}
+				if(IsSpeedupLayer)
+				{
+					Index = ((CSpeedupTile *)pTiles)[y * pTMap->m_Width + x].m_Type;
+					Flags = 0;
+					AngleRotate = ((CSpeedupTile *)pTiles)[y * pTMap->m_Width + x].m_Angle;
+					if(((CSpeedupTile *)pTiles)[y * pTMap->m_Width + x].m_Force == 0)
+						Index = 0;
+					else if(CurOverlay == 1)
+						Index = ((CSpeedupTile *)pTiles)[y * pTMap->m_Width + x].m_Force;
+					else if(CurOverlay == 2)
+						Index = ((CSpeedupTile *)pTiles)[y * pTMap->m_Width + x].m_MaxSpeed;
+				}
+				if(IsTuneLayer)
+				{
+					Index = ((CTuneTile *)pTiles)[y * pTMap->m_Width + x].m_Type;
+					Flags = 0;
+				}
+			}
+			else
+			{
+				Index = ((CTile *)pTiles)[y * pTMap->m_Width + x].m_Index;
+				Flags = ((CTile *)pTiles)[y * pTMap->m_Width + x].m_Flags;
+			}
+
+			//the amount of tiles handled before this tile
+			int TilesHandledCount = vTmpTiles.size();
+			Visuals.m_pTilesOfLayer[y * pTMap->m_Width + x].SetIndexBufferByteOffset((offset_ptr32)(TilesHandledCount * 6 * sizeof(unsigned int)));
+
+			bool AddAsSpeedup = false;
+			if(IsSpeedupLayer && CurOverlay == 0)
+				AddAsSpeedup = true;
+
+			if(AddTile(vTmpTiles, vTmpTileTexCoords, As3DTextureCoords, Index, Flags, x, y, pGroup, DoTextureCoords, AddAsSpeedup, AngleRotate))
+				Visuals.m_pTilesOfLayer[y * pTMap->m_Width + x].Draw(true);
+
+			//do the border tiles
+			if(x == 0)
+			{
+				if(y == 0)
+				{
+					Visuals.m_BorderTopLeft.SetIndexBufferByteOffset((offset_ptr32)(vTmpBorderCorners.size() * 6 * sizeof(unsigned int)));
+					if(AddTile(vTmpBorderCorners, vTmpBorderCornersTexCoords, As3DTextureCoords, Index, Flags, x, y, pGroup, DoTextureCoords, AddAsSpeedup, AngleRotate))
+						Visuals.m_BorderTopLeft.Draw(true);
+				}
+				else if(y == pTMap->m_Height - 1)
+				{
+					Visuals.m_BorderBottomLeft.SetIndexBufferByteOffset((offset_ptr32)(vTmpBorderCorners.size() * 6 * sizeof(unsigned int)));
+					if(AddTile(vTmpBorderCorners, vTmpBorderCornersTexCoords, As3DTextureCoords, Index, Flags, x, y, pGroup, DoTextureCoords, AddAsSpeedup, AngleRotate))
+						Visuals.m_BorderBottomLeft.Draw(true);
+				}
+				else
+				{
+					Visuals.m_pBorderLeft[y - 1].SetIndexBufferByteOffset((offset_ptr32)(vTmpBorderLeftTiles.size() * 6 * sizeof(unsigned int)));
+					if(AddTile(vTmpBorderLeftTiles, vTmpBorderLeftTilesTexCoords, As3DTextureCoords, Index, Flags, x, y, pGroup, DoTextureCoords, AddAsSpeedup, AngleRotate))
+						Visuals.m_pBorderLeft[y - 1].Draw(true);
+				}
+			}
+			else if(x == pTMap->m_Width - 1)
+			{
+				if(y == 0)
+				{
+					Visuals.m_BorderTopRight.SetIndexBufferByteOffset((offset_ptr32)(vTmpBorderCorners.size() * 6 * sizeof(unsigned int)));
+					if(AddTile(vTmpBorderCorners, vTmpBorderCornersTexCoords, As3DTextureCoords, Index, Flags, x, y, pGroup, DoTextureCoords, AddAsSpeedup, AngleRotate))
+						Visuals.m_BorderTopRight.Draw(true);
+				}
+				else if(y == pTMap->m_Height - 1)
+				{
+					Visuals.m_BorderBottomRight.SetIndexBufferByteOffset((offset_ptr32)(vTmpBorderCorners.size() * 6 * sizeof(unsigned int)));
+					if(AddTile(vTmpBorderCorners, vTmpBorderCornersTexCoords, As3DTextureCoords, Index, Flags, x, y, pGroup, DoTextureCoords, AddAsSpeedup, AngleRotate))
+						Visuals.m_BorderBottomRight.Draw(true);
+				}
+				else
+				{
+					Visuals.m_pBorderRight[y - 1].SetIndexBufferByteOffset((offset_ptr32)(vTmpBorderRightTiles.size() * 6 * sizeof(unsigned int)));
+					if(AddTile(vTmpBorderRightTiles, vTmpBorderRightTilesTexCoords, As3DTextureCoords, Index, Flags, x, y, pGroup, DoTextureCoords, AddAsSpeedup, AngleRotate))
+						Visuals.m_pBorderRight[y - 1].Draw(true);
+				}
+			}
+			else if(y == 0)
+			{
+				if(x > 0 && x < pTMap->m_Width - 1)
+				{
+					Visuals.m_pBorderTop[x - 1].SetIndexBufferByteOffset((offset_ptr32)(vTmpBorderTopTiles.size() * 6 * sizeof(unsigned int)));
+					if(AddTile(vTmpBorderTopTiles, vTmpBorderTopTilesTexCoords, As3DTextureCoords, Index, Flags, x, y, pGroup, DoTextureCoords, AddAsSpeedup, AngleRotate))
+						Visuals.m_pBorderTop[x - 1].Draw(true);
+				}
+			}
+			else if(y == pTMap->m_Height - 1)
+			{
+				if(x > 0 && x < pTMap->m_Width - 1)
+				{
+					Visuals.m_pBorderBottom[x - 1].SetIndexBufferByteOffset((offset_ptr32)(vTmpBorderBottomTiles.size() * 6 * sizeof(unsigned int)));
+					if(AddTile(vTmpBorderBottomTiles, vTmpBorderBottomTilesTexCoords, As3DTextureCoords, Index, Flags, x, y, pGroup, DoTextureCoords, AddAsSpeedup, AngleRotate))
+						Visuals.m_pBorderBottom[x - 1].Draw(true);
+				}
+			}
+		}
+	}
+
+	//append one kill tile to the gamelayer
+	if(IsGameLayer)
+	{
+		Visuals.m_BorderKillTile.SetIndexBufferByteOffset((offset_ptr32)(vTmpTiles.size() * 6 * sizeof(unsigned int)));
+		if(AddTile(vTmpTiles, vTmpTileTexCoords, As3DTextureCoords, TILE_DEATH, 0, 0, 0, pGroup, DoTextureCoords))
+			Visuals.m_BorderKillTile.Draw(true);
+	}
+
+	//add the border corners, then the borders and fix their byte offsets
+	int TilesHandledCount = vTmpTiles.size();
+	Visuals.m_BorderTopLeft.AddIndexBufferByteOffset(TilesHandledCount * 6 * sizeof(unsigned int));
+	Visuals.m_BorderTopRight.AddIndexBufferByteOffset(TilesHandledCount * 6 * sizeof(unsigned int));
+	Visuals.m_BorderBottomLeft.AddIndexBufferByteOffset(TilesHandledCount * 6 * sizeof(unsigned int));
+	Visuals.m_BorderBottomRight.AddIndexBufferByteOffset(TilesHandledCount * 6 * sizeof(unsigned int));
+	//add the Corners to the tiles
+	vTmpTiles.insert(vTmpTiles.end(), vTmpBorderCorners.begin(), vTmpBorderCorners.end());
+	vTmpTileTexCoords.insert(vTmpTileTexCoords.end(), vTmpBorderCornersTexCoords.begin(), vTmpBorderCornersTexCoords.end());
+
+	//now the borders
+	TilesHandledCount = vTmpTiles.size();
+	if(pTMap->m_Width > 2)
+	{
+		for(int i = 0; i < pTMap->m_Width - 2; ++i)
+		{
+			Visuals.m_pBorderTop[i].AddIndexBufferByteOffset(TilesHandledCount * 6 * sizeof(unsigned int));
+		}
+	}
+	vTmpTiles.insert(vTmpTiles.end(), vTmpBorderTopTiles.begin(), vTmpBorderTopTiles.end());
+	vTmpTileTexCoords.insert(vTmpTileTexCoords.end(), vTmpBorderTopTilesTexCoords.begin(), vTmpBorderTopTilesTexCoords.end());
+
+	TilesHandledCount = vTmpTiles.size();
+	if(pTMap->m_Width > 2)
+	{
+		for(int i = 0; i < pTMap->m_Width - 2; ++i)
+		{
+			Visuals.m_pBorderBottom[i].AddIndexBufferByteOffset(TilesHandledCount * 6 * sizeof(unsigned int));
+		}
+	}
+	vTmpTiles.insert(vTmpTiles.end(), vTmpBorderBottomTiles.begin(), vTmpBorderBottomTiles.end());
+	vTmpTileTexCoords.insert(vTmpTileTexCoords.end(), vTmpBorderBottomTilesTexCoords.begin(), vTmpBorderBottomTilesTexCoords.end());
+
+	TilesHandledCount = vTmpTiles.size();
+	if(pTMap->m_Height > 2)
+	{
+		for(int i = 0; i < pTMap->m_Height - 2; ++i)
+		{
+			Visuals.m_pBorderLeft[i].AddIndexBufferByteOffset(TilesHandledCount * 6 * sizeof(unsigned int));
+		}
+	}
+	vTmpTiles.insert(vTmpTiles.end(), vTmpBorderLeftTiles.begin(), vTmpBorderLeftTiles.end());
+	vTmpTileTexCoords.insert(vTmpTileTexCoords.end(), vTmpBorderLeftTilesTexCoords.begin(), vTmpBorderLeftTilesTexCoords.end());
+
+	TilesHandledCount = vTmpTiles.size();
+	if(pTMap->m_Height > 2)
+	{
+		for(int i = 0; i < pTMap->m_Height - 2; ++i)
+		{
+			Visuals.m_pBorderRight[i].AddIndexBufferByteOffset(TilesHandledCount * 6 * sizeof(unsigned int));
+		}
+	}
+	vTmpTiles.insert(vTmpTiles.end(), vTmpBorderRightTiles.begin(), vTmpBorderRightTiles.end());
+	vTmpTileTexCoords.insert(vTmpTileTexCoords.end(), vTmpBorderRightTilesTexCoords.begin(), vTmpBorderRightTilesTexCoords.end());
+
+	//setup params
+	float *pTmpTiles = vTmpTiles.empty() ? NULL : (float *)vTmpTiles.data();
+	unsigned char *pTmpTileTexCoords = vTmpTileTexCoords.empty() ? NULL : (unsigned char *)vTmpTileTexCoords.data();
+
+	m_NumTiles = vTmpTiles.size();
+	m_UploadDataSize = vTmpTileTexCoords.size() * sizeof(SGraphicTileTexureCoords) + vTmpTiles.size() * sizeof(SGraphicTile);
+	if(m_UploadDataSize > 0)
+	{
+		m_pUploadData = (char *)malloc(sizeof(char) * m_UploadDataSize);
+
+		mem_copy_special(m_pUploadData, pTmpTiles, sizeof(vec2), vTmpTiles.size() * 4, (DoTextureCoords ? sizeof(vec3) : 0));
+		if(DoTextureCoords)
+		{
+			mem_copy_special(m_pUploadData + sizeof(vec2), pTmpTileTexCoords, sizeof(vec3), vTmpTiles.size() * 4, sizeof(vec2));
+		}
+	}
+}
+
+void CMapLayers::AddTileLayerJobs(CLayers *pLayers, CMapItemLayerTilemap *pTMap, CMapItemGroup *pGroup, bool As3DTextureCoords, std::vector<STileLayerVisuals *> &vpVisuals, std::vector<std::shared_ptr<CTileLayerBufferJob>> &vpJobs)
+{
+	const bool IsGameLayer = pTMap == pLayers->GameLayer();
+	const bool IsFrontLayer = pTMap == pLayers->FrontLayer();
+	const bool IsSwitchLayer = pTMap == pLayers->SwitchLayer();
+	const bool IsTeleLayer = pTMap == pLayers->TeleLayer();
+	const bool IsSpeedupLayer = pTMap == pLayers->SpeedupLayer();
+	const bool IsTuneLayer = pTMap == pLayers->TuneLayer();
+	const bool IsEntityLayer = IsGameLayer || IsFrontLayer || IsSwitchLayer || IsTeleLayer || IsSpeedupLayer || IsTuneLayer;
+
+	bool DoTextureCoords = false;
+	if(pTMap->m_Image == -1)
+	{
+		if(IsEntityLayer)
+			DoTextureCoords = true;
+	}
+	else
+		DoTextureCoords = true;
+
+	int DataIndex = 0;
+	unsigned int TileSize = 0;
+	int OverlayCount = 0;
+	if(IsFrontLayer)
+	{
+		DataIndex = pTMap->m_Front;
+		TileSize = sizeof(CTile);
+	}
+	else if(IsSwitchLayer)
+	{
+		DataIndex = pTMap->m_Switch;
+		TileSize = sizeof(CSwitchTile);
+		OverlayCount = 2;
+	}
+	else if(IsTeleLayer)
+	{
+		DataIndex = pTMap->m_Tele;
+		TileSize = sizeof(CTeleTile);
+		OverlayCount = 1;
+	}
+	else if(IsSpeedupLayer)
+	{
+		DataIndex = pTMap->m_Speedup;
+		TileSize = sizeof(CSpeedupTile);
+		OverlayCount = 2;
+	}
+	else if(IsTuneLayer)
+	{
+		DataIndex = pTMap->m_Tune;
+		TileSize = sizeof(CTuneTile);
+	}
+	else
+	{
+		DataIndex = pTMap->m_Data;
+		TileSize = sizeof(CTile);
+	}
+	unsigned int Size = pLayers->Map()->GetDataSize(DataIndex);
+	void *pTiles = pLayers->Map()->GetData(DataIndex);
+
+	if(Size >= pTMap->m_Width * pTMap->m_Height * TileSize)
+	{
+		int CurOverlay = 0;
+		while(CurOverlay < OverlayCount + 1)
+		{
+			// We can later just count the tile layers to get the idx in the vector
+			vpVisuals.push_back(new STileLayerVisuals());
+			STileLayerVisuals &Visuals = *vpVisuals.back();
+			if(!Visuals.Init(pTMap->m_Width, pTMap->m_Height))
+			{
+				++CurOverlay;
+				continue;
+			}
+			Visuals.m_IsTextured = DoTextureCoords;
+
+			auto pJob = std::make_shared<CTileLayerBufferJob>(&Visuals, pTMap, pTiles, pGroup, CurOverlay, DoTextureCoords, As3DTextureCoords);
+			pJob->m_IsEntityLayer = IsEntityLayer;
+			pJob->m_IsGameLayer = IsGameLayer;
+			pJob->m_IsFrontLayer = IsFrontLayer;
+			pJob->m_IsSwitchLayer = IsSwitchLayer;
+			pJob->m_IsTeleLayer = IsTeleLayer;
+			pJob->m_IsSpeedupLayer = IsSpeedupLayer;
+			pJob->m_IsTuneLayer = IsTuneLayer;
+			vpJobs.push_back(std::move(pJob));
+
+			++CurOverlay;
+		}
+	}
+}
@@ -276,8 +276,8 @@ void CMenuBackground::LoadMenuBackground(bool HasDayHint, bool HasNightHint)
 		{
 			m_pLayers->InitBackground(m_pMap);
 
-			CMapLayers::OnMapLoad();
 			m_pImages->LoadBackground(m_pLayers, m_pMap);
+			CMapLayers::OnMapLoad();
 
 			// look for custom positions
 			CMapItemLayerTilemap *pTLayer = m_pLayers->GameLayer();
@@ -19,21 +19,72 @@ CParticles::CParticles()
 	m_RenderGeneral.m_pParts = this;
 }
 
-void CParticles::OnReset()
+void CParticles::CGroup::Add(const CParticle &Particle, float Life)
 {
-	// reset particles
-	for(int i = 0; i < MAX_PARTICLES; i++)
+	m_vPosX.push_back(Particle.m_Pos.x);
+	m_vPosY.push_back(Particle.m_Pos.y);
+	m_vVelX.push_back(Particle.m_Vel.x);
+	m_vVelY.push_back(Particle.m_Vel.y);
+	m_vGravity.push_back(Particle.m_Gravity);
+	m_vFriction.push_back(Particle.m_Friction);
+	m_vLife.push_back(Life);
+	m_vLifeSpan.push_back(Particle.m_LifeSpan);
+	m_vRot.push_back(Particle.m_Rot);
+	m_vRotspeed.push_back(Particle.m_Rotspeed);
+	m_vCollides.push_back(Particle.m_Collides);
+	m_vLook.push_back({Particle.m_Spr, Particle.m_StartSize, Particle.m_EndSize, Particle.m_UseAlphaFading, Particle.m_StartAlpha, Particle.m_EndAlpha, Particle.m_Color});
+}
+
+void CParticles::CGroup::Clear()
+{
+	m_vPosX.clear();
+	m_vPosY.clear();
+	m_vVelX.clear();
+	m_vVelY.clear();
+	m_vGravity.clear();
+	m_vFriction.clear();
+	m_vLife.clear();
+	m_vLifeSpan.clear();
+	m_vRot.clear();
+	m_vRotspeed.clear();
+	m_vCollides.clear();
+	m_vLook.clear();
+}
+
+template<typename T>
+static void CompactArray(std::vector<T> &vArray, const uint8_t *pKeep)
+{
+	size_t Kept = 0;
+	for(size_t i = 0; i < vArray.size(); i++)
 	{
-		m_aParticles[i].m_PrevPart = i - 1;
-		m_aParticles[i].m_NextPart = i + 1;
+		if(pKeep[i])
+			vArray[Kept++] = vArray[i];
 	}
+	vArray.resize(Kept);
+}
 
-	m_aParticles[0].m_PrevPart = 0;
-	m_aParticles[MAX_PARTICLES - 1].m_NextPart = -1;
-	m_FirstFree = 0;
+void CParticles::CGroup::Compact(const uint8_t *pKeep)
+{
+	CompactArray(m_vPosX, pKeep);
+	CompactArray(m_vPosY, pKeep);
+	CompactArray(m_vVelX, pKeep);
+	CompactArray(m_vVelY, pKeep);
+	CompactArray(m_vGravity, pKeep);
+	CompactArray(m_vFriction, pKeep);
+	CompactArray(m_vLife, pKeep);
+	CompactArray(m_vLifeSpan, pKeep);
+	CompactArray(m_vRot, pKeep);
+	CompactArray(m_vRotspeed, pKeep);
+	CompactArray(m_vCollides, pKeep);
+	CompactArray(m_vLook, pKeep);
+}
 
-	for(int &FirstPart : m_aFirstPart)
-		FirstPart = -1;
+void CParticles::OnReset()
+{
+	// reset particles
+	for(auto &Group : m_aGroups)
+		Group.Clear();
+	m_NumParticles = 0;
 }
 
 void CParticles::Add(int Group, CParticle *pPart, float TimePassed)
@@ -50,27 +101,88 @@ void CParticles::Add(int Group, CParticle *pPart, float TimePassed)
 			return;
 	}
 
-	if(m_FirstFree == -1)
+	if(m_NumParticles >= MAX_PARTICLES)
 		return;
 
-	// remove from the free list
-	int Id = m_FirstFree;
-	m_FirstFree = m_aParticles[Id].m_NextPart;
-	if(m_FirstFree != -1)
-		m_aParticles[m_FirstFree].m_PrevPart = -1;
+	m_aGroups[Group].Add(*pPart, TimePassed);
+	m_NumParticles++;
+}
+
+void CParticles::UpdateGroup(CGroup &Group, float TimePassed, int FrictionCount)
+{
+	const int Num = Group.Size();
+	if(Num == 0)
+		return;
 
-	// copy data
-	m_aParticles[Id] = *pPart;
+	float *pPosX = Group.m_vPosX.data();
+	float *pPosY = Group.m_vPosY.data();
+	float *pVelX = Group.m_vVelX.data();
+	float *pVelY = Group.m_vVelY.data();
+	const float *pGravity = Group.m_vGravity.data();
+	const float *pFriction = Group.m_vFriction.data();
+	float *pLife = Group.m_vLife.data();
+	const float *pLifeSpan = Group.m_vLifeSpan.data();
+	float *pRot = Group.m_vRot.data();
+	const float *pRotspeed = Group.m_vRotspeed.data();
+	const uint8_t *pCollides = Group.m_vCollides.data();
+
+	for(int i = 0; i < Num; i++)
+		pVelY[i] += pGravity[i] * TimePassed;
+
+	for(int f = 0; f < FrictionCount; f++) // apply friction
+	{
+		for(int i = 0; i < Num; i++)
+		{
+			pVelX[i] *= pFriction[i];
+			pVelY[i] *= pFriction[i];
+		}
+	}
+
+	// find the particles that hit something, only those don't move and bounce
+	m_vCollisionCandidates.clear();
+	m_vMove.assign(Num, 1);
+	uint8_t *pMove = m_vMove.data();
+	for(int i = 0; i < Num; i++)
+	{
+		if(pCollides[i] && Collision()->CheckPoint(pPosX[i] + pVelX[i] * TimePassed, pPosY[i] + pVelY[i] * TimePassed))
+		{
+			m_vCollisionCandidates.push_back(i);
+			pMove[i] = 0;
+		}
+	}
+	for(const int i : m_vCollisionCandidates)
+	{
+		vec2 Pos = vec2(pPosX[i], pPosY[i]);
+		vec2 Vel = vec2(pVelX[i], pVelY[i]) * TimePassed;
+		Collision()->MovePoint(&Pos, &Vel, random_float(0.1f, 1.0f), nullptr);
+		pVelX[i] = Vel.x * (1.0f / TimePassed);
+		pVelY[i] = Vel.y * (1.0f / TimePassed);
+	}
 
-	// insert to the group list
-	m_aParticles[Id].m_PrevPart = -1;
-	m_aParticles[Id].m_NextPart = m_aFirstPart[Group];
-	if(m_aFirstPart[Group] != -1)
-		m_aParticles[m_aFirstPart[Group]].m_PrevPart = Id;
-	m_aFirstPart[Group] = Id;
+	// move the points
+	for(int i = 0; i < Num; i++)
+	{
+		const float Move = pMove[i] ? TimePassed : 0.0f;
+		pPosX[i] += pVelX[i] * Move;
+		pPosY[i] += pVelY[i] * Move;
+		pLife[i] += TimePassed;
+		pRot[i] += TimePassed * pRotspeed[i];
+	}
 
-	// set some parameters
-	m_aParticles[Id].m_Life = TimePassed;
+	// check particle death
+	m_vKeep.resize(Num);
+	uint8_t *pKeep = m_vKeep.data();
+	int NumKept = 0;
+	for(int i = 0; i < Num; i++)
+	{
+		pKeep[i] = pLife[i] <= pLifeSpan[i];
+		NumKept += pKeep[i];
+	}
+	if(NumKept != Num)
+	{
+		Group.Compact(pKeep);
+		m_NumParticles -= Num - NumKept;
+	}
 }
 
 void CParticles::Update(float TimePassed)
@@ -91,56 +203,8 @@ void CParticles::Update(float TimePassed)
 		FrictionFraction -= 0.05f;
 	}
 
-	for(int &FirstPart : m_aFirstPart)
-	{
-		int i = FirstPart;
-		while(i != -1)
-		{
-			int Next = m_aParticles[i].m_NextPart;
-			//m_aParticles[i].vel += flow_get(m_aParticles[i].pos)*time_passed * m_aParticles[i].flow_affected;
-			m_aParticles[i].m_Vel.y += m_aParticles[i].m_Gravity * TimePassed;
-
-			for(int f = 0; f < FrictionCount; f++) // apply friction
-				m_aParticles[i].m_Vel *= m_aParticles[i].m_Friction;
-
-			// move the point
-			vec2 Vel = m_aParticles[i].m_Vel * TimePassed;
-			if(m_aParticles[i].m_Collides)
-			{
-				Collision()->MovePoint(&m_aParticles[i].m_Pos, &Vel, random_float(0.1f, 1.0f), NULL);
-			}
-			else
-			{
-				m_aParticles[i].m_Pos += Vel;
-			}
-			m_aParticles[i].m_Vel = Vel * (1.0f / TimePassed);
-
-			m_aParticles[i].m_Life += TimePassed;
-			m_aParticles[i].m_Rot += TimePassed * m_aParticles[i].m_Rotspeed;
-
-			// check particle death
-			if(m_aParticles[i].m_Life > m_aParticles[i].m_LifeSpan)
-			{
-				// remove it from the group list
-				if(m_aParticles[i].m_PrevPart != -1)
-					m_aParticles[m_aParticles[i].m_PrevPart].m_NextPart = m_aParticles[i].m_NextPart;
-				else
-					FirstPart = m_aParticles[i].m_NextPart;
-
-				if(m_aParticles[i].m_NextPart != -1)
-					m_aParticles[m_aParticles[i].m_NextPart].m_PrevPart = m_aParticles[i].m_PrevPart;
-
-				// insert to the free list
-				if(m_FirstFree != -1)
-					m_aParticles[m_FirstFree].m_PrevPart = i;
-				m_aParticles[i].m_PrevPart = -1;
-				m_aParticles[i].m_NextPart = m_FirstFree;
-				m_FirstFree = i;
-			}
-
-			i = Next;
-		}
-	}
+	for(auto &Group : m_aGroups)
+		UpdateGroup(Group, TimePassed, FrictionCount);
 }
 
 void CParticles::OnRender()
@@ -216,10 +280,13 @@ void CParticles::RenderGroup(int Group)
 		ParticleQuadContainerIndex = m_ExtraParticleQuadContainerIndex;
 	}
 
+	const CGroup &Parts = m_aGroups[Group];
+
+	// newest particles are rendered first, below the older ones
 	// don't use the buffer methods here, else the old renderer gets many draw calls
 	if(Graphics()->IsQuadContainerBufferingEnabled())
 	{
-		int i = m_aFirstPart[Group];
+		int i = Parts.Size() - 1;
 
 		static IGraphics::SRenderSpriteInfo s_aParticleRenderInfo[MAX_PARTICLES];
 
@@ -231,42 +298,44 @@ void CParticles::RenderGroup(int Group)
 
 		if(i != -1)
 		{
-			float Alpha = m_aParticles[i].m_Color.a;
-			if(m_aParticles[i].m_UseAlphaFading)
+			const SParticleLook &Look = Parts.m_vLook[i];
+			float Alpha = Look.m_Color.a;
+			if(Look.m_UseAlphaFading)
 			{
-				float a = m_aParticles[i].m_Life / m_aParticles[i].m_LifeSpan;
-				Alpha = mix(m_aParticles[i].m_StartAlpha, m_aParticles[i].m_EndAlpha, a);
+				float a = Parts.m_vLife[i] / Parts.m_vLifeSpan[i];
+				Alpha = mix(Look.m_StartAlpha, Look.m_EndAlpha, a);
 			}
-			LastColor.r = m_aParticles[i].m_Color.r;
-			LastColor.g = m_aParticles[i].m_Color.g;
-			LastColor.b = m_aParticles[i].m_Color.b;
+			LastColor.r = Look.m_Color.r;
+			LastColor.g = Look.m_Color.g;
+			LastColor.b = Look.m_Color.b;
 			LastColor.a = Alpha;
 
 			Graphics()->SetColor(
-				m_aParticles[i].m_Color.r,
-				m_aParticles[i].m_Color.g,
-				m_aParticles[i].m_Color.b,
+				Look.m_Color.r,
+				Look.m_Color.g,
+				Look.m_Color.b,
 				Alpha);
 
-			LastQuadOffset = m_aParticles[i].m_Spr;
+			LastQuadOffset = Look.m_Spr;
 		}
 
-		while(i != -1)
+		for(; i >= 0; i--)
 		{
-			int QuadOffset = m_aParticles[i].m_Spr;
-			float a = m_aParticles[i].m_Life / m_aParticles[i].m_LifeSpan;
-			vec2 p = m_aParticles[i].m_Pos;
-			float Size = mix(m_aParticles[i].m_StartSize, m_aParticles[i].m_EndSize, a);
-			float Alpha = m_aParticles[i].m_Color.a;
-			if(m_aParticles[i].m_UseAlphaFading)
+			const SParticleLook &Look = Parts.m_vLook[i];
+			int QuadOffset = Look.m_Spr;
+			float a = Parts.m_vLife[i] / Parts.m_vLifeSpan[i];
+			vec2 p = vec2(Parts.m_vPosX[i], Parts.m_vPosY[i]);
+			float Size = mix(Look.m_StartSize, Look.m_EndSize, a);
+			float Alpha = Look.m_Color.a;
+			if(Look.m_UseAlphaFading)
 			{
-				Alpha = mix(m_aParticles[i].m_StartAlpha, m_aParticles[i].m_EndAlpha, a);
+				Alpha = mix(Look.m_StartAlpha, Look.m_EndAlpha, a);
 			}
 
 			// the current position, respecting the size, is inside the viewport, render it, else ignore
 			if(ParticleIsVisibleOnScreen(p, Size))
 			{
-				if((size_t)CurParticleRenderCount == gs_GraphicsMaxParticlesRenderCount || LastColor.r != m_aParticles[i].m_Color.r || LastColor.g != m_aParticles[i].m_Color.g || LastColor.b != m_aParticles[i].m_Color.b || LastColor.a != Alpha || LastQuadOffset != QuadOffset)
+				if((size_t)CurParticleRenderCount == gs_GraphicsMaxParticlesRenderCount || LastColor.r != Look.m_Color.r || LastColor.g != Look.m_Color.g || LastColor.b != Look.m_Color.b || LastColor.a != Alpha || LastQuadOffset != QuadOffset)
 				{
 					Graphics()->TextureSet(aParticles[LastQuadOffset - FirstParticleOffset]);
 					Graphics()->RenderQuadContainerAsSpriteMultiple(ParticleQuadContainerIndex, LastQuadOffset - FirstParticleOffset, CurParticleRenderCount, s_aParticleRenderInfo);
@@ -274,26 +343,24 @@ void CParticles::RenderGroup(int Group)
 					LastQuadOffset = QuadOffset;
 
 					Graphics()->SetColor(
-						m_aParticles[i].m_Color.r,
-						m_aParticles[i].m_Color.g,
-						m_aParticles[i].m_Color.b,
+						Look.m_Color.r,
+						Look.m_Color.g,
+						Look.m_Color.b,
 						Alpha);
 
-					LastColor.r = m_aParticles[i].m_Color.r;
-					LastColor.g = m_aParticles[i].m_Color.g;
-					LastColor.b = m_aParticles[i].m_Color.b;
+					LastColor.r = Look.m_Color.r;
+					LastColor.g = Look.m_Color.g;
+					LastColor.b = Look.m_Color.b;
 					LastColor.a = Alpha;
 				}
 
 				s_aParticleRenderInfo[CurParticleRenderCount].m_Pos[0] = p.x;
 				s_aParticleRenderInfo[CurParticleRenderCount].m_Pos[1] = p.y;
 				s_aParticleRenderInfo[CurParticleRenderCount].m_Scale = Size;
-				s_aParticleRenderInfo[CurParticleRenderCount].m_Rotation = m_aParticles[i].m_Rot;
+				s_aParticleRenderInfo[CurParticleRenderCount].m_Rotation = Parts.m_vRot[i];
 
 				++CurParticleRenderCount;
 			}
-
-			i = m_aParticles[i].m_NextPart;
 		}
 
 		Graphics()->TextureSet(aParticles[LastQuadOffset - FirstParticleOffset]);
@@ -301,42 +368,39 @@ void CParticles::RenderGroup(int Group)
 	}
 	else
 	{
-		int i = m_aFirstPart[Group];
-
 		Graphics()->BlendNormal();
 		Graphics()->WrapClamp();
 
-		while(i != -1)
+		for(int i = Parts.Size() - 1; i >= 0; i--)
 		{
-			float a = m_aParticles[i].m_Life / m_aParticles[i].m_LifeSpan;
-			vec2 p = m_aParticles[i].m_Pos;
-			float Size = mix(m_aParticles[i].m_StartSize, m_aParticles[i].m_EndSize, a);
-			float Alpha = m_aParticles[i].m_Color.a;
-			if(m_aParticles[i].m_UseAlphaFading)
+			const SParticleLook &Look = Parts.m_vLook[i];
+			float a = Parts.m_vLife[i] / Parts.m_vLifeSpan[i];
+			vec2 p = vec2(Parts.m_vPosX[i], Parts.m_vPosY[i]);
+			float Size = mix(Look.m_StartSize, Look.m_EndSize, a);
+			float Alpha = Look.m_Color.a;
+			if(Look.m_UseAlphaFading)
 			{
-				Alpha = mix(m_aParticles[i].m_StartAlpha, m_aParticles[i].m_EndAlpha, a);
+				Alpha = mix(Look.m_StartAlpha, Look.m_EndAlpha, a);
 			}
 
 			// the current position, respecting the size, is inside the viewport, render it, else ignore
 			if(ParticleIsVisibleOnScreen(p, Size))
 			{
-				Graphics()->TextureSet(aParticles[m_aParticles[i].m_Spr - FirstParticleOffset]);
+				Graphics()->TextureSet(aParticles[Look.m_Spr - FirstParticleOffset]);
 				Graphics()->QuadsBegin();
 
-				Graphics()->QuadsSetRotation(m_aParticles[i].m_Rot);
+				Graphics()->QuadsSetRotation(Parts.m_vRot[i]);
 
 				Graphics()->SetColor(
-					m_aParticles[i].m_Color.r,
-					m_aParticles[i].m_Color.g,
-					m_aParticles[i].m_Color.b,
+					Look.m_Color.r,
+					Look.m_Color.g,
+					Look.m_Color.b,
 					Alpha);
 
 				IGraphics::CQuadItem QuadItem(p.x, p.y, Size, Size);
 				Graphics()->QuadsDraw(&QuadItem, 1);
 				Graphics()->QuadsEnd();
 			}
-
-			i = m_aParticles[i].m_NextPart;
 		}
 		Graphics()->WrapNormal();
 		Graphics()->BlendNormal();
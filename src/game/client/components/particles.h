@@ -2,9 +2,12 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #ifndef GAME_CLIENT_COMPONENTS_PARTICLES_H
 #define GAME_CLIENT_COMPONENTS_PARTICLES_H
+#include <base/color.h>
 #include <base/vmath.h>
 #include <game/client/component.h>
 
+#include <vector>
+
 // particles
 struct CParticle
 {
@@ -51,11 +54,6 @@ struct CParticle
 	ColorRGBA m_Color;
 
 	bool m_Collides;
-
-	// set by the particle system
-	float m_Life;
-	int m_PrevPart;
-	int m_NextPart;
 };
 
 class CParticles : public CComponent
@@ -90,12 +88,53 @@ private:
 		MAX_PARTICLES = 1024 * 8,
 	};
 
-	CParticle m_aParticles[MAX_PARTICLES];
-	int m_FirstFree;
-	int m_aFirstPart[NUM_GROUPS];
+	// properties that are only needed for rendering
+	struct SParticleLook
+	{
+		int m_Spr;
+		float m_StartSize;
+		float m_EndSize;
+		bool m_UseAlphaFading;
+		float m_StartAlpha;
+		float m_EndAlpha;
+		ColorRGBA m_Color;
+	};
+
+	// The particles of a group in the order they were added, with one array
+	// per property so the update loops can be vectorized.
+	class CGroup
+	{
+	public:
+		std::vector<float> m_vPosX;
+		std::vector<float> m_vPosY;
+		std::vector<float> m_vVelX;
+		std::vector<float> m_vVelY;
+		std::vector<float> m_vGravity;
+		std::vector<float> m_vFriction;
+		std::vector<float> m_vLife;
+		std::vector<float> m_vLifeSpan;
+		std::vector<float> m_vRot;
+		std::vector<float> m_vRotspeed;
+		std::vector<uint8_t> m_vCollides;
+		std::vector<SParticleLook> m_vLook;
+
+		int Size() const { return m_vLife.size(); }
+		void Add(const CParticle &Particle, float Life);
+		void Clear();
+		// keeps the particles for which `pKeep` is set, in their order
+		void Compact(const uint8_t *pKeep);
+	};
+
+	CGroup m_aGroups[NUM_GROUPS];
+	int m_NumParticles;
+	// reused by the update
+	std::vector<uint8_t> m_vMove;
+	std::vector<uint8_t> m_vKeep;
+	std::vector<int> m_vCollisionCandidates;
 
 	void RenderGroup(int Group);
 	void Update(float TimePassed);
+	void UpdateGroup(CGroup &Group, float TimePassed, int FrictionCount);
 
 	template<int TGROUP>
 	class CRenderGroup : public CComponent
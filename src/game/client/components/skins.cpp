@@ -3,9 +3,12 @@
 
 #include <base/math.h>
 #include <base/system.h>
+#include <algorithm>
+#include <chrono>
 #include <ctime>
 
 #include <engine/engine.h>
+#include <engine/gfx/image_loader.h>
 #include <engine/graphics.h>
 #include <engine/shared/config.h>
 #include <engine/storage.h>
@@ -17,29 +20,61 @@
 
 #include "skins.h"
 
+using namespace std::chrono_literals;
+
 bool CSkins::IsVanillaSkin(const char *pName)
 {
 	return std::any_of(std::begin(VANILLA_SKINS), std::end(VANILLA_SKINS), [pName](const char *pVanillaSkin) { return str_comp(pName, pVanillaSkin) == 0; });
 }
 
-int CSkins::CGetPngFile::OnCompletion(int State)
+CSkins::CGetPngFile::CGetPngFile(const char *pUrl, IStorage *pStorage, const char *pDest) :
+	CHttpRequest(pUrl)
 {
-	State = CHttpRequest::OnCompletion(State);
+	WriteToFile(pStorage, pDest, IStorage::TYPE_SAVE);
+	Timeout(CTimeout{0, 0, 0, 0});
+	LogProgress(HTTPLOG::NONE);
+}
 
-	if(State != HTTP_ERROR && State != HTTP_ABORTED && !m_pSkins->LoadSkinPNG(m_Info, Dest(), Dest(), IStorage::TYPE_SAVE))
-	{
-		State = HTTP_ERROR;
-	}
-	return State;
+CSkins::CSkinLoadJob::CSkinLoadJob(IStorage *pStorage, const char *pName, const char *pPath, int StorageType) :
+	m_pStorage(pStorage),
+	m_StorageType(StorageType),
+	m_Skin(pName)
+{
+	str_copy(m_aPath, pPath);
 }
 
-CSkins::CGetPngFile::CGetPngFile(CSkins *pSkins, const char *pUrl, IStorage *pStorage, const char *pDest) :
-	CHttpRequest(pUrl),
-	m_pSkins(pSkins)
+CSkins::CSkinLoadJob::~CSkinLoadJob()
 {
-	WriteToFile(pStorage, pDest, IStorage::TYPE_SAVE);
-	Timeout(CTimeout{0, 0, 0, 0});
-	LogProgress(HTTPLOG::NONE);
+	free(m_Info.m_pData);
+	free(m_InfoGrayscale.m_pData);
+}
+
+void CSkins::CSkinLoadJob::Run()
+{
+	void *pFileData;
+	unsigned FileSize;
+	if(!m_pStorage->ReadFile(m_aPath, m_StorageType, &pFileData, &FileSize))
+		return;
+	TImageByteBuffer ByteBuffer((uint8_t *)pFileData, (uint8_t *)pFileData + FileSize);
+	free(pFileData);
+
+	SImageByteBuffer ImageByteBuffer(&ByteBuffer);
+	uint8_t *pImgBuffer = nullptr;
+	EImageFormat ImageFormat;
+	int PngliteIncompatible;
+	if(!::LoadPNG(ImageByteBuffer, m_aPath, PngliteIncompatible, m_Info.m_Width, m_Info.m_Height, pImgBuffer, ImageFormat))
+		return;
+	m_Info.m_pData = pImgBuffer;
+
+	// the main thread loads the skin again to show the warnings
+	const CDataSprite &Body = g_pData->m_aSprites[SPRITE_TEE_BODY];
+	if(ImageFormat != IMAGE_FORMAT_RGBA || PngliteIncompatible != 0 ||
+		m_Info.m_Width == 0 || m_Info.m_Width % Body.m_pSet->m_Gridx != 0 ||
+		m_Info.m_Height == 0 || m_Info.m_Height % Body.m_pSet->m_Gridy != 0)
+		return;
+	m_Info.m_Format = CImageInfo::FORMAT_RGBA;
+
+	m_Prepared = PrepareSkin(m_Skin, m_Info, m_InfoGrayscale);
 }
 
 struct SSkinScanUser
@@ -65,13 +100,16 @@ int CSkins::SkinScan(const char *pName, int IsDir, int DirType, void *pUser)
 
 	// Don't add duplicate skins (one from user's config directory, other from
 	// client itself)
-	if(pSelf->m_Skins.find(aNameWithoutPng) != pSelf->m_Skins.end())
+	if(pSelf->m_Skins.find(aNameWithoutPng) != pSelf->m_Skins.end() || pSelf->m_LoadingSkins.find(aNameWithoutPng) != pSelf->m_LoadingSkins.end())
 		return 0;
 
 	char aBuf[IO_MAX_PATH_LENGTH];
 	str_format(aBuf, sizeof(aBuf), "skins/%s", pName);
-	pSelf->LoadSkin(aNameWithoutPng, aBuf, DirType);
-	pUserReal->m_SkinLoadedFunc((int)pSelf->m_Skins.size());
+	if(g_Config.m_ClThreadskinloading)
+		pSelf->AddLoadingSkin(aNameWithoutPng, aBuf, DirType);
+	else
+		pSelf->LoadSkin(aNameWithoutPng, aBuf, DirType);
+	pUserReal->m_SkinLoadedFunc((int)(pSelf->m_Skins.size() + pSelf->m_LoadingSkins.size()));
 	return 0;
 }
 
@@ -148,16 +186,17 @@ const CSkin *CSkins::LoadSkin(const char *pName, CImageInfo &Info)
 	}
 
 	CSkin Skin{pName};
-	Skin.m_OriginalSkin.m_Body = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_BODY]);
-	Skin.m_OriginalSkin.m_BodyOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_BODY_OUTLINE]);
-	Skin.m_OriginalSkin.m_Feet = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_FOOT]);
-	Skin.m_OriginalSkin.m_FeetOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_FOOT_OUTLINE]);
-	Skin.m_OriginalSkin.m_Hands = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_HAND]);
-	Skin.m_OriginalSkin.m_HandsOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_HAND_OUTLINE]);
-
-	for(int i = 0; i < 6; ++i)
-		Skin.m_OriginalSkin.m_aEyes[i] = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_EYE_NORMAL + i]);
+	CImageInfo Grayscale;
+	if(!PrepareSkin(Skin, Info, Grayscale))
+	{
+		Graphics()->FreePNG(&Info);
+		return nullptr;
+	}
+	return UploadSkin(std::move(Skin), Info, Grayscale);
+}
 
+bool CSkins::PrepareSkin(CSkin &Skin, const CImageInfo &Info, CImageInfo &Grayscale)
+{
 	int FeetGridPixelsWidth = (Info.m_Width / g_pData->m_aSprites[SPRITE_TEE_FOOT].m_pSet->m_Gridx);
 	int FeetGridPixelsHeight = (Info.m_Height / g_pData->m_aSprites[SPRITE_TEE_FOOT].m_pSet->m_Gridy);
 	int FeetWidth = g_pData->m_aSprites[SPRITE_TEE_FOOT].m_W * FeetGridPixelsWidth;
@@ -185,8 +224,8 @@ const CSkin *CSkins::LoadSkin(const char *pName, CImageInfo &Info)
 	int BodyWidth = g_pData->m_aSprites[SPRITE_TEE_BODY].m_W * (Info.m_Width / g_pData->m_aSprites[SPRITE_TEE_BODY].m_pSet->m_Gridx); // body width
 	int BodyHeight = g_pData->m_aSprites[SPRITE_TEE_BODY].m_H * (Info.m_Height / g_pData->m_aSprites[SPRITE_TEE_BODY].m_pSet->m_Gridy); // body height
 	if(BodyWidth > Info.m_Width || BodyHeight > Info.m_Height)
-		return nullptr;
-	unsigned char *pData = (unsigned char *)Info.m_pData;
+		return false;
+	const unsigned char *pData = (const unsigned char *)Info.m_pData;
 	const int PixelStep = 4;
 	int Pitch = Info.m_Width * PixelStep;
 
@@ -222,12 +261,16 @@ const CSkin *CSkins::LoadSkin(const char *pName, CImageInfo &Info)
 	CheckMetrics(Skin.m_Metrics.m_Feet, pData, Pitch, FeetOutlineOffsetX, FeetOutlineOffsetY, FeetOutlineWidth, FeetOutlineHeight);
 
 	// make the texture gray scale
+	Grayscale = Info;
+	Grayscale.m_pData = malloc((size_t)Info.m_Width * Info.m_Height * PixelStep);
+	mem_copy(Grayscale.m_pData, Info.m_pData, (size_t)Info.m_Width * Info.m_Height * PixelStep);
+	unsigned char *pGrayscaleData = (unsigned char *)Grayscale.m_pData;
 	for(int i = 0; i < Info.m_Width * Info.m_Height; i++)
 	{
-		int v = (pData[i * PixelStep] + pData[i * PixelStep + 1] + pData[i * PixelStep + 2]) / 3;
-		pData[i * PixelStep] = v;
-		pData[i * PixelStep + 1] = v;
-		pData[i * PixelStep + 2] = v;
+		int v = (pGrayscaleData[i * PixelStep] + pGrayscaleData[i * PixelStep + 1] + pGrayscaleData[i * PixelStep + 2]) / 3;
+		pGrayscaleData[i * PixelStep] = v;
+		pGrayscaleData[i * PixelStep + 1] = v;
+		pGrayscaleData[i * PixelStep + 2] = v;
 	}
 
 	int aFreq[256] = {0};
@@ -238,8 +281,8 @@ const CSkin *CSkins::LoadSkin(const char *pName, CImageInfo &Info)
 	for(int y = 0; y < BodyHeight; y++)
 		for(int x = 0; x < BodyWidth; x++)
 		{
-			if(pData[y * Pitch + x * PixelStep + 3] > 128)
-				aFreq[pData[y * Pitch + x * PixelStep]]++;
+			if(pGrayscaleData[y * Pitch + x * PixelStep + 3] > 128)
+				aFreq[pGrayscaleData[y * Pitch + x * PixelStep]]++;
 		}
 
 	for(int i = 1; i < 256; i++)
@@ -254,7 +297,7 @@ const CSkin *CSkins::LoadSkin(const char *pName, CImageInfo &Info)
 	for(int y = 0; y < BodyHeight; y++)
 		for(int x = 0; x < BodyWidth; x++)
 		{
-			int v = pData[y * Pitch + x * PixelStep];
+			int v = pGrayscaleData[y * Pitch + x * PixelStep];
 			if(v <= OrgWeight && OrgWeight == 0)
 				v = 0;
 			else if(v <= OrgWeight)
@@ -263,26 +306,43 @@ const CSkin *CSkins::LoadSkin(const char *pName, CImageInfo &Info)
 				v = NewWeight;
 			else
 				v = (int)(((v - OrgWeight) / (float)InvOrgWeight) * InvNewWeight + NewWeight);
-			pData[y * Pitch + x * PixelStep] = v;
-			pData[y * Pitch + x * PixelStep + 1] = v;
-			pData[y * Pitch + x * PixelStep + 2] = v;
+			pGrayscaleData[y * Pitch + x * PixelStep] = v;
+			pGrayscaleData[y * Pitch + x * PixelStep + 1] = v;
+			pGrayscaleData[y * Pitch + x * PixelStep + 2] = v;
 		}
 
-	Skin.m_ColorableSkin.m_Body = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_BODY]);
-	Skin.m_ColorableSkin.m_BodyOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_BODY_OUTLINE]);
-	Skin.m_ColorableSkin.m_Feet = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_FOOT]);
-	Skin.m_ColorableSkin.m_FeetOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_FOOT_OUTLINE]);
-	Skin.m_ColorableSkin.m_Hands = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_HAND]);
-	Skin.m_ColorableSkin.m_HandsOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_HAND_OUTLINE]);
+	return true;
+}
+
+const CSkin *CSkins::UploadSkin(CSkin &&Skin, CImageInfo &Info, CImageInfo &Grayscale)
+{
+	Skin.m_OriginalSkin.m_Body = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_BODY]);
+	Skin.m_OriginalSkin.m_BodyOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_BODY_OUTLINE]);
+	Skin.m_OriginalSkin.m_Feet = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_FOOT]);
+	Skin.m_OriginalSkin.m_FeetOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_FOOT_OUTLINE]);
+	Skin.m_OriginalSkin.m_Hands = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_HAND]);
+	Skin.m_OriginalSkin.m_HandsOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_HAND_OUTLINE]);
+
+	for(int i = 0; i < 6; ++i)
+		Skin.m_OriginalSkin.m_aEyes[i] = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_EYE_NORMAL + i]);
+
+	Skin.m_ColorableSkin.m_Body = Graphics()->LoadSpriteTexture(Grayscale, &g_pData->m_aSprites[SPRITE_TEE_BODY]);
+	Skin.m_ColorableSkin.m_BodyOutline = Graphics()->LoadSpriteTexture(Grayscale, &g_pData->m_aSprites[SPRITE_TEE_BODY_OUTLINE]);
+	Skin.m_ColorableSkin.m_Feet = Graphics()->LoadSpriteTexture(Grayscale, &g_pData->m_aSprites[SPRITE_TEE_FOOT]);
+	Skin.m_ColorableSkin.m_FeetOutline = Graphics()->LoadSpriteTexture(Grayscale, &g_pData->m_aSprites[SPRITE_TEE_FOOT_OUTLINE]);
+	Skin.m_ColorableSkin.m_Hands = Graphics()->LoadSpriteTexture(Grayscale, &g_pData->m_aSprites[SPRITE_TEE_HAND]);
+	Skin.m_ColorableSkin.m_HandsOutline = Graphics()->LoadSpriteTexture(Grayscale, &g_pData->m_aSprites[SPRITE_TEE_HAND_OUTLINE]);
 
 	for(int i = 0; i < 6; ++i)
-		Skin.m_ColorableSkin.m_aEyes[i] = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_EYE_NORMAL + i]);
+		Skin.m_ColorableSkin.m_aEyes[i] = Graphics()->LoadSpriteTexture(Grayscale, &g_pData->m_aSprites[SPRITE_TEE_EYE_NORMAL + i]);
 
 	Graphics()->FreePNG(&Info);
+	Graphics()->FreePNG(&Grayscale);
 
 	// set skin data
 	if(g_Config.m_Debug)
 	{
+		char aBuf[512];
 		str_format(aBuf, sizeof(aBuf), "load skin %s", Skin.GetName());
 		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
 	}
@@ -342,10 +402,36 @@ void CSkins::Refresh(TSkinLoadedCBFunc &&SkinLoadedFunc)
 	m_Skins.clear();
 	m_DownloadSkins.clear();
 	m_DownloadingSkins = 0;
+	// jobs that are still running finish on their own
+	m_LoadingSkins.clear();
+	m_vpUnqueuedSkins.clear();
+	m_vpQueuedSkins.clear();
 	SSkinScanUser SkinScanUser;
 	SkinScanUser.m_pThis = this;
 	SkinScanUser.m_SkinLoadedFunc = SkinLoadedFunc;
 	Storage()->ListDirectory(IStorage::TYPE_ALL, "skins", SkinScan, &SkinScanUser);
+	std::reverse(m_vpUnqueuedSkins.begin(), m_vpUnqueuedSkins.end());
+
+	// the default skin is the fallback for skins that are still loading, so
+	// it's needed right away, as is any skin if it's missing
+	const auto DefaultIt = m_LoadingSkins.find("default");
+	if(DefaultIt != m_LoadingSkins.end())
+	{
+		std::shared_ptr<CSkinLoadJob> pJob = DefaultIt->second;
+		pJob->m_Queued = true;
+		CJobPool::RunBlocking(pJob.get());
+		FinishLoadingSkin(pJob);
+	}
+	while(m_Skins.empty() && !m_vpUnqueuedSkins.empty())
+	{
+		std::shared_ptr<CSkinLoadJob> pJob = m_vpUnqueuedSkins.back();
+		m_vpUnqueuedSkins.pop_back();
+		if(pJob->m_Queued)
+			continue;
+		pJob->m_Queued = true;
+		CJobPool::RunBlocking(pJob.get());
+		FinishLoadingSkin(pJob);
+	}
 	if(m_Skins.empty())
 	{
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "gameclient", "failed to load skins. folder='skins/'");
@@ -356,6 +442,66 @@ void CSkins::Refresh(TSkinLoadedCBFunc &&SkinLoadedFunc)
 	}
 }
 
+void CSkins::OnRender()
+{
+	// skins that aren't referenced yet are loaded a few at a time, so
+	// referenced ones don't have to wait for all of them
+	while(m_vpQueuedSkins.size() < MAX_QUEUED_SKINS && !m_vpUnqueuedSkins.empty())
+	{
+		std::shared_ptr<CSkinLoadJob> pJob = std::move(m_vpUnqueuedSkins.back());
+		m_vpUnqueuedSkins.pop_back();
+		if(!pJob->m_Queued)
+			QueueLoadingSkin(pJob, IJob::PRIORITY_LOW);
+	}
+
+	// upload the textures of finished skins, as many as fit in the frame
+	const auto Deadline = time_get_nanoseconds() + 2ms;
+	bool Refind = false;
+	for(auto It = m_vpQueuedSkins.begin(); It != m_vpQueuedSkins.end() && time_get_nanoseconds() < Deadline;)
+	{
+		if((*It)->Status() != IJob::STATE_DONE)
+		{
+			++It;
+			continue;
+		}
+		std::shared_ptr<CSkinLoadJob> pJob = std::move(*It);
+		It = m_vpQueuedSkins.erase(It);
+		FinishLoadingSkin(pJob);
+		Refind |= pJob->m_Referenced;
+	}
+
+	// the players, ghosts, chat and kill messages that got the default skin
+	// get the loaded one, like after refreshing the skins
+	if(Refind)
+		GameClient()->RefindSkins();
+}
+
+void CSkins::AddLoadingSkin(const char *pName, const char *pPath, int DirType)
+{
+	auto pJob = std::make_shared<CSkinLoadJob>(Storage(), pName, pPath, DirType);
+	m_LoadingSkins.insert({pJob->m_Skin.GetName(), pJob});
+	m_vpUnqueuedSkins.push_back(std::move(pJob));
+}
+
+void CSkins::QueueLoadingSkin(const std::shared_ptr<CSkinLoadJob> &pJob, int Priority)
+{
+	pJob->m_Queued = true;
+	pJob->SetPriority(Priority);
+	m_vpQueuedSkins.push_back(pJob);
+	Engine()->AddJob(pJob);
+}
+
+const CSkin *CSkins::FinishLoadingSkin(const std::shared_ptr<CSkinLoadJob> &pJob)
+{
+	m_LoadingSkins.erase(pJob->m_Skin.GetName());
+	if(!pJob->m_Prepared)
+	{
+		// load it again to show the same warnings as before
+		return LoadSkin(pJob->m_Skin.GetName(), pJob->Path(), pJob->StorageType());
+	}
+	return UploadSkin(std::move(pJob->m_Skin), pJob->m_Info, pJob->m_InfoGrayscale);
+}
+
 int CSkins::Num()
 {
 	return m_Skins.size();
@@ -405,6 +551,16 @@ const CSkin *CSkins::FindImpl(const char *pName)
 	if(SkinIt != m_Skins.end())
 		return SkinIt->second.get();
 
+	const auto LoadingIt = m_LoadingSkins.find(pName);
+	if(LoadingIt != m_LoadingSkins.end())
+	{
+		// skins that are in use are loaded before all others
+		LoadingIt->second->m_Referenced = true;
+		if(!LoadingIt->second->m_Queued)
+			QueueLoadingSkin(LoadingIt->second, IJob::PRIORITY_HIGH);
+		return nullptr;
+	}
+
 	if(str_comp(pName, "default") == 0)
 		return nullptr;
 
@@ -422,10 +578,14 @@ const CSkin *CSkins::FindImpl(const char *pName)
 			char aPath[IO_MAX_PATH_LENGTH];
 			str_format(aPath, sizeof(aPath), "downloadedskins/%s.png", SkinDownloadIt->second->GetName());
 			Storage()->RenameFile(SkinDownloadIt->second->m_aPath, aPath, IStorage::TYPE_SAVE);
-			const auto *pSkin = LoadSkin(SkinDownloadIt->second->GetName(), SkinDownloadIt->second->m_pTask->m_Info);
 			SkinDownloadIt->second->m_pTask = nullptr;
 			--m_DownloadingSkins;
-			return pSkin;
+			if(!g_Config.m_ClThreadskinloading)
+				return LoadSkin(SkinDownloadIt->second->GetName(), aPath, IStorage::TYPE_SAVE);
+			AddLoadingSkin(SkinDownloadIt->second->GetName(), aPath, IStorage::TYPE_SAVE);
+			m_vpUnqueuedSkins.back()->m_Referenced = true;
+			QueueLoadingSkin(m_vpUnqueuedSkins.back(), IJob::PRIORITY_HIGH);
+			return nullptr;
 		}
 		if(SkinDownloadIt->second->m_pTask && (SkinDownloadIt->second->m_pTask->State() == HTTP_ERROR || SkinDownloadIt->second->m_pTask->State() == HTTP_ABORTED))
 		{
@@ -443,8 +603,9 @@ const CSkin *CSkins::FindImpl(const char *pName)
 	str_format(aUrl, sizeof(aUrl), "%s%s.png", g_Config.m_ClDownloadCommunitySkins != 0 ? g_Config.m_ClSkinCommunityDownloadUrl : g_Config.m_ClSkinDownloadUrl, aEscapedName);
 	char aBuf[IO_MAX_PATH_LENGTH];
 	str_format(Skin.m_aPath, sizeof(Skin.m_aPath), "downloadedskins/%s", IStorage::FormatTmpPath(aBuf, sizeof(aBuf), pName));
-	Skin.m_pTask = std::make_shared<CGetPngFile>(this, aUrl, Storage(), Skin.m_aPath);
-	m_pClient->Engine()->AddJob(Skin.m_pTask);
+	Skin.m_pTask = std::make_shared<CGetPngFile>(aUrl, Storage(), Skin.m_aPath);
+	Skin.m_pTask->SetPriority(IJob::PRIORITY_LOW);
+	HttpRun(Skin.m_pTask);
 	auto &&pDownloadSkin = std::make_unique<CDownloadSkin>(std::move(Skin));
 	m_DownloadSkins.insert({pDownloadSkin->GetName(), std::move(pDownloadSkin)});
 	++m_DownloadingSkins;
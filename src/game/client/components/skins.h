@@ -5,10 +5,13 @@
 
 #include <base/system.h>
 #include <engine/shared/http.h>
+#include <engine/shared/jobs.h>
 #include <game/client/component.h>
 #include <game/client/skin.h>
+#include <memory>
 #include <string_view>
 #include <unordered_map>
+#include <vector>
 
 class CSkins : public CComponent
 {
@@ -17,14 +20,37 @@ public:
 
 	class CGetPngFile : public CHttpRequest
 	{
-		CSkins *m_pSkins;
+	public:
+		CGetPngFile(const char *pUrl, IStorage *pStorage, const char *pDest);
+	};
+
+	// Decodes a skin and prepares its colorable variant. Images that would
+	// cause graphics warnings are left to the main thread.
+	class CSkinLoadJob : public IJob
+	{
+		IStorage *m_pStorage;
+		char m_aPath[IO_MAX_PATH_LENGTH];
+		int m_StorageType;
 
-	protected:
-		virtual int OnCompletion(int State) override;
+		void Run() override;
 
 	public:
-		CGetPngFile(CSkins *pSkins, const char *pUrl, IStorage *pStorage, const char *pDest);
+		CSkinLoadJob(IStorage *pStorage, const char *pName, const char *pPath, int StorageType);
+		~CSkinLoadJob() override;
+
+		const char *Path() const { return m_aPath; }
+		int StorageType() const { return m_StorageType; }
+
+		// metrics and blood color are filled in by the job
+		CSkin m_Skin;
 		CImageInfo m_Info;
+		CImageInfo m_InfoGrayscale;
+		bool m_Prepared = false;
+		// set once the job is added to the pool
+		bool m_Queued = false;
+		// set once the skin was looked up while loading, whoever looked it up
+		// got the default skin and has to find it again
+		bool m_Referenced = false;
 	};
 
 	struct CDownloadSkin
@@ -60,6 +86,7 @@ public:
 
 	virtual int Sizeof() const override { return sizeof(*this); }
 	void OnInit() override;
+	void OnRender() override;
 
 	void Refresh(TSkinLoadedCBFunc &&SkinLoadedFunc);
 	int Num();
@@ -82,9 +109,25 @@ private:
 	size_t m_DownloadingSkins = 0;
 	char m_aEventSkinPrefix[24];
 
+	enum
+	{
+		// skins that are loaded ahead of being referenced at once
+		MAX_QUEUED_SKINS = 16,
+	};
+	// skins that are found but not loaded yet, by name
+	std::unordered_map<std::string_view, std::shared_ptr<CSkinLoadJob>> m_LoadingSkins;
+	// loading skins that aren't queued yet, the next one at the back
+	std::vector<std::shared_ptr<CSkinLoadJob>> m_vpUnqueuedSkins;
+	std::vector<std::shared_ptr<CSkinLoadJob>> m_vpQueuedSkins;
+
 	bool LoadSkinPNG(CImageInfo &Info, const char *pName, const char *pPath, int DirType);
 	const CSkin *LoadSkin(const char *pName, const char *pPath, int DirType);
 	const CSkin *LoadSkin(const char *pName, CImageInfo &Info);
+	static bool PrepareSkin(CSkin &Skin, const CImageInfo &Info, CImageInfo &Grayscale);
+	const CSkin *UploadSkin(CSkin &&Skin, CImageInfo &Info, CImageInfo &Grayscale);
+	void AddLoadingSkin(const char *pName, const char *pPath, int DirType);
+	void QueueLoadingSkin(const std::shared_ptr<CSkinLoadJob> &pJob, int Priority);
+	const CSkin *FinishLoadingSkin(const std::shared_ptr<CSkinLoadJob> &pJob);
 	const CSkin *FindImpl(const char *pName);
 	static int SkinScan(const char *pName, int IsDir, int DirType, void *pUser);
 };
@@ -3356,6 +3356,8 @@ void CGameClient::RefindSkins()
 			const CSkin *pSkin = m_Skins.Find(Client.m_aSkinName);
 			Client.m_SkinInfo.m_OriginalRenderSkin = pSkin->m_OriginalSkin;
 			Client.m_SkinInfo.m_ColorableRenderSkin = pSkin->m_ColorableSkin;
+			Client.m_SkinInfo.m_SkinMetrics = pSkin->m_Metrics;
+			Client.m_SkinInfo.m_BloodColor = pSkin->m_BloodColor;
 		}
 		else
 		{
@@ -10,7 +10,9 @@ class IGameController;
 class CGameContext;
 class CGameWorld;
 class CCharacter;
+class CPacker;
 class CSaveTeam;
+class CUnpacker;
 
 class CSaveTee
 {
@@ -21,6 +23,9 @@ public:
 	void Load(CCharacter *pchr, int Team, bool IsSwap = false);
 	char *GetString(const CSaveTeam *pTeam);
 	int FromString(const char *pString);
+	void Pack(CPacker *pPacker, const CSaveTeam *pTeam) const;
+	// returns false if the data is corrupted
+	bool Unpack(CUnpacker *pUnpacker);
 	void LoadHookedPlayer(const CSaveTeam *pTeam);
 	bool IsHooking() const;
 	vec2 GetPos() const { return m_Pos; }
@@ -136,9 +141,17 @@ public:
 	CSaveTeam();
 	~CSaveTeam();
 	char *GetString();
+	// Compact encoding of the same state: a BINARY_PREFIX followed by the
+	// base64 of varints, compressed if that makes it smaller.
+	char *GetBinaryString();
 	int GetMembersCount() const { return m_MembersCount; }
+	// Accepts both the text and the binary encoding.
 	// MatchPlayers has to be called afterwards
 	int FromString(const char *pString);
+	// Converts a save string of either encoding to the binary one, e.g. to
+	// migrate stored text saves. Returns false if it can't be loaded or
+	// doesn't fit into pBuffer.
+	static bool ConvertToBinary(const char *pString, char *pBuffer, int BufferSize);
 	// returns true if a team can load, otherwise writes a nice error Message in pMessage
 	bool MatchPlayers(const char (*paNames)[MAX_NAME_LENGTH], const int *pClientID, int NumPlayer, char *pMessage, int MessageLen);
 	int Save(CGameContext *pGameServer, int Team, bool Dry = false);
@@ -149,8 +162,12 @@ public:
 	// returns true if an error occurred
 	static bool HandleSaveError(int Result, int ClientID, CGameContext *pGameContext);
 
+	// text saves start with a digit
+	static constexpr const char *BINARY_PREFIX = "#1";
+
 private:
 	CCharacter *MatchCharacter(CGameContext *pGameServer, int ClientID, int SaveID, bool KeepCurrentCharacter);
+	int FromBinaryString(const char *pString);
 
 	char m_aString[65536];
 
@@ -0,0 +1,820 @@
+#include "save.h"
+
+#include <cstdio> // sscanf
+
+#include <engine/shared/compression.h>
+#include <engine/shared/packer.h>
+#include <game/gamecore.h>
+
+#include <memory>
+#include <vector>
+
+#include <zlib.h>
+
+// The encodings of saves, separate from saving and loading the game state,
+// so they can be tested without a game server.
+
+CSaveTee::CSaveTee() = default;
+
+char *CSaveTee::GetString(const CSaveTeam *pTeam)
+{
+	int HookedPlayer = -1;
+	if(m_HookedPlayer != -1)
+	{
+		for(int n = 0; n < pTeam->GetMembersCount(); n++)
+		{
+			if(m_HookedPlayer == pTeam->m_pSavedTees[n].GetClientID())
+			{
+				HookedPlayer = n;
+				break;
+			}
+		}
+	}
+
+	str_format(m_aString, sizeof(m_aString),
+		"%s\t%d\t%d\t%d\t%d\t%d\t"
+		// weapons
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t"
+		// tee stats
+		"%d\t%d\t%d\t%d\t%d\t%d\t%d\t" // m_EndlessJump
+		"%d\t%d\t%d\t%d\t%d\t%d\t%d\t" // m_DDRaceState
+		"%d\t%d\t%d\t%d\t" // m_Pos.x
+		"%d\t%d\t" // m_TeleCheckpoint
+		"%d\t%d\t%f\t%f\t" // m_CorePos.x
+		"%d\t%d\t%d\t%d\t" // m_ActiveWeapon
+		"%d\t%d\t%f\t%f\t" // m_HookPos.x
+		"%d\t%d\t%d\t%d\t" // m_HookTeleBase.x
+		// time checkpoints
+		"%d\t%d\t%d\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%d\t" // m_NotEligibleForFinish
+		"%d\t%d\t%d\t" // tele weapons
+		"%s\t" // m_aGameUuid
+		"%d\t%d\t" // m_HookedPlayer, m_NewHook
+		"%d\t%d\t%d\t%d\t" // input stuff
+		"%d\t" // m_ReloadTimer
+		"%d\t" // m_TeeStarted
+		"%d\t" //m_LiveFreeze
+		"%f\t%f\t%d\t%d\t%d", // m_Ninja
+		m_aName, m_Alive, m_Paused, m_NeededFaketuning, m_TeeFinished, m_IsSolo,
+		// weapons
+		m_aWeapons[0].m_AmmoRegenStart, m_aWeapons[0].m_Ammo, m_aWeapons[0].m_Ammocost, m_aWeapons[0].m_Got,
+		m_aWeapons[1].m_AmmoRegenStart, m_aWeapons[1].m_Ammo, m_aWeapons[1].m_Ammocost, m_aWeapons[1].m_Got,
+		m_aWeapons[2].m_AmmoRegenStart, m_aWeapons[2].m_Ammo, m_aWeapons[2].m_Ammocost, m_aWeapons[2].m_Got,
+		m_aWeapons[3].m_AmmoRegenStart, m_aWeapons[3].m_Ammo, m_aWeapons[3].m_Ammocost, m_aWeapons[3].m_Got,
+		m_aWeapons[4].m_AmmoRegenStart, m_aWeapons[4].m_Ammo, m_aWeapons[4].m_Ammocost, m_aWeapons[4].m_Got,
+		m_aWeapons[5].m_AmmoRegenStart, m_aWeapons[5].m_Ammo, m_aWeapons[5].m_Ammocost, m_aWeapons[5].m_Got,
+		m_LastWeapon, m_QueuedWeapon,
+		// tee states
+		m_EndlessJump, m_Jetpack, m_NinjaJetpack, m_FreezeTime, m_FreezeStart, m_DeepFrozen, m_EndlessHook,
+		m_DDRaceState, m_HitDisabledFlags, m_CollisionEnabled, m_TuneZone, m_TuneZoneOld, m_HookHitEnabled, m_Time,
+		(int)m_Pos.x, (int)m_Pos.y, (int)m_PrevPos.x, (int)m_PrevPos.y,
+		m_TeleCheckpoint, m_LastPenalty,
+		(int)m_CorePos.x, (int)m_CorePos.y, m_Vel.x, m_Vel.y,
+		m_ActiveWeapon, m_Jumped, m_JumpedTotal, m_Jumps,
+		(int)m_HookPos.x, (int)m_HookPos.y, m_HookDir.x, m_HookDir.y,
+		(int)m_HookTeleBase.x, (int)m_HookTeleBase.y, m_HookTick, m_HookState,
+		// time checkpoints
+		m_TimeCpBroadcastEndTime, m_LastTimeCp, m_LastTimeCpBroadcasted,
+		m_aCurrentTimeCp[0], m_aCurrentTimeCp[1], m_aCurrentTimeCp[2], m_aCurrentTimeCp[3], m_aCurrentTimeCp[4],
+		m_aCurrentTimeCp[5], m_aCurrentTimeCp[6], m_aCurrentTimeCp[7], m_aCurrentTimeCp[8], m_aCurrentTimeCp[9],
+		m_aCurrentTimeCp[10], m_aCurrentTimeCp[11], m_aCurrentTimeCp[12], m_aCurrentTimeCp[13], m_aCurrentTimeCp[14],
+		m_aCurrentTimeCp[15], m_aCurrentTimeCp[16], m_aCurrentTimeCp[17], m_aCurrentTimeCp[18], m_aCurrentTimeCp[19],
+		m_aCurrentTimeCp[20], m_aCurrentTimeCp[21], m_aCurrentTimeCp[22], m_aCurrentTimeCp[23], m_aCurrentTimeCp[24],
+		m_NotEligibleForFinish,
+		m_HasTelegunGun, m_HasTelegunLaser, m_HasTelegunGrenade,
+		m_aGameUuid,
+		HookedPlayer, m_NewHook,
+		m_InputDirection, m_InputJump, m_InputFire, m_InputHook,
+		m_ReloadTimer,
+		m_TeeStarted,
+		m_LiveFrozen,
+		m_Ninja.m_ActivationDir.x, m_Ninja.m_ActivationDir.y, m_Ninja.m_ActivationTick, m_Ninja.m_CurrentMoveTime, m_Ninja.m_OldVelAmount);
+	return m_aString;
+}
+
+int CSaveTee::FromString(const char *pString)
+{
+	int Num;
+	Num = sscanf(pString,
+		"%[^\t]\t%d\t%d\t%d\t%d\t%d\t"
+		// weapons
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t"
+		// tee states
+		"%d\t%d\t%d\t%d\t%d\t%d\t%d\t" // m_EndlessJump
+		"%d\t%d\t%d\t%d\t%d\t%d\t%d\t" // m_DDRaceState
+		"%f\t%f\t%f\t%f\t" // m_Pos.x
+		"%d\t%d\t" // m_TeleCheckpoint
+		"%f\t%f\t%f\t%f\t" // m_CorePos.x
+		"%d\t%d\t%d\t%d\t" // m_ActiveWeapon
+		"%f\t%f\t%f\t%f\t" // m_HookPos.x
+		"%f\t%f\t%d\t%d\t" // m_HookTeleBase.x
+		// time checkpoints
+		"%d\t%d\t%d\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%d\t" // m_NotEligibleForFinish
+		"%d\t%d\t%d\t" // tele weapons
+		"%36s\t" // m_aGameUuid
+		"%d\t%d\t" // m_HookedPlayer, m_NewHook
+		"%d\t%d\t%d\t%d\t" // input stuff
+		"%d\t" // m_ReloadTimer
+		"%d\t" // m_TeeStarted
+		"%d\t" // m_LiveFreeze
+		"%f\t%f\t%d\t%d\t%d", // m_Ninja
+		m_aName, &m_Alive, &m_Paused, &m_NeededFaketuning, &m_TeeFinished, &m_IsSolo,
+		// weapons
+		&m_aWeapons[0].m_AmmoRegenStart, &m_aWeapons[0].m_Ammo, &m_aWeapons[0].m_Ammocost, &m_aWeapons[0].m_Got,
+		&m_aWeapons[1].m_AmmoRegenStart, &m_aWeapons[1].m_Ammo, &m_aWeapons[1].m_Ammocost, &m_aWeapons[1].m_Got,
+		&m_aWeapons[2].m_AmmoRegenStart, &m_aWeapons[2].m_Ammo, &m_aWeapons[2].m_Ammocost, &m_aWeapons[2].m_Got,
+		&m_aWeapons[3].m_AmmoRegenStart, &m_aWeapons[3].m_Ammo, &m_aWeapons[3].m_Ammocost, &m_aWeapons[3].m_Got,
+		&m_aWeapons[4].m_AmmoRegenStart, &m_aWeapons[4].m_Ammo, &m_aWeapons[4].m_Ammocost, &m_aWeapons[4].m_Got,
+		&m_aWeapons[5].m_AmmoRegenStart, &m_aWeapons[5].m_Ammo, &m_aWeapons[5].m_Ammocost, &m_aWeapons[5].m_Got,
+		&m_LastWeapon, &m_QueuedWeapon,
+		// tee states
+		&m_EndlessJump, &m_Jetpack, &m_NinjaJetpack, &m_FreezeTime, &m_FreezeStart, &m_DeepFrozen, &m_EndlessHook,
+		&m_DDRaceState, &m_HitDisabledFlags, &m_CollisionEnabled, &m_TuneZone, &m_TuneZoneOld, &m_HookHitEnabled, &m_Time,
+		&m_Pos.x, &m_Pos.y, &m_PrevPos.x, &m_PrevPos.y,
+		&m_TeleCheckpoint, &m_LastPenalty,
+		&m_CorePos.x, &m_CorePos.y, &m_Vel.x, &m_Vel.y,
+		&m_ActiveWeapon, &m_Jumped, &m_JumpedTotal, &m_Jumps,
+		&m_HookPos.x, &m_HookPos.y, &m_HookDir.x, &m_HookDir.y,
+		&m_HookTeleBase.x, &m_HookTeleBase.y, &m_HookTick, &m_HookState,
+		// time checkpoints
+		&m_TimeCpBroadcastEndTime, &m_LastTimeCp, &m_LastTimeCpBroadcasted,
+		&m_aCurrentTimeCp[0], &m_aCurrentTimeCp[1], &m_aCurrentTimeCp[2], &m_aCurrentTimeCp[3], &m_aCurrentTimeCp[4],
+		&m_aCurrentTimeCp[5], &m_aCurrentTimeCp[6], &m_aCurrentTimeCp[7], &m_aCurrentTimeCp[8], &m_aCurrentTimeCp[9],
+		&m_aCurrentTimeCp[10], &m_aCurrentTimeCp[11], &m_aCurrentTimeCp[12], &m_aCurrentTimeCp[13], &m_aCurrentTimeCp[14],
+		&m_aCurrentTimeCp[15], &m_aCurrentTimeCp[16], &m_aCurrentTimeCp[17], &m_aCurrentTimeCp[18], &m_aCurrentTimeCp[19],
+		&m_aCurrentTimeCp[20], &m_aCurrentTimeCp[21], &m_aCurrentTimeCp[22], &m_aCurrentTimeCp[23], &m_aCurrentTimeCp[24],
+		&m_NotEligibleForFinish,
+		&m_HasTelegunGun, &m_HasTelegunLaser, &m_HasTelegunGrenade,
+		m_aGameUuid,
+		&m_HookedPlayer, &m_NewHook,
+		&m_InputDirection, &m_InputJump, &m_InputFire, &m_InputHook,
+		&m_ReloadTimer,
+		&m_TeeStarted,
+		&m_LiveFrozen,
+		&m_Ninja.m_ActivationDir.x, &m_Ninja.m_ActivationDir.y, &m_Ninja.m_ActivationTick, &m_Ninja.m_CurrentMoveTime, &m_Ninja.m_OldVelAmount);
+	switch(Num) // Don't forget to update this when you save / load more / less.
+	{
+	case 96:
+		m_NotEligibleForFinish = false;
+		[[fallthrough]];
+	case 97:
+		m_HasTelegunGrenade = 0;
+		m_HasTelegunLaser = 0;
+		m_HasTelegunGun = 0;
+		FormatUuid(CalculateUuid("game-uuid-nonexistent@ddnet.tw"), m_aGameUuid, sizeof(m_aGameUuid));
+		[[fallthrough]];
+	case 101:
+		m_HookedPlayer = -1;
+		m_NewHook = false;
+		if(m_HookState == HOOK_GRABBED)
+			m_HookState = HOOK_FLYING;
+		m_InputDirection = 0;
+		m_InputJump = 0;
+		m_InputFire = 0;
+		m_InputHook = 0;
+		m_ReloadTimer = 0;
+		[[fallthrough]];
+	case 108:
+		m_TeeStarted = true;
+		[[fallthrough]];
+	case 109:
+		m_LiveFrozen = false;
+		[[fallthrough]];
+	case 110:
+		if(m_aWeapons[WEAPON_NINJA].m_Got)
+		{
+			// remove ninja
+			m_aWeapons[WEAPON_NINJA].m_Got = false;
+			m_aWeapons[WEAPON_NINJA].m_Ammo = 0;
+			m_ActiveWeapon = m_LastWeapon;
+		}
+		m_Ninja.m_ActivationDir.x = 0.0;
+		m_Ninja.m_ActivationDir.y = 0.0;
+		m_Ninja.m_ActivationTick = 0;
+		m_Ninja.m_CurrentMoveTime = 0;
+		m_Ninja.m_OldVelAmount = 0;
+		[[fallthrough]];
+	case 115:
+		return 0;
+	default:
+		dbg_msg("load", "failed to load tee-string");
+		dbg_msg("load", "loaded %d vars", Num);
+		return Num + 1; // never 0 here
+	}
+}
+
+// floats are stored bit by bit, so they don't lose precision
+static void PackFloat(CPacker *pPacker, float Value)
+{
+	int Bits;
+	static_assert(sizeof(Bits) == sizeof(Value));
+	mem_copy(&Bits, &Value, sizeof(Bits));
+	pPacker->AddInt(Bits);
+}
+
+static float UnpackFloat(CUnpacker *pUnpacker)
+{
+	int Bits = pUnpacker->GetInt();
+	float Value;
+	mem_copy(&Value, &Bits, sizeof(Value));
+	return Value;
+}
+
+void CSaveTee::Pack(CPacker *pPacker, const CSaveTeam *pTeam) const
+{
+	int HookedPlayer = -1;
+	if(m_HookedPlayer != -1)
+	{
+		for(int n = 0; n < pTeam->GetMembersCount(); n++)
+		{
+			if(m_HookedPlayer == pTeam->m_pSavedTees[n].GetClientID())
+			{
+				HookedPlayer = n;
+				break;
+			}
+		}
+	}
+
+	// same fields in the same order as the text encoding, positions are
+	// stored as integers as well to load the same state from both
+	pPacker->AddString(m_aName);
+	pPacker->AddInt(m_Alive);
+	pPacker->AddInt(m_Paused);
+	pPacker->AddInt(m_NeededFaketuning);
+	pPacker->AddInt(m_TeeFinished);
+	pPacker->AddInt(m_IsSolo);
+	for(const auto &Weapon : m_aWeapons)
+	{
+		pPacker->AddInt(Weapon.m_AmmoRegenStart);
+		pPacker->AddInt(Weapon.m_Ammo);
+		pPacker->AddInt(Weapon.m_Ammocost);
+		pPacker->AddInt(Weapon.m_Got);
+	}
+	pPacker->AddInt(m_LastWeapon);
+	pPacker->AddInt(m_QueuedWeapon);
+
+	pPacker->AddInt(m_EndlessJump);
+	pPacker->AddInt(m_Jetpack);
+	pPacker->AddInt(m_NinjaJetpack);
+	pPacker->AddInt(m_FreezeTime);
+	pPacker->AddInt(m_FreezeStart);
+	pPacker->AddInt(m_DeepFrozen);
+	pPacker->AddInt(m_EndlessHook);
+	pPacker->AddInt(m_DDRaceState);
+	pPacker->AddInt(m_HitDisabledFlags);
+	pPacker->AddInt(m_CollisionEnabled);
+	pPacker->AddInt(m_TuneZone);
+	pPacker->AddInt(m_TuneZoneOld);
+	pPacker->AddInt(m_HookHitEnabled);
+	pPacker->AddInt(m_Time);
+	pPacker->AddInt((int)m_Pos.x);
+	pPacker->AddInt((int)m_Pos.y);
+	pPacker->AddInt((int)m_PrevPos.x);
+	pPacker->AddInt((int)m_PrevPos.y);
+	pPacker->AddInt(m_TeleCheckpoint);
+	pPacker->AddInt(m_LastPenalty);
+	pPacker->AddInt((int)m_CorePos.x);
+	pPacker->AddInt((int)m_CorePos.y);
+	PackFloat(pPacker, m_Vel.x);
+	PackFloat(pPacker, m_Vel.y);
+	pPacker->AddInt(m_ActiveWeapon);
+	pPacker->AddInt(m_Jumped);
+	pPacker->AddInt(m_JumpedTotal);
+	pPacker->AddInt(m_Jumps);
+	pPacker->AddInt((int)m_HookPos.x);
+	pPacker->AddInt((int)m_HookPos.y);
+	PackFloat(pPacker, m_HookDir.x);
+	PackFloat(pPacker, m_HookDir.y);
+	pPacker->AddInt((int)m_HookTeleBase.x);
+	pPacker->AddInt((int)m_HookTeleBase.y);
+	pPacker->AddInt(m_HookTick);
+	pPacker->AddInt(m_HookState);
+
+	pPacker->AddInt(m_TimeCpBroadcastEndTime);
+	pPacker->AddInt(m_LastTimeCp);
+	pPacker->AddInt(m_LastTimeCpBroadcasted);
+	for(float TimeCp : m_aCurrentTimeCp)
+		PackFloat(pPacker, TimeCp);
+
+	pPacker->AddInt(m_NotEligibleForFinish);
+	pPacker->AddInt(m_HasTelegunGun);
+	pPacker->AddInt(m_HasTelegunLaser);
+	pPacker->AddInt(m_HasTelegunGrenade);
+	pPacker->AddString(m_aGameUuid);
+	pPacker->AddInt(HookedPlayer);
+	pPacker->AddInt(m_NewHook);
+	pPacker->AddInt(m_InputDirection);
+	pPacker->AddInt(m_InputJump);
+	pPacker->AddInt(m_InputFire);
+	pPacker->AddInt(m_InputHook);
+	pPacker->AddInt(m_ReloadTimer);
+	pPacker->AddInt(m_TeeStarted);
+	pPacker->AddInt(m_LiveFrozen);
+	PackFloat(pPacker, m_Ninja.m_ActivationDir.x);
+	PackFloat(pPacker, m_Ninja.m_ActivationDir.y);
+	pPacker->AddInt(m_Ninja.m_ActivationTick);
+	pPacker->AddInt(m_Ninja.m_CurrentMoveTime);
+	pPacker->AddInt(m_Ninja.m_OldVelAmount);
+}
+
+bool CSaveTee::Unpack(CUnpacker *pUnpacker)
+{
+	str_copy(m_aName, pUnpacker->GetString(CUnpacker::SANITIZE_CC), sizeof(m_aName));
+	m_Alive = pUnpacker->GetInt();
+	m_Paused = pUnpacker->GetInt();
+	m_NeededFaketuning = pUnpacker->GetInt();
+	m_TeeFinished = pUnpacker->GetInt();
+	m_IsSolo = pUnpacker->GetInt();
+	for(auto &Weapon : m_aWeapons)
+	{
+		Weapon.m_AmmoRegenStart = pUnpacker->GetInt();
+		Weapon.m_Ammo = pUnpacker->GetInt();
+		Weapon.m_Ammocost = pUnpacker->GetInt();
+		Weapon.m_Got = pUnpacker->GetInt();
+	}
+	m_LastWeapon = pUnpacker->GetInt();
+	m_QueuedWeapon = pUnpacker->GetInt();
+
+	m_EndlessJump = pUnpacker->GetInt();
+	m_Jetpack = pUnpacker->GetInt();
+	m_NinjaJetpack = pUnpacker->GetInt();
+	m_FreezeTime = pUnpacker->GetInt();
+	m_FreezeStart = pUnpacker->GetInt();
+	m_DeepFrozen = pUnpacker->GetInt();
+	m_EndlessHook = pUnpacker->GetInt();
+	m_DDRaceState = pUnpacker->GetInt();
+	m_HitDisabledFlags = pUnpacker->GetInt();
+	m_CollisionEnabled = pUnpacker->GetInt();
+	m_TuneZone = pUnpacker->GetInt();
+	m_TuneZoneOld = pUnpacker->GetInt();
+	m_HookHitEnabled = pUnpacker->GetInt();
+	m_Time = pUnpacker->GetInt();
+	m_Pos.x = pUnpacker->GetInt();
+	m_Pos.y = pUnpacker->GetInt();
+	m_PrevPos.x = pUnpacker->GetInt();
+	m_PrevPos.y = pUnpacker->GetInt();
+	m_TeleCheckpoint = pUnpacker->GetInt();
+	m_LastPenalty = pUnpacker->GetInt();
+	m_CorePos.x = pUnpacker->GetInt();
+	m_CorePos.y = pUnpacker->GetInt();
+	m_Vel.x = UnpackFloat(pUnpacker);
+	m_Vel.y = UnpackFloat(pUnpacker);
+	m_ActiveWeapon = pUnpacker->GetInt();
+	m_Jumped = pUnpacker->GetInt();
+	m_JumpedTotal = pUnpacker->GetInt();
+	m_Jumps = pUnpacker->GetInt();
+	m_HookPos.x = pUnpacker->GetInt();
+	m_HookPos.y = pUnpacker->GetInt();
+	m_HookDir.x = UnpackFloat(pUnpacker);
+	m_HookDir.y = UnpackFloat(pUnpacker);
+	m_HookTeleBase.x = pUnpacker->GetInt();
+	m_HookTeleBase.y = pUnpacker->GetInt();
+	m_HookTick = pUnpacker->GetInt();
+	m_HookState = pUnpacker->GetInt();
+
+	m_TimeCpBroadcastEndTime = pUnpacker->GetInt();
+	m_LastTimeCp = pUnpacker->GetInt();
+	m_LastTimeCpBroadcasted = pUnpacker->GetInt();
+	for(float &TimeCp : m_aCurrentTimeCp)
+		TimeCp = UnpackFloat(pUnpacker);
+
+	m_NotEligibleForFinish = pUnpacker->GetInt();
+	m_HasTelegunGun = pUnpacker->GetInt();
+	m_HasTelegunLaser = pUnpacker->GetInt();
+	m_HasTelegunGrenade = pUnpacker->GetInt();
+	str_copy(m_aGameUuid, pUnpacker->GetString(CUnpacker::SANITIZE_CC), sizeof(m_aGameUuid));
+	m_HookedPlayer = pUnpacker->GetInt();
+	m_NewHook = pUnpacker->GetInt();
+	m_InputDirection = pUnpacker->GetInt();
+	m_InputJump = pUnpacker->GetInt();
+	m_InputFire = pUnpacker->GetInt();
+	m_InputHook = pUnpacker->GetInt();
+	m_ReloadTimer = pUnpacker->GetInt();
+	m_TeeStarted = pUnpacker->GetInt();
+	m_LiveFrozen = pUnpacker->GetInt();
+	m_Ninja.m_ActivationDir.x = UnpackFloat(pUnpacker);
+	m_Ninja.m_ActivationDir.y = UnpackFloat(pUnpacker);
+	m_Ninja.m_ActivationTick = pUnpacker->GetInt();
+	m_Ninja.m_CurrentMoveTime = pUnpacker->GetInt();
+	m_Ninja.m_OldVelAmount = pUnpacker->GetInt();
+	return !pUnpacker->Error();
+}
+
+void CSaveTee::LoadHookedPlayer(const CSaveTeam *pTeam)
+{
+	if(m_HookedPlayer == -1)
+		return;
+	m_HookedPlayer = pTeam->m_pSavedTees[m_HookedPlayer].GetClientID();
+}
+
+CSaveTeam::CSaveTeam()
+{
+	m_aString[0] = '\0';
+}
+
+CSaveTeam::~CSaveTeam()
+{
+	delete[] m_pSwitchers;
+	delete[] m_pSavedTees;
+}
+
+char *CSaveTeam::GetString()
+{
+	str_format(m_aString, sizeof(m_aString), "%d\t%d\t%d\t%d\t%d", m_TeamState, m_MembersCount, m_HighestSwitchNumber, m_TeamLocked, m_Practice);
+
+	for(int i = 0; i < m_MembersCount; i++)
+	{
+		char aBuf[1024];
+		str_format(aBuf, sizeof(aBuf), "\n%s", m_pSavedTees[i].GetString(this));
+		str_append(m_aString, aBuf);
+	}
+
+	if(m_pSwitchers && m_HighestSwitchNumber)
+	{
+		for(int i = 1; i < m_HighestSwitchNumber + 1; i++)
+		{
+			char aBuf[64];
+			str_format(aBuf, sizeof(aBuf), "\n%d\t%d\t%d", m_pSwitchers[i].m_Status, m_pSwitchers[i].m_EndTime, m_pSwitchers[i].m_Type);
+			str_append(m_aString, aBuf);
+		}
+	}
+
+	return m_aString;
+}
+
+char *CSaveTeam::GetBinaryString()
+{
+	std::vector<unsigned char> vData;
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(m_TeamState);
+	Packer.AddInt(m_MembersCount);
+	Packer.AddInt(m_HighestSwitchNumber);
+	Packer.AddInt(m_TeamLocked);
+	Packer.AddInt(m_Practice);
+	vData.insert(vData.end(), Packer.Data(), Packer.Data() + Packer.Size());
+
+	// one tee always fits into the packer
+	for(int i = 0; i < m_MembersCount; i++)
+	{
+		Packer.Reset();
+		m_pSavedTees[i].Pack(&Packer, this);
+		dbg_assert(!Packer.Error(), "save tee too big");
+		vData.insert(vData.end(), Packer.Data(), Packer.Data() + Packer.Size());
+	}
+
+	for(int i = 1; i < m_HighestSwitchNumber + 1; i++)
+	{
+		Packer.Reset();
+		Packer.AddInt(m_pSwitchers ? m_pSwitchers[i].m_Status : 0);
+		Packer.AddInt(m_pSwitchers ? m_pSwitchers[i].m_EndTime : 0);
+		Packer.AddInt(m_pSwitchers ? m_pSwitchers[i].m_Type : 0);
+		vData.insert(vData.end(), Packer.Data(), Packer.Data() + Packer.Size());
+	}
+
+	// header: whether the data is compressed and its uncompressed size
+	std::vector<unsigned char> vCompressed(compressBound(vData.size()));
+	uLongf CompressedSize = vCompressed.size();
+	const bool Compressed = compress2(vCompressed.data(), &CompressedSize, vData.data(), vData.size(), Z_DEFAULT_COMPRESSION) == Z_OK && CompressedSize < vData.size();
+	Packer.Reset();
+	Packer.AddInt(Compressed);
+	Packer.AddInt(vData.size());
+	std::vector<unsigned char> vEncoded(Packer.Data(), Packer.Data() + Packer.Size());
+	if(Compressed)
+		vEncoded.insert(vEncoded.end(), vCompressed.data(), vCompressed.data() + CompressedSize);
+	else
+		vEncoded.insert(vEncoded.end(), vData.begin(), vData.end());
+
+	// the savegame column holds text
+	const int PrefixLength = str_length(BINARY_PREFIX);
+	str_copy(m_aString, BINARY_PREFIX, sizeof(m_aString));
+	str_base64(m_aString + PrefixLength, sizeof(m_aString) - PrefixLength, vEncoded.data(), vEncoded.size());
+	return m_aString;
+}
+
+int CSaveTeam::FromString(const char *pString)
+{
+	if(str_startswith(pString, BINARY_PREFIX))
+		return FromBinaryString(pString);
+
+	char aTeamStats[MAX_CLIENTS];
+	char aSwitcher[64];
+	char aSaveTee[1024];
+
+	char *pCopyPos;
+	unsigned int Pos = 0;
+	unsigned int LastPos = 0;
+	unsigned int StrSize;
+
+	str_copy(m_aString, pString, sizeof(m_aString));
+
+	while(m_aString[Pos] != '\n' && Pos < sizeof(m_aString) && m_aString[Pos]) // find next \n or \0
+		Pos++;
+
+	pCopyPos = m_aString + LastPos;
+	StrSize = Pos - LastPos + 1;
+	if(m_aString[Pos] == '\n')
+	{
+		Pos++; // skip \n
+		LastPos = Pos;
+	}
+
+	if(StrSize <= 0)
+	{
+		dbg_msg("load", "savegame: wrong format (couldn't load teamstats)");
+		return 1;
+	}
+
+	if(StrSize < sizeof(aTeamStats))
+	{
+		str_copy(aTeamStats, pCopyPos, StrSize);
+		int Num = sscanf(aTeamStats, "%d\t%d\t%d\t%d\t%d", &m_TeamState, &m_MembersCount, &m_HighestSwitchNumber, &m_TeamLocked, &m_Practice);
+		switch(Num) // Don't forget to update this when you save / load more / less.
+		{
+		case 4:
+			m_Practice = false;
+			[[fallthrough]];
+		case 5:
+			break;
+		default:
+			dbg_msg("load", "failed to load teamstats");
+			dbg_msg("load", "loaded %d vars", Num);
+			return Num + 1; // never 0 here
+		}
+	}
+	else
+	{
+		dbg_msg("load", "savegame: wrong format (couldn't load teamstats, too big)");
+		return 1;
+	}
+
+	if(m_pSavedTees)
+	{
+		delete[] m_pSavedTees;
+		m_pSavedTees = 0;
+	}
+
+	if(m_MembersCount > MAX_CLIENTS)
+	{
+		dbg_msg("load", "savegame: team has too many players");
+		return 1;
+	}
+	else if(m_MembersCount)
+	{
+		m_pSavedTees = new CSaveTee[m_MembersCount];
+	}
+
+	for(int n = 0; n < m_MembersCount; n++)
+	{
+		while(m_aString[Pos] != '\n' && Pos < sizeof(m_aString) && m_aString[Pos]) // find next \n or \0
+			Pos++;
+
+		pCopyPos = m_aString + LastPos;
+		StrSize = Pos - LastPos + 1;
+		if(m_aString[Pos] == '\n')
+		{
+			Pos++; // skip \n
+			LastPos = Pos;
+		}
+
+		if(StrSize <= 0)
+		{
+			dbg_msg("load", "savegame: wrong format (couldn't load tee)");
+			return 1;
+		}
+
+		if(StrSize < sizeof(aSaveTee))
+		{
+			str_copy(aSaveTee, pCopyPos, StrSize);
+			int Num = m_pSavedTees[n].FromString(aSaveTee);
+			if(Num)
+			{
+				dbg_msg("load", "failed to load tee");
+				dbg_msg("load", "loaded %d vars", Num - 1);
+				return 1;
+			}
+		}
+		else
+		{
+			dbg_msg("load", "savegame: wrong format (couldn't load tee, too big)");
+			return 1;
+		}
+	}
+
+	if(m_pSwitchers)
+	{
+		delete[] m_pSwitchers;
+		m_pSwitchers = 0;
+	}
+
+	if(m_HighestSwitchNumber)
+		m_pSwitchers = new SSimpleSwitchers[m_HighestSwitchNumber + 1];
+
+	for(int n = 1; n < m_HighestSwitchNumber + 1; n++)
+	{
+		while(m_aString[Pos] != '\n' && Pos < sizeof(m_aString) && m_aString[Pos]) // find next \n or \0
+			Pos++;
+
+		pCopyPos = m_aString + LastPos;
+		StrSize = Pos - LastPos + 1;
+		if(m_aString[Pos] == '\n')
+		{
+			Pos++; // skip \n
+			LastPos = Pos;
+		}
+
+		if(StrSize <= 0)
+		{
+			dbg_msg("load", "savegame: wrong format (couldn't load switcher)");
+			return 1;
+		}
+
+		if(StrSize < sizeof(aSwitcher))
+		{
+			str_copy(aSwitcher, pCopyPos, StrSize);
+			int Num = sscanf(aSwitcher, "%d\t%d\t%d", &(m_pSwitchers[n].m_Status), &(m_pSwitchers[n].m_EndTime), &(m_pSwitchers[n].m_Type));
+			if(Num != 3)
+			{
+				dbg_msg("load", "failed to load switcher");
+				dbg_msg("load", "loaded %d vars", Num - 1);
+			}
+		}
+		else
+		{
+			dbg_msg("load", "savegame: wrong format (couldn't load switcher, too big)");
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+bool CSaveTeam::ConvertToBinary(const char *pString, char *pBuffer, int BufferSize)
+{
+	// too large for the stack
+	auto pTeam = std::make_unique<CSaveTeam>();
+	if(pTeam->FromString(pString))
+		return false;
+	const char *pBinary = pTeam->GetBinaryString();
+	if(str_length(pBinary) >= BufferSize)
+		return false;
+	str_copy(pBuffer, pBinary, BufferSize);
+	return true;
+}
+
+int CSaveTeam::FromBinaryString(const char *pString)
+{
+	pString += str_length(BINARY_PREFIX);
+	std::vector<unsigned char> vEncoded(str_length(pString) / 4 * 3);
+	const int EncodedSize = str_base64_decode(vEncoded.data(), vEncoded.size(), pString);
+	if(EncodedSize < 0)
+	{
+		dbg_msg("load", "savegame: wrong format (invalid base64)");
+		return 1;
+	}
+
+	const unsigned char *pEnd = vEncoded.data() + EncodedSize;
+	int Compressed;
+	int DataSize;
+	const unsigned char *pPayload = CVariableInt::Unpack(vEncoded.data(), &Compressed, EncodedSize);
+	if(pPayload)
+		pPayload = CVariableInt::Unpack(pPayload, &DataSize, pEnd - pPayload);
+	// the uncompressed data is never larger than the text encoding
+	if(!pPayload || DataSize < 0 || DataSize > (int)sizeof(m_aString))
+	{
+		dbg_msg("load", "savegame: wrong format (invalid header)");
+		return 1;
+	}
+
+	std::vector<unsigned char> vData;
+	if(Compressed)
+	{
+		vData.resize(DataSize);
+		uLongf UncompressedSize = DataSize;
+		if(uncompress(vData.data(), &UncompressedSize, pPayload, pEnd - pPayload) != Z_OK || (int)UncompressedSize != DataSize)
+		{
+			dbg_msg("load", "savegame: wrong format (couldn't decompress)");
+			return 1;
+		}
+	}
+	else
+	{
+		vData.assign(pPayload, pEnd);
+	}
+
+	CUnpacker Unpacker;
+	Unpacker.Reset(vData.data(), vData.size());
+	m_TeamState = Unpacker.GetInt();
+	m_MembersCount = Unpacker.GetInt();
+	m_HighestSwitchNumber = Unpacker.GetInt();
+	m_TeamLocked = Unpacker.GetInt();
+	m_Practice = Unpacker.GetInt();
+	// every tee and switcher takes at least one byte
+	if(Unpacker.Error() || m_MembersCount < 0 || m_MembersCount > MAX_CLIENTS || m_HighestSwitchNumber < 0 || m_HighestSwitchNumber > (int)vData.size())
+	{
+		dbg_msg("load", "savegame: wrong format (couldn't load teamstats)");
+		return 1;
+	}
+
+	delete[] m_pSavedTees;
+	m_pSavedTees = nullptr;
+	if(m_MembersCount)
+		m_pSavedTees = new CSaveTee[m_MembersCount];
+	for(int n = 0; n < m_MembersCount; n++)
+	{
+		if(!m_pSavedTees[n].Unpack(&Unpacker))
+		{
+			dbg_msg("load", "failed to load tee");
+			return 1;
+		}
+	}
+
+	delete[] m_pSwitchers;
+	m_pSwitchers = nullptr;
+	if(m_HighestSwitchNumber)
+		m_pSwitchers = new SSimpleSwitchers[m_HighestSwitchNumber + 1];
+	for(int n = 1; n < m_HighestSwitchNumber + 1; n++)
+	{
+		m_pSwitchers[n].m_Status = Unpacker.GetInt();
+		m_pSwitchers[n].m_EndTime = Unpacker.GetInt();
+		m_pSwitchers[n].m_Type = Unpacker.GetInt();
+	}
+	if(Unpacker.Error())
+	{
+		dbg_msg("load", "failed to load switcher");
+		return 1;
+	}
+	return 0;
+}
+
+bool CSaveTeam::MatchPlayers(const char (*paNames)[MAX_NAME_LENGTH], const int *pClientID, int NumPlayer, char *pMessage, int MessageLen)
+{
+	if(NumPlayer > m_MembersCount)
+	{
+		str_format(pMessage, MessageLen, "Too many players in this team, should be %d", m_MembersCount);
+		return false;
+	}
+	// check for wrong players
+	for(int i = 0; i < NumPlayer; i++)
+	{
+		int Found = false;
+		for(int j = 0; j < m_MembersCount; j++)
+		{
+			if(str_comp(paNames[i], m_pSavedTees[j].GetName()) == 0)
+			{
+				Found = true;
+			}
+		}
+		if(!Found)
+		{
+			str_format(pMessage, MessageLen, "'%s' doesn't belong to this team", paNames[i]);
+			return false;
+		}
+	}
+	// check for missing players
+	for(int i = 0; i < m_MembersCount; i++)
+	{
+		int Found = false;
+		for(int j = 0; j < NumPlayer; j++)
+		{
+			if(str_comp(m_pSavedTees[i].GetName(), paNames[j]) == 0)
+			{
+				m_pSavedTees[i].SetClientID(pClientID[j]);
+				Found = true;
+				break;
+			}
+		}
+		if(!Found)
+		{
+			str_format(pMessage, MessageLen, "'%s' has to be in this team", m_pSavedTees[i].GetName());
+			return false;
+		}
+	}
+	// match hook to correct ClientID
+	for(int n = 0; n < m_MembersCount; n++)
+		m_pSavedTees[n].LoadHookedPlayer(this);
+	return true;
+}
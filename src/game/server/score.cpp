@@ -36,13 +36,85 @@ void CScore::ExecPlayerThread(
 	if(pResult == nullptr)
 		return;
 	auto Tmp = std::make_unique<CSqlPlayerRequest>(pResult);
-	str_copy(Tmp->m_aName, pName, sizeof(Tmp->m_aName));
+	FillPlayerRequest(Tmp.get(), ClientID, pName, Offset);
+
+	m_pPool->Execute(pFuncPtr, std::move(Tmp), pThreadName);
+}
+
+void CScore::FillPlayerRequest(CSqlPlayerRequest *pRequest, int ClientID, const char *pName, int Offset)
+{
+	str_copy(pRequest->m_aName, pName, sizeof(pRequest->m_aName));
+	str_copy(pRequest->m_aMap, g_Config.m_SvMap, sizeof(pRequest->m_aMap));
+	str_copy(pRequest->m_aServer, g_Config.m_SvSqlServerName, sizeof(pRequest->m_aServer));
+	str_copy(pRequest->m_aRequestingPlayer, Server()->ClientName(ClientID), sizeof(pRequest->m_aRequestingPlayer));
+	pRequest->m_Offset = Offset;
+}
+
+bool CScore::ShowFromLeaderboard(
+	void (*pFuncPtr)(const CScoreLeaderboardResult *, const CSqlPlayerRequest *),
+	int ClientID,
+	const char *pName,
+	int Offset)
+{
+	const CScoreLeaderboardResult *pLeaderboard = Leaderboard();
+	if(pLeaderboard == nullptr)
+		return false;
+
+	auto pResult = NewSqlPlayerResult(ClientID);
+	if(pResult == nullptr)
+		return true;
+	CSqlPlayerRequest Request(pResult);
+	FillPlayerRequest(&Request, ClientID, pName, Offset);
+	pFuncPtr(pLeaderboard, &Request);
+	// processed by the player like a finished database request
+	pResult->m_Success = true;
+	pResult->m_Completed.store(true);
+	return true;
+}
+
+void CScore::LoadLeaderboard()
+{
+	if(m_pLoadingLeaderboard)
+		return; // already in progress
+
+	m_pLoadingLeaderboard = std::make_shared<CScoreLeaderboardResult>();
+	m_LoadingLeaderboardTime = time_get();
+
+	auto Tmp = std::make_unique<CSqlLeaderboardRequest>(m_pLoadingLeaderboard);
 	str_copy(Tmp->m_aMap, g_Config.m_SvMap, sizeof(Tmp->m_aMap));
 	str_copy(Tmp->m_aServer, g_Config.m_SvSqlServerName, sizeof(Tmp->m_aServer));
-	str_copy(Tmp->m_aRequestingPlayer, Server()->ClientName(ClientID), sizeof(Tmp->m_aRequestingPlayer));
-	Tmp->m_Offset = Offset;
+	m_pPool->Execute(CScoreWorker::LoadLeaderboard, std::move(Tmp), "load leaderboard");
+}
 
-	m_pPool->Execute(pFuncPtr, std::move(Tmp), pThreadName);
+const CScoreLeaderboardResult *CScore::Leaderboard()
+{
+	if(!g_Config.m_SvSqlLeaderboard)
+		return nullptr;
+
+	if(m_pLoadingLeaderboard != nullptr && m_pLoadingLeaderboard->m_Completed)
+	{
+		if(m_pLoadingLeaderboard->m_Success)
+		{
+			for(const auto &[Name, Time] : m_vLeaderboardFinishes)
+			{
+				m_pLoadingLeaderboard->m_Global.Add(Name.c_str(), Time);
+				m_pLoadingLeaderboard->m_Regional.Add(Name.c_str(), Time);
+			}
+			m_pLeaderboard = m_pLoadingLeaderboard;
+			m_LeaderboardTime = m_LoadingLeaderboardTime;
+		}
+		m_pLoadingLeaderboard = nullptr;
+	}
+
+	const int64_t Now = time_get();
+	const int64_t Refresh = (int64_t)g_Config.m_SvSqlLeaderboardRefresh * time_freq();
+	if(m_pLoadingLeaderboard == nullptr && Now - m_LoadingLeaderboardTime > Refresh)
+		LoadLeaderboard();
+
+	// fall back to the database if reloading failed for a while
+	if(m_pLeaderboard == nullptr || Now - m_LeaderboardTime > 3 * Refresh || str_comp(m_pLeaderboard->m_aServer, g_Config.m_SvSqlServerName) != 0)
+		return nullptr;
+	return m_pLeaderboard.get();
 }
 
 bool CScore::RateLimitPlayer(int ClientID)
@@ -71,9 +143,13 @@ void CScore::GeneratePassphrase(char *pBuf, int BufSize)
 CScore::CScore(CGameContext *pGameServer, CDbConnectionPool *pPool) :
 	m_pPool(pPool),
 	m_pGameServer(pGameServer),
-	m_pServer(pGameServer->Server())
+	m_pServer(pGameServer->Server()),
+	m_LeaderboardTime(0),
+	m_LoadingLeaderboardTime(0)
 {
 	LoadBestTime();
+	if(g_Config.m_SvSqlLeaderboard)
+		LoadLeaderboard();
 
 	uint64_t aSeed[2];
 	secure_random_fill(aSeed, sizeof(aSeed));
@@ -160,7 +236,18 @@ void CScore::SaveScore(int ClientID, float Time, const char *pTimestamp, const f
 	for(int i = 0; i < NUM_CHECKPOINTS; i++)
 		Tmp->m_aCurrentTimeCp[i] = aTimeCp[i];
 
-	m_pPool->ExecuteWrite(CScoreWorker::SaveScore, std::move(Tmp), "save score");
+	// same precision as stored in the database
+	char aTime[32];
+	str_format(aTime, sizeof(aTime), "%.2f", Time);
+	const float RankTime = str_tofloat(aTime);
+	m_vLeaderboardFinishes.emplace_back(Tmp->m_aName, RankTime);
+	if(m_pLeaderboard)
+	{
+		m_pLeaderboard->m_Global.Add(Tmp->m_aName, RankTime);
+		m_pLeaderboard->m_Regional.Add(Tmp->m_aName, RankTime);
+	}
+
+	m_pPool->ExecuteWriteBatched(CScoreWorker::SaveScore, CScoreWorker::SaveScores, std::move(Tmp), "save score");
 }
 
 void CScore::SaveTeamScore(int *pClientIDs, unsigned int Size, float Time, const char *pTimestamp)
@@ -183,13 +270,15 @@ void CScore::SaveTeamScore(int *pClientIDs, unsigned int Size, float Time, const
 	str_copy(Tmp->m_aMap, g_Config.m_SvMap, sizeof(Tmp->m_aMap));
 	Tmp->m_TeamrankUuid = RandomUuid();
 
-	m_pPool->ExecuteWrite(CScoreWorker::SaveTeamScore, std::move(Tmp), "save team score");
+	m_pPool->ExecuteWriteBatched(CScoreWorker::SaveTeamScore, nullptr, std::move(Tmp), "save team score");
 }
 
 void CScore::ShowRank(int ClientID, const char *pName)
 {
 	if(RateLimitPlayer(ClientID))
 		return;
+	if(ShowFromLeaderboard(CScoreWorker::ShowRankFromLeaderboard, ClientID, pName, 0))
+		return;
 	ExecPlayerThread(CScoreWorker::ShowRank, "show rank", ClientID, pName, 0);
 }
 
@@ -204,6 +293,8 @@ void CScore::ShowTop(int ClientID, int Offset)
 {
 	if(RateLimitPlayer(ClientID))
 		return;
+	if(ShowFromLeaderboard(CScoreWorker::ShowTopFromLeaderboard, ClientID, "", Offset))
+		return;
 	ExecPlayerThread(CScoreWorker::ShowTop, "show top5", ClientID, "", Offset);
 }
 
@@ -27,6 +27,7 @@ class CScore
 
 	// returns new SqlResult bound to the player, if no current Thread is active for this player
 	std::shared_ptr<CScorePlayerResult> NewSqlPlayerResult(int ClientID);
+	void FillPlayerRequest(CSqlPlayerRequest *pRequest, int ClientID, const char *pName, int Offset);
 	// Creates for player database requests
 	void ExecPlayerThread(
 		bool (*pFuncPtr)(IDbConnection *, const ISqlData *, char *pError, int ErrorSize),
@@ -38,6 +39,27 @@ class CScore
 	// returns true if the player should be rate limited
 	bool RateLimitPlayer(int ClientID);
 
+	// Best times of the current map to answer /rank and /top5 without a
+	// database query. It is loaded at map start, updated by finishes on this
+	// server and reloaded every sv_sql_leaderboard_refresh seconds to pick up
+	// ranks from other servers.
+	std::shared_ptr<CScoreLeaderboardResult> m_pLeaderboard;
+	std::shared_ptr<CScoreLeaderboardResult> m_pLoadingLeaderboard;
+	int64_t m_LeaderboardTime;
+	int64_t m_LoadingLeaderboardTime;
+	// finishes on this server since map start, the database might not
+	// contain them yet when the leaderboard is loaded
+	std::vector<std::pair<std::string, float>> m_vLeaderboardFinishes;
+	void LoadLeaderboard();
+	// returns nullptr if there is no recent enough leaderboard
+	const CScoreLeaderboardResult *Leaderboard();
+	// returns true if the request got answered from the leaderboard
+	bool ShowFromLeaderboard(
+		void (*pFuncPtr)(const CScoreLeaderboardResult *, const CSqlPlayerRequest *),
+		int ClientID,
+		const char *pName,
+		int Offset);
+
 public:
 	CScore(CGameContext *pGameServer, CDbConnectionPool *pPool);
 	~CScore() {}
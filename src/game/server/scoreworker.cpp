@@ -7,6 +7,7 @@
 #include <engine/server/sql_string_helpers.h>
 #include <engine/shared/config.h>
 
+#include <algorithm>
 #include <cmath>
 
 // "6b407e81-8b77-3e04-a207-8da17f37d000"
@@ -15,6 +16,9 @@ static const CUuid UUID_NO_SAVE_ID =
 	{{0x6b, 0x40, 0x7e, 0x81, 0x8b, 0x77, 0x3e, 0x04,
 		0xa2, 0x07, 0x8d, 0xa1, 0x7f, 0x37, 0xd0, 0x00}};
 
+// maximum number of rows inserted by one statement when saving scores
+static const int MAX_INSERT_ROWS = 8;
+
 CScorePlayerResult::CScorePlayerResult()
 {
 	SetVariant(Variant::DIRECT);
@@ -92,6 +96,71 @@ bool CTeamrank::SamePlayers(const std::vector<std::string> *pvSortedNames)
 	return true;
 }
 
+// times are stored with two decimals
+static float RoundTime(float Time)
+{
+	return std::round(Time * 100.0f) / 100.0f;
+}
+
+static bool LeaderboardLess(const CLeaderboard::CEntry &Entry, const CLeaderboard::CEntry &Other)
+{
+	if(Entry.m_Time != Other.m_Time)
+		return Entry.m_Time < Other.m_Time;
+	return str_comp(Entry.m_aName, Other.m_aName) < 0;
+}
+
+void CLeaderboard::Clear()
+{
+	m_vEntries.clear();
+	m_BestTimes.clear();
+}
+
+void CLeaderboard::Add(const char *pName, float Time)
+{
+	CEntry Entry;
+	str_copy(Entry.m_aName, pName);
+	Entry.m_Time = Time;
+
+	auto BestTime = m_BestTimes.find(Entry.m_aName);
+	if(BestTime != m_BestTimes.end())
+	{
+		if(BestTime->second <= Time)
+			return;
+		CEntry Old = Entry;
+		Old.m_Time = BestTime->second;
+		m_vEntries.erase(std::lower_bound(m_vEntries.begin(), m_vEntries.end(), Old, LeaderboardLess));
+		BestTime->second = Time;
+	}
+	else
+	{
+		m_BestTimes.emplace(Entry.m_aName, Time);
+	}
+	m_vEntries.insert(std::upper_bound(m_vEntries.begin(), m_vEntries.end(), Entry, LeaderboardLess), Entry);
+}
+
+int CLeaderboard::Find(const char *pName, float *pTime) const
+{
+	auto BestTime = m_BestTimes.find(pName);
+	if(BestTime == m_BestTimes.end())
+		return 0;
+	*pTime = BestTime->second;
+	return Rank(BestTime->second);
+}
+
+int CLeaderboard::Rank(float Time) const
+{
+	auto First = std::lower_bound(m_vEntries.begin(), m_vEntries.end(), Time, [](const CEntry &Entry, float Value) { return Entry.m_Time < Value; });
+	return First - m_vEntries.begin() + 1;
+}
+
+float CLeaderboard::PercentRank(int Rank) const
+{
+	// computed the same way as the database does to get the same rounding
+	if(m_vEntries.size() <= 1)
+		return 0.0f;
+	return (double)(Rank - 1) / (m_vEntries.size() - 1);
+}
+
 bool CScoreWorker::LoadBestTime(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize)
 {
 	const auto *pData = dynamic_cast<const CSqlLoadBestTimeData *>(pGameData);
@@ -121,6 +190,51 @@ bool CScoreWorker::LoadBestTime(IDbConnection *pSqlServer, const ISqlData *pGame
 	return false;
 }
 
+bool CScoreWorker::LoadLeaderboard(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize)
+{
+	const auto *pData = dynamic_cast<const CSqlLeaderboardRequest *>(pGameData);
+	auto *pResult = dynamic_cast<CScoreLeaderboardResult *>(pGameData->m_pResult.get());
+
+	char aServerLike[16];
+	str_format(aServerLike, sizeof(aServerLike), "%%%s%%", pData->m_aServer);
+	const char *pAny = "%";
+
+	char aBuf[512];
+	str_format(aBuf, sizeof(aBuf),
+		"SELECT Name, MIN(Time) AS BestTime "
+		"FROM %s_race "
+		"WHERE Map = ? "
+		"AND Server LIKE ? "
+		"GROUP BY Name "
+		"ORDER BY BestTime",
+		pSqlServer->GetPrefix());
+
+	for(CLeaderboard *pLeaderboard : {&pResult->m_Global, &pResult->m_Regional})
+	{
+		if(pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
+		{
+			return true;
+		}
+		pSqlServer->BindString(1, pData->m_aMap);
+		pSqlServer->BindString(2, pLeaderboard == &pResult->m_Global ? pAny : aServerLike);
+
+		pLeaderboard->Clear();
+		bool End = false;
+		while(!pSqlServer->Step(&End, pError, ErrorSize) && !End)
+		{
+			char aName[MAX_NAME_LENGTH];
+			pSqlServer->GetString(1, aName, sizeof(aName));
+			pLeaderboard->Add(aName, pSqlServer->GetFloat(2));
+		}
+		if(!End)
+		{
+			return true;
+		}
+	}
+	str_copy(pResult->m_aServer, pData->m_aServer);
+	return false;
+}
+
 // update stuff
 bool CScoreWorker::LoadPlayerData(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize)
 {
@@ -393,8 +507,6 @@ bool CScoreWorker::MapInfo(IDbConnection *pSqlServer, const ISqlData *pGameData,
 bool CScoreWorker::SaveScore(IDbConnection *pSqlServer, const ISqlData *pGameData, Write w, char *pError, int ErrorSize)
 {
 	const auto *pData = dynamic_cast<const CSqlScoreData *>(pGameData);
-	auto *pResult = dynamic_cast<CScorePlayerResult *>(pGameData->m_pResult.get());
-	auto *paMessages = pResult->m_Data.m_aaMessages;
 
 	char aBuf[1024];
 
@@ -465,88 +577,144 @@ bool CScoreWorker::SaveScore(IDbConnection *pSqlServer, const ISqlData *pGameDat
 		return false;
 	}
 
-	if(w == Write::NORMAL)
+	return SaveScores(pSqlServer, &pGameData, 1, w, pError, ErrorSize);
+}
+
+bool CScoreWorker::SaveScores(IDbConnection *pSqlServer, const ISqlData *const *ppGameData, int NumData, Write w, char *pError, int ErrorSize)
+{
+	if(w == Write::NORMAL_SUCCEEDED || w == Write::NORMAL_FAILED)
 	{
-		str_format(aBuf, sizeof(aBuf),
-			"SELECT COUNT(*) AS NumFinished FROM %s_race WHERE Map=? AND Name=? ORDER BY time ASC LIMIT 1",
-			pSqlServer->GetPrefix());
-		if(pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
+		for(int i = 0; i < NumData; i++)
 		{
-			return true;
+			if(SaveScore(pSqlServer, ppGameData[i], w, pError, ErrorSize))
+			{
+				return true;
+			}
 		}
-		pSqlServer->BindString(1, pData->m_aMap);
-		pSqlServer->BindString(2, pData->m_aName);
+		return false;
+	}
 
-		bool End;
-		if(pSqlServer->Step(&End, pError, ErrorSize))
-		{
-			return true;
-		}
-		int NumFinished = pSqlServer->GetInt(1);
-		if(NumFinished == 0)
+	char aBuf[1024];
+	if(w == Write::NORMAL)
+	{
+		for(int i = 0; i < NumData; i++)
 		{
-			str_format(aBuf, sizeof(aBuf), "SELECT Points FROM %s_maps WHERE Map=?", pSqlServer->GetPrefix());
+			const auto *pData = dynamic_cast<const CSqlScoreData *>(ppGameData[i]);
+			auto *pResult = dynamic_cast<CScorePlayerResult *>(ppGameData[i]->m_pResult.get());
+			auto *paMessages = pResult->m_Data.m_aaMessages;
+
+			// the rows of this batch aren't inserted yet, only award the
+			// points for the first finish of a player in it
+			bool FinishedBefore = false;
+			for(int j = 0; j < i && !FinishedBefore; j++)
+			{
+				const auto *pOther = dynamic_cast<const CSqlScoreData *>(ppGameData[j]);
+				FinishedBefore = str_comp(pOther->m_aMap, pData->m_aMap) == 0 && str_comp(pOther->m_aName, pData->m_aName) == 0;
+			}
+			if(FinishedBefore)
+				continue;
+
+			str_format(aBuf, sizeof(aBuf),
+				"SELECT COUNT(*) AS NumFinished FROM %s_race WHERE Map=? AND Name=? ORDER BY time ASC LIMIT 1",
+				pSqlServer->GetPrefix());
 			if(pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
 			{
 				return true;
 			}
 			pSqlServer->BindString(1, pData->m_aMap);
+			pSqlServer->BindString(2, pData->m_aName);
 
-			bool End2;
-			if(pSqlServer->Step(&End2, pError, ErrorSize))
+			bool End;
+			if(pSqlServer->Step(&End, pError, ErrorSize))
 			{
 				return true;
 			}
-			if(!End2)
+			int NumFinished = pSqlServer->GetInt(1);
+			if(NumFinished == 0)
 			{
-				int Points = pSqlServer->GetInt(1);
-				if(pSqlServer->AddPoints(pData->m_aName, Points, pError, ErrorSize))
+				str_format(aBuf, sizeof(aBuf), "SELECT Points FROM %s_maps WHERE Map=?", pSqlServer->GetPrefix());
+				if(pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
+				{
+					return true;
+				}
+				pSqlServer->BindString(1, pData->m_aMap);
+
+				bool End2;
+				if(pSqlServer->Step(&End2, pError, ErrorSize))
 				{
 					return true;
 				}
-				str_format(paMessages[0], sizeof(paMessages[0]),
-					"You earned %d point%s for finishing this map!",
-					Points, Points == 1 ? "" : "s");
+				if(!End2)
+				{
+					int Points = pSqlServer->GetInt(1);
+					if(pSqlServer->AddPoints(pData->m_aName, Points, pError, ErrorSize))
+					{
+						return true;
+					}
+					str_format(paMessages[0], sizeof(paMessages[0]),
+						"You earned %d point%s for finishing this map!",
+						Points, Points == 1 ? "" : "s");
+				}
 			}
 		}
 	}
 
-	// save score. Can't fail, because no UNIQUE/PRIMARY KEY constrain is defined.
-	str_format(aBuf, sizeof(aBuf),
-		"%s INTO %s_race%s("
-		"	Map, Name, Timestamp, Time, Server, "
-		"	cp1, cp2, cp3, cp4, cp5, cp6, cp7, cp8, cp9, cp10, cp11, cp12, cp13, "
-		"	cp14, cp15, cp16, cp17, cp18, cp19, cp20, cp21, cp22, cp23, cp24, cp25, "
-		"	GameID, DDNet7) "
-		"VALUES (?, ?, %s, %.2f, ?, "
-		"	%.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, "
-		"	%.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, "
-		"	%.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, "
-		"	?, %s)",
-		pSqlServer->InsertIgnore(), pSqlServer->GetPrefix(),
-		w == Write::NORMAL ? "" : "_backup",
-		pSqlServer->InsertTimestampAsUtc(), pData->m_Time,
-		pData->m_aCurrentTimeCp[0], pData->m_aCurrentTimeCp[1], pData->m_aCurrentTimeCp[2],
-		pData->m_aCurrentTimeCp[3], pData->m_aCurrentTimeCp[4], pData->m_aCurrentTimeCp[5],
-		pData->m_aCurrentTimeCp[6], pData->m_aCurrentTimeCp[7], pData->m_aCurrentTimeCp[8],
-		pData->m_aCurrentTimeCp[9], pData->m_aCurrentTimeCp[10], pData->m_aCurrentTimeCp[11],
-		pData->m_aCurrentTimeCp[12], pData->m_aCurrentTimeCp[13], pData->m_aCurrentTimeCp[14],
-		pData->m_aCurrentTimeCp[15], pData->m_aCurrentTimeCp[16], pData->m_aCurrentTimeCp[17],
-		pData->m_aCurrentTimeCp[18], pData->m_aCurrentTimeCp[19], pData->m_aCurrentTimeCp[20],
-		pData->m_aCurrentTimeCp[21], pData->m_aCurrentTimeCp[22], pData->m_aCurrentTimeCp[23],
-		pData->m_aCurrentTimeCp[24], pSqlServer->False());
-	if(pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
+	// save scores in statements of 8, 4, 2 or 1 rows, so that only a few
+	// different statements end up in the statement cache. Can't fail,
+	// because no UNIQUE/PRIMARY KEY constrain is defined.
+	for(int First = 0; First < NumData;)
 	{
-		return true;
+		int NumRows = MAX_INSERT_ROWS;
+		while(NumRows > NumData - First)
+			NumRows /= 2;
+
+		str_format(aBuf, sizeof(aBuf),
+			"%s INTO %s_race%s("
+			"	Map, Name, Timestamp, Time, Server, "
+			"	cp1, cp2, cp3, cp4, cp5, cp6, cp7, cp8, cp9, cp10, cp11, cp12, cp13, "
+			"	cp14, cp15, cp16, cp17, cp18, cp19, cp20, cp21, cp22, cp23, cp24, cp25, "
+			"	GameID, DDNet7) "
+			"VALUES ",
+			pSqlServer->InsertIgnore(), pSqlServer->GetPrefix(),
+			w == Write::NORMAL ? "" : "_backup");
+		std::string Query = aBuf;
+		for(int i = 0; i < NumRows; i++)
+		{
+			str_format(aBuf, sizeof(aBuf),
+				"%s(?, ?, %s, ?, ?, "
+				"	?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, "
+				"	?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, "
+				"	?, %s)",
+				i == 0 ? "" : ", ",
+				pSqlServer->InsertTimestampAsUtc(), pSqlServer->False());
+			Query += aBuf;
+		}
+		if(pSqlServer->PrepareStatement(Query.c_str(), pError, ErrorSize))
+		{
+			return true;
+		}
+		int Index = 1;
+		for(int i = First; i < First + NumRows; i++)
+		{
+			const auto *pData = dynamic_cast<const CSqlScoreData *>(ppGameData[i]);
+			pSqlServer->BindString(Index++, pData->m_aMap);
+			pSqlServer->BindString(Index++, pData->m_aName);
+			pSqlServer->BindString(Index++, pData->m_aTimestamp);
+			pSqlServer->BindFloat(Index++, RoundTime(pData->m_Time));
+			pSqlServer->BindString(Index++, g_Config.m_SvSqlServerName);
+			for(float CpTime : pData->m_aCurrentTimeCp)
+				pSqlServer->BindFloat(Index++, RoundTime(CpTime));
+			pSqlServer->BindString(Index++, pData->m_aGameUuid);
+		}
+		pSqlServer->Print();
+		int NumInserted;
+		if(pSqlServer->ExecuteUpdate(&NumInserted, pError, ErrorSize))
+		{
+			return true;
+		}
+		First += NumRows;
 	}
-	pSqlServer->BindString(1, pData->m_aMap);
-	pSqlServer->BindString(2, pData->m_aName);
-	pSqlServer->BindString(3, pData->m_aTimestamp);
-	pSqlServer->BindString(4, g_Config.m_SvSqlServerName);
-	pSqlServer->BindString(5, pData->m_aGameUuid);
-	pSqlServer->Print();
-	int NumInserted;
-	return pSqlServer->ExecuteUpdate(&NumInserted, pError, ErrorSize);
+	return false;
 }
 
 bool CScoreWorker::SaveTeamScore(IDbConnection *pSqlServer, const ISqlData *pGameData, Write w, char *pError, int ErrorSize)
@@ -666,15 +834,16 @@ bool CScoreWorker::SaveTeamScore(IDbConnection *pSqlServer, const ISqlData *pGam
 			if(pData->m_Time < Time)
 			{
 				str_format(aBuf, sizeof(aBuf),
-					"UPDATE %s_teamrace SET Time=%.2f, Timestamp=%s, DDNet7=%s, GameID=? WHERE ID = ?",
-					pSqlServer->GetPrefix(), pData->m_Time, pSqlServer->InsertTimestampAsUtc(), pSqlServer->False());
+					"UPDATE %s_teamrace SET Time=?, Timestamp=%s, DDNet7=%s, GameID=? WHERE ID = ?",
+					pSqlServer->GetPrefix(), pSqlServer->InsertTimestampAsUtc(), pSqlServer->False());
 				if(pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
 				{
 					return true;
 				}
-				pSqlServer->BindString(1, pData->m_aTimestamp);
-				pSqlServer->BindString(2, pData->m_aGameUuid);
-				pSqlServer->BindBlob(3, Teamrank.m_TeamID.m_aData, sizeof(Teamrank.m_TeamID.m_aData));
+				pSqlServer->BindFloat(1, RoundTime(pData->m_Time));
+				pSqlServer->BindString(2, pData->m_aTimestamp);
+				pSqlServer->BindString(3, pData->m_aGameUuid);
+				pSqlServer->BindBlob(4, Teamrank.m_TeamID.m_aData, sizeof(Teamrank.m_TeamID.m_aData));
 				pSqlServer->Print();
 				int NumUpdated;
 				if(pSqlServer->ExecuteUpdate(&NumUpdated, pError, ErrorSize))
@@ -693,10 +862,10 @@ bool CScoreWorker::SaveTeamScore(IDbConnection *pSqlServer, const ISqlData *pGam
 		// if no entry found... create a new one
 		str_format(aBuf, sizeof(aBuf),
 			"%s INTO %s_teamrace%s(Map, Name, Timestamp, Time, ID, GameID, DDNet7) "
-			"VALUES (?, ?, %s, %.2f, ?, ?, %s)",
+			"VALUES (?, ?, %s, ?, ?, ?, %s)",
 			pSqlServer->InsertIgnore(), pSqlServer->GetPrefix(),
 			w == Write::NORMAL ? "" : "_backup",
-			pSqlServer->InsertTimestampAsUtc(), pData->m_Time, pSqlServer->False());
+			pSqlServer->InsertTimestampAsUtc(), pSqlServer->False());
 		if(pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
 		{
 			return true;
@@ -704,10 +873,11 @@ bool CScoreWorker::SaveTeamScore(IDbConnection *pSqlServer, const ISqlData *pGam
 		pSqlServer->BindString(1, pData->m_aMap);
 		pSqlServer->BindString(2, pData->m_aaNames[i]);
 		pSqlServer->BindString(3, pData->m_aTimestamp);
+		pSqlServer->BindFloat(4, RoundTime(pData->m_Time));
 		// copy uuid, because mysql BindBlob doesn't support const buffers
 		CUuid TeamrankId = pData->m_TeamrankUuid;
-		pSqlServer->BindBlob(4, TeamrankId.m_aData, sizeof(TeamrankId.m_aData));
-		pSqlServer->BindString(5, pData->m_aGameUuid);
+		pSqlServer->BindBlob(5, TeamrankId.m_aData, sizeof(TeamrankId.m_aData));
+		pSqlServer->BindString(6, pData->m_aGameUuid);
 		pSqlServer->Print();
 		int NumInserted;
 		if(pSqlServer->ExecuteUpdate(&NumInserted, pError, ErrorSize))
@@ -718,6 +888,47 @@ bool CScoreWorker::SaveTeamScore(IDbConnection *pSqlServer, const ISqlData *pGam
 	return false;
 }
 
+void CScoreWorker::RankMessages(const CSqlPlayerRequest *pData, CScorePlayerResult *pResult, int Rank, float Time, float PercentRank, const char *pRegionalRank)
+{
+	if(Rank == 0)
+	{
+		str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
+			"%s is not ranked", pData->m_aName);
+		return;
+	}
+
+	char aTime[32];
+	// CEIL and FLOOR are not supported in SQLite
+	int BetterThanPercent = std::floor(100.0f - 100.0f * PercentRank);
+	str_time_float(Time, TIME_HOURS_CENTISECS, aTime, sizeof(aTime));
+	if(g_Config.m_SvHideScore)
+	{
+		str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
+			"Your time: %s, better than %d%%", aTime, BetterThanPercent);
+	}
+	else
+	{
+		pResult->m_MessageKind = CScorePlayerResult::ALL;
+
+		if(str_comp_nocase(pData->m_aRequestingPlayer, pData->m_aName) == 0)
+		{
+			str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
+				"%s - %s - better than %d%%",
+				pData->m_aName, aTime, BetterThanPercent);
+		}
+		else
+		{
+			str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
+				"%s - %s - better than %d%% - requested by %s",
+				pData->m_aName, aTime, BetterThanPercent, pData->m_aRequestingPlayer);
+		}
+
+		str_format(pResult->m_Data.m_aaMessages[1], sizeof(pResult->m_Data.m_aaMessages[1]),
+			"Global rank %d - %s %s",
+			Rank, pData->m_aServer, pRegionalRank);
+	}
+}
+
 bool CScoreWorker::ShowRank(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize)
 {
 	const auto *pData = dynamic_cast<const CSqlPlayerRequest *>(pGameData);
@@ -782,46 +993,34 @@ bool CScoreWorker::ShowRank(IDbConnection *pSqlServer, const ISqlData *pGameData
 
 	if(!End)
 	{
-		int Rank = pSqlServer->GetInt(1);
-		float Time = pSqlServer->GetFloat(2);
-		// CEIL and FLOOR are not supported in SQLite
-		int BetterThanPercent = std::floor(100.0f - 100.0f * pSqlServer->GetFloat(3));
-		str_time_float(Time, TIME_HOURS_CENTISECS, aBuf, sizeof(aBuf));
-		if(g_Config.m_SvHideScore)
-		{
-			str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
-				"Your time: %s, better than %d%%", aBuf, BetterThanPercent);
-		}
-		else
-		{
-			pResult->m_MessageKind = CScorePlayerResult::ALL;
-
-			if(str_comp_nocase(pData->m_aRequestingPlayer, pData->m_aName) == 0)
-			{
-				str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
-					"%s - %s - better than %d%%",
-					pData->m_aName, aBuf, BetterThanPercent);
-			}
-			else
-			{
-				str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
-					"%s - %s - better than %d%% - requested by %s",
-					pData->m_aName, aBuf, BetterThanPercent, pData->m_aRequestingPlayer);
-			}
-
-			str_format(pResult->m_Data.m_aaMessages[1], sizeof(pResult->m_Data.m_aaMessages[1]),
-				"Global rank %d - %s %s",
-				Rank, pData->m_aServer, aRegionalRank);
-		}
+		RankMessages(pData, pResult, pSqlServer->GetInt(1), pSqlServer->GetFloat(2), pSqlServer->GetFloat(3), aRegionalRank);
 	}
 	else
 	{
-		str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
-			"%s is not ranked", pData->m_aName);
+		RankMessages(pData, pResult, 0, 0.0f, 0.0f, aRegionalRank);
 	}
 	return false;
 }
 
+void CScoreWorker::ShowRankFromLeaderboard(const CScoreLeaderboardResult *pLeaderboard, const CSqlPlayerRequest *pData)
+{
+	auto *pResult = dynamic_cast<CScorePlayerResult *>(pData->m_pResult.get());
+
+	float Time;
+	char aRegionalRank[16];
+	int RegionalRank = pLeaderboard->m_Regional.Find(pData->m_aName, &Time);
+	if(RegionalRank == 0)
+		str_copy(aRegionalRank, "unranked", sizeof(aRegionalRank));
+	else
+		str_format(aRegionalRank, sizeof(aRegionalRank), "rank %d", RegionalRank);
+
+	int Rank = pLeaderboard->m_Global.Find(pData->m_aName, &Time);
+	if(Rank == 0)
+		RankMessages(pData, pResult, 0, 0.0f, 0.0f, aRegionalRank);
+	else
+		RankMessages(pData, pResult, Rank, Time, pLeaderboard->m_Global.PercentRank(Rank), aRegionalRank);
+}
+
 bool CScoreWorker::ShowTeamRank(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize)
 {
 	const auto *pData = dynamic_cast<const CSqlPlayerRequest *>(pGameData);
@@ -992,6 +1191,47 @@ bool CScoreWorker::ShowTop(IDbConnection *pSqlServer, const ISqlData *pGameData,
 	return !End;
 }
 
+static int LeaderboardTop(CScorePlayerResult *pResult, int Line, const CLeaderboard &Leaderboard, int Offset, int Num)
+{
+	const int LimitStart = maximum(absolute(Offset) - 1, 0);
+	char aTime[32];
+	for(int i = LimitStart; i < LimitStart + Num && i < Leaderboard.Size(); i++)
+	{
+		int Index = i;
+		if(Offset < 0)
+		{
+			// descending ranks, but equal times stay ordered by name
+			Index = Leaderboard.Size() - 1 - i;
+			const int First = Leaderboard.Rank(Leaderboard.Entry(Index).m_Time) - 1;
+			int Last = Index;
+			while(Last + 1 < Leaderboard.Size() && Leaderboard.Entry(Last + 1).m_Time == Leaderboard.Entry(Index).m_Time)
+				Last++;
+			Index = First + Last - Index;
+		}
+		const CLeaderboard::CEntry &Entry = Leaderboard.Entry(Index);
+		str_time_float(Entry.m_Time, TIME_HOURS_CENTISECS, aTime, sizeof(aTime));
+		str_format(pResult->m_Data.m_aaMessages[Line], sizeof(pResult->m_Data.m_aaMessages[Line]),
+			"%d. %s Time: %s", Leaderboard.Rank(Entry.m_Time), Entry.m_aName, aTime);
+		Line++;
+	}
+	return Line;
+}
+
+void CScoreWorker::ShowTopFromLeaderboard(const CScoreLeaderboardResult *pLeaderboard, const CSqlPlayerRequest *pData)
+{
+	auto *pResult = dynamic_cast<CScorePlayerResult *>(pData->m_pResult.get());
+
+	int Line = 0;
+	str_copy(pResult->m_Data.m_aaMessages[Line], "------------ Global Top ------------", sizeof(pResult->m_Data.m_aaMessages[Line]));
+	Line++;
+	Line = LeaderboardTop(pResult, Line, pLeaderboard->m_Global, pData->m_Offset, 5);
+
+	str_format(pResult->m_Data.m_aaMessages[Line], sizeof(pResult->m_Data.m_aaMessages[Line]),
+		"------------ %s Top ------------", pData->m_aServer);
+	Line++;
+	LeaderboardTop(pResult, Line, pLeaderboard->m_Regional, pData->m_Offset, 3);
+}
+
 bool CScoreWorker::ShowTeamTop5(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize)
 {
 	const auto *pData = dynamic_cast<const CSqlPlayerRequest *>(pGameData);
@@ -1547,7 +1787,7 @@ bool CScoreWorker::SaveTeam(IDbConnection *pSqlServer, const ISqlData *pGameData
 	char aSaveID[UUID_MAXSTRSIZE];
 	FormatUuid(pResult->m_SaveID, aSaveID, UUID_MAXSTRSIZE);
 
-	char *pSaveState = pResult->m_SavedTeam.GetString();
+	char *pSaveState = g_Config.m_SvSaveBinary ? pResult->m_SavedTeam.GetBinaryString() : pResult->m_SavedTeam.GetString();
 	char aBuf[65536];
 
 	dbg_msg("score/dbg", "code=%s failure=%d", pData->m_aCode, (int)w);
@@ -4,6 +4,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -81,6 +82,53 @@ struct CSqlLoadBestTimeData : ISqlData
 	char m_aMap[MAX_MAP_LENGTH];
 };
 
+// Best time of every player on one map, sorted like the ranks of the race
+// table. Ranks are compatible with `RANK() OVER (ORDER BY MIN(Time))`.
+class CLeaderboard
+{
+public:
+	struct CEntry
+	{
+		char m_aName[MAX_NAME_LENGTH];
+		float m_Time;
+	};
+
+	void Clear();
+	// keeps the better one of the previous and the new time
+	void Add(const char *pName, float Time);
+
+	int Size() const { return m_vEntries.size(); }
+	const CEntry &Entry(int Index) const { return m_vEntries[Index]; }
+	// returns the rank of a player or 0 if there is none
+	int Find(const char *pName, float *pTime) const;
+	int Rank(float Time) const;
+	// like `PERCENT_RANK()`
+	float PercentRank(int Rank) const;
+
+private:
+	std::vector<CEntry> m_vEntries;
+	std::unordered_map<std::string, float> m_BestTimes;
+};
+
+struct CScoreLeaderboardResult : ISqlResult
+{
+	char m_aServer[5];
+	CLeaderboard m_Global;
+	// only the ranks made on servers matching m_aServer
+	CLeaderboard m_Regional;
+};
+
+struct CSqlLeaderboardRequest : ISqlData
+{
+	CSqlLeaderboardRequest(std::shared_ptr<CScoreLeaderboardResult> pResult) :
+		ISqlData(std::move(pResult))
+	{
+	}
+
+	char m_aMap[MAX_MAP_LENGTH];
+	char m_aServer[5];
+};
+
 struct CSqlPlayerRequest : ISqlData
 {
 	CSqlPlayerRequest(std::shared_ptr<CScorePlayerResult> pResult) :
@@ -273,6 +321,7 @@ struct CTeamrank
 struct CScoreWorker
 {
 	static bool LoadBestTime(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize);
+	static bool LoadLeaderboard(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize);
 
 	static bool RandomMap(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize);
 	static bool RandomUnfinishedMap(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize);
@@ -283,6 +332,11 @@ struct CScoreWorker
 	static bool ShowRank(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize);
 	static bool ShowTeamRank(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize);
 	static bool ShowTop(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize);
+	// same answers as ShowRank and ShowTop, without querying the database
+	static void ShowRankFromLeaderboard(const CScoreLeaderboardResult *pLeaderboard, const CSqlPlayerRequest *pData);
+	static void ShowTopFromLeaderboard(const CScoreLeaderboardResult *pLeaderboard, const CSqlPlayerRequest *pData);
+	// formats the answer to /rank, Rank is 0 if the player has no rank
+	static void RankMessages(const CSqlPlayerRequest *pData, CScorePlayerResult *pResult, int Rank, float Time, float PercentRank, const char *pRegionalRank);
 	static bool ShowTeamTop5(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize);
 	static bool ShowPlayerTeamTop5(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize);
 	static bool ShowTimes(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize);
@@ -294,6 +348,8 @@ struct CScoreWorker
 	static bool LoadTeam(IDbConnection *pSqlServer, const ISqlData *pGameData, Write w, char *pError, int ErrorSize);
 
 	static bool SaveScore(IDbConnection *pSqlServer, const ISqlData *pGameData, Write w, char *pError, int ErrorSize);
+	// inserts several scores queued at once with a single statement
+	static bool SaveScores(IDbConnection *pSqlServer, const ISqlData *const *ppGameData, int NumData, Write w, char *pError, int ErrorSize);
 	static bool SaveTeamScore(IDbConnection *pSqlServer, const ISqlData *pGameData, Write w, char *pError, int ErrorSize);
 };
 
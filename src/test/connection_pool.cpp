@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/server/databases/connection.h>
+#include <engine/server/databases/connection_pool.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+struct CTestSqlData : ISqlData
+{
+	CTestSqlData(int Index) :
+		ISqlData(std::make_shared<ISqlResult>()), m_Index(Index)
+	{
+	}
+	int m_Index;
+};
+
+static std::atomic_int gs_NumRunningReads{0};
+static std::atomic_int gs_MaxRunningReads{0};
+static std::mutex gs_WriteLock;
+static std::vector<int> gs_vWrites;
+
+static bool TestRead(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize)
+{
+	const int NumRunning = ++gs_NumRunningReads;
+	int Max = gs_MaxRunningReads.load();
+	while(NumRunning > Max && !gs_MaxRunningReads.compare_exchange_weak(Max, NumRunning))
+	{
+	}
+
+	// wait for the other read, it can only arrive while this one is running
+	// if the reads are executed in parallel
+	const int64_t Timeout = time_get() + time_freq() * 5;
+	while(gs_MaxRunningReads.load() < 2 && time_get() < Timeout)
+		thread_yield();
+
+	gs_NumRunningReads--;
+	return false;
+}
+
+static bool TestWrite(IDbConnection *pSqlServer, const ISqlData *pGameData, Write w, char *pError, int ErrorSize)
+{
+	const auto *pData = dynamic_cast<const CTestSqlData *>(pGameData);
+	std::lock_guard<std::mutex> Lock(gs_WriteLock);
+	gs_vWrites.push_back(pData->m_Index);
+	return false;
+}
+
+TEST(ConnectionPool, ParallelReadsOrderedWrites)
+{
+	gs_vWrites.clear();
+	std::vector<std::shared_ptr<ISqlResult>> vpResults;
+	{
+		CDbConnectionPool Pool;
+		Pool.SetNumReadWorkers(2);
+		Pool.RegisterSqliteDatabase(CDbConnectionPool::READ, ":memory:");
+		Pool.RegisterSqliteDatabase(CDbConnectionPool::WRITE, ":memory:");
+
+		for(int i = 0; i < 2; i++)
+		{
+			auto pData = std::make_unique<CTestSqlData>(i);
+			vpResults.push_back(pData->m_pResult);
+			Pool.Execute(TestRead, std::move(pData), "test read");
+		}
+		// batched and single writes mixed, in the order they are queued
+		for(int i = 0; i < 40; i++)
+		{
+			auto pData = std::make_unique<CTestSqlData>(i);
+			vpResults.push_back(pData->m_pResult);
+			if(i % 7 == 3)
+				Pool.ExecuteWrite(TestWrite, std::move(pData), "test write");
+			else
+				Pool.ExecuteWriteBatched(TestWrite, nullptr, std::move(pData), "test write");
+		}
+
+		// the reads are dismissed after the shutdown started
+		for(int i = 0; i < 2; i++)
+		{
+			while(!vpResults[i]->m_Completed)
+				thread_yield();
+		}
+	}
+
+	for(const auto &pResult : vpResults)
+	{
+		EXPECT_TRUE(pResult->m_Completed);
+		EXPECT_TRUE(pResult->m_Success);
+	}
+	EXPECT_EQ(gs_MaxRunningReads.load(), 2);
+	ASSERT_EQ(gs_vWrites.size(), 40u);
+	for(int i = 0; i < 40; i++)
+		EXPECT_EQ(gs_vWrites[i], i);
+}
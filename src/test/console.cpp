@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/console.h>
+#include <engine/shared/config.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class Console : public ::testing::Test
+{
+protected:
+	std::unique_ptr<IConsole> m_pConsole = CreateConsole(CFGFLAG_SERVER);
+
+	struct CCall
+	{
+		int m_NumCalls = 0;
+		int m_Sum = 0;
+		std::string m_LastString;
+	};
+
+	static void CountCall(IConsole::IResult *pResult, void *pUser)
+	{
+		CCall *pCall = static_cast<CCall *>(pUser);
+		pCall->m_NumCalls++;
+		pCall->m_Sum += pResult->GetInteger(0);
+		pCall->m_LastString = pResult->GetString(1);
+		// callbacks may modify their arguments
+		if(pResult->NumArguments() > 0)
+			pResult->RemoveArgument(0);
+	}
+
+	static void CountChain(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
+	{
+		(*static_cast<int *>(pUserData))++;
+		pfnCallback(pResult, pCallbackUserData);
+	}
+};
+
+TEST_F(Console, FindCommand)
+{
+	CCall Server, Client;
+	m_pConsole->Register("test_cmd", "i[number] ?s[text]", CFGFLAG_SERVER, CountCall, &Server, "");
+	m_pConsole->Register("test_cmd", "i[number] ?s[text]", CFGFLAG_CLIENT, CountCall, &Client, "");
+
+	m_pConsole->ExecuteLine("test_cmd 1");
+	m_pConsole->ExecuteLine("TEST_Cmd 2 abc");
+	m_pConsole->ExecuteLine("test_cmd_unknown 4");
+	EXPECT_EQ(Server.m_NumCalls, 2);
+	EXPECT_EQ(Server.m_Sum, 3);
+	EXPECT_EQ(Server.m_LastString, "abc");
+	EXPECT_EQ(Client.m_NumCalls, 0);
+
+	int NumChained = 0;
+	m_pConsole->Chain("Test_CMD", CountChain, &NumChained);
+	m_pConsole->ExecuteLine("test_cmd 5");
+	EXPECT_EQ(NumChained, 1);
+	EXPECT_EQ(Server.m_Sum, 8);
+
+	m_pConsole->RegisterTemp("temp_cmd", "", CFGFLAG_SERVER, "");
+	EXPECT_TRUE(m_pConsole->GetCommandInfo("TEMP_CMD", CFGFLAG_SERVER, true));
+	EXPECT_FALSE(m_pConsole->GetCommandInfo("temp_cmd", CFGFLAG_SERVER, false));
+	m_pConsole->DeregisterTemp("temp_cmd");
+	EXPECT_FALSE(m_pConsole->GetCommandInfo("temp_cmd", CFGFLAG_SERVER, true));
+	m_pConsole->RegisterTemp("temp_cmd2", "", CFGFLAG_SERVER, "");
+	EXPECT_TRUE(m_pConsole->GetCommandInfo("temp_cmd2", CFGFLAG_SERVER, true));
+	m_pConsole->DeregisterTempAll();
+	EXPECT_FALSE(m_pConsole->GetCommandInfo("temp_cmd2", CFGFLAG_SERVER, true));
+	EXPECT_TRUE(m_pConsole->GetCommandInfo("test_cmd", CFGFLAG_SERVER, false));
+}
+
+TEST_F(Console, RepeatedLine)
+{
+	CCall Call;
+	m_pConsole->Register("test_cmd", "i[number] ?s[text]", CFGFLAG_SERVER, CountCall, &Call, "");
+	for(int i = 0; i < 3; i++)
+		m_pConsole->ExecuteLine("test_cmd 7 \"quoted \\\" text\"; test_cmd 1");
+	EXPECT_EQ(Call.m_NumCalls, 6);
+	EXPECT_EQ(Call.m_Sum, 24);
+
+	m_pConsole->ExecuteLine("test_cmd 7 \"quoted \\\" text\"");
+	EXPECT_EQ(Call.m_LastString, "quoted \" text");
+
+	// invalid arguments are rejected every time
+	for(int i = 0; i < 2; i++)
+		m_pConsole->ExecuteLine("test_cmd");
+	EXPECT_EQ(Call.m_NumCalls, 7);
+
+	// lines parsed for other parameters aren't reused
+	m_pConsole->Register("test_cmd", "r[text]", CFGFLAG_SERVER, CountCall, &Call, "");
+	m_pConsole->ExecuteLine("test_cmd 7 \"quoted \\\" text\"");
+	EXPECT_EQ(Call.m_NumCalls, 8);
+	EXPECT_EQ(Call.m_LastString, "");
+}
+
+TEST_F(Console, LargeAutoexec)
+{
+	const int NUM_COMMANDS = 500;
+	const int NUM_LINES = 50000;
+
+	std::vector<std::string> vNames;
+	vNames.reserve(NUM_COMMANDS);
+	std::vector<CCall> vCalls(NUM_COMMANDS);
+	for(int i = 0; i < NUM_COMMANDS; i++)
+	{
+		vNames.push_back("sv_benchmark_command_" + std::to_string(i));
+		m_pConsole->Register(vNames.back().c_str(), "i[number] ?r[text]", CFGFLAG_SERVER, CountCall, &vCalls[i], "");
+	}
+
+	// config like lines with a few frequently repeated ones, like votes
+	std::vector<std::string> vLines;
+	std::vector<CCall> vExpected(NUM_COMMANDS);
+	for(int i = 0; i < NUM_LINES; i++)
+	{
+		const int Command = i % 4 == 0 ? i % 8 : (i * 7919) % NUM_COMMANDS;
+		const int Value = i % 4 == 0 ? 1 : i % 100;
+		vLines.push_back(vNames[Command] + " " + std::to_string(Value) + " some text # comment");
+		vExpected[Command].m_NumCalls++;
+		vExpected[Command].m_Sum += Value;
+	}
+
+	for(const std::string &Line : vLines)
+		m_pConsole->ExecuteLine(Line.c_str());
+
+	// every line reaches its own command with its own arguments, whether it
+	// was parsed or taken from the parsed line cache
+	for(int i = 0; i < NUM_COMMANDS; i++)
+	{
+		EXPECT_EQ(vCalls[i].m_NumCalls, vExpected[i].m_NumCalls) << vNames[i];
+		EXPECT_EQ(vCalls[i].m_Sum, vExpected[i].m_Sum) << vNames[i];
+		if(vExpected[i].m_NumCalls)
+		{
+			EXPECT_EQ(vCalls[i].m_LastString, "some text ") << vNames[i];
+		}
+	}
+}
@@ -0,0 +1,267 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/hash_ctxt.h>
+
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
+#include <engine/storage.h>
+
+#include <memory>
+
+static const int FIRST_TICK = 100;
+static const int LAST_TICK = 700;
+static const int MESSAGE_INTERVAL = 10;
+
+class CCountingListener : public CDemoPlayer::IListener
+{
+public:
+	int m_NumSnapshots = 0;
+	int m_NumMessages = 0;
+
+	void OnDemoPlayerSnapshot(void *pData, int Size) override { m_NumSnapshots++; }
+	void OnDemoPlayerMessage(void *pData, int Size) override
+	{
+		EXPECT_EQ(Size, (int)sizeof(int));
+		m_NumMessages++;
+	}
+};
+
+class CHashingListener : public CDemoPlayer::IListener
+{
+public:
+	SHA256_CTX m_Sha256;
+	bool m_Enabled = true;
+
+	CHashingListener() { sha256_init(&m_Sha256); }
+	SHA256_DIGEST Finish() { return sha256_finish(&m_Sha256); }
+
+	void OnDemoPlayerSnapshot(void *pData, int Size) override
+	{
+		if(m_Enabled)
+			sha256_update(&m_Sha256, pData, Size);
+	}
+	void OnDemoPlayerMessage(void *pData, int Size) override
+	{
+		if(m_Enabled)
+			sha256_update(&m_Sha256, pData, Size);
+	}
+};
+
+static void RecordTestDemo(IStorage *pStorage, const char *pFilename, CDemoRecorderThread *pThread = nullptr, CDemoRecorder::EStopMode StopMode = CDemoRecorder::STOP_KEEP_FILE, const char *pTargetFilename = nullptr)
+{
+	CSnapshotDelta SnapshotDelta;
+	CDemoRecorder Recorder(&SnapshotDelta, true);
+	Recorder.SetThread(pThread);
+	unsigned char aMapData[1] = {0};
+	SHA256_DIGEST Sha256 = SHA256_ZEROED;
+	ASSERT_EQ(Recorder.Start(pStorage, nullptr, pFilename, "0.6 626fce9a778df4d4", "test", &Sha256, 0, "server", 0, aMapData), 0);
+
+	CSnapshotBuilder Builder;
+	char aSnapshot[CSnapshot::MAX_SIZE];
+	for(int Tick = FIRST_TICK; Tick <= LAST_TICK; Tick++)
+	{
+		Builder.Init();
+		int *pItem = (int *)Builder.NewItem(1, 0, 2 * sizeof(int));
+		pItem[0] = Tick;
+		pItem[1] = Tick / 7;
+		const int Size = Builder.Finish(aSnapshot);
+		Recorder.RecordSnapshot(Tick, aSnapshot, Size);
+		if(Tick % MESSAGE_INTERVAL == 0)
+			Recorder.RecordMessage(&Tick, sizeof(Tick));
+		if(Tick == FIRST_TICK + SERVER_TICK_SPEED * 5)
+			Recorder.AddDemoMarker();
+	}
+	EXPECT_EQ(Recorder.Length(), (LAST_TICK - FIRST_TICK) / SERVER_TICK_SPEED);
+	EXPECT_EQ(Recorder.Stop(StopMode, pTargetFilename), 0);
+	EXPECT_FALSE(Recorder.IsRecording());
+}
+
+TEST(Demo, KeyFrameIndex)
+{
+	CNetBase::Init();
+	auto pStorage = std::unique_ptr<IStorage>(CreateLocalStorage());
+	CTestInfo Info;
+	char aStripped[128];
+	Info.Filename(aStripped, sizeof(aStripped), "-stripped.tmp");
+
+	RecordTestDemo(pStorage.get(), Info.m_aFilename);
+
+	// the same demo without the trailer, so the player has to scan it
+	{
+		void *pData;
+		unsigned DataSize;
+		ASSERT_TRUE(pStorage->ReadFile(Info.m_aFilename, IStorage::TYPE_ALL, &pData, &DataSize));
+		IOHANDLE File = pStorage->OpenFile(aStripped, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		ASSERT_TRUE(File);
+		io_write(File, pData, DataSize - 1);
+		io_close(File);
+		free(pData);
+	}
+
+	CSnapshotDelta SnapshotDelta;
+	CDemoPlayer IndexedPlayer(&SnapshotDelta, false);
+	CDemoPlayer ScannedPlayer(&SnapshotDelta, false);
+	ASSERT_EQ(IndexedPlayer.Load(pStorage.get(), nullptr, Info.m_aFilename, IStorage::TYPE_ALL), 0);
+	ASSERT_EQ(ScannedPlayer.Load(pStorage.get(), nullptr, aStripped, IStorage::TYPE_ALL), 0);
+
+	const CDemoPlayer::CPlaybackInfo *pIndexedInfo = IndexedPlayer.Info();
+	const CDemoPlayer::CPlaybackInfo *pScannedInfo = ScannedPlayer.Info();
+	EXPECT_EQ(pIndexedInfo->m_Info.m_FirstTick, FIRST_TICK);
+	EXPECT_EQ(pIndexedInfo->m_Info.m_LastTick, LAST_TICK);
+	EXPECT_EQ(pIndexedInfo->m_SeekablePoints, 3);
+	EXPECT_EQ(pIndexedInfo->m_Info.m_FirstTick, pScannedInfo->m_Info.m_FirstTick);
+	EXPECT_EQ(pIndexedInfo->m_Info.m_LastTick, pScannedInfo->m_Info.m_LastTick);
+	EXPECT_EQ(pIndexedInfo->m_SeekablePoints, pScannedInfo->m_SeekablePoints);
+
+	// the index chunk must not show up during playback
+	CCountingListener Listener;
+	IndexedPlayer.SetListener(&Listener);
+	IndexedPlayer.Play();
+	while(IndexedPlayer.IsPlaying() && !pIndexedInfo->m_Info.m_Paused)
+		IndexedPlayer.Update(false);
+	EXPECT_TRUE(IndexedPlayer.IsPlaying());
+	EXPECT_EQ(Listener.m_NumMessages, (LAST_TICK - FIRST_TICK) / MESSAGE_INTERVAL + 1);
+	EXPECT_EQ(pIndexedInfo->m_Info.m_CurrentTick, LAST_TICK);
+
+	EXPECT_EQ(IndexedPlayer.SetPos(500), 0);
+	EXPECT_EQ(pIndexedInfo->m_NextTick, 500);
+
+	IndexedPlayer.Stop();
+	ScannedPlayer.Stop();
+
+	// the demo browser takes the length from the index if there is one
+	char aNoLength[128];
+	Info.Filename(aNoLength, sizeof(aNoLength), "-nolength.tmp");
+	{
+		void *pData;
+		unsigned DataSize;
+		ASSERT_TRUE(pStorage->ReadFile(Info.m_aFilename, IStorage::TYPE_ALL, &pData, &DataSize));
+		mem_zero((char *)pData + offsetof(CDemoHeader, m_aLength), sizeof(CDemoHeader::m_aLength));
+		IOHANDLE File = pStorage->OpenFile(aNoLength, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		ASSERT_TRUE(File);
+		io_write(File, pData, DataSize);
+		io_close(File);
+		free(pData);
+	}
+	const int Length = (LAST_TICK - FIRST_TICK) / SERVER_TICK_SPEED;
+	for(const char *pFilename : {Info.m_aFilename, aStripped, aNoLength})
+	{
+		CDemoHeader Header;
+		CTimelineMarkers TimelineMarkers;
+		CMapInfo MapInfo;
+		ASSERT_TRUE(IndexedPlayer.GetDemoInfo(pStorage.get(), pFilename, IStorage::TYPE_ALL, &Header, &TimelineMarkers, &MapInfo)) << pFilename;
+		EXPECT_EQ(bytes_be_to_uint(Header.m_aLength), (unsigned)Length) << pFilename;
+		EXPECT_STREQ(MapInfo.m_aName, "test");
+	}
+
+	if(!HasFailure())
+	{
+		pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
+		pStorage->RemoveFile(aStripped, IStorage::TYPE_SAVE);
+		pStorage->RemoveFile(aNoLength, IStorage::TYPE_SAVE);
+	}
+}
+
+TEST(Demo, RecorderThread)
+{
+	CNetBase::Init();
+	auto pStorage = std::unique_ptr<IStorage>(CreateLocalStorage());
+	CTestInfo Info;
+	char aRecording[128];
+	Info.Filename(aRecording, sizeof(aRecording), "-recording.tmp");
+	char aRemoved[128];
+	Info.Filename(aRemoved, sizeof(aRemoved), "-removed.tmp");
+
+	{
+		// the thread finishes, renames and removes the demos after the
+		// recorders were stopped, at the latest when it is destroyed
+		CSnapshotDelta SnapshotDelta;
+		CDemoRecorderThread Thread(SnapshotDelta, CSnapshot::MAX_SIZE * 4);
+		RecordTestDemo(pStorage.get(), aRecording, &Thread, CDemoRecorder::STOP_KEEP_FILE, Info.m_aFilename);
+		RecordTestDemo(pStorage.get(), aRemoved, &Thread, CDemoRecorder::STOP_REMOVE_FILE);
+	}
+	EXPECT_FALSE(pStorage->FileExists(aRecording, IStorage::TYPE_SAVE));
+	EXPECT_FALSE(pStorage->FileExists(aRemoved, IStorage::TYPE_SAVE));
+
+	CSnapshotDelta SnapshotDelta;
+	CDemoPlayer Player(&SnapshotDelta, false);
+	ASSERT_EQ(Player.Load(pStorage.get(), nullptr, Info.m_aFilename, IStorage::TYPE_ALL), 0);
+	const CDemoPlayer::CPlaybackInfo *pInfo = Player.Info();
+	EXPECT_EQ(pInfo->m_Info.m_FirstTick, FIRST_TICK);
+	EXPECT_EQ(pInfo->m_Info.m_LastTick, LAST_TICK);
+	EXPECT_EQ(bytes_be_to_uint(pInfo->m_Header.m_aLength), (unsigned)((LAST_TICK - FIRST_TICK) / SERVER_TICK_SPEED));
+	ASSERT_EQ(bytes_be_to_uint(pInfo->m_TimelineMarkers.m_aNumTimelineMarkers), 1u);
+	EXPECT_EQ(bytes_be_to_uint(pInfo->m_TimelineMarkers.m_aTimelineMarkers[0]), (unsigned)(FIRST_TICK + SERVER_TICK_SPEED * 5));
+
+	CCountingListener Listener;
+	Player.SetListener(&Listener);
+	Player.Play();
+	while(Player.IsPlaying() && !pInfo->m_Info.m_Paused)
+		Player.Update(false);
+	EXPECT_EQ(Listener.m_NumMessages, (LAST_TICK - FIRST_TICK) / MESSAGE_INTERVAL + 1);
+	EXPECT_EQ(pInfo->m_Info.m_CurrentTick, LAST_TICK);
+	Player.Stop();
+
+	if(!HasFailure())
+	{
+		pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
+	}
+}
+
+static SHA256_DIGEST PlayTestDemo(IStorage *pStorage, const char *pFilename, bool DecodeThread, bool StateCache)
+{
+	const int OldDecodeThread = g_Config.m_ClDemoDecodeThread;
+	const int OldStateCache = g_Config.m_ClDemoStateCache;
+	g_Config.m_ClDemoDecodeThread = DecodeThread;
+	g_Config.m_ClDemoStateCache = StateCache;
+	CSnapshotDelta SnapshotDelta;
+	CDemoPlayer Player(&SnapshotDelta, false);
+	EXPECT_EQ(Player.Load(pStorage, nullptr, pFilename, IStorage::TYPE_ALL), 0);
+	g_Config.m_ClDemoDecodeThread = OldDecodeThread;
+	g_Config.m_ClDemoStateCache = OldStateCache;
+	const CDemoPlayer::CPlaybackInfo *pInfo = Player.Info();
+
+	CHashingListener Listener;
+	Player.SetListener(&Listener);
+	Player.Play();
+	while(Player.IsPlaying() && !pInfo->m_Info.m_Paused)
+		Player.Update(false);
+	EXPECT_EQ(pInfo->m_Info.m_CurrentTick, LAST_TICK);
+
+	// seek back, with the state cache these resume from cached states
+	// instead of key frames, which must not change what is played back
+	for(int Tick : {650, 420, 300, 690, 123})
+	{
+		Listener.m_Enabled = false;
+		EXPECT_EQ(Player.SetPos(Tick), 0);
+		EXPECT_EQ(pInfo->m_NextTick, Tick);
+		Listener.m_Enabled = true;
+		Player.Unpause();
+		for(int i = 0; i < 20; i++)
+			Player.Update(false);
+	}
+	Player.Stop();
+	return Listener.Finish();
+}
+
+TEST(Demo, DecodeThread)
+{
+	CNetBase::Init();
+	auto pStorage = std::unique_ptr<IStorage>(CreateLocalStorage());
+	CTestInfo Info;
+	RecordTestDemo(pStorage.get(), Info.m_aFilename);
+
+	// replaying from the key frames on the main thread is the reference
+	const SHA256_DIGEST Expected = PlayTestDemo(pStorage.get(), Info.m_aFilename, false, false);
+	EXPECT_EQ(PlayTestDemo(pStorage.get(), Info.m_aFilename, false, true), Expected);
+	EXPECT_EQ(PlayTestDemo(pStorage.get(), Info.m_aFilename, true, false), Expected);
+	EXPECT_EQ(PlayTestDemo(pStorage.get(), Info.m_aFilename, true, true), Expected);
+
+	if(!HasFailure())
+	{
+		pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
+	}
+}
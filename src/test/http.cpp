@@ -0,0 +1,199 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <engine/server/map_http_server.h>
+#include <engine/shared/config.h>
+#include <engine/shared/http.h>
+#include <engine/storage.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// serves a map with the map HTTP server as a local stand-in for a web server
+class Http : public ::testing::Test
+{
+protected:
+	CMapHttpServer m_Server;
+	std::vector<unsigned char> m_vMap;
+	char m_aUrl[128];
+	std::atomic<bool> m_Stop{false};
+	std::thread m_Thread;
+
+	void SetUp() override
+	{
+		ASSERT_FALSE(HttpInit(nullptr));
+		g_Config.m_HttpAllowInsecure = 1;
+
+		m_vMap.resize(512 * 1024 + 3);
+		for(size_t i = 0; i < m_vMap.size(); i++)
+			m_vMap[i] = i * 13 + i / 509;
+		const SHA256_DIGEST Sha256 = sha256(m_vMap.data(), m_vMap.size());
+
+		NETADDR Addr;
+		ASSERT_EQ(net_addr_from_str(&Addr, "127.0.0.1:0"), 0);
+		bool Opened = false;
+		for(Addr.port = 18403; Addr.port < 18503 && !Opened; Addr.port++)
+			Opened = m_Server.Open(Addr, nullptr, 256);
+		ASSERT_TRUE(Opened);
+		m_Server.SetMap(0, Sha256, m_vMap.data(), m_vMap.size());
+
+		char aSha256[SHA256_MAXSTRSIZE];
+		sha256_str(Sha256, aSha256, sizeof(aSha256));
+		str_format(m_aUrl, sizeof(m_aUrl), "http://127.0.0.1:%d/%s.map", Addr.port - 1, aSha256);
+
+		m_Thread = std::thread([this]() {
+			while(!m_Stop)
+			{
+				m_Server.Update();
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			}
+		});
+	}
+
+	void TearDown() override
+	{
+		HttpShutdown(1000);
+		m_Stop = true;
+		if(m_Thread.joinable())
+			m_Thread.join();
+		g_Config.m_HttpAllowInsecure = 0;
+	}
+};
+
+TEST_F(Http, Get)
+{
+	std::shared_ptr<CHttpRequest> pRequest = HttpGet(m_aUrl);
+	pRequest->LogProgress(HTTPLOG::NONE);
+	HttpRun(pRequest);
+	pRequest->Wait();
+	ASSERT_EQ(pRequest->State(), HTTP_DONE);
+	EXPECT_EQ(pRequest->Status(), IJob::STATE_DONE);
+	unsigned char *pResult;
+	size_t ResultLength;
+	pRequest->Result(&pResult, &ResultLength);
+	ASSERT_EQ(ResultLength, m_vMap.size());
+	EXPECT_EQ(mem_comp(pResult, m_vMap.data(), ResultLength), 0);
+}
+
+TEST_F(Http, NotFound)
+{
+	char aUrl[128];
+	str_copy(aUrl, m_aUrl);
+	aUrl[str_length(aUrl) - 5] ^= 1;
+	std::shared_ptr<CHttpRequest> pRequest = HttpGet(aUrl);
+	pRequest->LogProgress(HTTPLOG::NONE);
+	HttpRun(pRequest);
+	pRequest->Wait();
+	EXPECT_EQ(pRequest->State(), HTTP_ERROR);
+}
+
+TEST_F(Http, Concurrent)
+{
+	// all requests are handled by the single HTTP thread, more of them than
+	// are run at once
+	std::vector<std::shared_ptr<CHttpRequest>> vpRequests;
+	for(int i = 0; i < 100; i++)
+	{
+		std::shared_ptr<CHttpRequest> pRequest = i % 2 ? HttpGet(m_aUrl) : HttpHead(m_aUrl);
+		pRequest->LogProgress(HTTPLOG::NONE);
+		HttpRun(pRequest);
+		vpRequests.push_back(pRequest);
+	}
+	for(size_t i = 0; i < vpRequests.size(); i++)
+	{
+		vpRequests[i]->Wait();
+		EXPECT_EQ(vpRequests[i]->State(), HTTP_DONE);
+		unsigned char *pResult;
+		size_t ResultLength;
+		vpRequests[i]->Result(&pResult, &ResultLength);
+		EXPECT_EQ(ResultLength, i % 2 ? m_vMap.size() : 0);
+	}
+}
+
+TEST_F(Http, Blocking)
+{
+	std::unique_ptr<CHttpRequest> pRequest = HttpHead(m_aUrl);
+	pRequest->LogProgress(HTTPLOG::NONE);
+	CJobPool::RunBlocking(pRequest.get());
+	EXPECT_EQ(pRequest->State(), HTTP_DONE);
+	EXPECT_EQ(pRequest->Status(), IJob::STATE_DONE);
+}
+
+class CResponseJob : public IJob
+{
+	std::shared_ptr<CHttpRequest> m_pRequest;
+	void Run() override { m_State = m_pRequest->State(); }
+
+public:
+	std::atomic<int> m_State{-2};
+	CResponseJob(std::shared_ptr<CHttpRequest> pRequest) :
+		m_pRequest(std::move(pRequest)) {}
+};
+
+TEST_F(Http, Dependency)
+{
+	CJobPool Pool;
+	Pool.Init(1);
+	std::shared_ptr<CHttpRequest> pRequest = HttpGet(m_aUrl);
+	pRequest->LogProgress(HTTPLOG::NONE);
+	auto pJob = std::make_shared<CResponseJob>(pRequest);
+	pJob->AddDependency(pRequest);
+	Pool.Add(pJob);
+	HttpRun(pRequest);
+	while(pJob->Status() != IJob::STATE_DONE)
+		thread_yield();
+	EXPECT_EQ(pJob->m_State, HTTP_DONE);
+}
+
+TEST_F(Http, Abort)
+{
+	std::shared_ptr<CHttpRequest> pRequest = HttpGet(m_aUrl);
+	pRequest->LogProgress(HTTPLOG::NONE);
+	pRequest->Abort();
+	HttpRun(pRequest);
+	pRequest->Wait();
+	EXPECT_EQ(pRequest->State(), HTTP_ABORTED);
+}
+
+TEST_F(Http, Cache)
+{
+	CTestInfo Info;
+	std::unique_ptr<IStorage> pStorage(Info.CreateTestStorage());
+	ASSERT_TRUE(pStorage);
+
+	for(int i = 0; i < 2; i++)
+	{
+		std::shared_ptr<CHttpRequest> pRequest = HttpGet(m_aUrl);
+		pRequest->LogProgress(HTTPLOG::NONE);
+		pRequest->UseCache(pStorage.get());
+		HttpRun(pRequest);
+		pRequest->Wait();
+		ASSERT_EQ(pRequest->State(), HTTP_DONE);
+		// the second request is revalidated with the stored ETag
+		EXPECT_EQ(pRequest->FromCache(), i == 1);
+		unsigned char *pResult;
+		size_t ResultLength;
+		pRequest->Result(&pResult, &ResultLength);
+		ASSERT_EQ(ResultLength, m_vMap.size());
+		EXPECT_EQ(mem_comp(pResult, m_vMap.data(), ResultLength), 0);
+	}
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+}
+
+TEST_F(Http, Shutdown)
+{
+	HttpShutdown(1000);
+	std::shared_ptr<CHttpRequest> pRequest = HttpGet(m_aUrl);
+	pRequest->LogProgress(HTTPLOG::NONE);
+	HttpRun(pRequest);
+	pRequest->Wait();
+	EXPECT_EQ(pRequest->State(), HTTP_ABORTED);
+
+	ASSERT_FALSE(HttpInit(nullptr));
+	pRequest = HttpGet(m_aUrl);
+	pRequest->LogProgress(HTTPLOG::NONE);
+	HttpRun(pRequest);
+	pRequest->Wait();
+	EXPECT_EQ(pRequest->State(), HTTP_DONE);
+}
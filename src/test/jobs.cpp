@@ -6,6 +6,7 @@
 #include <engine/shared/jobs.h>
 
 #include <functional>
+#include <mutex>
 
 static const int TEST_NUM_THREADS = 4;
 
@@ -145,3 +146,89 @@ TEST_F(Jobs, Many)
 	}
 	new(&m_Pool) CJobPool();
 }
+
+TEST_F(Jobs, Priority)
+{
+	// keep all workers busy while the other jobs are queued
+	SEMAPHORE Blocked, Release;
+	sphore_init(&Blocked);
+	sphore_init(&Release);
+	for(int i = 0; i < TEST_NUM_THREADS; i++)
+	{
+		Add(std::make_shared<CJob>([&] {
+			sphore_signal(&Blocked);
+			sphore_wait(&Release);
+		}));
+	}
+	for(int i = 0; i < TEST_NUM_THREADS; i++)
+		sphore_wait(&Blocked);
+
+	std::mutex Lock;
+	std::vector<int> vOrder;
+	std::vector<std::shared_ptr<IJob>> vpJobs;
+	for(int Priority : {IJob::PRIORITY_LOW, IJob::PRIORITY_NORMAL, IJob::PRIORITY_HIGH, IJob::PRIORITY_LOW, IJob::PRIORITY_HIGH})
+	{
+		auto pJob = std::make_shared<CJob>([&, Priority] {
+			std::lock_guard<std::mutex> LockScope(Lock);
+			vOrder.push_back(Priority);
+		});
+		pJob->SetPriority(Priority);
+		Add(pJob);
+		vpJobs.push_back(pJob);
+	}
+
+	// a single worker runs the queued jobs in priority order
+	sphore_signal(&Release);
+	for(auto &pJob : vpJobs)
+	{
+		while(pJob->Status() != IJob::STATE_DONE)
+			thread_yield();
+	}
+	EXPECT_EQ(vOrder, std::vector<int>({IJob::PRIORITY_HIGH, IJob::PRIORITY_HIGH, IJob::PRIORITY_NORMAL, IJob::PRIORITY_LOW, IJob::PRIORITY_LOW}));
+	EXPECT_EQ(m_Pool.Stats(IJob::PRIORITY_HIGH).m_NumJobs, 2);
+	EXPECT_EQ(m_Pool.Stats(IJob::PRIORITY_LOW).m_NumJobs, 2);
+	EXPECT_GE(m_Pool.Stats(IJob::PRIORITY_LOW).m_MaxLatency, m_Pool.Stats(IJob::PRIORITY_HIGH).m_MaxLatency);
+
+	for(int i = 1; i < TEST_NUM_THREADS; i++)
+		sphore_signal(&Release);
+	m_Pool.Destroy();
+	sphore_destroy(&Blocked);
+	sphore_destroy(&Release);
+}
+
+TEST_F(Jobs, Dependencies)
+{
+	static const int NUM_JOBS = 200;
+	std::atomic<int> NumDone(0);
+	std::atomic<int> Result(-1);
+
+	auto pFirst = std::make_shared<CJob>([] {});
+	Add(pFirst);
+	while(pFirst->Status() != IJob::STATE_DONE)
+		thread_yield();
+
+	// fan-out to many jobs which are joined by the last one
+	auto pLast = std::make_shared<CJob>([&] { Result = NumDone.load(); });
+	auto pStart = std::make_shared<CJob>([] {});
+	std::vector<std::shared_ptr<IJob>> vpJobs;
+	for(int i = 0; i < NUM_JOBS; i++)
+	{
+		auto pJob = std::make_shared<CJob>([&] { NumDone++; });
+		pJob->AddDependency(pStart);
+		pLast->AddDependency(pJob);
+		vpJobs.push_back(pJob);
+	}
+	// dependencies which are already done don't delay the job
+	pLast->AddDependency(pFirst);
+	Add(pLast);
+	for(auto &pJob : vpJobs)
+		Add(pJob);
+	EXPECT_EQ(vpJobs[0]->Status(), IJob::STATE_PENDING);
+	EXPECT_EQ(pLast->Status(), IJob::STATE_PENDING);
+
+	Add(pStart);
+	while(pLast->Status() != IJob::STATE_DONE)
+		thread_yield();
+	EXPECT_EQ(Result, NUM_JOBS);
+	EXPECT_EQ(NumDone, NUM_JOBS);
+}
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include <engine/shared/jsonreader.h>
+
+#include <string>
+
+// writes the events in a compact form
+class CJsonEventRecorder : public CJsonReader
+{
+protected:
+	bool OnBeginObject() override { return Add("{"); }
+	bool OnEndObject() override { return Add("}"); }
+	bool OnBeginArray() override { return Add("["); }
+	bool OnEndArray() override { return Add("]"); }
+	bool OnKey(const char *pKey) override { return Add(std::string("k:") + pKey); }
+	bool OnString(const char *pValue) override { return Add(std::string("s:") + pValue); }
+	bool OnInt(int64_t Value) override { return Add("i:" + std::to_string(Value)); }
+	bool OnDouble(double Value) override { return Add("d:" + std::to_string(Value)); }
+	bool OnBool(bool Value) override { return Add(Value ? "true" : "false"); }
+	bool OnNull() override { return Add("null"); }
+
+	bool Add(const std::string &Event)
+	{
+		if(!m_Events.empty())
+			m_Events += ' ';
+		m_Events += Event;
+		return Event == m_AbortOn;
+	}
+
+public:
+	std::string m_Events;
+	std::string m_AbortOn;
+};
+
+static std::string Parse(const char *pJson)
+{
+	CJsonEventRecorder Reader;
+	if(Reader.Feed(pJson, str_length(pJson)) || Reader.Finish())
+		return "error";
+	return Reader.m_Events;
+}
+
+TEST(JsonReader, Values)
+{
+	EXPECT_EQ(Parse("{}"), "{ }");
+	EXPECT_EQ(Parse("[]"), "[ ]");
+	EXPECT_EQ(Parse(" { \"a\" : [ 1 , -2 , 3.5 , 1e2 ] , \"b\":{\"c\":null},\"d\":true,\"e\":false } "),
+		"{ k:a [ i:1 i:-2 d:3.500000 d:100.000000 ] k:b { k:c null } k:d true k:e false }");
+	EXPECT_EQ(Parse("\"abc\""), "s:abc");
+	EXPECT_EQ(Parse("0"), "i:0");
+	EXPECT_EQ(Parse("-12"), "i:-12");
+	EXPECT_EQ(Parse("[[],[[]],{}]"), "[ [ ] [ [ ] ] { } ]");
+}
+
+TEST(JsonReader, Strings)
+{
+	EXPECT_EQ(Parse(R"("a\"b\\c\/d\n")"), "s:a\"b\\c/d\n");
+	EXPECT_EQ(Parse(R"("Aä愛")"), "s:Aä愛");
+	EXPECT_EQ(Parse(R"("😂")"), "s:😂");
+	EXPECT_EQ(Parse(R"("愛😂")"), "s:愛😂");
+	EXPECT_EQ(Parse(R"("\ud83d")"), "error");
+	EXPECT_EQ(Parse(R"("\ud83dx")"), "error");
+	EXPECT_EQ(Parse(R"("\ude02")"), "error");
+	EXPECT_EQ(Parse(R"("\ude02\ud83d")"), "error");
+	EXPECT_EQ(Parse(R"("\ud83d\u0041")"), "error");
+	EXPECT_EQ(Parse(R"("\ud83d\ud83d")"), "error");
+	EXPECT_EQ(Parse(R"("\ud7ff\ue000")"), "s:\ud7ff\ue000");
+	EXPECT_EQ(Parse(R"("\u00g0")"), "error");
+	EXPECT_EQ(Parse(R"("\x")"), "error");
+}
+
+TEST(JsonReader, Errors)
+{
+	EXPECT_EQ(Parse(""), "error");
+	EXPECT_EQ(Parse("{"), "error");
+	EXPECT_EQ(Parse("[1,]"), "error");
+	EXPECT_EQ(Parse("{\"a\"}"), "error");
+	EXPECT_EQ(Parse("{\"a\":1,}"), "error");
+	EXPECT_EQ(Parse("{1:2}"), "error");
+	EXPECT_EQ(Parse("[1}"), "error");
+	EXPECT_EQ(Parse("{}}"), "error");
+	EXPECT_EQ(Parse("{} {}"), "error");
+	EXPECT_EQ(Parse("tru"), "error");
+	EXPECT_EQ(Parse("nul1"), "error");
+	EXPECT_EQ(Parse("01"), "error");
+	EXPECT_EQ(Parse("1."), "error");
+	EXPECT_EQ(Parse("-"), "error");
+	EXPECT_EQ(Parse("1e"), "error");
+	EXPECT_EQ(Parse("\"abc"), "error");
+	std::string Deep(1000, '[');
+	EXPECT_EQ(Parse(Deep.c_str()), "error");
+}
+
+TEST(JsonReader, Chunks)
+{
+	const char *pJson = R"({"servers": [{"name": "aä😂\"", "n": -12.5e1, "ok": true, "x": null}, 1234]})";
+	const std::string Expected = Parse(pJson);
+	ASSERT_NE(Expected, "error");
+
+	// the result doesn't depend on where the input is split
+	const int Length = str_length(pJson);
+	for(int Split = 0; Split <= Length; Split++)
+	{
+		CJsonEventRecorder Reader;
+		EXPECT_FALSE(Reader.Feed(pJson, Split));
+		EXPECT_FALSE(Reader.Feed(pJson + Split, Length - Split));
+		EXPECT_FALSE(Reader.Finish());
+		EXPECT_EQ(Reader.m_Events, Expected) << "split at " << Split;
+	}
+	CJsonEventRecorder Reader;
+	for(int i = 0; i < Length; i++)
+		EXPECT_FALSE(Reader.Feed(pJson + i, 1));
+	EXPECT_FALSE(Reader.Finish());
+	EXPECT_EQ(Reader.m_Events, Expected);
+}
+
+TEST(JsonReader, Abort)
+{
+	CJsonEventRecorder Reader;
+	Reader.m_AbortOn = "k:b";
+	const char *pJson = R"({"a": 1, "b": 2, "c": 3})";
+	EXPECT_TRUE(Reader.Feed(pJson, str_length(pJson)));
+	EXPECT_EQ(Reader.m_Events, "{ k:a i:1 k:b");
+	// nothing is parsed after an error
+	EXPECT_TRUE(Reader.Feed("}", 1));
+	EXPECT_TRUE(Reader.Finish());
+	EXPECT_EQ(Reader.m_Events, "{ k:a i:1 k:b");
+}
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include <engine/server/map_http_server.h>
+
+#include <algorithm>
+#include <vector>
+
+TEST(MapHttpServer, ParseRequest)
+{
+	bool Head;
+	char aPath[64];
+	EXPECT_EQ(CMapHttpServer::ParseRequest("GET /abc.map HTTP/1.1\r\nHost: x\r\n\r\n", &Head, aPath, sizeof(aPath)), 200);
+	EXPECT_FALSE(Head);
+	EXPECT_STREQ(aPath, "/abc.map");
+	EXPECT_EQ(CMapHttpServer::ParseRequest("HEAD /abc.map HTTP/1.0\r\n\r\n", &Head, aPath, sizeof(aPath)), 200);
+	EXPECT_TRUE(Head);
+	EXPECT_EQ(CMapHttpServer::ParseRequest("POST /abc.map HTTP/1.1\r\n\r\n", &Head, aPath, sizeof(aPath)), 405);
+	EXPECT_EQ(CMapHttpServer::ParseRequest("GET /abc.map\r\n\r\n", &Head, aPath, sizeof(aPath)), 400);
+	EXPECT_EQ(CMapHttpServer::ParseRequest("GET /abc.map FTP/1.1\r\n\r\n", &Head, aPath, sizeof(aPath)), 400);
+	EXPECT_EQ(CMapHttpServer::ParseRequest("GET /0123456789012345678901234567890123456789012345678901234567890123456789 HTTP/1.1\r\n\r\n", &Head, aPath, sizeof(aPath)), 414);
+}
+
+TEST(MapHttpServer, ParsePath)
+{
+	const SHA256_DIGEST Expected = sha256("abc", 3);
+	char aSha256[SHA256_MAXSTRSIZE];
+	sha256_str(Expected, aSha256, sizeof(aSha256));
+
+	char aPath[128];
+	SHA256_DIGEST Sha256;
+	str_format(aPath, sizeof(aPath), "/%s.map", aSha256);
+	EXPECT_TRUE(CMapHttpServer::ParsePath(aPath, &Sha256));
+	EXPECT_EQ(Sha256, Expected);
+	str_format(aPath, sizeof(aPath), "/%s.map?foo=bar", aSha256);
+	EXPECT_TRUE(CMapHttpServer::ParsePath(aPath, &Sha256));
+	EXPECT_EQ(Sha256, Expected);
+
+	str_format(aPath, sizeof(aPath), "/%s.mop", aSha256);
+	EXPECT_FALSE(CMapHttpServer::ParsePath(aPath, &Sha256));
+	str_format(aPath, sizeof(aPath), "/x%s.map", aSha256);
+	EXPECT_FALSE(CMapHttpServer::ParsePath(aPath, &Sha256));
+	EXPECT_FALSE(CMapHttpServer::ParsePath("/../../etc/passwd", &Sha256));
+	aSha256[10] = 'x';
+	str_format(aPath, sizeof(aPath), "/%s.map", aSha256);
+	EXPECT_FALSE(CMapHttpServer::ParsePath(aPath, &Sha256));
+}
+
+static std::vector<unsigned char> Download(CMapHttpServer *pServer, const NETADDR &Addr, const char *pRequest)
+{
+	NETADDR BindAddr = {};
+	BindAddr.type = NETTYPE_IPV4;
+	NETSOCKET Socket = net_tcp_create(BindAddr);
+	EXPECT_TRUE(Socket);
+	EXPECT_EQ(net_tcp_connect(Socket, &Addr), 0);
+	net_tcp_send(Socket, pRequest, str_length(pRequest));
+	net_set_non_blocking(Socket);
+
+	std::vector<unsigned char> vResponse;
+	const int64_t Timeout = time_get() + 10 * time_freq();
+	while(time_get() < Timeout)
+	{
+		pServer->Update();
+		unsigned char aBuf[16384];
+		int Bytes = net_tcp_recv(Socket, aBuf, sizeof(aBuf));
+		if(Bytes == 0)
+			break;
+		if(Bytes > 0)
+			vResponse.insert(vResponse.end(), aBuf, aBuf + Bytes);
+	}
+	net_tcp_close(Socket);
+	return vResponse;
+}
+
+static bool OpenServer(CMapHttpServer *pServer, NETADDR *pAddr)
+{
+	if(net_addr_from_str(pAddr, "127.0.0.1:0") != 0)
+		return false;
+	for(pAddr->port = 18303; pAddr->port < 18403; pAddr->port++)
+	{
+		if(pServer->Open(*pAddr, nullptr, 4))
+			return true;
+	}
+	return false;
+}
+
+// splits a response into its header, without the empty line, and its body
+static bool SplitResponse(const std::vector<unsigned char> &vResponse, std::string *pHeader, std::vector<unsigned char> *pvBody)
+{
+	const char *pHeaderEnd = "\r\n\r\n";
+	auto HeaderEnd = std::search(vResponse.begin(), vResponse.end(), pHeaderEnd, pHeaderEnd + 4);
+	if(HeaderEnd == vResponse.end())
+		return false;
+	*pHeader = std::string(vResponse.begin(), HeaderEnd);
+	pvBody->assign(HeaderEnd + 4, vResponse.end());
+	return true;
+}
+
+TEST(MapHttpServer, Download)
+{
+	std::vector<unsigned char> vMap(3 * 1024 * 1024 + 17);
+	for(size_t i = 0; i < vMap.size(); i++)
+		vMap[i] = i * 7 + i / 251;
+	const SHA256_DIGEST Sha256 = sha256(vMap.data(), vMap.size());
+	char aSha256[SHA256_MAXSTRSIZE];
+	sha256_str(Sha256, aSha256, sizeof(aSha256));
+
+	CMapHttpServer Server;
+	NETADDR Addr;
+	ASSERT_TRUE(OpenServer(&Server, &Addr));
+	Server.SetMap(0, Sha256, vMap.data(), vMap.size());
+
+	char aRequest[256];
+	str_format(aRequest, sizeof(aRequest), "GET /%s.map HTTP/1.1\r\nHost: localhost\r\n\r\n", aSha256);
+	std::vector<unsigned char> vResponse = Download(&Server, Addr, aRequest);
+	const char *pHeaderEnd = "\r\n\r\n";
+	auto HeaderEnd = std::search(vResponse.begin(), vResponse.end(), pHeaderEnd, pHeaderEnd + 4);
+	ASSERT_NE(HeaderEnd, vResponse.end());
+	std::string Header(vResponse.begin(), HeaderEnd);
+	EXPECT_TRUE(str_startswith(Header.c_str(), "HTTP/1.1 200 OK\r\n"));
+	EXPECT_NE(Header.find("Content-Length: 3145745\r\n"), std::string::npos);
+	std::vector<unsigned char> vBody(HeaderEnd + 4, vResponse.end());
+	EXPECT_EQ(vBody, vMap);
+
+	str_format(aRequest, sizeof(aRequest), "HEAD /%s.map HTTP/1.1\r\n\r\n", aSha256);
+	vResponse = Download(&Server, Addr, aRequest);
+	ASSERT_GE(vResponse.size(), 4u);
+	EXPECT_TRUE(std::equal(vResponse.end() - 4, vResponse.end(), pHeaderEnd));
+
+	// replaced maps are not served anymore
+	Server.SetMap(0, Sha256, nullptr, 0);
+	vResponse = Download(&Server, Addr, aRequest);
+	EXPECT_TRUE(str_startswith(std::string(vResponse.begin(), vResponse.end()).c_str(), "HTTP/1.1 404 Not Found\r\n"));
+	EXPECT_EQ(Server.NumConnections(), 0);
+}
+
+TEST(MapHttpServer, NotModified)
+{
+	std::vector<unsigned char> vMap(12345);
+	for(size_t i = 0; i < vMap.size(); i++)
+		vMap[i] = i * 13;
+	const SHA256_DIGEST Sha256 = sha256(vMap.data(), vMap.size());
+	char aSha256[SHA256_MAXSTRSIZE];
+	sha256_str(Sha256, aSha256, sizeof(aSha256));
+
+	CMapHttpServer Server;
+	NETADDR Addr;
+	ASSERT_TRUE(OpenServer(&Server, &Addr));
+	Server.SetMap(0, Sha256, vMap.data(), vMap.size());
+
+	char aRequest[256];
+	str_format(aRequest, sizeof(aRequest), "GET /%s.map HTTP/1.1\r\nHost: localhost\r\n\r\n", aSha256);
+	std::string Header;
+	std::vector<unsigned char> vBody;
+	ASSERT_TRUE(SplitResponse(Download(&Server, Addr, aRequest), &Header, &vBody));
+	EXPECT_TRUE(str_startswith(Header.c_str(), "HTTP/1.1 200 OK\r\n"));
+	const char *pETag = "\r\nETag: ";
+	const size_t ETagStart = Header.find(pETag);
+	ASSERT_NE(ETagStart, std::string::npos);
+	const size_t ETagEnd = Header.find("\r\n", ETagStart + 2);
+	const std::string ETag = Header.substr(ETagStart + str_length(pETag), ETagEnd == std::string::npos ? std::string::npos : ETagEnd - ETagStart - str_length(pETag));
+	EXPECT_EQ(ETag, std::string("\"") + aSha256 + "\"");
+	EXPECT_EQ(vBody, vMap);
+
+	// the cached map is still current
+	str_format(aRequest, sizeof(aRequest), "GET /%s.map HTTP/1.1\r\nHost: localhost\r\nIf-None-Match: %s\r\n\r\n", aSha256, ETag.c_str());
+	ASSERT_TRUE(SplitResponse(Download(&Server, Addr, aRequest), &Header, &vBody));
+	EXPECT_TRUE(str_startswith(Header.c_str(), "HTTP/1.1 304 Not Modified\r\n"));
+	EXPECT_TRUE(vBody.empty());
+
+	// a different tag gets the whole map
+	str_format(aRequest, sizeof(aRequest), "GET /%s.map HTTP/1.1\r\nHost: localhost\r\nIf-None-Match: \"0123\"\r\n\r\n", aSha256);
+	ASSERT_TRUE(SplitResponse(Download(&Server, Addr, aRequest), &Header, &vBody));
+	EXPECT_TRUE(str_startswith(Header.c_str(), "HTTP/1.1 200 OK\r\n"));
+	EXPECT_EQ(vBody, vMap);
+	EXPECT_EQ(Server.NumConnections(), 0);
+}
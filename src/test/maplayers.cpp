@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/shared/jobs.h>
+#include <engine/storage.h>
+#include <game/client/components/maplayers.h>
+#include <game/layers.h>
+#include <game/mapitems.h>
+
+#include <memory>
+#include <vector>
+
+class MapLayers : public ::testing::Test
+{
+protected:
+	using CVisuals = CMapLayers::STileLayerVisuals;
+	using CVisual = CMapLayers::STileLayerVisuals::STileVisual;
+	using CJob = CMapLayers::CTileLayerBufferJob;
+
+	std::unique_ptr<IKernel> m_pKernel;
+	CLayers m_Layers;
+
+	void SetUp() override
+	{
+		m_pKernel = std::unique_ptr<IKernel>(IKernel::Create());
+		IStorage *pStorage = CreateLocalStorage();
+		ASSERT_TRUE(pStorage);
+		m_pKernel->RegisterInterface(pStorage);
+		IEngineMap *pMap = CreateEngineMap();
+		m_pKernel->RegisterInterface(pMap);
+		m_pKernel->RegisterInterface(static_cast<IMap *>(pMap), false);
+		ASSERT_TRUE(pMap->Load("data/maps/coverage.map"));
+		m_Layers.Init(m_pKernel.get());
+		ASSERT_TRUE(m_Layers.GameLayer());
+	}
+
+	// the jobs of all tile layers of the map, like CMapLayers::OnMapLoad
+	// creates them
+	void AddJobs(bool As3DTextureCoords, std::vector<CVisuals *> &vpVisuals, std::vector<std::shared_ptr<CJob>> &vpJobs)
+	{
+		for(int g = 0; g < m_Layers.NumGroups(); g++)
+		{
+			CMapItemGroup *pGroup = m_Layers.GetGroup(g);
+			for(int l = 0; l < pGroup->m_NumLayers; l++)
+			{
+				CMapItemLayer *pLayer = m_Layers.GetLayer(pGroup->m_StartLayer + l);
+				if(pLayer->m_Type == LAYERTYPE_TILES)
+					CMapLayers::AddTileLayerJobs(&m_Layers, (CMapItemLayerTilemap *)pLayer, pGroup, As3DTextureCoords, vpVisuals, vpJobs);
+			}
+		}
+	}
+
+	static void ExpectSameVisual(CVisual &Parallel, CVisual &Serial, const char *pWhat, size_t Job, unsigned Index)
+	{
+		EXPECT_EQ(Parallel.IndexBufferByteOffset(), Serial.IndexBufferByteOffset()) << pWhat << " " << Index << " of job " << Job;
+		EXPECT_EQ(Parallel.DoDraw(), Serial.DoDraw()) << pWhat << " " << Index << " of job " << Job;
+	}
+
+	static void ExpectSameVisuals(CVisuals *pParallel, CVisuals *pSerial, size_t Job)
+	{
+		ASSERT_EQ(pParallel->m_Width, pSerial->m_Width);
+		ASSERT_EQ(pParallel->m_Height, pSerial->m_Height);
+		EXPECT_EQ(pParallel->m_IsTextured, pSerial->m_IsTextured);
+		for(unsigned i = 0; i < pSerial->m_Width * pSerial->m_Height; i++)
+			ExpectSameVisual(pParallel->m_pTilesOfLayer[i], pSerial->m_pTilesOfLayer[i], "tile", Job, i);
+		// the borders leave out the corners
+		for(unsigned i = 0; i + 2 < pSerial->m_Width; i++)
+		{
+			ExpectSameVisual(pParallel->m_pBorderTop[i], pSerial->m_pBorderTop[i], "top border", Job, i);
+			ExpectSameVisual(pParallel->m_pBorderBottom[i], pSerial->m_pBorderBottom[i], "bottom border", Job, i);
+		}
+		for(unsigned i = 0; i + 2 < pSerial->m_Height; i++)
+		{
+			ExpectSameVisual(pParallel->m_pBorderLeft[i], pSerial->m_pBorderLeft[i], "left border", Job, i);
+			ExpectSameVisual(pParallel->m_pBorderRight[i], pSerial->m_pBorderRight[i], "right border", Job, i);
+		}
+		ExpectSameVisual(pParallel->m_BorderTopLeft, pSerial->m_BorderTopLeft, "top left corner", Job, 0);
+		ExpectSameVisual(pParallel->m_BorderTopRight, pSerial->m_BorderTopRight, "top right corner", Job, 0);
+		ExpectSameVisual(pParallel->m_BorderBottomLeft, pSerial->m_BorderBottomLeft, "bottom left corner", Job, 0);
+		ExpectSameVisual(pParallel->m_BorderBottomRight, pSerial->m_BorderBottomRight, "bottom right corner", Job, 0);
+		ExpectSameVisual(pParallel->m_BorderKillTile, pSerial->m_BorderKillTile, "kill tile", Job, 0);
+	}
+};
+
+TEST_F(MapLayers, ParallelMatchesSerial)
+{
+	for(bool As3DTextureCoords : {false, true})
+	{
+		std::vector<CVisuals *> vpParallelVisuals;
+		std::vector<std::shared_ptr<CJob>> vpParallelJobs;
+		AddJobs(As3DTextureCoords, vpParallelVisuals, vpParallelJobs);
+		std::vector<CVisuals *> vpSerialVisuals;
+		std::vector<std::shared_ptr<CJob>> vpSerialJobs;
+		AddJobs(As3DTextureCoords, vpSerialVisuals, vpSerialJobs);
+		ASSERT_EQ(vpParallelJobs.size(), vpSerialJobs.size());
+		ASSERT_FALSE(vpSerialJobs.empty());
+
+		{
+			CJobPool Pool;
+			Pool.Init(4);
+			for(auto &pJob : vpParallelJobs)
+				Pool.Add(pJob);
+			for(auto &pJob : vpParallelJobs)
+			{
+				while(pJob->Status() != IJob::STATE_DONE)
+					thread_yield();
+			}
+		}
+		for(auto &pJob : vpSerialJobs)
+			CJobPool::RunBlocking(pJob.get());
+
+		size_t NumTiles = 0;
+		for(size_t i = 0; i < vpSerialJobs.size(); i++)
+		{
+			const CJob *pParallel = vpParallelJobs[i].get();
+			const CJob *pSerial = vpSerialJobs[i].get();
+			ExpectSameVisuals(pParallel->Visuals(), pSerial->Visuals(), i);
+			EXPECT_EQ(pParallel->m_NumTiles, pSerial->m_NumTiles) << "job " << i;
+			ASSERT_EQ(pParallel->m_UploadDataSize, pSerial->m_UploadDataSize) << "job " << i;
+			if(pSerial->m_UploadDataSize > 0)
+			{
+				EXPECT_EQ(mem_comp(pParallel->m_pUploadData, pSerial->m_pUploadData, pSerial->m_UploadDataSize), 0) << "job " << i;
+			}
+			NumTiles += pSerial->m_NumTiles;
+		}
+		EXPECT_GT(NumTiles, 0u);
+
+		for(CVisuals *pVisuals : vpParallelVisuals)
+			delete pVisuals;
+		for(CVisuals *pVisuals : vpSerialVisuals)
+			delete pVisuals;
+	}
+}
@@ -2,6 +2,8 @@
 
 #include <engine/server/name_ban.h>
 
+#include <algorithm>
+
 TEST(NameBan, Empty)
 {
 	std::vector<CNameBan> vBans;
@@ -30,3 +32,53 @@ TEST(NameBan, Substring)
 	EXPECT_TRUE(IsNameBanned("abcxyzdef", vBans));
 	EXPECT_FALSE(IsNameBanned("abcdef", vBans));
 }
+
+TEST(NameBan, Index)
+{
+	static const char *const s_apNames[] = {"", "abc", "ABC", "äbc", "abd", "xyz", "nameless tee", "brainless tee", "Tee", "tee", "ÄÖÜ", "äöü", "a", "ab", "aaaaaaaaaaaaaaa", "12345", "1234", "l1l1", "ñ"};
+	static const char *const s_apQueries[] = {"", " ", "abc", "  abc  ", "xabcx", "ABCD", "zzz", "tee", "nameless  tee", "my tee", "äöü!", "ÄÖÜ", "aaaa", "1l1l", "\xff", "\xff\xfe\xfd", "Ñ", "12346", "bc", "xyzxyz"};
+
+	CNameBans Bans;
+	std::vector<CNameBan> vBans;
+	unsigned Seed = 1;
+	auto &&Random = [&Seed](unsigned Max) {
+		Seed = Seed * 1103515245 + 12345;
+		return (Seed >> 16) % Max;
+	};
+
+	for(int Round = 0; Round < 500; Round++)
+	{
+		const char *pName = s_apNames[Random(std::size(s_apNames))];
+		if(Random(4) == 0)
+		{
+			Bans.Unban(pName);
+			vBans.erase(std::remove_if(vBans.begin(), vBans.end(), [pName](const CNameBan &Ban) { return str_comp(Ban.m_aName, pName) == 0; }), vBans.end());
+		}
+		else
+		{
+			const int Distance = (int)Random(5) - 1;
+			const int IsSubstring = Random(3);
+			Bans.Ban(pName, Distance, IsSubstring, "");
+			auto Existing = std::find_if(vBans.begin(), vBans.end(), [pName](const CNameBan &Ban) { return str_comp(Ban.m_aName, pName) == 0; });
+			if(Existing == vBans.end())
+				vBans.emplace_back(pName, Distance, IsSubstring);
+			else
+			{
+				Existing->m_Distance = Distance;
+				Existing->m_IsSubstring = IsSubstring;
+			}
+		}
+		ASSERT_EQ(Bans.Bans().size(), vBans.size());
+
+		for(const char *pQuery : s_apQueries)
+		{
+			const CNameBan *pExpected = IsNameBanned(pQuery, vBans);
+			const CNameBan *pIndexed = Bans.IsBanned(pQuery);
+			ASSERT_EQ(pExpected == nullptr, pIndexed == nullptr) << "round " << Round << " query '" << pQuery << "'";
+			if(pExpected)
+			{
+				EXPECT_STREQ(pExpected->m_aName, pIndexed->m_aName) << "round " << Round << " query '" << pQuery << "'";
+			}
+		}
+	}
+}
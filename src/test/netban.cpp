@@ -0,0 +1,135 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <engine/console.h>
+#include <engine/shared/config.h>
+#include <engine/shared/netban.h>
+#include <engine/storage.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+class CTestRange
+{
+public:
+	NETADDR m_LB;
+	NETADDR m_UB;
+
+	bool Matches(const NETADDR *pAddr) const
+	{
+		const int Bytes = pAddr->type == NETTYPE_IPV4 ? 4 : 16;
+		return m_LB.type == pAddr->type && mem_comp(m_LB.ip, pAddr->ip, Bytes) <= 0 && mem_comp(m_UB.ip, pAddr->ip, Bytes) >= 0;
+	}
+};
+
+static NETADDR RandomAddr(unsigned *pSeed, bool Ipv6)
+{
+	NETADDR Addr;
+	mem_zero(&Addr, sizeof(Addr));
+	Addr.type = Ipv6 ? NETTYPE_IPV6 : NETTYPE_IPV4;
+	for(int i = 0; i < (Ipv6 ? 16 : 4); i++)
+	{
+		*pSeed = *pSeed * 1103515245 + 12345;
+		// few distinct values, so the bans overlap
+		Addr.ip[i] = 10 + ((*pSeed >> 16) % 4) * 60 + (i >= 2 ? (*pSeed >> 8) % 3 : 0);
+	}
+	return Addr;
+}
+
+TEST(NetBan, Match)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage(Info.CreateTestStorage());
+	ASSERT_TRUE(pStorage);
+	std::unique_ptr<IConsole> pConsole = CreateConsole(CFGFLAG_SERVER);
+	CNetBan NetBan;
+	NetBan.Init(pConsole.get(), pStorage.get());
+
+	// more bans than the old fixed size pools could hold
+	unsigned Seed = 1;
+	std::vector<CTestRange> vBans;
+	IOHANDLE File = pStorage->OpenFile("banlist.txt", IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	for(int i = 0; i < 3000; i++)
+	{
+		CTestRange Ban;
+		Ban.m_LB = RandomAddr(&Seed, i % 5 == 0);
+		Ban.m_UB = Ban.m_LB;
+		char aLB[NETADDR_MAXSTRSIZE], aUB[NETADDR_MAXSTRSIZE], aLine[128];
+		net_addr_str(&Ban.m_LB, aLB, sizeof(aLB), false);
+		if(i % 3 == 0)
+		{
+			str_format(aLine, sizeof(aLine), "%s # single address", aLB);
+		}
+		else if(i % 3 == 1)
+		{
+			const int Length = Ban.m_LB.type == NETTYPE_IPV4 ? 20 + i % 12 : 100 + i % 28;
+			for(int Bit = Length; Bit < (Ban.m_LB.type == NETTYPE_IPV4 ? 32 : 128); Bit++)
+			{
+				Ban.m_LB.ip[Bit / 8] &= ~(1 << (7 - Bit % 8));
+				Ban.m_UB.ip[Bit / 8] |= 1 << (7 - Bit % 8);
+			}
+			str_format(aLine, sizeof(aLine), "%s/%d", aLB, Length);
+		}
+		else
+		{
+			NETADDR Other = RandomAddr(&Seed, Ban.m_LB.type == NETTYPE_IPV6);
+			if(mem_comp(Other.ip, Ban.m_LB.ip, sizeof(Other.ip)) < 0)
+				Ban.m_LB = Other;
+			else
+				Ban.m_UB = Other;
+			net_addr_str(&Ban.m_LB, aLB, sizeof(aLB), false);
+			net_addr_str(&Ban.m_UB, aUB, sizeof(aUB), false);
+			str_format(aLine, sizeof(aLine), "  %s - %s", aLB, aUB);
+		}
+		io_write(File, aLine, str_length(aLine));
+		io_write_newline(File);
+		// ranges of a single address are invalid
+		if(i % 3 != 2 || mem_comp(Ban.m_LB.ip, Ban.m_UB.ip, sizeof(Ban.m_LB.ip)) != 0)
+			vBans.push_back(Ban);
+	}
+	io_write(File, "not an address\n", 15);
+	io_close(File);
+	pConsole->StoreCommands(false);
+	pConsole->ExecuteLine("bans_load banlist.txt");
+
+	auto &&Check = [&]() {
+		for(int i = 0; i < 20000; i++)
+		{
+			const NETADDR Addr = RandomAddr(&Seed, i % 5 == 0);
+			bool Expected = false;
+			for(const CTestRange &Ban : vBans)
+				Expected = Expected || Ban.Matches(&Addr);
+			char aBuf[128];
+			ASSERT_EQ(NetBan.IsBanned(&Addr, aBuf, sizeof(aBuf)), Expected);
+		}
+	};
+	Check();
+
+	// removing bans must leave the others in place
+	for(int i = 0; i < 30; i++)
+	{
+		const CTestRange Ban = vBans.back();
+		if(mem_comp(Ban.m_LB.ip, Ban.m_UB.ip, sizeof(Ban.m_LB.ip)) == 0)
+			NetBan.UnbanByAddr(&Ban.m_LB);
+		else
+		{
+			CNetRange Range;
+			Range.m_LB = Ban.m_LB;
+			Range.m_UB = Ban.m_UB;
+			NetBan.UnbanByRange(&Range);
+		}
+		// the same ban may have been listed more than once
+		vBans.erase(std::remove_if(vBans.begin(), vBans.end(), [&Ban](const CTestRange &Other) {
+			return mem_comp(&Ban.m_LB, &Other.m_LB, sizeof(Ban.m_LB)) == 0 && mem_comp(&Ban.m_UB, &Other.m_UB, sizeof(Ban.m_UB)) == 0;
+		}),
+			vBans.end());
+	}
+	Check();
+
+	NetBan.UnbanAll();
+	vBans.clear();
+	Check();
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/packer.h>
+#include <game/server/save.h>
+
+#include <memory>
+#include <string>
+
+// a save in the text encoding, with values that differ for every field
+static std::string TextSave(int NumTees, int NumSwitchers)
+{
+	char aBuf[64];
+	str_format(aBuf, sizeof(aBuf), "3\t%d\t%d\t1\t0", NumTees, NumSwitchers);
+	std::string Save = aBuf;
+	for(int Tee = 0; Tee < NumTees; Tee++)
+	{
+		str_format(aBuf, sizeof(aBuf), "\ntee %d", Tee);
+		Save += aBuf;
+		// 99 values before the game uuid, 14 after it
+		for(int i = 0; i < 99; i++)
+		{
+			str_format(aBuf, sizeof(aBuf), "\t%d", (Tee * 131 + i * 17) % 1000);
+			Save += aBuf;
+		}
+		Save += "\t8d300ecf-5873-4297-bee5-95668fdff320";
+		// not hooking anyone
+		Save += "\t-1";
+		for(int i = 0; i < 13; i++)
+		{
+			str_format(aBuf, sizeof(aBuf), "\t%d", (Tee * 37 + i * 3) % 100);
+			Save += aBuf;
+		}
+	}
+	for(int Switcher = 1; Switcher <= NumSwitchers; Switcher++)
+	{
+		str_format(aBuf, sizeof(aBuf), "\n%d\t%d\t%d", Switcher % 2, Switcher * 1000, Switcher % 3);
+		Save += aBuf;
+	}
+	return Save;
+}
+
+TEST(SaveTeam, BinaryRoundTrip)
+{
+	for(int NumTees : {1, 5, 64})
+	{
+		auto pTeam = std::make_unique<CSaveTeam>();
+		ASSERT_EQ(pTeam->FromString(TextSave(NumTees, 3).c_str()), 0);
+		const std::string Text = pTeam->GetString();
+		const std::string Binary = pTeam->GetBinaryString();
+		EXPECT_TRUE(str_startswith(Binary.c_str(), CSaveTeam::BINARY_PREFIX));
+		EXPECT_LT(Binary.size(), Text.size());
+
+		auto pLoaded = std::make_unique<CSaveTeam>();
+		ASSERT_EQ(pLoaded->FromString(Binary.c_str()), 0);
+		EXPECT_EQ(pLoaded->GetMembersCount(), NumTees);
+		EXPECT_EQ(pLoaded->GetString(), Text);
+		EXPECT_EQ(pLoaded->GetBinaryString(), Binary);
+	}
+}
+
+TEST(SaveTeam, BinaryTruncated)
+{
+	for(int NumTees : {1, 5})
+	{
+		auto pTeam = std::make_unique<CSaveTeam>();
+		ASSERT_EQ(pTeam->FromString(TextSave(NumTees, 3).c_str()), 0);
+		const std::string Binary = pTeam->GetBinaryString();
+
+		auto pLoaded = std::make_unique<CSaveTeam>();
+		for(size_t Length = str_length(CSaveTeam::BINARY_PREFIX); Length < Binary.size(); Length++)
+			EXPECT_NE(pLoaded->FromString(Binary.substr(0, Length).c_str()), 0) << NumTees << " tees, " << Length << " characters";
+	}
+}
+
+TEST(SaveTeam, BinaryCorrupt)
+{
+	auto pTeam = std::make_unique<CSaveTeam>();
+	ASSERT_EQ(pTeam->FromString(TextSave(5, 3).c_str()), 0);
+	const std::string Binary = pTeam->GetBinaryString();
+
+	// the compressed data is checksummed
+	auto pLoaded = std::make_unique<CSaveTeam>();
+	for(size_t i = str_length(CSaveTeam::BINARY_PREFIX); i < Binary.size(); i++)
+	{
+		std::string Corrupt = Binary;
+		Corrupt[i] = Corrupt[i] == 'A' ? 'B' : 'A';
+		if(pLoaded->FromString(Corrupt.c_str()) == 0)
+		{
+			EXPECT_LE(pLoaded->GetMembersCount(), MAX_CLIENTS);
+		}
+	}
+
+	EXPECT_NE(pLoaded->FromString("#1"), 0);
+	EXPECT_NE(pLoaded->FromString("#1!not base64!"), 0);
+
+	// uncompressed, with more members than there can be
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(0);
+	Packer.AddInt(5);
+	for(int Value : {0, MAX_CLIENTS + 1, 0, 0, 0})
+		Packer.AddInt(Value);
+	char aBuf[128];
+	str_copy(aBuf, CSaveTeam::BINARY_PREFIX, sizeof(aBuf));
+	str_base64(aBuf + str_length(aBuf), sizeof(aBuf) - str_length(aBuf), Packer.Data(), Packer.Size());
+	EXPECT_NE(pLoaded->FromString(aBuf), 0);
+}
+
+TEST(SaveTeam, ConvertToBinary)
+{
+	for(int NumTees : {1, 5, 64})
+	{
+		const std::string Text = TextSave(NumTees, 3);
+		auto pText = std::make_unique<CSaveTeam>();
+		ASSERT_EQ(pText->FromString(Text.c_str()), 0);
+
+		char aBinary[65536];
+		ASSERT_TRUE(CSaveTeam::ConvertToBinary(Text.c_str(), aBinary, sizeof(aBinary))) << NumTees << " tees";
+		EXPECT_TRUE(str_startswith(aBinary, CSaveTeam::BINARY_PREFIX));
+		EXPECT_LT((size_t)str_length(aBinary), Text.size());
+
+		auto pBinary = std::make_unique<CSaveTeam>();
+		ASSERT_EQ(pBinary->FromString(aBinary), 0);
+		EXPECT_EQ(pBinary->GetMembersCount(), pText->GetMembersCount());
+		EXPECT_EQ(std::string(pBinary->GetString()), std::string(pText->GetString()));
+
+		// converting a binary save again keeps it
+		char aAgain[65536];
+		ASSERT_TRUE(CSaveTeam::ConvertToBinary(aBinary, aAgain, sizeof(aAgain)));
+		EXPECT_STREQ(aAgain, aBinary);
+
+		// the binary save doesn't fit
+		EXPECT_FALSE(CSaveTeam::ConvertToBinary(Text.c_str(), aBinary, str_length(aAgain)));
+	}
+
+	char aBuf[64];
+	EXPECT_FALSE(CSaveTeam::ConvertToBinary("not a save", aBuf, sizeof(aBuf)));
+}
@@ -13,24 +13,6 @@
 int DummyMysqlInit = (MysqlInit(), 1);
 #endif
 
-char *CSaveTeam::GetString()
-{
-	// Dummy implementation for testing
-	return nullptr;
-}
-
-int CSaveTeam::FromString(char const *)
-{
-	// Dummy implementation for testing
-	return 1;
-}
-
-bool CSaveTeam::MatchPlayers(const char (*paNames)[MAX_NAME_LENGTH], const int *pClientID, int NumPlayer, char *pMessage, int MessageLen)
-{
-	// Dummy implementation for testing
-	return false;
-}
-
 TEST(SQLite, Version)
 {
 	ASSERT_GE(sqlite3_libversion_number(), 3025000) << "SQLite >= 3.25.0 required for Window functions";
@@ -238,6 +220,210 @@ TEST_P(SingleScore, TimesDoesntExist)
 	ExpectLines(m_pPlayerResult, {"There are no times in the specified range"});
 }
 
+struct BatchedScore : public Score
+{
+	BatchedScore()
+	{
+		InsertBatch();
+		str_copy(m_PlayerRequest.m_aMap, "Kobra 3", sizeof(m_PlayerRequest.m_aMap));
+		str_copy(m_PlayerRequest.m_aRequestingPlayer, "brainless tee", sizeof(m_PlayerRequest.m_aRequestingPlayer));
+		m_PlayerRequest.m_Offset = 0;
+		str_copy(m_PlayerRequest.m_aServer, "GER", sizeof(m_PlayerRequest.m_aServer));
+		str_copy(m_PlayerRequest.m_aName, "nameless tee", sizeof(m_PlayerRequest.m_aName));
+	}
+
+	void InsertBatch()
+	{
+		str_copy(g_Config.m_SvSqlServerName, "USA", sizeof(g_Config.m_SvSqlServerName));
+		const char *apNames[] = {"nameless tee", "brainless tee", "nameless tee"};
+		const float aTimes[] = {100.0f, 110.0f, 90.0f};
+		std::vector<std::unique_ptr<CSqlScoreData>> vpScores;
+		const ISqlData *apData[std::size(apNames)];
+		for(size_t i = 0; i < std::size(apNames); i++)
+		{
+			auto pScore = std::make_unique<CSqlScoreData>(std::make_shared<CScorePlayerResult>());
+			str_copy(pScore->m_aMap, "Kobra 3", sizeof(pScore->m_aMap));
+			str_copy(pScore->m_aGameUuid, "8d300ecf-5873-4297-bee5-95668fdff320", sizeof(pScore->m_aGameUuid));
+			str_copy(pScore->m_aName, apNames[i], sizeof(pScore->m_aName));
+			pScore->m_ClientID = i;
+			pScore->m_Time = aTimes[i];
+			str_copy(pScore->m_aTimestamp, "2021-11-24 19:24:08", sizeof(pScore->m_aTimestamp));
+			for(float &Cp : pScore->m_aCurrentTimeCp)
+				Cp = 0;
+			apData[i] = pScore.get();
+			vpScores.push_back(std::move(pScore));
+		}
+		ASSERT_FALSE(m_pConn->StartTransaction(m_aError, sizeof(m_aError))) << m_aError;
+		ASSERT_FALSE(CScoreWorker::SaveScores(m_pConn, apData, std::size(apData), Write::NORMAL, m_aError, sizeof(m_aError))) << m_aError;
+		ASSERT_FALSE(m_pConn->CommitTransaction(m_aError, sizeof(m_aError))) << m_aError;
+
+		// points are only awarded once for the first finish in the batch
+		const auto *pFirstResult = dynamic_cast<CScorePlayerResult *>(vpScores[0]->m_pResult.get());
+		const auto *pSecondFinishResult = dynamic_cast<CScorePlayerResult *>(vpScores[2]->m_pResult.get());
+		EXPECT_STREQ(pFirstResult->m_Data.m_aaMessages[0], "You earned 5 points for finishing this map!");
+		EXPECT_STREQ(pSecondFinishResult->m_Data.m_aaMessages[0], "");
+	}
+};
+
+TEST_P(BatchedScore, Top)
+{
+	ASSERT_FALSE(CScoreWorker::ShowTop(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	ExpectLines(m_pPlayerResult,
+		{"------------ Global Top ------------",
+			"1. nameless tee Time: 01:30.00",
+			"2. brainless tee Time: 01:50.00",
+			"------------ GER Top ------------"});
+}
+
+TEST_P(BatchedScore, Points)
+{
+	ASSERT_FALSE(CScoreWorker::ShowPoints(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	ExpectLines(m_pPlayerResult, {"1. nameless tee Points: 5, requested by brainless tee"}, true);
+}
+
+TEST_P(BatchedScore, Rows)
+{
+	// more rows than fit into one statement, with times that are rounded
+	const int NumScores = 13;
+	std::vector<std::unique_ptr<CSqlScoreData>> vpScores;
+	const ISqlData *apData[NumScores];
+	for(int i = 0; i < NumScores; i++)
+	{
+		auto pScore = std::make_unique<CSqlScoreData>(std::make_shared<CScorePlayerResult>());
+		str_copy(pScore->m_aMap, "Kobra 4", sizeof(pScore->m_aMap));
+		str_copy(pScore->m_aGameUuid, "8d300ecf-5873-4297-bee5-95668fdff320", sizeof(pScore->m_aGameUuid));
+		str_format(pScore->m_aName, sizeof(pScore->m_aName), "tee %d", i);
+		pScore->m_ClientID = i;
+		pScore->m_Time = 100.0f + i + 0.004f;
+		str_copy(pScore->m_aTimestamp, "2021-11-24 19:24:08", sizeof(pScore->m_aTimestamp));
+		for(int Cp = 0; Cp < (int)std::size(pScore->m_aCurrentTimeCp); Cp++)
+			pScore->m_aCurrentTimeCp[Cp] = Cp + i;
+		apData[i] = pScore.get();
+		vpScores.push_back(std::move(pScore));
+	}
+	ASSERT_FALSE(m_pConn->StartTransaction(m_aError, sizeof(m_aError))) << m_aError;
+	ASSERT_FALSE(CScoreWorker::SaveScores(m_pConn, apData, NumScores, Write::NORMAL, m_aError, sizeof(m_aError))) << m_aError;
+	ASSERT_FALSE(m_pConn->CommitTransaction(m_aError, sizeof(m_aError))) << m_aError;
+
+	ASSERT_FALSE(m_pConn->PrepareStatement("SELECT COUNT(*), SUM(Time), SUM(cp1), SUM(cp25) FROM record_race WHERE Map = 'Kobra 4'", m_aError, sizeof(m_aError))) << m_aError;
+	bool End;
+	ASSERT_FALSE(m_pConn->Step(&End, m_aError, sizeof(m_aError))) << m_aError;
+	ASSERT_FALSE(End);
+	EXPECT_EQ(m_pConn->GetInt(1), NumScores);
+	EXPECT_NEAR(m_pConn->GetFloat(2), 100.0f * NumScores + NumScores * (NumScores - 1) / 2, 0.001f);
+	EXPECT_NEAR(m_pConn->GetFloat(3), NumScores * (NumScores - 1) / 2, 0.001f);
+	EXPECT_NEAR(m_pConn->GetFloat(4), 24 * NumScores + NumScores * (NumScores - 1) / 2, 0.001f);
+}
+
+struct Leaderboard : public Score
+{
+	Leaderboard()
+	{
+		// ties and ranks from several servers
+		InsertRanks({{"nameless tee", 100.0f, "USA"},
+			{"brainless tee", 90.0f, "GER"},
+			{"brainless tee", 95.0f, "USA"},
+			{"tiny tee", 100.0f, "GER"},
+			{"big tee", 120.5f, "GER"},
+			{"slow tee", 300.25f, "CHL"},
+			{"fast tee", 60.0f, "USA"},
+			{"fast tee", 200.0f, "GER"}});
+		LoadLeaderboard();
+		str_copy(m_PlayerRequest.m_aMap, "Kobra 3", sizeof(m_PlayerRequest.m_aMap));
+		str_copy(m_PlayerRequest.m_aRequestingPlayer, "brainless tee", sizeof(m_PlayerRequest.m_aRequestingPlayer));
+		str_copy(m_PlayerRequest.m_aServer, "GER", sizeof(m_PlayerRequest.m_aServer));
+	}
+
+	struct CRank
+	{
+		const char *m_pName;
+		float m_Time;
+		const char *m_pServer;
+	};
+
+	void InsertRanks(std::initializer_list<CRank> Ranks)
+	{
+		for(const CRank &Rank : Ranks)
+		{
+			str_copy(g_Config.m_SvSqlServerName, Rank.m_pServer, sizeof(g_Config.m_SvSqlServerName));
+			CSqlScoreData ScoreData(std::make_shared<CScorePlayerResult>());
+			str_copy(ScoreData.m_aMap, "Kobra 3", sizeof(ScoreData.m_aMap));
+			str_copy(ScoreData.m_aGameUuid, "8d300ecf-5873-4297-bee5-95668fdff320", sizeof(ScoreData.m_aGameUuid));
+			str_copy(ScoreData.m_aName, Rank.m_pName, sizeof(ScoreData.m_aName));
+			ScoreData.m_ClientID = 0;
+			ScoreData.m_Time = Rank.m_Time;
+			str_copy(ScoreData.m_aTimestamp, "2021-11-24 19:24:08", sizeof(ScoreData.m_aTimestamp));
+			for(float &Cp : ScoreData.m_aCurrentTimeCp)
+				Cp = 0;
+			ASSERT_FALSE(CScoreWorker::SaveScore(m_pConn, &ScoreData, Write::NORMAL, m_aError, sizeof(m_aError))) << m_aError;
+		}
+	}
+
+	void LoadLeaderboard()
+	{
+		CSqlLeaderboardRequest Request(m_pLeaderboard);
+		str_copy(Request.m_aMap, "Kobra 3", sizeof(Request.m_aMap));
+		str_copy(Request.m_aServer, "GER", sizeof(Request.m_aServer));
+		ASSERT_FALSE(CScoreWorker::LoadLeaderboard(m_pConn, &Request, m_aError, sizeof(m_aError))) << m_aError;
+	}
+
+	// the leaderboard has to give the same answers as the database
+	void ExpectSameAnswers(const char *pName, int Offset)
+	{
+		str_copy(m_PlayerRequest.m_aName, pName, sizeof(m_PlayerRequest.m_aName));
+		m_PlayerRequest.m_Offset = Offset;
+
+		auto pResult = std::make_shared<CScorePlayerResult>();
+		CSqlPlayerRequest Request = m_PlayerRequest;
+		Request.m_pResult = pResult;
+		if(Offset == 0)
+		{
+			ASSERT_FALSE(CScoreWorker::ShowRank(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+			CScoreWorker::ShowRankFromLeaderboard(m_pLeaderboard.get(), &Request);
+		}
+		else
+		{
+			ASSERT_FALSE(CScoreWorker::ShowTop(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+			CScoreWorker::ShowTopFromLeaderboard(m_pLeaderboard.get(), &Request);
+		}
+		EXPECT_EQ(pResult->m_MessageKind, m_pPlayerResult->m_MessageKind);
+		for(int i = 0; i < CScorePlayerResult::MAX_MESSAGES; i++)
+			EXPECT_STREQ(pResult->m_Data.m_aaMessages[i], m_pPlayerResult->m_Data.m_aaMessages[i]);
+		m_pPlayerResult->SetVariant(CScorePlayerResult::DIRECT);
+	}
+
+	std::shared_ptr<CScoreLeaderboardResult> m_pLeaderboard{std::make_shared<CScoreLeaderboardResult>()};
+};
+
+TEST_P(Leaderboard, Rank)
+{
+	for(const char *pName : {"nameless tee", "brainless tee", "tiny tee", "big tee", "slow tee", "fast tee", "unknown tee"})
+		ExpectSameAnswers(pName, 0);
+}
+
+TEST_P(Leaderboard, Top)
+{
+	for(int Offset : {1, 2, 4, 7, 10, -1, -3})
+		ExpectSameAnswers("", Offset);
+}
+
+TEST_P(Leaderboard, Update)
+{
+	const float Time = 97.5f;
+	m_pLeaderboard->m_Global.Add("big tee", Time);
+	m_pLeaderboard->m_Regional.Add("big tee", Time);
+	m_pLeaderboard->m_Global.Add("new tee", 1000.0f);
+	m_pLeaderboard->m_Regional.Add("new tee", 1000.0f);
+	// only better than the regional time
+	m_pLeaderboard->m_Global.Add("fast tee", 70.0f);
+	m_pLeaderboard->m_Regional.Add("fast tee", 70.0f);
+	InsertRanks({{"big tee", Time, "GER"}, {"new tee", 1000.0f, "GER"}, {"fast tee", 70.0f, "GER"}});
+	for(const char *pName : {"big tee", "new tee", "fast tee", "tiny tee"})
+		ExpectSameAnswers(pName, 0);
+	for(int Offset : {1, 3, -1})
+		ExpectSameAnswers("", Offset);
+}
+
 struct TeamScore : public Score
 {
 	void SetUp() override
@@ -579,6 +765,8 @@ auto g_TestValues
 		})
 
 INSTANTIATE(SingleScore);
+INSTANTIATE(BatchedScore);
+INSTANTIATE(Leaderboard);
 INSTANTIATE(TeamScore);
 INSTANTIATE(MapInfo);
 INSTANTIATE(MapVote);
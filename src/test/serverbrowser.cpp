@@ -1,9 +1,17 @@
 #include <gtest/gtest.h>
+#include <cstddef>
 #include <memory>
+#include <string>
+#include <vector>
 
+#include <engine/client/serverbrowser.h>
+#include <engine/client/serverbrowser_http.h>
 #include <engine/client/serverbrowser_ping_cache.h>
 #include <engine/console.h>
 #include <engine/engine.h>
+#include <engine/external/json-parser/json.h>
+#include <engine/favorites.h>
+#include <engine/friends.h>
 #include <engine/shared/config.h>
 #include <engine/storage.h>
 #include <test/test.h>
@@ -97,3 +105,451 @@ TEST(ServerBrowser, PingCache)
 	EXPECT_EQ(pPingCache->GetPing(&OtherLocalhost4, 1), 1337);
 	EXPECT_EQ(pPingCache->GetPing(&OtherLocalhost6, 1), 345);
 }
+
+static bool ParseServerList(const char *pJson, std::vector<CServerInfo> *pvServers, std::vector<NETADDR> *pvLegacyServers, size_t ChunkSize = 16 * 1024)
+{
+	CServerListParser Parser;
+	const size_t Length = str_length(pJson);
+	for(size_t Offset = 0; Offset < Length; Offset += ChunkSize)
+	{
+		if(Parser.Feed(pJson + Offset, minimum(ChunkSize, Length - Offset)))
+			return true;
+	}
+	return Parser.Finish(pvServers, pvLegacyServers);
+}
+
+TEST(ServerBrowser, ParseServerList)
+{
+	const char *pJson = R"({
+		"servers": [
+			{
+				"addresses": ["tw-0.6+udp://1.2.3.4:8303", "unknown://1.2.3.4:8303", "tw-0.6+udp://1.2.3.5:8303"],
+				"location": "eu:de",
+				"unknown": [{"info": 1}],
+				"info": {
+					"max_clients": 64, "max_players": 64, "passworded": true,
+					"game_type": "DDraceNetwork", "name": "My \"server\" \u00e4", "version": "0.6.4",
+					"map": {"name": "Multeasymap", "sha256": "abc"},
+					"client_score_kind": "time",
+					"clients": [
+						{"name": "nameless tee", "clan": "", "country": -1, "score": 12, "is_player": true, "skin": {"color_body": 1, "name": "", "color_feet": 2}},
+						{"name": "brainless tee", "clan": "x", "country": 276, "score": -9999, "is_player": false, "afk": true}
+					]
+				}
+			},
+			{
+				"addresses": [1],
+				"info": {"max_clients": "invalid"}
+			},
+			{
+				"info": {
+					"max_clients": 1, "max_players": 2, "passworded": false,
+					"game_type": "a", "name": "b", "version": "c", "map": {"name": "d"}, "clients": []
+				},
+				"addresses": ["unknown://1.2.3.4:8303"]
+			}
+		],
+		"servers_legacy": ["5.6.7.8:8303"]
+	})";
+
+	std::vector<CServerInfo> vServers;
+	std::vector<NETADDR> vLegacyServers;
+	for(size_t ChunkSize : {1, 7, 4096})
+	{
+		ASSERT_FALSE(ParseServerList(pJson, &vServers, &vLegacyServers, ChunkSize));
+		// the second server has invalid info, the third no known address
+		ASSERT_EQ(vServers.size(), 1u);
+		const CServerInfo &Info = vServers[0];
+		ASSERT_EQ(Info.m_NumAddresses, 2);
+		char aAddr[NETADDR_MAXSTRSIZE];
+		net_addr_str(&Info.m_aAddresses[1], aAddr, sizeof(aAddr), true);
+		EXPECT_STREQ(aAddr, "1.2.3.5:8303");
+		EXPECT_EQ(Info.m_Location, CServerInfo::LOC_EUROPE);
+		EXPECT_EQ(Info.m_MaxClients, 64);
+		EXPECT_EQ(Info.m_Flags, SERVER_FLAG_PASSWORD);
+		EXPECT_EQ(Info.m_ClientScoreKind, CServerInfo::CLIENT_SCORE_KIND_TIME);
+		EXPECT_STREQ(Info.m_aName, "My \"server\" ä");
+		EXPECT_STREQ(Info.m_aMap, "Multeasymap");
+		ASSERT_EQ(Info.m_NumClients, 2);
+		EXPECT_EQ(Info.m_NumPlayers, 1);
+		EXPECT_STREQ(Info.m_aClients[0].m_aSkin, "default");
+		EXPECT_TRUE(Info.m_aClients[0].m_CustomSkinColors);
+		EXPECT_EQ(Info.m_aClients[0].m_CustomSkinColorFeet, 2);
+		EXPECT_FALSE(Info.m_aClients[0].m_Afk);
+		EXPECT_STREQ(Info.m_aClients[1].m_aName, "brainless tee");
+		EXPECT_EQ(Info.m_aClients[1].m_Country, 276);
+		EXPECT_STREQ(Info.m_aClients[1].m_aSkin, "");
+		EXPECT_TRUE(Info.m_aClients[1].m_Afk);
+		ASSERT_EQ(vLegacyServers.size(), 1u);
+	}
+
+	EXPECT_TRUE(ParseServerList(R"({"servers_legacy": []})", &vServers, &vLegacyServers));
+	EXPECT_TRUE(ParseServerList(R"({"servers": {}})", &vServers, &vLegacyServers));
+	EXPECT_TRUE(ParseServerList(R"({"servers": [], "servers_legacy": ["invalid"]})", &vServers, &vLegacyServers));
+	EXPECT_TRUE(ParseServerList(R"({"servers": [{"info": {}}]})", &vServers, &vLegacyServers));
+	EXPECT_TRUE(ParseServerList(R"({"servers": [{"addresses": [], "location": "mars"}]})", &vServers, &vLegacyServers));
+	EXPECT_TRUE(ParseServerList(R"({"servers": [1]})", &vServers, &vLegacyServers));
+	EXPECT_TRUE(ParseServerList(R"({"servers": [])", &vServers, &vLegacyServers));
+	EXPECT_FALSE(ParseServerList(R"({"servers": [{"addresses": []}]})", &vServers, &vLegacyServers));
+	EXPECT_TRUE(vServers.empty());
+}
+
+// Serverlist in the format of the masters, with about as many servers and
+// players as the real one.
+static std::string GenerateServerList(int NumServers)
+{
+	std::string Json = "{\"servers\":[";
+	for(int i = 0; i < NumServers; i++)
+	{
+		char aServer[512];
+		str_format(aServer, sizeof(aServer),
+			"%s{\"addresses\":[\"tw-0.6+udp://10.%d.%d.1:8303\",\"tw-0.7+udp://10.%d.%d.1:8303\"],\"location\":\"%s\","
+			"\"info\":{\"max_clients\":64,\"max_players\":64,\"passworded\":%s,\"game_type\":\"DDraceNetwork\","
+			"\"name\":\"DDNet GER%d - Novice [DDraceNetwork] \\u00e4\",\"map\":{\"name\":\"Map %d\",\"sha256\":\"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef\",\"size\":%d},"
+			"\"version\":\"0.6.4, 17.3\",\"client_score_kind\":\"time\",\"requires_login\":false,\"clients\":[",
+			i == 0 ? "" : ",", i / 256, i % 256, i / 256, i % 256, i % 3 ? "eu:de" : "na:us", i % 7 == 0 ? "true" : "false", i, i % 500, 10000 + i);
+		Json += aServer;
+		for(int c = 0; c < (i * 7) % 24; c++)
+		{
+			char aClient[256];
+			str_format(aClient, sizeof(aClient),
+				"%s{\"name\":\"player %d.%d\",\"clan\":\"clan %d\",\"country\":%d,\"score\":%d,\"is_player\":%s,"
+				"\"skin\":{\"name\":\"greensward\",\"color_body\":%d,\"color_feet\":%d},\"afk\":%s}",
+				c == 0 ? "" : ",", i, c, c % 5, c * 17 % 300, -9999 + c * 100, c % 4 ? "true" : "false", c * 1000, c * 999, c % 3 ? "false" : "true");
+			Json += aClient;
+		}
+		Json += "]}}";
+	}
+	Json += "],\"servers_legacy\":[\"10.255.0.1:8303\"]}";
+	return Json;
+}
+
+// Allocations of a json document, counted through the allocator hooks of the
+// parser. Each block is prefixed with its size.
+class CJsonHeap
+{
+	static const size_t HEADER_SIZE = alignof(std::max_align_t);
+
+public:
+	int64_t m_Bytes = 0;
+	int64_t m_PeakBytes = 0;
+
+	static void *Alloc(size_t Size, int Zero, void *pUser)
+	{
+		CJsonHeap *pSelf = (CJsonHeap *)pUser;
+		char *pBlock = (char *)(Zero ? calloc(1, Size + HEADER_SIZE) : malloc(Size + HEADER_SIZE));
+		if(!pBlock)
+			return nullptr;
+		*(size_t *)pBlock = Size;
+		pSelf->m_Bytes += Size;
+		pSelf->m_PeakBytes = maximum(pSelf->m_PeakBytes, pSelf->m_Bytes);
+		return pBlock + HEADER_SIZE;
+	}
+
+	static void Free(void *pPtr, void *pUser)
+	{
+		if(!pPtr)
+			return;
+		char *pBlock = (char *)pPtr - HEADER_SIZE;
+		((CJsonHeap *)pUser)->m_Bytes -= *(size_t *)pBlock;
+		free(pBlock);
+	}
+};
+
+// how the serverlist was read before, from a document of the whole list
+static bool ParseServerListDom(const json_value &Json, std::vector<CServerInfo> *pvServers)
+{
+	const json_value &Servers = Json["servers"];
+	if(Servers.type != json_array)
+		return true;
+	for(unsigned i = 0; i < Servers.u.array.length; i++)
+	{
+		const json_value &Server = Servers[i];
+		const json_value &Addresses = Server["addresses"];
+		int Location = CServerInfo::LOC_UNKNOWN;
+		CServerInfo2 ParsedInfo;
+		if(Addresses.type != json_array || CServerInfo::ParseLocation(&Location, Server["location"]))
+			return true;
+		if(CServerInfo2::FromJson(&ParsedInfo, &Server["info"]))
+			continue;
+		CServerInfo Info = ParsedInfo;
+		Info.m_Location = Location;
+		Info.m_NumAddresses = 0;
+		for(unsigned a = 0; a < Addresses.u.array.length && Info.m_NumAddresses < MAX_SERVER_ADDRESSES; a++)
+		{
+			if(net_addr_from_url(&Info.m_aAddresses[Info.m_NumAddresses], Addresses[a], nullptr, 0) == 0)
+				Info.m_NumAddresses++;
+		}
+		pvServers->push_back(Info);
+	}
+	return false;
+}
+
+// the stream parser has no allocator hooks, its memory is taken from the
+// buffers it holds between the chunks
+class ServerListParser : public ::testing::Test
+{
+protected:
+	static int64_t ParserBytes(const CServerListParser &Parser)
+	{
+		// the open containers of the reader mirror the frames, the string
+		// token that is being read is left out
+		return sizeof(Parser) +
+		       Parser.Depth() +
+		       Parser.m_vFrames.capacity() * sizeof(int) +
+		       Parser.m_vServers.capacity() * sizeof(CServerInfo) +
+		       Parser.m_vLegacyServers.capacity() * sizeof(NETADDR);
+	}
+};
+
+TEST_F(ServerListParser, Benchmark)
+{
+	const std::string Json = GenerateServerList(2000);
+
+	// the whole body has to be kept for the document
+	CJsonHeap JsonHeap;
+	json_settings Settings = {};
+	Settings.mem_alloc = CJsonHeap::Alloc;
+	Settings.mem_free = CJsonHeap::Free;
+	Settings.user_data = &JsonHeap;
+	std::vector<CServerInfo> vDomServers;
+	int64_t Start = time_get();
+	char aError[256];
+	json_value *pJson = json_parse_ex(&Settings, Json.c_str(), Json.size(), aError);
+	ASSERT_TRUE(pJson);
+	ASSERT_FALSE(ParseServerListDom(*pJson, &vDomServers));
+	json_value_free_ex(&Settings, pJson);
+	const int64_t DomTime = time_get() - Start;
+	EXPECT_EQ(JsonHeap.m_Bytes, 0);
+	const int64_t DomOutputBytes = vDomServers.capacity() * sizeof(CServerInfo);
+	const int64_t DomPeak = Json.size() + JsonHeap.m_PeakBytes + DomOutputBytes;
+
+	// the stream is read in chunks like they arrive from curl, only the
+	// chunk that is being read is kept
+	const size_t ChunkSize = 16 * 1024;
+	std::vector<CServerInfo> vServers;
+	std::vector<NETADDR> vLegacyServers;
+	int64_t ParserPeak = 0;
+	Start = time_get();
+	{
+		CServerListParser Parser;
+		for(size_t Offset = 0; Offset < Json.size(); Offset += ChunkSize)
+		{
+			ASSERT_FALSE(Parser.Feed(Json.c_str() + Offset, minimum(ChunkSize, Json.size() - Offset)));
+			ParserPeak = maximum(ParserPeak, ParserBytes(Parser));
+		}
+		ASSERT_FALSE(Parser.Finish(&vServers, &vLegacyServers));
+	}
+	const int64_t StreamTime = time_get() - Start;
+	const int64_t StreamPeak = ChunkSize + ParserPeak;
+
+	// both include the parsed servers
+	const int64_t OutputBytes = vServers.capacity() * sizeof(CServerInfo);
+	dbg_msg("test", "parsed %d servers from %d bytes into %d bytes: document %.2fms, %d bytes peak; stream %.2fms, %d bytes peak",
+		(int)vServers.size(), (int)Json.size(), (int)OutputBytes,
+		DomTime * 1000.0 / time_freq(), (int)DomPeak,
+		StreamTime * 1000.0 / time_freq(), (int)StreamPeak);
+	EXPECT_GE(StreamPeak, OutputBytes);
+	EXPECT_LT(StreamPeak, DomPeak);
+
+	ASSERT_EQ(vServers.size(), vDomServers.size());
+	for(size_t i = 0; i < vServers.size(); i++)
+	{
+		const CServerInfo &Info = vServers[i];
+		const CServerInfo &Expected = vDomServers[i];
+		EXPECT_STREQ(Info.m_aName, Expected.m_aName);
+		EXPECT_STREQ(Info.m_aMap, Expected.m_aMap);
+		EXPECT_EQ(Info.m_Location, Expected.m_Location);
+		EXPECT_EQ(Info.m_Flags, Expected.m_Flags);
+		ASSERT_EQ(Info.m_NumAddresses, Expected.m_NumAddresses);
+		EXPECT_EQ(mem_comp(Info.m_aAddresses, Expected.m_aAddresses, Info.m_NumAddresses * sizeof(NETADDR)), 0);
+		ASSERT_EQ(Info.m_NumClients, Expected.m_NumClients);
+		EXPECT_EQ(Info.m_NumPlayers, Expected.m_NumPlayers);
+		for(int c = 0; c < Info.m_NumClients; c++)
+		{
+			EXPECT_STREQ(Info.m_aClients[c].m_aName, Expected.m_aClients[c].m_aName);
+			EXPECT_STREQ(Info.m_aClients[c].m_aSkin, Expected.m_aClients[c].m_aSkin);
+			EXPECT_EQ(Info.m_aClients[c].m_Score, Expected.m_aClients[c].m_Score);
+			EXPECT_EQ(Info.m_aClients[c].m_CustomSkinColorFeet, Expected.m_aClients[c].m_CustomSkinColorFeet);
+			EXPECT_EQ(Info.m_aClients[c].m_Afk, Expected.m_aClients[c].m_Afk);
+		}
+	}
+}
+
+class CTestFriends : public IFriends
+{
+public:
+	void Init(bool Foes) override {}
+	int NumFriends() const override { return 0; }
+	const CFriendInfo *GetFriend(int Index) const override { return nullptr; }
+	int GetFriendState(const char *pName, const char *pClan) const override { return str_comp(pName, "player7") == 0 ? FRIEND_PLAYER : FRIEND_NO; }
+	bool IsFriend(const char *pName, const char *pClan, bool PlayersOnly) const override { return GetFriendState(pName, pClan) != FRIEND_NO; }
+	void AddFriend(const char *pName, const char *pClan) override {}
+	void RemoveFriend(const char *pName, const char *pClan) override {}
+};
+
+class CTestFavorites : public IFavorites
+{
+protected:
+	void OnConfigSave(IConfigManager *pConfigManager) override {}
+
+public:
+	TRISTATE IsFavorite(const NETADDR *pAddrs, int NumAddrs) const override { return TRISTATE::NONE; }
+	TRISTATE IsPingAllowed(const NETADDR *pAddrs, int NumAddrs) const override { return TRISTATE::NONE; }
+	void Add(const NETADDR *pAddrs, int NumAddrs) override {}
+	void AllowPing(const NETADDR *pAddrs, int NumAddrs, bool AllowPing) override {}
+	void Remove(const NETADDR *pAddrs, int NumAddrs) override {}
+	void AllEntries(const CEntry **ppEntries, int *pNumEntries) override { *pNumEntries = 0; }
+};
+
+// drives the filtering and sorting of the browser without the network
+class ServerBrowserSort : public ::testing::Test
+{
+protected:
+	static const int NUM_SERVERS = 300;
+
+	CConfig m_SavedConfig;
+	CTestFriends m_Friends;
+	CTestFavorites m_Favorites;
+	CServerBrowser m_Browser;
+
+	void SetUp() override
+	{
+		m_SavedConfig = g_Config;
+		m_Browser.m_pFriends = &m_Friends;
+		m_Browser.m_pFavorites = &m_Favorites;
+		m_Browser.m_ServerlistType = IServerBrowser::TYPE_DDNET;
+		SetRankedMaps("[\"map1\", \"map4\"]");
+	}
+
+	void TearDown() override
+	{
+		g_Config = m_SavedConfig;
+	}
+
+	void SetRankedMaps(const char *pMaps)
+	{
+		char aJson[128];
+		str_format(aJson, sizeof(aJson), "{\"maps\": %s}", pMaps);
+		json_value_free(m_Browser.m_pDDNetInfo);
+		m_Browser.m_pDDNetInfo = json_parse(aJson, str_length(aJson));
+		ASSERT_TRUE(m_Browser.m_pDDNetInfo);
+		m_Browser.LoadDDNetRanks();
+	}
+
+	// the info a server sends in the given round, with many ties between
+	// the servers for every sort criterion
+	CServerInfo MakeInfo(int Server, int Round)
+	{
+		CServerInfo Info;
+		mem_zero(&Info, sizeof(Info));
+		const int Seed = Server * 7 + Round * 3;
+		str_format(Info.m_aName, sizeof(Info.m_aName), "server %d", Server % 50);
+		str_format(Info.m_aMap, sizeof(Info.m_aMap), "map%d", Seed % 6);
+		str_copy(Info.m_aGameType, Seed % 3 ? "DDraceNetwork" : "Gores");
+		Info.m_Flags = Seed % 11 == 0 ? SERVER_FLAG_PASSWORD : 0;
+		Info.m_MaxClients = MAX_CLIENTS;
+		Info.m_MaxPlayers = MAX_CLIENTS;
+		Info.m_NumClients = Seed % 13;
+		Info.m_NumPlayers = Info.m_NumClients - Seed % 2 * minimum(Info.m_NumClients, 2);
+		Info.m_NumReceivedClients = Info.m_NumClients;
+		for(int i = 0; i < Info.m_NumClients; i++)
+		{
+			CServerInfo::CClient &Client = Info.m_aClients[i];
+			if(i == 3)
+				str_copy(Client.m_aName, "(connecting)");
+			else
+				str_format(Client.m_aName, sizeof(Client.m_aName), "player%d", (Seed + i) % 17);
+			Client.m_Player = i < Info.m_NumPlayers;
+			Client.m_Score = Seed * i % 100;
+		}
+		Info.m_HasRank = m_Browser.HasRank(Info.m_aMap);
+		return Info;
+	}
+
+	void Update(int Server, int Round)
+	{
+		m_Browser.SetInfo(m_Browser.m_ppServerlist[Server], MakeInfo(Server, Round));
+	}
+
+	void SetLatency(int Server, int Latency)
+	{
+		CServerBrowser::CServerEntry *pEntry = m_Browser.m_ppServerlist[Server];
+		pEntry->m_Info.m_Latency = Latency;
+		m_Browser.MarkChanged(pEntry);
+	}
+
+	void AddServers()
+	{
+		for(int i = 0; i < NUM_SERVERS; i++)
+		{
+			NETADDR Addr;
+			char aAddr[32];
+			str_format(aAddr, sizeof(aAddr), "10.0.%d.%d:8303", i / 256, i % 256);
+			ASSERT_EQ(net_addr_from_str(&Addr, aAddr), 0);
+			m_Browser.Add(&Addr, 1);
+			Update(i, 0);
+			SetLatency(i, i * 37 % 200);
+		}
+	}
+
+	std::vector<int> SortedServers() const
+	{
+		return std::vector<int>(m_Browser.m_pSortedServerlist, m_Browser.m_pSortedServerlist + m_Browser.m_NumSortedServers);
+	}
+
+	void SortChanged()
+	{
+		m_Browser.SortChanged();
+	}
+
+	// filters all servers again, without using the cached results
+	void FullSort()
+	{
+		m_Browser.m_FilterGeneration++;
+		m_Browser.Sort();
+	}
+};
+
+TEST_F(ServerBrowserSort, IncrementalMatchesFull)
+{
+	g_Config.m_BrFilterEmpty = 1;
+	g_Config.m_BrFilterPw = 1;
+	g_Config.m_BrFilterUnfinishedMap = 1;
+	g_Config.m_BrFilterConnectingPlayers = 1;
+	g_Config.m_BrFilterSpectators = 1;
+	AddServers();
+
+	int Round = 0;
+	for(int Sort : {IServerBrowser::SORT_NAME, IServerBrowser::SORT_PING, IServerBrowser::SORT_MAP, IServerBrowser::SORT_GAMETYPE, IServerBrowser::SORT_NUMPLAYERS})
+	{
+		for(int Order = 0; Order < 2; Order++)
+		{
+			g_Config.m_BrSort = Sort;
+			g_Config.m_BrSortOrder = Order;
+			FullSort();
+
+			for(int Step = 0; Step < 4; Step++)
+			{
+				Round++;
+				for(int i = Round % 3; i < NUM_SERVERS; i += 3)
+					Update(i, Round);
+				for(int i = Round % 5; i < NUM_SERVERS; i += 5)
+					SetLatency(i, (i + Round) * 53 % 200);
+				// the ranks change without the server info changing
+				if(Step == 2)
+					SetRankedMaps(Round % 2 ? "[\"map2\"]" : "[\"map0\", \"map3\", \"map5\"]");
+
+				SortChanged();
+				const std::vector<int> vIncremental = SortedServers();
+				const int NumPlayers = m_Browser.NumSortedPlayers();
+				EXPECT_GT(vIncremental.size(), 0u);
+				EXPECT_LT(vIncremental.size(), (size_t)NUM_SERVERS);
+
+				FullSort();
+				EXPECT_EQ(vIncremental, SortedServers()) << "sort " << Sort << ", order " << Order << ", round " << Round;
+				EXPECT_EQ(NumPlayers, m_Browser.NumSortedPlayers());
+			}
+		}
+	}
+}
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/client/sound_mix.h>
+
+#include <vector>
+
+// the mixing loop as it was before it was vectorized
+static void MixVoiceReference(int *pOut, const short *pIn, int Channels, unsigned Frames, int VolumeL, int VolumeR)
+{
+	const short *pInL = pIn;
+	const short *pInR = Channels == 1 ? pIn : pIn + 1;
+	for(unsigned s = 0; s < Frames; s++)
+	{
+		*pOut++ += (*pInL) * VolumeL;
+		*pOut++ += (*pInR) * VolumeR;
+		pInL += Channels;
+		pInR += Channels;
+	}
+}
+
+static std::vector<short> GenerateSample(unsigned NumValues, unsigned Seed)
+{
+	std::vector<short> vSample(NumValues);
+	for(unsigned i = 0; i < NumValues; i++)
+		vSample[i] = (short)((i + Seed) * 2654435761u >> 16);
+	return vSample;
+}
+
+TEST(SoundMix, Voice)
+{
+	for(int Channels = 1; Channels <= 2; Channels++)
+	{
+		for(unsigned Frames : {0, 1, 3, 4, 7, 8, 9, 16, 31, 100})
+		{
+			const std::vector<short> vSample = GenerateSample(Frames * Channels, Frames);
+			std::vector<int> vExpected(Frames * 2, 1);
+			std::vector<int> vOut(Frames * 2, 1);
+			for(const auto &[VolumeL, VolumeR] : {std::pair(255, 255), std::pair(0, 37), std::pair(200, 1), std::pair(100000, 3)})
+			{
+				MixVoiceReference(vExpected.data(), vSample.data(), Channels, Frames, VolumeL, VolumeR);
+				MixVoice(vOut.data(), vSample.data(), Channels, Frames, VolumeL, VolumeR);
+				EXPECT_EQ(vOut, vExpected) << "channels " << Channels << ", frames " << Frames << ", volume " << VolumeL << " " << VolumeR;
+			}
+		}
+	}
+}
+
+TEST(SoundMix, Finish)
+{
+	const int aMix[] = {0, 256, -256, 101 * 256, 32767 * 256, -32768 * 256, 40000 * 256, -40000 * 256};
+	short aOut[std::size(aMix)];
+	MixFinish(aOut, aMix, std::size(aMix), 101);
+	const short aExpected[] = {0, 1, -1, 101, 32767, -32768, 32767, -32768};
+	for(size_t i = 0; i < std::size(aMix); i++)
+		EXPECT_EQ(aOut[i], aExpected[i]) << i;
+	MixFinish(aOut, aMix, std::size(aMix), 0);
+	for(short Value : aOut)
+		EXPECT_EQ(Value, 0);
+}
+
+TEST(SoundMix, Benchmark)
+{
+	// a busy map with many ambient sounds, mixed in the blocks of the audio device
+	const int NumVoices = 128;
+	const unsigned BlockFrames = 512;
+	const unsigned NumBlocks = 48000 / BlockFrames;
+	std::vector<std::vector<short>> vvSamples;
+	for(int i = 0; i < NumVoices; i++)
+		vvSamples.push_back(GenerateSample(BlockFrames * NumBlocks * (i % 2 + 1), i));
+
+	std::vector<int> vMix(BlockFrames * 2);
+	std::vector<int> vMixReference(BlockFrames * 2);
+	std::vector<short> vOut(BlockFrames * 2);
+	int64_t Time = 0;
+	int64_t ReferenceTime = 0;
+	for(unsigned Block = 0; Block < NumBlocks; Block++)
+	{
+		std::fill(vMix.begin(), vMix.end(), 0);
+		std::fill(vMixReference.begin(), vMixReference.end(), 0);
+
+		int64_t Start = time_get();
+		for(int i = 0; i < NumVoices; i++)
+		{
+			const int Channels = i % 2 + 1;
+			MixVoiceReference(vMixReference.data(), &vvSamples[i][Block * BlockFrames * Channels], Channels, BlockFrames, i % 256, 255 - i % 256);
+		}
+		ReferenceTime += time_get() - Start;
+
+		Start = time_get();
+		for(int i = 0; i < NumVoices; i++)
+		{
+			const int Channels = i % 2 + 1;
+			MixVoice(vMix.data(), &vvSamples[i][Block * BlockFrames * Channels], Channels, BlockFrames, i % 256, 255 - i % 256);
+		}
+		MixFinish(vOut.data(), vMix.data(), vMix.size(), 100);
+		Time += time_get() - Start;
+
+		ASSERT_EQ(vMix, vMixReference);
+	}
+
+	dbg_msg("test", "mixed %d voices for %u frames: %.2fms, per sample loop %.2fms",
+		NumVoices, BlockFrames * NumBlocks,
+		Time * 1000.0 / time_freq(), ReferenceTime * 1000.0 / time_freq());
+}
@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+
+#include <engine/server/databases/statement_cache.h>
+
+#include <memory>
+
+TEST(StatementCache, FindAdd)
+{
+	CStatementCache<int> Cache;
+	EXPECT_EQ(Cache.Find("SELECT 1"), nullptr);
+	EXPECT_EQ(*Cache.Add("SELECT 1", 1), 1);
+	EXPECT_EQ(*Cache.Add("SELECT 2", 2), 2);
+	ASSERT_NE(Cache.Find("SELECT 1"), nullptr);
+	EXPECT_EQ(*Cache.Find("SELECT 1"), 1);
+	EXPECT_EQ(*Cache.Find("SELECT 2"), 2);
+	EXPECT_EQ(Cache.Find("SELECT 3"), nullptr);
+	EXPECT_EQ(Cache.Size(), 2);
+	EXPECT_EQ(Cache.Hits(), 3);
+	EXPECT_EQ(Cache.Misses(), 2);
+
+	Cache.Clear();
+	EXPECT_EQ(Cache.Size(), 0);
+	EXPECT_EQ(Cache.Find("SELECT 1"), nullptr);
+}
+
+TEST(StatementCache, EvictLeastRecentlyUsed)
+{
+	int NumReleased = 0;
+	auto Deleter = [&](int *pStmt) {
+		NumReleased++;
+		delete pStmt;
+	};
+	typedef std::unique_ptr<int, decltype(Deleter)> CStmt;
+	CStatementCache<CStmt> Cache(2);
+	Cache.Add("a", CStmt(new int(1), Deleter));
+	Cache.Add("b", CStmt(new int(2), Deleter));
+	ASSERT_NE(Cache.Find("a"), nullptr);
+	Cache.Add("c", CStmt(new int(3), Deleter));
+	EXPECT_EQ(NumReleased, 1);
+	EXPECT_EQ(Cache.Find("b"), nullptr);
+	ASSERT_NE(Cache.Find("a"), nullptr);
+	EXPECT_EQ(**Cache.Find("c"), 3);
+	EXPECT_EQ(Cache.Size(), 2);
+
+	Cache.Clear();
+	EXPECT_EQ(NumReleased, 3);
+}
@@ -59,6 +59,11 @@ public:
 		{
 			return m_IsDirectory < Other.m_IsDirectory;
 		}
+		// nested directories before their parents
+		if(m_IsDirectory)
+		{
+			return str_comp(m_aData, Other.m_aData) > 0;
+		}
 		return str_comp(m_aData, Other.m_aData) < 0;
 	}
 };
@@ -106,7 +111,7 @@ void TestDeleteTestStorageFiles(const char *pPath)
 	str_copy(Path.m_aData, Data.m_aCurrentDir, sizeof(Path.m_aData));
 	vEntries.push_back(Path);
 
-	// Sorts directories after files.
+	// Sorts directories after files, deepest first.
 	std::sort(vEntries.begin(), vEntries.end());
 
 	// Don't delete too many files.
@@ -64,6 +64,20 @@ TEST(Thread, SemaphoreWrapperSingleThreaded)
 	EXPECT_EQ(Semaphore.GetApproximateValue(), 0);
 }
 
+TEST(Thread, SemaphoreTryWait)
+{
+	CSemaphore Semaphore;
+	EXPECT_FALSE(Semaphore.TryWait());
+	Semaphore.Signal();
+	Semaphore.Signal();
+	EXPECT_TRUE(Semaphore.TryWait());
+	EXPECT_EQ(Semaphore.GetApproximateValue(), 1);
+	EXPECT_TRUE(Semaphore.TryWait());
+	EXPECT_EQ(Semaphore.GetApproximateValue(), 0);
+	EXPECT_FALSE(Semaphore.TryWait());
+	EXPECT_EQ(Semaphore.GetApproximateValue(), 0);
+}
+
 static void SemaphoreThread(void *pUser)
 {
 	SEMAPHORE *pSemaphore = (SEMAPHORE *)pUser;